@@ -0,0 +1,35 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <chrono>
+#include <cstdio>
+
+// Medições de desempenho em bench/ (veja "make bench"). Cada medição é um
+// programa que mostra os tempos; nenhuma falha por ser lenta.
+
+static inline double Bench_Agora()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Menor tempo (ms) de "repeticoes" execuções de f(), para reduzir o ruído
+// de outras tarefas da máquina.
+template <typename Funcao>
+double Bench_Mede(int repeticoes, const Funcao& f)
+{
+    double melhor = 1e30;
+    for (int i = 0; i < repeticoes; ++i)
+    {
+        double inicio = Bench_Agora();
+        f();
+        double ms = Bench_Agora() - inicio;
+        if (ms < melhor)
+            melhor = ms;
+    }
+    return melhor;
+}
+
+// Impede que o compilador descarte um resultado não usado.
+static volatile float g_BenchSumidouro;
+
+#endif // _BENCH_H
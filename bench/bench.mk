@@ -0,0 +1,37 @@
+# Medições de desempenho, incluídas pelo Makefile de cada sistema, que
+# define BIN. Como os testes (veja "tests/tests.mk"), cada medição é um
+# programa que usa apenas os módulos de que precisa. "make bench" compila e
+# executa todas, a partir da raiz do projeto (algumas leem arquivos de
+# data/).
+
+CXXFLAGS_BENCH = -std=c++11 -Wall -Wno-unused-function -O2 -g -I ./include/ -I ./bench/
+LIBS_BENCH     = -lpthread
+
+ESTATUAS = src/statueai.cpp src/bezierpath.cpp src/lineofsight.cpp src/bvh.cpp src/fastmath.cpp src/mappedfile.cpp \
+           src/navmesh.cpp src/flowfield.cpp src/jobs.cpp src/framearena.cpp
+
+BENCHS = $(BIN)/bench/statueai_bench \
+         $(BIN)/bench/matrices_bench \
+         $(BIN)/bench/scenegraph_bench \
+         $(BIN)/bench/jobs_bench \
+         $(BIN)/bench/objparser_bench \
+         $(BIN)/bench/normals_bench \
+         $(BIN)/bench/pool_bench \
+         $(BIN)/bench/flowfield_bench
+
+$(BIN)/bench/statueai_bench: bench/statueai_bench.cpp $(ESTATUAS)
+$(BIN)/bench/matrices_bench: bench/matrices_bench.cpp src/fastmath.cpp
+$(BIN)/bench/scenegraph_bench: bench/scenegraph_bench.cpp src/scenegraph.cpp src/fastmath.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/bench/jobs_bench: bench/jobs_bench.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/bench/objparser_bench: bench/objparser_bench.cpp src/objparser.cpp src/tiny_obj_loader.cpp src/mappedfile.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/bench/normals_bench: bench/normals_bench.cpp src/normals.cpp src/tiny_obj_loader.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/bench/pool_bench: bench/pool_bench.cpp src/collisions.cpp src/bounds.cpp src/fastmath.cpp
+$(BIN)/bench/flowfield_bench: bench/flowfield_bench.cpp $(ESTATUAS)
+
+$(BENCHS): bench/bench.h include/*.h
+	mkdir -p $(BIN)/bench
+	g++ $(CXXFLAGS_BENCH) -o $@ $(filter %.cpp %.c,$^) $(LIBS_BENCH)
+
+.PHONY: bench
+bench: $(BENCHS)
+	@for b in $(BENCHS); do echo "== $$b"; ./$$b || exit 1; done
@@ -0,0 +1,186 @@
+// Multidões que fogem pelo campo de fuga ("flowfield.h") em um cenário de
+// paredes sobre um chão de 80 x 80: o cálculo completo do campo quando o
+// jogador muda de célula e StatueAI_Steer() ("statueai.h") com 200 a 5000
+// estátuas, em uma thread e com as threads de "jobs.h", em estátuas por ms.
+
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "navmesh.h"
+#include "flowfield.h"
+#include "statueai.h"
+#include "jobs.h"
+#include "bench.h"
+
+#define PAREDES    40
+#define PASSOS     120
+#define REPETICOES 5
+#define DT         (1.0f / 60.0f)
+#define CHAO       -1.0f
+
+static const size_t MULTIDOES[] = { 200, 500, 1000, 2000, 5000 };
+#define NUM_MULTIDOES (sizeof(MULTIDOES) / sizeof(MULTIDOES[0]))
+
+static float Aleatorio(float a, float b)
+{
+    return a + (b - a) * (float)std::rand() / (float)RAND_MAX;
+}
+
+// Cubo [-1, 1]^3: 8 vértices e 12 triângulos
+static const float CUBO_VERTICES[8 * 3] = { -1,-1,-1,  1,-1,-1,  -1,1,-1,  1,1,-1,  -1,-1,1,  1,-1,1,  -1,1,1,  1,1,1 };
+static const unsigned int CUBO_INDICES[12 * 3] = { 0,4,6, 0,6,2,  1,3,7, 1,7,5,  0,1,5, 0,5,4,
+                                                   2,6,7, 2,7,3,  0,2,3, 0,3,1,  4,5,7, 4,7,6 };
+
+// Paredes espalhadas, longe da origem (onde fica o jogador), como em
+// tests/zeroalloc_test.cpp, e a malha com os parâmetros de PrepareNavMesh()
+static void CriaCenario(NavMesh* navmesh, FlowField* campo)
+{
+    std::vector<glm::vec3> triangulos;
+    for (int i = 0; i < PAREDES; ++i)
+    {
+        glm::vec3 centro(Aleatorio(-35.0f, 35.0f), CHAO + 1.5f, Aleatorio(-35.0f, 35.0f));
+        if (glm::length(glm::vec2(centro.x, centro.z)) < 14.0f)
+            centro.x += centro.x < 0.0f ? -14.0f : 14.0f;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), centro)
+                        * glm::rotate(glm::mat4(1.0f), Aleatorio(0.0f, 3.14f), glm::vec3(0.0f, 1.0f, 0.0f))
+                        * glm::scale(glm::mat4(1.0f), glm::vec3(Aleatorio(1.0f, 4.0f), 1.5f, 0.3f));
+        for (int k = 0; k < 12 * 3; ++k)
+        {
+            const float* v = &CUBO_VERTICES[3 * CUBO_INDICES[k]];
+            triangulos.push_back(glm::vec3(model * glm::vec4(v[0], v[1], v[2], 1.0f)));
+        }
+    }
+
+    NavMeshParams params;
+    params.min          = glm::vec3(-40.0f, CHAO - 1.0f, -40.0f);
+    params.max          = glm::vec3( 40.0f, CHAO + 5.0f,  40.0f);
+    params.cell_size    = 0.3f;
+    params.cell_height  = 0.1f;
+    params.agent_height = 1.8f;
+    params.agent_radius = 0.4f;
+    params.agent_climb  = 0.4f;
+    params.max_slope    = 45.0f;
+
+    glm::vec3 a(params.min.x, CHAO, params.min.z), b(params.max.x, CHAO, params.min.z);
+    glm::vec3 c(params.max.x, CHAO, params.max.z), d(params.min.x, CHAO, params.max.z);
+    const glm::vec3 plano[6] = { a, c, b, a, d, c };
+    triangulos.insert(triangulos.end(), plano, plano + 6);
+
+    NavMesh_Build(navmesh, params, triangulos.data(), triangulos.size());
+    FlowField_Build(campo, *navmesh);
+}
+
+// "n" estátuas em células livres a mais de 3 m do jogador, todas fugindo
+// pelo campo
+static void CriaMultidao(StatueAI* ai, size_t n, const FlowField& campo, const glm::vec4& jogador)
+{
+    while (ai->count < n)
+    {
+        uint32_t c = (uint32_t)(std::rand() % campo.livre.size());
+        if (!campo.livre[c] || campo.distancia[c] == FLOWFIELD_NONE)
+            continue;
+        float x = campo.min_x + ((float)(c % campo.largura) + 0.5f) * campo.cell_size;
+        float z = campo.min_z + ((float)(c / campo.largura) + 0.5f) * campo.cell_size;
+        if (glm::length(glm::vec2(x - jogador.x, z - jogador.z)) < 3.0f)
+            continue;
+
+        glm::vec3 centro(x, campo.altura[c] + 0.9f, z);
+        glm::vec3 path[4] = { centro, centro, centro, centro };
+        StatueAI_Add(ai, glm::vec4(centro, 1.0f), path, -1);
+        ai->visto[ai->count - 1] = 1;
+    }
+    StatueAI_PlanEscapes(ai, NULL, &campo, 0, n, jogador);
+
+    // Já no meio da fuga, para que StatueAI_Steer() mova todas desde o
+    // primeiro passo
+    for (size_t i = 0; i < n; ++i)
+        ai->tempo_visto[i] = 4.0f;
+}
+
+// Menor tempo (ms) por passo de StatueAI_Steer(), em PASSOS passos a partir
+// de "inicial"
+static double MedeSteer(const StatueAI& inicial, const FlowField& campo, const glm::vec4& jogador, size_t* guiadas)
+{
+    const glm::vec4 visao(1.0f, 0.0f, 0.0f, 0.0f);
+    double melhor = 1e30;
+    StatueAI ai;
+    for (int r = 0; r < REPETICOES; ++r)
+    {
+        ai = inicial;
+        double total = 0.0;
+        for (int passo = 0; passo < PASSOS; ++passo)
+        {
+            StatueAI_Update(&ai, 0, ai.count, jogador, visao, DT);
+            double inicio = Bench_Agora();
+            StatueAI_Steer(&ai, campo, 0, ai.count, DT);
+            total += Bench_Agora() - inicio;
+        }
+        if (total < melhor)
+            melhor = total;
+    }
+
+    *guiadas = 0;
+    for (size_t i = 0; i < ai.count; ++i)
+        *guiadas += ai.rota[i] == STATUEAI_ROTA_CAMPO;
+    g_BenchSumidouro = ai.centro_x[0];
+    return melhor / PASSOS;
+}
+
+int main()
+{
+    std::srand(1);
+    NavMesh   navmesh;
+    FlowField campo;
+    CriaCenario(&navmesh, &campo);
+
+    // Cálculo completo, com o jogador alternando entre duas células
+    const glm::vec4 jogador(0.0f, CHAO + 1.7f, 0.0f, 1.0f);
+    int lado = 0;
+    double calculo = Bench_Mede(REPETICOES, [&]()
+    {
+        lado ^= 1;
+        FlowField_Update(&campo, glm::vec3(jogador) + glm::vec3(1.5f * lado, 0.0f, 0.0f), (size_t)-1);
+    });
+    FlowField_Update(&campo, glm::vec3(jogador), (size_t)-1);
+
+    unsigned long livres = 0, alcancaveis = 0;
+    for (size_t c = 0; c < campo.livre.size(); ++c)
+    {
+        livres      += campo.livre[c];
+        alcancaveis += campo.distancia[c] != FLOWFIELD_NONE;
+    }
+
+    StatueAI multidoes[NUM_MULTIDOES];
+    for (size_t k = 0; k < NUM_MULTIDOES; ++k)
+        CriaMultidao(&multidoes[k], MULTIDOES[k], campo, jogador);
+
+    double serial[NUM_MULTIDOES], paralelo[NUM_MULTIDOES];
+    size_t guiadas[NUM_MULTIDOES];
+    for (size_t k = 0; k < NUM_MULTIDOES; ++k)
+        serial[k] = MedeSteer(multidoes[k], campo, jogador, &guiadas[k]);
+
+    Jobs_Init();
+    unsigned int threads = Jobs_NumThreads();
+    for (size_t k = 0; k < NUM_MULTIDOES; ++k)
+        paralelo[k] = MedeSteer(multidoes[k], campo, jogador, &guiadas[k]);
+    Jobs_Shutdown();
+
+    printf("flowfield: grade de %d x %d, %lu células livres, %lu alcançáveis; %u threads.\n",
+           campo.largura, campo.profundidade, livres, alcancaveis, threads);
+    printf("  cálculo completo do campo     %8.3f ms (%.0f células/ms)\n", calculo, alcancaveis / calculo);
+    printf("  StatueAI_Steer(), por passo em %d passos:\n", PASSOS);
+    printf("                                     1 thread              %u threads\n", threads);
+    for (size_t k = 0; k < NUM_MULTIDOES; ++k)
+        printf("    %5lu estátuas (%5lu guiadas) %8.3f ms %8.0f/ms %8.3f ms %8.0f/ms\n",
+               (unsigned long)MULTIDOES[k], (unsigned long)guiadas[k],
+               serial[k], MULTIDOES[k] / serial[k], paralelo[k], MULTIDOES[k] / paralelo[k]);
+    return EXIT_SUCCESS;
+}
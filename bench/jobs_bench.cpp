@@ -0,0 +1,96 @@
+// Custo do sistema de tarefas ("jobs.h"): uma Jobs_ParallelFor() vazia,
+// criar e esperar tarefas, e um laço sobre um milhão de elementos em uma
+// thread, com Jobs_ParallelFor() e criando threads a cada chamada (como
+// antes de "jobs.h").
+
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+#include "jobs.h"
+#include "bench.h"
+
+#define ELEMENTOS  1000000
+#define TAREFAS    10000
+#define CHAMADAS   1000
+#define REPETICOES 10
+
+static void Calcula(std::vector<float>& v, size_t a, size_t b)
+{
+    for (size_t i = a; i < b; ++i)
+        v[i] = std::sqrt(v[i] * 1.0001f + 1.0f);
+}
+
+int main()
+{
+    std::vector<float> v(ELEMENTOS, 1.0f);
+
+    double serial = Bench_Mede(REPETICOES, [&]() { Calcula(v, 0, ELEMENTOS); });
+
+    Jobs_Init();
+    unsigned int threads = Jobs_NumThreads();
+
+    double paralelo = Bench_Mede(REPETICOES, [&]()
+    {
+        Jobs_ParallelFor(0, ELEMENTOS, 4096, [&v](size_t a, size_t b) { Calcula(v, a, b); });
+    });
+
+    // Uma std::thread por faixa, criada e terminada a cada chamada
+    double com_threads = Bench_Mede(REPETICOES, [&]()
+    {
+        std::vector<std::thread> grupo;
+        size_t tamanho = (ELEMENTOS + threads - 1) / threads;
+        for (size_t a = tamanho; a < ELEMENTOS; a += tamanho)
+            grupo.push_back(std::thread(Calcula, std::ref(v), a, std::min(a + tamanho, (size_t)ELEMENTOS)));
+        Calcula(v, 0, tamanho);
+        for (size_t i = 0; i < grupo.size(); ++i)
+            grupo[i].join();
+    });
+
+    // Só o custo de dividir, distribuir e esperar
+    double vazio = Bench_Mede(REPETICOES, [&]()
+    {
+        for (int k = 0; k < CHAMADAS; ++k)
+            Jobs_ParallelFor(0, 64, 1, [](size_t, size_t) {});
+    });
+
+    double tarefas = Bench_Mede(REPETICOES, [&]()
+    {
+        for (int k = 0; k < TAREFAS; ++k)
+        {
+            Job* job = Jobs_Create([]() {});
+            Jobs_Run(job);
+            Jobs_Wait(job);
+        }
+    });
+
+    double filhas = Bench_Mede(REPETICOES, [&]()
+    {
+        Job* raiz = Jobs_Create(JobFunction());
+        for (int k = 0; k < TAREFAS; ++k)
+        {
+            Job* filha = Jobs_Create([]() {}, raiz);
+            Jobs_Run(filha);
+            Jobs_Release(filha);
+        }
+        Jobs_Run(raiz);
+        Jobs_Wait(raiz);
+    });
+
+    JobStats stats = Jobs_Stats();
+    Jobs_Shutdown();
+
+    g_BenchSumidouro = v[ELEMENTOS / 2];
+
+    printf("jobs: %u threads (%lu tarefas executadas, %lu roubadas).\n", threads, stats.jobs, stats.stolen);
+    printf("  %d elementos:\n", ELEMENTOS);
+    printf("    1 thread                            %8.3f ms\n", serial);
+    printf("    Jobs_ParallelFor()                  %8.3f ms\n", paralelo);
+    printf("    std::thread por chamada             %8.3f ms\n", com_threads);
+    printf("  Jobs_ParallelFor() vazia, 64 elementos %8.3f us\n", vazio * 1000.0 / CHAMADAS);
+    printf("  Jobs_Create(), Jobs_Run(), Jobs_Wait() %8.3f us\n", tarefas * 1000.0 / TAREFAS);
+    printf("  %d filhas de uma tarefa, cada uma   %8.3f us\n", TAREFAS, filhas * 1000.0 / TAREFAS);
+    return EXIT_SUCCESS;
+}
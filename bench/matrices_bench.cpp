@@ -0,0 +1,219 @@
+// Operações de matrizes e vetores: as funções de "matrices.h", as de GLM e
+// as de "fastmath.h" (SSE), um milhão de chamadas cada, sobre entradas
+// variadas para que o compilador não calcule os resultados de antemão.
+
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "matrices.h"
+#include "fastmath.h"
+#include "bench.h"
+
+#define OPERACOES  1000000
+#define ENTRADAS   4096 // Potência de dois
+#define REPETICOES 5
+
+static float Aleatorio(float a, float b)
+{
+    return a + (b - a) * (float)std::rand() / (float)RAND_MAX;
+}
+
+// Tempos (ms) de uma operação; negativo quando a implementação não existe.
+static void Mostra(const char* operacao, double matrices, double glm, double fastmath)
+{
+    // Alinhado pelo número de caracteres, não de bytes (UTF-8)
+    int caracteres = 0;
+    for (const char* c = operacao; *c; ++c)
+        caracteres += (*c & 0xC0) != 0x80;
+    printf("  %s%*s", operacao, std::max(22 - caracteres, 0), "");
+    const double tempos[3] = { matrices, glm, fastmath };
+    for (int k = 0; k < 3; ++k)
+        if (tempos[k] < 0.0)
+            printf(" %12s", "-");
+        else
+            printf(" %9.3f ms", tempos[k]);
+    printf("\n");
+}
+
+int main()
+{
+    // Matrizes afins (rotação, escala e translação, como as dos modelos) e
+    // pontos de w = 1 e vetores de w = 0
+    std::srand(1);
+    std::vector<glm::mat4> matrizes(ENTRADAS);
+    std::vector<glm::vec4> pontos(ENTRADAS), vetores(ENTRADAS), eixos(ENTRADAS);
+    std::vector<float>     angulos(ENTRADAS);
+    std::vector<glm::vec3> minimos(ENTRADAS), maximos(ENTRADAS), pontos3(ENTRADAS);
+    for (size_t i = 0; i < ENTRADAS; ++i)
+    {
+        angulos[i] = Aleatorio(0.0f, 6.28f);
+        eixos[i]   = glm::vec4(Aleatorio(-1.0f, 1.0f), Aleatorio(0.1f, 1.0f), Aleatorio(-1.0f, 1.0f), 0.0f);
+        matrizes[i] = Matrix_Translate(Aleatorio(-50.0f, 50.0f), Aleatorio(-5.0f, 5.0f), Aleatorio(-50.0f, 50.0f))
+                    * Matrix_Rotate(angulos[i], eixos[i])
+                    * Matrix_Scale(Aleatorio(0.5f, 2.0f), Aleatorio(0.5f, 2.0f), Aleatorio(0.5f, 2.0f));
+        pontos[i]  = glm::vec4(Aleatorio(-10.0f, 10.0f), Aleatorio(-10.0f, 10.0f), Aleatorio(-10.0f, 10.0f), 1.0f);
+        vetores[i] = glm::vec4(Aleatorio(-1.0f, 1.0f), Aleatorio(-1.0f, 1.0f), Aleatorio(-1.0f, 1.0f), 0.0f);
+        pontos3[i] = glm::vec3(pontos[i]);
+        minimos[i] = glm::vec3(Aleatorio(-2.0f, 0.0f), Aleatorio(-2.0f, 0.0f), Aleatorio(-2.0f, 0.0f));
+        maximos[i] = minimos[i] + glm::vec3(Aleatorio(0.1f, 4.0f), Aleatorio(0.1f, 4.0f), Aleatorio(0.1f, 4.0f));
+    }
+    const size_t M = ENTRADAS - 1;
+
+    glm::mat4 soma_m(0.0f);
+    glm::vec4 soma_v(0.0f);
+    float     soma_f = 0.0f;
+
+    printf("matrices: %d operações de cada.\n", OPERACOES);
+    printf("  %-25s%12s %12s %12s\n", "operação", "matrices.h", "glm", "fastmath.h");
+
+    // Produto 4x4: "matrices.h" usa o operador de GLM
+    double produto_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_m += matrizes[i & M] * matrizes[(i + 1) & M];
+    });
+    double produto_fast = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_m += FastMath_Multiply(matrizes[i & M], matrizes[(i + 1) & M]);
+    });
+    Mostra("produto 4x4", -1.0, produto_glm, produto_fast);
+
+    double inversa_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_m += glm::inverse(matrizes[i & M]);
+    });
+    double inversa_fast = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_m += FastMath_AffineInverse(matrizes[i & M]);
+    });
+    Mostra("inversa (afim)", -1.0, inversa_glm, inversa_fast);
+
+    // Pontos: ENTRADAS por matriz
+    std::vector<glm::vec3> transformados(ENTRADAS);
+    double pontos_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; i += ENTRADAS)
+        {
+            const glm::mat4& m = matrizes[(i / ENTRADAS) & M];
+            for (size_t j = 0; j < ENTRADAS; ++j)
+                transformados[j] = glm::vec3(m * glm::vec4(pontos3[j], 1.0f));
+            soma_v += glm::vec4(transformados[(i / ENTRADAS) & M], 0.0f);
+        }
+    });
+    double pontos_fast = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; i += ENTRADAS)
+        {
+            FastMath_TransformPoints(matrizes[(i / ENTRADAS) & M], pontos3.data(), transformados.data(), ENTRADAS);
+            soma_v += glm::vec4(transformados[(i / ENTRADAS) & M], 0.0f);
+        }
+    });
+    Mostra("transformar pontos", -1.0, pontos_glm, pontos_fast);
+
+    // Caixas: os oito cantos, como antes de "fastmath.h", contra o método de Arvo
+    double caixa_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+        {
+            const glm::mat4& m = matrizes[i & M];
+            const glm::vec3& a = minimos[i & M];
+            const glm::vec3& b = maximos[i & M];
+            glm::vec3 menor(1e30f), maior(-1e30f);
+            for (int k = 0; k < 8; ++k)
+            {
+                glm::vec3 canto = glm::vec3(m * glm::vec4(k & 1 ? b.x : a.x, k & 2 ? b.y : a.y, k & 4 ? b.z : a.z, 1.0f));
+                menor = glm::min(menor, canto);
+                maior = glm::max(maior, canto);
+            }
+            soma_v += glm::vec4(maior - menor, 0.0f);
+        }
+    });
+    double caixa_fast = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+        {
+            glm::vec3 menor, maior;
+            FastMath_TransformAABB(matrizes[i & M], minimos[i & M], maximos[i & M], &menor, &maior);
+            soma_v += glm::vec4(maior - menor, 0.0f);
+        }
+    });
+    Mostra("caixa (AABB)", -1.0, caixa_glm, caixa_fast);
+
+    double escalar_mat = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_f += dotproduct(vetores[i & M], vetores[(i + 1) & M]);
+    });
+    double escalar_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_f += glm::dot(vetores[i & M], vetores[(i + 1) & M]);
+    });
+    Mostra("produto escalar", escalar_mat, escalar_glm, -1.0);
+
+    double vetorial_mat = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_v += crossproduct(vetores[i & M], vetores[(i + 1) & M]);
+    });
+    double vetorial_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_v += glm::vec4(glm::cross(glm::vec3(vetores[i & M]), glm::vec3(vetores[(i + 1) & M])), 0.0f);
+    });
+    Mostra("produto vetorial", vetorial_mat, vetorial_glm, -1.0);
+
+    double norma_mat = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_f += norm(vetores[i & M]);
+    });
+    double norma_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_f += glm::length(vetores[i & M]);
+    });
+    Mostra("norma", norma_mat, norma_glm, -1.0);
+
+    double rotacao_mat = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_m += Matrix_Rotate(angulos[i & M], eixos[i & M]);
+    });
+    double rotacao_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_m += glm::rotate(glm::mat4(1.0f), angulos[i & M], glm::vec3(eixos[i & M]));
+    });
+    Mostra("rotação", rotacao_mat, rotacao_glm, -1.0);
+
+    const glm::vec4 up(0.0f, 1.0f, 0.0f, 0.0f);
+    double camera_mat = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+            soma_m += Matrix_Camera_View(pontos[i & M], vetores[i & M], up);
+    });
+    double camera_glm = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < OPERACOES; ++i)
+        {
+            glm::vec3 olho(pontos[i & M]);
+            soma_m += glm::lookAt(olho, olho + glm::vec3(vetores[i & M]), glm::vec3(up));
+        }
+    });
+    Mostra("câmera", camera_mat, camera_glm, -1.0);
+
+    g_BenchSumidouro = soma_m[3][0] + soma_v.x + soma_f;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+// Cálculo de normais ("normals.h") em data/snowglobe.obj e
+// data/iso_flat1piece.obj: o ComputeNormals() anterior (média por vértice
+// com glm::vec4) e Normals_Compute() nos quatro modos, com e sem as
+// threads de "jobs.h".
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <glm/vec4.hpp>
+
+#include "matrices.h"
+#include "tiny_obj_loader.h"
+#include "normals.h"
+#include "jobs.h"
+#include "bench.h"
+
+#define REPETICOES 20
+#define VINCO      1.0f // Radianos, como um modelo com arestas vivas
+
+static const char* MODELOS[] = { "data/snowglobe.obj", "data/iso_flat1piece.obj" };
+
+#define MODOS 4
+static const NormalsWeight PESOS[MODOS]  = { NORMALS_AREA, NORMALS_AREA, NORMALS_ANGLE, NORMALS_ANGLE };
+static const float         VINCOS[MODOS] = { NORMALS_NO_CREASE, VINCO, NORMALS_NO_CREASE, VINCO };
+static const char*         NOMES[MODOS]  = { "área              ", "área, vinco       ",
+                                             "ângulo            ", "ângulo, vinco     " };
+
+// O ComputeNormals() de main.cpp antes de "normals.h"
+static void NormaisAntigas(const std::vector<float>& posicoes, const std::vector<uint32_t>& indices, std::vector<float>& normals)
+{
+    size_t num_vertices = posicoes.size() / 3;
+
+    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
+    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+
+    for (size_t triangle = 0; 3*triangle + 2 < indices.size(); ++triangle)
+    {
+        glm::vec4  vertices[3];
+        for (size_t vertex = 0; vertex < 3; ++vertex)
+        {
+            uint32_t idx = indices[3*triangle + vertex];
+            vertices[vertex] = glm::vec4(posicoes[3*idx + 0], posicoes[3*idx + 1], posicoes[3*idx + 2], 1.0);
+        }
+
+        const glm::vec4  n = crossproduct(vertices[1]-vertices[0],vertices[2]-vertices[0]);
+
+        for (size_t vertex = 0; vertex < 3; ++vertex)
+        {
+            uint32_t idx = indices[3*triangle + vertex];
+            num_triangles_per_vertex[idx] += 1;
+            vertex_normals[idx] += n;
+        }
+    }
+
+    normals.resize(3*num_vertices);
+    for (size_t i = 0; i < vertex_normals.size(); ++i)
+    {
+        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
+        n /= norm(n);
+        normals[3*i + 0] = n.x;
+        normals[3*i + 1] = n.y;
+        normals[3*i + 2] = n.z;
+    }
+}
+
+int main()
+{
+    const size_t modelos = sizeof(MODELOS) / sizeof(MODELOS[0]);
+    std::vector<std::vector<float> >    posicoes(modelos);
+    std::vector<std::vector<uint32_t> > indices(modelos);
+    for (size_t i = 0; i < modelos; ++i)
+    {
+        tinyobj::attrib_t                attrib;
+        std::vector<tinyobj::shape_t>    shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string                      err;
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, MODELOS[i], "data/", true))
+        {
+            fprintf(stderr, "ERROR: não foi possível ler \"%s\" (execute a partir da raiz do projeto).\n", MODELOS[i]);
+            std::exit(EXIT_FAILURE);
+        }
+        posicoes[i] = attrib.vertices;
+        for (size_t shape = 0; shape < shapes.size(); ++shape)
+            for (size_t k = 0; k < shapes[shape].mesh.indices.size(); ++k)
+                indices[i].push_back(shapes[shape].mesh.indices[k].vertex_index);
+    }
+
+    std::vector<float> normais;
+    double antigo[modelos], serial[modelos][MODOS], paralelo[modelos][MODOS];
+    for (size_t i = 0; i < modelos; ++i)
+    {
+        antigo[i] = Bench_Mede(REPETICOES, [&]() { NormaisAntigas(posicoes[i], indices[i], normais); });
+        normais.resize(3 * indices[i].size());
+        for (int modo = 0; modo < MODOS; ++modo)
+            serial[i][modo] = Bench_Mede(REPETICOES, [&]()
+            {
+                Normals_Compute(posicoes[i].data(), 3, posicoes[i].size() / 3, indices[i].data(), indices[i].size(),
+                                normais.data(), 3, PESOS[modo], VINCOS[modo]);
+            });
+    }
+
+    Jobs_Init();
+    unsigned int threads = Jobs_NumThreads();
+    for (size_t i = 0; i < modelos; ++i)
+    {
+        normais.resize(3 * indices[i].size());
+        for (int modo = 0; modo < MODOS; ++modo)
+            paralelo[i][modo] = Bench_Mede(REPETICOES, [&]()
+            {
+                Normals_Compute(posicoes[i].data(), 3, posicoes[i].size() / 3, indices[i].data(), indices[i].size(),
+                                normais.data(), 3, PESOS[modo], VINCOS[modo]);
+            });
+    }
+    Jobs_Shutdown();
+
+    g_BenchSumidouro = normais[0];
+
+    printf("normals: %u threads, vinco de %.1f radianos.\n", threads, VINCO);
+    for (size_t i = 0; i < modelos; ++i)
+    {
+        printf("  %s (%lu vértices, %lu triângulos):\n", MODELOS[i],
+               (unsigned long)(posicoes[i].size() / 3), (unsigned long)(indices[i].size() / 3));
+        printf("                        1 thread   %u threads\n", threads);
+        printf("    ComputeNormals()    %8.3f ms\n", antigo[i]);
+        for (int modo = 0; modo < MODOS; ++modo)
+            printf("    %s  %8.3f ms %8.3f ms\n", NOMES[modo], serial[i][modo], paralelo[i][modo]);
+    }
+    return EXIT_SUCCESS;
+}
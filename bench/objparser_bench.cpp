@@ -0,0 +1,293 @@
+// Velocidade de leitura (MB/s) dos modelos de data/: tinyobj::LoadObj()
+// contra ObjParser_Load() ("objparser.h") em uma thread e com as threads de
+// "jobs.h", e a contagem de ObjParser_Count().
+//
+// Também o pico de memória residente (getrusage(), ru_maxrss) de carregar
+// cada modelo, e uma grade sintética grande sem normais, até os vetores
+// prontos para a GPU, pelos dois caminhos de main.cpp: antes, ObjModel
+// (tinyobj::LoadObj()) seguido da cópia de PrepareTriangles(); depois, a
+// leitura em fluxo de PrepareTrianglesFromFile(), que reserva os vetores
+// com ObjParser_Count() e escreve neles a partir dos callbacks de
+// ObjParser_LoadWithCallback(). O cálculo de normais de arquivos sem "vn"
+// fica de fora nos dois. Cada leitura é feita em um processo filho, cujo
+// pico é descontado do de um filho que não faz nada.
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "objparser.h"
+#include "jobs.h"
+#include "bench.h"
+
+#define REPETICOES 5
+#define GRADE      700 // Vértices por lado da grade sintética (cerca de 25 MB de OBJ)
+
+static const char* MODELOS[] = { "data/snowglobe.obj", "data/iso_flat.obj", "data/revolver.obj", "data/statue.obj" };
+
+static double TamanhoMB(const char* arquivo)
+{
+    FILE* f = fopen(arquivo, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "ERROR: não foi possível abrir \"%s\" (execute a partir da raiz do projeto).\n", arquivo);
+        std::exit(EXIT_FAILURE);
+    }
+    fseek(f, 0, SEEK_END);
+    double mb = ftell(f) / 1048576.0;
+    fclose(f);
+    return mb;
+}
+
+// Menor tempo de leitura de "arquivo" com tinyobj (true) ou com ObjParser_Load()
+static double Le(const char* arquivo, bool tinyobj)
+{
+    return Bench_Mede(REPETICOES, [arquivo, tinyobj]()
+    {
+        tinyobj::attrib_t                attrib;
+        std::vector<tinyobj::shape_t>    shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string                      err;
+        if (tinyobj)
+            tinyobj::LoadObj(&attrib, &shapes, &materials, &err, arquivo, "data/");
+        else
+            ObjParser_Load(&attrib, &shapes, &materials, &err, arquivo, "data/");
+        g_BenchSumidouro = attrib.vertices.empty() ? 0.0f : attrib.vertices[0];
+    });
+}
+
+// Vetores de MalhaPreparada (main.cpp) que vão para a GPU
+struct Malha
+{
+    std::vector<uint32_t> indices;
+    std::vector<float>    posicoes;  // 4 por quina
+    std::vector<float>    normais;   // 4 por quina
+    std::vector<float>    texcoords; // 2 por quina
+};
+
+// Uma quina de triângulo, com os índices já convertidos para a lista (-1 =
+// ausente)
+static void Quina(Malha* malha, const float* v, const float* vn, const float* vt)
+{
+    malha->indices.push_back((uint32_t)malha->indices.size());
+    malha->posicoes.insert(malha->posicoes.end(), v, v + 3);
+    malha->posicoes.push_back(1.0f);
+    if (vn != NULL)
+    {
+        malha->normais.insert(malha->normais.end(), vn, vn + 3);
+        malha->normais.push_back(0.0f);
+    }
+    if (vt != NULL)
+        malha->texcoords.insert(malha->texcoords.end(), vt, vt + 2);
+}
+
+// Antes: ObjModel e a cópia de PrepareTriangles()
+static void CarregaAntes(const char* arquivo)
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      err;
+    tinyobj::LoadObj(&attrib, &shapes, &materials, &err, arquivo, "data/");
+
+    Malha malha;
+    for (size_t s = 0; s < shapes.size(); ++s)
+        for (size_t k = 0; k < shapes[s].mesh.indices.size(); ++k)
+        {
+            const tinyobj::index_t& idx = shapes[s].mesh.indices[k];
+            Quina(&malha, &attrib.vertices[3 * idx.vertex_index],
+                  idx.normal_index != -1 ? &attrib.normals[3 * idx.normal_index] : NULL,
+                  idx.texcoord_index != -1 ? &attrib.texcoords[2 * idx.texcoord_index] : NULL);
+        }
+    g_BenchSumidouro = (float)malha.indices.size();
+}
+
+// Depois: as listas do arquivo e os vetores da malha, reservados pela
+// contagem, preenchidos pelos callbacks
+struct Fluxo
+{
+    std::vector<float> v, vn, vt;
+    Malha              malha;
+};
+
+static const float* Elemento(const std::vector<float>& lista, int indice, int componentes)
+{
+    size_t n = lista.size() / componentes;
+    int i = indice > 0 ? indice - 1 : (int)n + indice;
+    return indice != 0 && i >= 0 && (size_t)i < n ? &lista[(size_t)i * componentes] : NULL;
+}
+
+static void FluxoV(void* f, float x, float y, float z, float)
+{
+    std::vector<float>& v = ((Fluxo*)f)->v;
+    v.push_back(x); v.push_back(y); v.push_back(z);
+}
+
+static void FluxoVN(void* f, float x, float y, float z)
+{
+    std::vector<float>& vn = ((Fluxo*)f)->vn;
+    vn.push_back(x); vn.push_back(y); vn.push_back(z);
+}
+
+static void FluxoVT(void* f, float u, float v, float)
+{
+    std::vector<float>& vt = ((Fluxo*)f)->vt;
+    vt.push_back(u); vt.push_back(v);
+}
+
+static void FluxoFace(void* f, tinyobj::index_t* indices, int num_indices)
+{
+    Fluxo* fluxo = (Fluxo*)f;
+    for (int k = 1; k + 1 < num_indices; ++k)
+    {
+        const tinyobj::index_t quinas[3] = { indices[0], indices[k], indices[k + 1] };
+        for (int q = 0; q < 3; ++q)
+        {
+            const float* v = Elemento(fluxo->v, quinas[q].vertex_index, 3);
+            if (v != NULL)
+                Quina(&fluxo->malha, v, Elemento(fluxo->vn, quinas[q].normal_index, 3),
+                      Elemento(fluxo->vt, quinas[q].texcoord_index, 2));
+        }
+    }
+}
+
+static void CarregaEmFluxo(const char* arquivo)
+{
+    Fluxo fluxo;
+    ObjParserCounts contagem;
+    if (ObjParser_Count(arquivo, &contagem))
+    {
+        size_t quinas = 3 * contagem.triangles;
+        fluxo.v.reserve(3 * contagem.vertices);
+        fluxo.vn.reserve(3 * contagem.normals);
+        fluxo.vt.reserve(2 * contagem.texcoords);
+        fluxo.malha.indices.reserve(quinas);
+        fluxo.malha.posicoes.reserve(4 * quinas);
+        fluxo.malha.normais.reserve(4 * quinas);
+        if (contagem.texcoords > 0)
+            fluxo.malha.texcoords.reserve(2 * quinas);
+    }
+
+    tinyobj::callback_t callback;
+    callback.vertex_cb   = FluxoV;
+    callback.normal_cb   = FluxoVN;
+    callback.texcoord_cb = FluxoVT;
+    callback.index_cb    = FluxoFace;
+    ObjParser_LoadWithCallback(arquivo, callback, &fluxo);
+    g_BenchSumidouro = (float)fluxo.malha.indices.size();
+}
+
+// Pico de memória residente (MB) de um processo filho que executa f()
+template <typename Funcao>
+static double PicoMB(const Funcao& f)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        f();
+        _exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    struct rusage uso;
+    if (pid < 0 || wait4(pid, &status, 0, &uso) != pid)
+    {
+        fprintf(stderr, "ERROR: não foi possível medir a memória de um processo filho.\n");
+        std::exit(EXIT_FAILURE);
+    }
+#ifdef __APPLE__
+    return uso.ru_maxrss / 1048576.0; // Bytes
+#else
+    return uso.ru_maxrss / 1024.0;    // KB
+#endif
+}
+
+// Grade de GRADE x GRADE vértices em quadriláteros, sem normais nem
+// coordenadas de textura
+static std::string CriaGrade()
+{
+    char nome[] = "/tmp/objparser_benchXXXXXX";
+    int fd = mkstemp(nome);
+    FILE* f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (f == NULL)
+    {
+        fprintf(stderr, "ERROR: não foi possível criar a grade sintética.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    fprintf(f, "o grade\n");
+    for (int z = 0; z < GRADE; ++z)
+        for (int x = 0; x < GRADE; ++x)
+            fprintf(f, "v %.4f %.4f %.4f\n", x * 0.1f, 0.01f * ((x * 7 + z * 13) % 17), z * 0.1f);
+    for (int z = 0; z + 1 < GRADE; ++z)
+        for (int x = 0; x + 1 < GRADE; ++x)
+        {
+            int a = z * GRADE + x + 1;
+            fprintf(f, "f %d %d %d %d\n", a, a + GRADE, a + GRADE + 1, a + 1);
+        }
+    fclose(f);
+    return nome;
+}
+
+int main()
+{
+    const size_t modelos = sizeof(MODELOS) / sizeof(MODELOS[0]);
+
+    // Antes de Jobs_Init(): os filhos de fork() não herdam as threads
+    std::string grade = CriaGrade();
+    std::vector<std::string> arquivos(MODELOS, MODELOS + modelos);
+    arquivos.push_back(grade);
+    std::vector<double> pico_antes(arquivos.size()), pico_fluxo(arquivos.size());
+    double base = PicoMB([]() {});
+    for (size_t i = 0; i < arquivos.size(); ++i)
+    {
+        const char* arquivo = arquivos[i].c_str();
+        pico_antes[i] = PicoMB([arquivo]() { CarregaAntes(arquivo); }) - base;
+        pico_fluxo[i] = PicoMB([arquivo]() { CarregaEmFluxo(arquivo); }) - base;
+    }
+    std::vector<double> tinyobj(modelos), uma_thread(modelos), varias_threads(modelos), contagem(modelos);
+
+    for (size_t i = 0; i < modelos; ++i)
+    {
+        tinyobj[i]    = Le(MODELOS[i], true);
+        uma_thread[i] = Le(MODELOS[i], false);
+    }
+
+    Jobs_Init();
+    unsigned int threads = Jobs_NumThreads();
+    for (size_t i = 0; i < modelos; ++i)
+    {
+        varias_threads[i] = Le(MODELOS[i], false);
+        contagem[i] = Bench_Mede(REPETICOES, [i]()
+        {
+            ObjParserCounts counts;
+            ObjParser_Count(MODELOS[i], &counts);
+            g_BenchSumidouro = (float)counts.triangles;
+        });
+    }
+    Jobs_Shutdown();
+
+    printf("objparser: MB/s, pedaços de %lu KB, %u threads.\n", (unsigned long)(g_ObjParserChunkSize / 1024), threads);
+    printf("  %-22s %8s %10s %10s %10s %10s\n", "modelo", "MB", "tinyobj", "1 thread", "threads", "contagem");
+    for (size_t i = 0; i < modelos; ++i)
+    {
+        double mb = TamanhoMB(MODELOS[i]);
+        printf("  %-22s %8.2f %10.1f %10.1f %10.1f %10.1f\n", MODELOS[i], mb,
+               mb / (tinyobj[i] / 1000.0), mb / (uma_thread[i] / 1000.0),
+               mb / (varias_threads[i] / 1000.0), mb / (contagem[i] / 1000.0));
+    }
+
+    printf("  pico de memória residente até os vetores da GPU, MB acima de %.1f MB:\n", base);
+    printf("  %-22s %8s %10s %10s\n", "modelo", "MB", "antes", "em fluxo");
+    for (size_t i = 0; i < arquivos.size(); ++i)
+        printf("  %-22s %8.2f %10.1f %10.1f\n", i < modelos ? MODELOS[i] : "grade sintética",
+               TamanhoMB(arquivos[i].c_str()), pico_antes[i], pico_fluxo[i]);
+
+    std::remove(grade.c_str());
+    return EXIT_SUCCESS;
+}
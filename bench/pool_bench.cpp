@@ -0,0 +1,199 @@
+// Colisores em Pool ("pool.h") e no formato anterior, um
+// std::unordered_map<std::string, std::vector<Cubo_Collision>> com o nome
+// do objeto repetido em cada colisor, com um milhão de colisores: o
+// ShootRay() de cada versão, liberar e recarregar uma célula do mundo e
+// remover e adicionar colisores avulsos.
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#include "collisions.h"
+#include "bench.h"
+
+#define COLISORES  1000000
+#define CELULAS    64
+#define REPETICOES 10
+#define ERASES     10     // vector::erase() no meio de um milhão é lento demais para mais
+#define AVULSOS    100000
+
+static const char* NOMES[] = { "statue", "wall", "floor", "cow" };
+
+// O colisor de main.cpp antes de "pool.h"
+struct Cubo_Collision
+{
+    Cubo cube;
+    bool colide;
+    glm::mat4 Matrix_Model;
+    std::string objName;
+    glm::vec3 Ka;
+    glm::vec3 Kd;
+    glm::vec3 Ks;
+    glm::vec3 Ke;
+    int celula;
+    WorldBounds limites;
+    int no;
+};
+
+typedef std::unordered_map<std::string, std::vector<Cubo_Collision> > ColisoresAntigos;
+
+static const WorldBounds& LimitesAntigos(Cubo_Collision* c)
+{
+    Bounds_Update(&c->limites, c->Matrix_Model, glm::vec3(c->cube.vert_min), glm::vec3(c->cube.vert_max));
+    return c->limites;
+}
+
+static void ShootRayAntigo(ColisoresAntigos& cubos, const Raio& ray)
+{
+    for(auto& c: cubos)
+        for(auto& v: c.second)
+        {
+            if(v.objName != "statue") continue;
+            const WorldBounds& limites = LimitesAntigos(&v);
+            Cubo temp {glm::vec4(limites.min, 1.0f), glm::vec4(limites.max, 1.0f)};
+            v.colide = (collision(ray, temp) || v.colide);
+        }
+}
+
+static const WorldBounds& LimitesDoColisor(CubosColisores* cubos, size_t i)
+{
+    WorldBounds* limites = &cubos->quente[i].limites;
+    if (limites->sujo)
+    {
+        const CuboFrio& c = cubos->fria[i];
+        Bounds_Update(limites, c.Matrix_Model, glm::vec3(c.cube.vert_min), glm::vec3(c.cube.vert_max));
+    }
+    return *limites;
+}
+
+static void ShootRay(std::unordered_map<std::string, CubosColisores>& cubos, const Raio& ray)
+{
+    CubosColisores& estatuas = cubos["statue"];
+    for(size_t i = 0; i < Pool_Size(estatuas); i++)
+    {
+        const WorldBounds& limites = LimitesDoColisor(&estatuas, i);
+        Cubo temp {glm::vec4(limites.min, 1.0f), glm::vec4(limites.max, 1.0f)};
+        estatuas.quente[i].colide = (collision(ray, temp) || estatuas.quente[i].colide);
+    }
+}
+
+int main()
+{
+    const size_t nomes = sizeof(NOMES) / sizeof(NOMES[0]);
+
+    // Metade estátuas; o resto dividido entre os outros nomes
+    std::mt19937 gerador(1);
+    std::uniform_real_distribution<float> posicao(-500.0f, 500.0f);
+    std::vector<Cubo_Collision> todos(COLISORES);
+    for (size_t i = 0; i < COLISORES; ++i)
+    {
+        Cubo_Collision& c = todos[i];
+        glm::vec4 centro(posicao(gerador), posicao(gerador), posicao(gerador), 0.0f);
+        c.cube.vert_min   = centro + glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f);
+        c.cube.vert_max   = centro + glm::vec4( 1.0f,  1.0f,  1.0f, 1.0f);
+        c.colide          = false;
+        c.Matrix_Model    = glm::mat4(1.0f);
+        c.objName         = NOMES[i % 2 == 0 ? 0 : 1 + (i / 2) % (nomes - 1)];
+        c.Ka = c.Kd = c.Ks = c.Ke = glm::vec3(0.5f);
+        c.celula          = (int)(i % CELULAS);
+        c.limites.sujo    = true;
+        c.no              = (int)i;
+        LimitesAntigos(&c);
+    }
+
+    ColisoresAntigos antigos;
+    std::unordered_map<std::string, CubosColisores> pools;
+    std::vector<PoolHandle> handles;
+    for (size_t k = 0; k < nomes; ++k)
+        Pool_Reserve(&pools[NOMES[k]], COLISORES);
+    for (size_t i = 0; i < COLISORES; ++i)
+    {
+        const Cubo_Collision& c = todos[i];
+        antigos[c.objName].push_back(c);
+
+        CuboQuente quente = { c.limites, c.no, false };
+        CuboFrio   fria   = { c.cube, c.Matrix_Model, c.Ka, c.Kd, c.Ks, c.Ke, c.celula };
+        PoolHandle h = Pool_Add(&pools[c.objName], quente, fria);
+        if (c.objName == "statue")
+            handles.push_back(h);
+    }
+
+    Raio ray;
+    ray.origem = glm::vec4(-600.0f, 0.0f, 0.0f, 1.0f);
+    ray.dir    = glm::vec4(1.0f, 0.001f, 0.0007f, 0.0f);
+
+    double tiro_antigo = Bench_Mede(REPETICOES, [&]() { ShootRayAntigo(antigos, ray); });
+    double tiro_pool   = Bench_Mede(REPETICOES, [&]() { ShootRay(pools, ray); });
+
+    // Libera a célula 0 (como RemoveColisoresDaCelula()) e a carrega de novo
+    std::vector<Cubo_Collision> celula;
+    for (size_t i = 0; i < COLISORES; ++i)
+        if (todos[i].celula == 0)
+            celula.push_back(todos[i]);
+
+    double celula_antiga = Bench_Mede(REPETICOES, [&]()
+    {
+        for (auto& c : antigos)
+            c.second.erase(std::remove_if(c.second.begin(), c.second.end(),
+                                          [](const Cubo_Collision& x){ return x.celula == 0; }),
+                           c.second.end());
+        for (size_t i = 0; i < celula.size(); ++i)
+            antigos[celula[i].objName].push_back(celula[i]);
+    });
+    double celula_pool = Bench_Mede(REPETICOES, [&]()
+    {
+        for (auto& c : pools)
+            Pool_RemoveIf(&c.second, [](const CuboQuente&, const CuboFrio& x){ return x.celula == 0; });
+        for (size_t i = 0; i < celula.size(); ++i)
+        {
+            const Cubo_Collision& c = celula[i];
+            CuboQuente quente = { c.limites, c.no, false };
+            CuboFrio   fria   = { c.cube, c.Matrix_Model, c.Ka, c.Kd, c.Ks, c.Ke, c.celula };
+            Pool_Add(&pools[c.objName], quente, fria);
+        }
+    });
+
+    // Estátuas avulsas removidas e adicionadas de novo; handles de estátuas
+    // da célula 0 já foram invalidados acima e são ignorados por Pool_Remove()
+    std::vector<Cubo_Collision>& estatuas_antigas = antigos["statue"];
+    double avulso_antigo = Bench_Mede(REPETICOES, [&]()
+    {
+        for (int k = 0; k < ERASES; ++k)
+        {
+            size_t i = gerador() % estatuas_antigas.size();
+            Cubo_Collision c = estatuas_antigas[i];
+            estatuas_antigas.erase(estatuas_antigas.begin() + i);
+            estatuas_antigas.push_back(c);
+        }
+    });
+    CubosColisores& estatuas = pools["statue"];
+    double avulso_pool = Bench_Mede(REPETICOES, [&]()
+    {
+        for (int k = 0; k < AVULSOS; ++k)
+        {
+            size_t i = gerador() % handles.size();
+            if (!Pool_Valid(estatuas, handles[i]))
+                continue;
+            size_t indice = Pool_Index(estatuas, handles[i]);
+            CuboQuente quente = estatuas.quente[indice];
+            CuboFrio   fria   = estatuas.fria[indice];
+            Pool_Remove(&estatuas, handles[i]);
+            handles[i] = Pool_Add(&estatuas, quente, fria);
+        }
+    });
+
+    g_BenchSumidouro = (float)(estatuas.quente[0].colide + estatuas_antigas[0].colide);
+
+    printf("pool: %d colisores (%lu estátuas), %d células; %lu bytes por colisor antes, %lu + %lu em Pool.\n",
+           COLISORES, (unsigned long)Pool_Size(estatuas), CELULAS, (unsigned long)sizeof(Cubo_Collision),
+           (unsigned long)sizeof(CuboQuente), (unsigned long)sizeof(CuboFrio));
+    printf("                                  antes       Pool\n");
+    printf("  ShootRay()                    %8.3f ms %8.3f ms\n", tiro_antigo, tiro_pool);
+    printf("  liberar e recarregar célula   %8.3f ms %8.3f ms\n", celula_antiga, celula_pool);
+    printf("  remover e adicionar estátua   %8.3f us %8.3f us\n",
+           avulso_antigo * 1000.0 / ERASES, avulso_pool * 1000.0 / AVULSOS);
+    return EXIT_SUCCESS;
+}
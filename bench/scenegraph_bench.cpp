@@ -0,0 +1,113 @@
+// Atualização de uma hierarquia de 100 mil nós ("scenegraph.h"): tudo
+// alterado, uma centena de folhas movidas e nada alterado, com e sem as
+// threads de "jobs.h". Para comparação, o movimento como era antes, com
+// Matrix_Translate(delta) * Matrix_Model em cada matriz.
+
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "matrices.h"
+#include "scenegraph.h"
+#include "jobs.h"
+#include "bench.h"
+
+// Células do mundo, cada uma com grupos de objetos: 1 + 100 + 100*10 + 100*10*99 nós
+#define CELULAS    100
+#define GRUPOS     10
+#define OBJETOS    99
+#define MOVIDOS    100
+#define REPETICOES 20
+
+static float Aleatorio(float a, float b)
+{
+    return a + (b - a) * (float)std::rand() / (float)RAND_MAX;
+}
+
+static glm::quat RotacaoAleatoria()
+{
+    return glm::angleAxis(Aleatorio(0.0f, 6.28f), glm::normalize(glm::vec3(Aleatorio(-1.0f, 1.0f), 1.0f, Aleatorio(-1.0f, 1.0f))));
+}
+
+// Marca todas as células (e portanto todos os nós) como alteradas.
+static void MoveCelulas(SceneGraph* g, const std::vector<int>& celulas, float deslocamento)
+{
+    for (size_t i = 0; i < celulas.size(); ++i)
+        SceneGraph_SetPosition(g, celulas[i], glm::vec3(32.0f * (i % 10) + deslocamento, 0.0f, 32.0f * (i / 10)));
+}
+
+int main()
+{
+    std::srand(1);
+    SceneGraph g;
+    int mundo = SceneGraph_Add(&g, -1, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    std::vector<int> celulas, folhas;
+    for (int c = 0; c < CELULAS; ++c)
+    {
+        int celula = SceneGraph_Add(&g, mundo, glm::vec3(32.0f * (c % 10), 0.0f, 32.0f * (c / 10)),
+                                    glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+        celulas.push_back(celula);
+        for (int k = 0; k < GRUPOS; ++k)
+        {
+            int grupo = SceneGraph_Add(&g, celula, glm::vec3(Aleatorio(0.0f, 32.0f), 0.0f, Aleatorio(0.0f, 32.0f)),
+                                       RotacaoAleatoria(), glm::vec3(1.0f));
+            for (int j = 0; j < OBJETOS; ++j)
+                folhas.push_back(SceneGraph_Add(&g, grupo, glm::vec3(Aleatorio(-4.0f, 4.0f), Aleatorio(0.0f, 2.0f), Aleatorio(-4.0f, 4.0f)),
+                                                RotacaoAleatoria(), glm::vec3(Aleatorio(0.5f, 2.0f))));
+        }
+    }
+    size_t nos = g.pai.size();
+    SceneGraph_Update(&g);
+
+    // Os mesmos objetos como matrizes soltas, movidas como antes
+    std::vector<glm::mat4> matrizes(folhas.size());
+    for (size_t i = 0; i < folhas.size(); ++i)
+        matrizes[i] = SceneGraph_World(g, folhas[i]);
+
+    float deslocamento = 0.0f;
+    double tudo = Bench_Mede(REPETICOES, [&]()
+    {
+        MoveCelulas(&g, celulas, deslocamento += 0.01f);
+        SceneGraph_Update(&g);
+    });
+
+    size_t proxima = 0;
+    double algumas = Bench_Mede(REPETICOES, [&]()
+    {
+        for (int k = 0; k < MOVIDOS; ++k, proxima = (proxima + 7919) % folhas.size())
+            SceneGraph_SetPosition(&g, folhas[proxima], glm::vec3(Aleatorio(-4.0f, 4.0f), 1.0f, Aleatorio(-4.0f, 4.0f)));
+        SceneGraph_Update(&g);
+    });
+
+    double nada = Bench_Mede(REPETICOES, [&]() { SceneGraph_Update(&g); });
+
+    double antigo = Bench_Mede(REPETICOES, [&]()
+    {
+        for (size_t i = 0; i < matrizes.size(); ++i)
+            matrizes[i] = Matrix_Translate(0.01f, 0.0f, 0.0f) * matrizes[i];
+    });
+
+    Jobs_Init();
+    unsigned long paralelos = SceneGraph_Stats().parallel;
+    double tudo_paralelo = Bench_Mede(REPETICOES, [&]()
+    {
+        MoveCelulas(&g, celulas, deslocamento += 0.01f);
+        SceneGraph_Update(&g);
+    });
+    paralelos = SceneGraph_Stats().parallel - paralelos;
+    unsigned int threads = Jobs_NumThreads();
+    Jobs_Shutdown();
+
+    g_BenchSumidouro = SceneGraph_World(g, folhas.back())[3][0] + matrizes.back()[3][0];
+
+    printf("scenegraph: %lu nós (%lu folhas).\n", (unsigned long)nos, (unsigned long)folhas.size());
+    printf("  todos alterados, 1 thread          %8.3f ms\n", tudo);
+    printf("  todos alterados, %u threads         %8.3f ms (%lu updates paralelos)\n", threads, tudo_paralelo, paralelos);
+    printf("  %d folhas movidas                  %8.3f ms\n", MOVIDOS, algumas);
+    printf("  nada alterado                      %8.3f us\n", nada * 1000.0);
+    printf("  Matrix_Translate * Matrix_Model    %8.3f ms (todas as folhas)\n", antigo);
+    return EXIT_SUCCESS;
+}
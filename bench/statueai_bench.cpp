@@ -0,0 +1,158 @@
+// Atualização de 100 mil estátuas: o laço original, com o estado de cada
+// estátua junto da sua caixa de colisão (array of structures), contra
+// StatueAI_Update() (structure of arrays e SSE, veja "statueai.h") em uma
+// thread e dividido entre as threads de "jobs.h".
+
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "matrices.h"
+#include "statueai.h"
+#include "jobs.h"
+#include "bench.h"
+
+#define ESTATUAS   100000
+#define PASSOS     60
+#define REPETICOES 5
+#define DT         (1.0f / 60.0f)
+
+// Os campos do antigo Cubo_Collision usados pela atualização das estátuas.
+struct EstatuaAntiga
+{
+    glm::mat4 Matrix_Model;
+    glm::vec4 vert_min, vert_max; // Caixa no sistema do modelo
+    bool      colide;
+    bool      visto;
+    float     tempoVisto;
+    float     t;
+    glm::vec3 Path[4];
+};
+
+static glm::vec3 cubic_bezier(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 p4, float t)
+{
+    return (float)(pow((1-t),3)) * p1 + (float)(3*t*pow((1-t),2)) * p2 + (float)(3*t*t*(1-t)) * p3 + (float)(t*t*t)*p4;
+}
+
+static double d2r(double d)
+{
+    return (d / 180.0) * ((double) M_PI);
+}
+
+// O laço de main.cpp antes de "statueai.h".
+static void AtualizaAntigas(std::vector<EstatuaAntiga>& estatuas, const glm::vec4& LightPos, const glm::vec4& view_vector, float dt)
+{
+    for (size_t i = 0; i < estatuas.size(); ++i)
+    {
+        EstatuaAntiga* modelo = &estatuas[i];
+        glm::vec4 centro = ((modelo->Matrix_Model * modelo->vert_min) + (modelo->Matrix_Model * modelo->vert_max)) * 0.5f;
+
+        glm::vec4 l = (LightPos - centro)/norm(LightPos - centro);
+        float angle = dotproduct(-l, view_vector);
+        if(modelo->visto)
+        {
+            modelo->tempoVisto += dt;
+
+            glm::vec3 oldPos = glm::vec3(centro.x, centro.y, centro.z);
+            glm::vec3 newPos = cubic_bezier(modelo->Path[0], modelo->Path[1], modelo->Path[2], modelo->Path[3], modelo->t);
+            glm::vec3 deltaPos = newPos - oldPos;
+            modelo->Matrix_Model = Matrix_Translate(deltaPos.x, deltaPos.y, deltaPos.z) * modelo->Matrix_Model;
+
+            modelo->t = 1 / (1 + exp(-2*(modelo->tempoVisto-5))); // Função Sigmoid
+
+        } else if(acos(angle) < d2r(25))
+        {
+            modelo->tempoVisto += dt;
+            if(modelo->tempoVisto >= 5 && !modelo->visto)
+            {
+                modelo->visto = true;
+                modelo->tempoVisto = 0;
+            }
+        } else modelo->tempoVisto = 0;
+    }
+}
+
+static float Aleatorio(float a, float b)
+{
+    return a + (b - a) * (float)std::rand() / (float)RAND_MAX;
+}
+
+int main()
+{
+    // Estátuas espalhadas em volta do jogador, um quarto delas já fugindo
+    std::srand(1);
+    std::vector<EstatuaAntiga> antigas(ESTATUAS);
+    StatueAI ai;
+    for (size_t i = 0; i < ESTATUAS; ++i)
+    {
+        glm::vec4 centro(Aleatorio(-100.0f, 100.0f), 1.0f, Aleatorio(-100.0f, 100.0f), 1.0f);
+        glm::vec3 path[4];
+        path[0] = glm::vec3(centro);
+        for (int k = 1; k < 4; ++k)
+            path[k] = path[k-1] + glm::vec3(Aleatorio(-5.0f, 5.0f), 0.0f, Aleatorio(-5.0f, 5.0f));
+
+        EstatuaAntiga& e = antigas[i];
+        e.Matrix_Model = Matrix_Translate(centro.x, centro.y, centro.z);
+        e.vert_min   = glm::vec4(-0.5f, -1.0f, -0.5f, 1.0f);
+        e.vert_max   = glm::vec4( 0.5f,  1.0f,  0.5f, 1.0f);
+        e.colide     = false;
+        e.visto      = i % 4 == 0;
+        e.tempoVisto = 0.0f;
+        e.t          = 0.0f;
+        for (int k = 0; k < 4; ++k)
+            e.Path[k] = path[k];
+
+        StatueAI_Add(&ai, centro, path, -1);
+        ai.visto[i] = e.visto ? 1 : 0;
+        ai.desobstruida[i] = 1;
+    }
+
+    const glm::vec4 jogador(0.0f, 1.7f, 0.0f, 1.0f);
+    const glm::vec4 visao(1.0f, 0.0f, 0.0f, 0.0f);
+
+    // O estado muda a cada passo (as estátuas fogem), então cada repetição
+    // recomeça de uma cópia do estado inicial
+    std::vector<EstatuaAntiga> copia_antigas;
+    double antigo = Bench_Mede(REPETICOES, [&]()
+    {
+        copia_antigas = antigas;
+        for (int passo = 0; passo < PASSOS; ++passo)
+            AtualizaAntigas(copia_antigas, jogador, visao, DT);
+    });
+
+    StatueAI copia;
+    double uma_thread = Bench_Mede(REPETICOES, [&]()
+    {
+        copia = ai;
+        for (int passo = 0; passo < PASSOS; ++passo)
+            StatueAI_Update(&copia, 0, copia.count, jogador, visao, DT);
+    });
+
+    Jobs_Init();
+    double varias_threads = Bench_Mede(REPETICOES, [&]()
+    {
+        copia = ai;
+        for (int passo = 0; passo < PASSOS; ++passo)
+            StatueAI_Update(&copia, 0, copia.count, jogador, visao, DT);
+    });
+    unsigned int threads = Jobs_NumThreads();
+    Jobs_Shutdown();
+
+    // Tempo das cópias, descontado das medições acima
+    double copias_antigas = Bench_Mede(REPETICOES, [&]() { copia_antigas = antigas; });
+    double copias_soa     = Bench_Mede(REPETICOES, [&]() { copia = ai; });
+
+    unsigned long fugindo = 0;
+    for (size_t i = 0; i < copia.count; ++i)
+        fugindo += copia.visto[i] != 0;
+    g_BenchSumidouro = copia_antigas[ESTATUAS/2].Matrix_Model[3][0] + copia.centro_x[ESTATUAS/2];
+
+    printf("statueai: %d estátuas (%lu fugindo ao final), %d passos.\n", ESTATUAS, fugindo, PASSOS);
+    printf("  laço original (AoS)          %8.3f ms/passo\n", (antigo - copias_antigas) / PASSOS);
+    printf("  StatueAI_Update, 1 thread    %8.3f ms/passo\n", (uma_thread - copias_soa) / PASSOS);
+    printf("  StatueAI_Update, %u threads   %8.3f ms/passo\n", threads, (varias_threads - copias_soa) / PASSOS);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,22 @@
+#ifndef _ALLOCCOUNTER_H
+#define _ALLOCCOUNTER_H
+
+// Contagem das alocações de memória dinâmica feitas com "new", por thread,
+// para verificar que o laço principal não aloca nada depois que o jogo se
+// estabiliza (veja FrameArena e "--zero-alloc" em main.cpp). A contagem
+// substitui os operadores "new" e "delete" globais e só existe em builds com
+// ALLOC_COUNTER definido (os alvos Debug e os testes que a usam); nas
+// demais, AllocCounter_Enabled() é falso e as contagens são zero.
+//
+// Alocações de bibliotecas em C (malloc() do driver OpenGL ou da GLFW, por
+// exemplo) não são contadas.
+
+bool AllocCounter_Enabled();
+
+// Alocações feitas pela thread atual desde o início do programa.
+unsigned long AllocCounter_Thread();
+
+// Alocações feitas por todas as threads.
+unsigned long AllocCounter_Total();
+
+#endif // _ALLOCCOUNTER_H
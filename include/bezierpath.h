@@ -0,0 +1,87 @@
+#ifndef _BEZIERPATH_H
+#define _BEZIERPATH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// Caminhos formados por curvas de Bézier cúbicas.
+//
+// Cada segmento é guardado na base de potências, P(u) = a + u*(b + u*(c + u*d)),
+// avaliada pelo método de Horner (três multiplicações e três somas por
+// coordenada). Junto com os coeficientes, é pré-calculada uma tabela de
+// comprimento de arco, que permite percorrer o caminho com velocidade
+// constante, ou com uma suavização (easing) aplicada à distância percorrida,
+// independentemente do espaçamento entre os pontos de controle.
+
+#define BEZIERPATH_SAMPLES    64 // Amostras por segmento na tabela de comprimento
+#define BEZIERPATH_TABLE_SIZE 33 // Entradas da tabela inversa de BezierPathBatch
+
+struct BezierSegment
+{
+    glm::vec3 a, b, c, d; // Coeficientes na base de potências
+};
+
+// Caminho com um ou mais segmentos consecutivos.
+struct BezierPath
+{
+    std::vector<BezierSegment> segmentos;
+    std::vector<float>         comprimento; // Comprimento acumulado em cada amostra
+    float                      total;       // Comprimento do caminho
+};
+
+// Constrói um caminho a partir de 3*n+1 pontos de controle: os pontos
+// [3*k, 3*k+3] formam o k-ésimo segmento, que começa onde o anterior termina.
+void BezierPath_Build(BezierPath* path, const glm::vec3* points, size_t num_points);
+
+// Ponto no parâmetro "u" em [0,1], que percorre os segmentos em sequência
+// (cada segmento ocupa uma fração igual de "u").
+glm::vec3 BezierPath_Evaluate(const BezierPath& path, float u);
+
+// Parâmetro "u" do ponto a uma distância "s" do início, medida sobre a curva.
+float BezierPath_ParamAtDistance(const BezierPath& path, float s);
+
+// Ponto a uma distância "s" do início (velocidade constante).
+glm::vec3 BezierPath_PointAtDistance(const BezierPath& path, float s);
+
+// Ponto após percorrer a fração "f" do comprimento, em [0,1]. Para uma
+// trajetória suavizada, "f" é o resultado da função de easing.
+glm::vec3 BezierPath_PointAtFraction(const BezierPath& path, float f);
+
+// Funções de easing comuns, de [0,1] em [0,1].
+float BezierPath_EaseInOut(float x);
+float BezierPath_EaseSigmoid(float x, float inclinacao);
+
+// Muitos caminhos de um segmento em vetores separados por campo, avaliados
+// em lote (quatro por vez com SSE). Em vez da tabela de comprimento, cada
+// caminho guarda o parâmetro "u" em BEZIERPATH_TABLE_SIZE distâncias
+// igualmente espaçadas; entre elas, "u" é interpolado linearmente.
+struct BezierPathBatch
+{
+    BezierPathBatch() : count(0) {}
+
+    size_t count;
+
+    // Coeficientes: coef_x[k][i] é o k-ésimo coeficiente (a, b, c, d) em x
+    // do i-ésimo caminho.
+    std::vector<float> coef_x[4];
+    std::vector<float> coef_y[4];
+    std::vector<float> coef_z[4];
+
+    std::vector<float> total;  // Comprimento de cada caminho
+    std::vector<float> tabela; // BEZIERPATH_TABLE_SIZE parâmetros por caminho
+};
+
+void BezierPathBatch_Add(BezierPathBatch* batch, const glm::vec3 points[4]);
+
+// Remove os caminhos com remover[i] != 0, mantendo a ordem dos demais.
+void BezierPathBatch_Erase(BezierPathBatch* batch, const std::vector<uint8_t>& remover);
+
+// Para cada caminho i em [first, first+count), escreve em x[i], y[i] e z[i]
+// o ponto após percorrer a fração fraction[i] do seu comprimento.
+void BezierPathBatch_Evaluate(const BezierPathBatch& batch, size_t first, size_t count,
+                              const float* fraction, float* x, float* y, float* z);
+
+#endif // _BEZIERPATH_H
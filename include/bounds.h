@@ -0,0 +1,54 @@
+#ifndef _BOUNDS_H
+#define _BOUNDS_H
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// Volumes envolventes de uma instância no sistema do mundo: a caixa alinhada
+// aos eixos (AABB) da caixa do modelo transformada pelo método de Arvo (veja
+// FastMath_TransformAABB() em "fastmath.h"), correta também para instâncias
+// rotacionadas, e uma esfera. Quem altera a matriz de modelagem marca a
+// entrada como suja; Bounds_Update() só recalcula entradas sujas.
+struct WorldBounds
+{
+    glm::vec3 min;    // AABB no mundo
+    glm::vec3 max;
+    glm::vec3 centro; // Esfera envolvente no mundo
+    float     raio;
+    bool      sujo;   // A matriz mudou desde o último Bounds_Update()
+};
+
+// Planos do volume de visualização, com normais apontando para dentro:
+// um ponto p está do lado de dentro do plano k se dot(planos[k], [p,1]) >= 0.
+struct Frustum
+{
+    glm::vec4 planos[6];
+};
+
+struct BoundsStats
+{
+    unsigned long updates; // Entradas recalculadas
+    unsigned long reuses;  // Consultas atendidas sem recalcular
+};
+
+// Marca "b" para ser recalculado na próxima consulta.
+inline void Bounds_Invalidate(WorldBounds* b) { b->sujo = true; }
+
+// Recalcula "b", se estiver sujo, a partir da caixa [min_local, max_local]
+// do modelo e da matriz "model".
+void Bounds_Update(WorldBounds* b, const glm::mat4& model,
+                   const glm::vec3& min_local, const glm::vec3& max_local);
+
+// Extrai os planos de "projection * view" (método de Gribb e Hartmann). Vale
+// para as projeções de "matrices.h", em que w > 0 nos pontos visíveis.
+void Bounds_ExtractFrustum(Frustum* f, const glm::mat4& projection_view);
+
+// Falso somente se a esfera ou a caixa está inteiramente fora de algum plano
+// (testes conservadores: podem aceitar objetos fora do volume).
+bool Bounds_SphereInFrustum(const Frustum& f, const glm::vec3& centro, float raio);
+bool Bounds_AABBInFrustum(const Frustum& f, const glm::vec3& min, const glm::vec3& max);
+
+BoundsStats Bounds_Stats();
+
+#endif // _BOUNDS_H
@@ -0,0 +1,91 @@
+#ifndef _BVH_H
+#define _BVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// Hierarquia de volumes envolventes (BVH) sobre os triângulos de uma malha,
+// para testes de raio e de colisão. A árvore é construída uma única vez, no
+// sistema de coordenadas do modelo, dividindo os triângulos pela heurística
+// de área de superfície (SAH) avaliada em BVH_BINS faixas ao longo do maior
+// eixo, e pode ser guardada em disco ao lado do arquivo ".obj".
+//
+// Em geometrias muito desiguais a SAH pode separar poucos triângulos por
+// nível e gerar árvores profundas; abaixo de BVH_SAH_MAX_DEPTH as divisões
+// são pela mediana, e nenhum nó passa de BVH_MAX_DEPTH, o que limita a
+// pilha das consultas.
+
+#define BVH_BINS          12 // Faixas avaliadas em cada divisão
+#define BVH_MAX_LEAF_SIZE 4  // Máximo de triângulos em uma folha, até BVH_MAX_DEPTH
+#define BVH_SAH_MAX_DEPTH 32 // Profundidade (a raiz tem 0) da última divisão pela SAH
+#define BVH_MAX_DEPTH     64 // Profundidade máxima de um nó
+
+struct BVHNode
+{
+    glm::vec3 min;
+    uint32_t  inicio;         // Folha: primeiro triângulo. Interno: filho esquerdo (o direito é inicio+1)
+    glm::vec3 max;
+    uint32_t  num_triangulos; // 0 nos nós internos
+};
+
+// Triângulo na forma usada pelo teste de Möller-Trumbore
+struct BVHTriangle
+{
+    glm::vec3 v0;
+    glm::vec3 e1; // v1 - v0
+    glm::vec3 e2; // v2 - v0
+};
+
+struct BVH
+{
+    std::vector<BVHNode>     nos;        // nos[0] é a raiz
+    std::vector<BVHTriangle> triangulos; // Na ordem das folhas
+};
+
+// Contadores de trabalho de uma ou mais consultas
+struct BVHQueryStats
+{
+    unsigned long nodes;     // Nós visitados
+    unsigned long triangles; // Testes raio-triângulo
+};
+
+// Constrói a BVH dos triângulos dados por "indices" (três por triângulo).
+// Cada vértice ocupa "stride" floats em "positions", começando por x, y, z.
+void BVH_Build(BVH* bvh, const float* positions, size_t stride,
+               const unsigned int* indices, size_t num_indices);
+
+// Verdadeiro se o raio origem + t*dir, com t em (0, tmax), atinge algum
+// triângulo. Para no primeiro encontrado.
+bool BVH_Occluded(const BVH& bvh, const glm::vec3& origem, const glm::vec3& dir, float tmax,
+                  BVHQueryStats* stats = NULL);
+
+// Interseção mais próxima do raio com t em (0, tmax). Retorna falso se não
+// houver; caso contrário escreve "t" e o índice do triângulo em
+// bvh.triangulos.
+bool BVH_Raycast(const BVH& bvh, const glm::vec3& origem, const glm::vec3& dir, float tmax,
+                 float* t, size_t* triangulo = NULL, BVHQueryStats* stats = NULL);
+
+// Verdadeiro se algum triângulo intercepta a caixa [min, max].
+bool BVH_OverlapsBox(const BVH& bvh, const glm::vec3& min, const glm::vec3& max,
+                     BVHQueryStats* stats = NULL);
+
+// Verdadeiro se algum triângulo está a uma distância menor ou igual a
+// "raio" do segmento [a, b] (cápsula).
+bool BVH_OverlapsCapsule(const BVH& bvh, const glm::vec3& a, const glm::vec3& b, float raio,
+                         BVHQueryStats* stats = NULL);
+
+// Cache das BVHs dos objetos de uma malha. O arquivo guarda o tamanho e a
+// data de modificação de "source" (o ".obj") e é ignorado se eles mudarem,
+// se o número de triângulos de algum objeto não for o esperado ou se alguma
+// árvore for inválida ou mais profunda que BVH_MAX_DEPTH.
+bool BVH_SaveCache(const char* filename, const char* source,
+                   const std::vector<std::shared_ptr<const BVH> >& bvhs);
+bool BVH_LoadCache(const char* filename, const char* source,
+                   const std::vector<size_t>& num_triangles,
+                   std::vector<std::shared_ptr<const BVH> >* bvhs);
+
+#endif // _BVH_H
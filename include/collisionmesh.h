@@ -0,0 +1,42 @@
+#ifndef _COLLISIONMESH_H
+#define _COLLISIONMESH_H
+
+#include <memory>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "bvh.h"
+
+// Malha de colisão estática do cenário. Cada instância de um objeto do
+// cenário é registrada com a BVH da sua malha (no sistema do modelo) e a sua
+// matriz de modelagem; as consultas descartam as instâncias pela caixa
+// envolvente no mundo e percorrem a BVH das demais, com custo logarítmico no
+// número de triângulos.
+
+struct CollisionMeshStats
+{
+    unsigned long queries;        // Consultas feitas
+    unsigned long hits;           // Consultas com contato
+    unsigned long instance_tests; // Instâncias cuja BVH foi percorrida
+    BVHQueryStats bvh;            // Trabalho dentro das BVHs
+};
+
+void CollisionMesh_AddInstance(const std::shared_ptr<const BVH>& bvh, const glm::mat4& model, int celula);
+void CollisionMesh_RemoveCell(int celula);
+
+// Acrescenta a "vertices" os triângulos (três vértices cada, no mundo) das
+// instâncias da célula "celula", por exemplo para construir a malha de
+// navegação (veja "navmesh.h").
+void CollisionMesh_CollectTriangles(int celula, std::vector<glm::vec3>* vertices);
+
+// Verdadeiro se a cápsula de eixo [a, b] e raio "raio" toca o cenário.
+bool CollisionMesh_OverlapsCapsule(const glm::vec3& a, const glm::vec3& b, float raio);
+
+// Verdadeiro se a caixa [min, max] (no mundo) toca o cenário.
+bool CollisionMesh_OverlapsBox(const glm::vec3& min, const glm::vec3& max);
+
+CollisionMeshStats CollisionMesh_Stats();
+
+#endif // _COLLISIONMESH_H
@@ -10,6 +10,9 @@
 #include <glm/vec4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "bounds.h"
+#include "pool.h"
+
 struct Raio
 {
     glm::vec4 origem;
@@ -46,38 +49,51 @@ struct Plano
     float d; // Distancia da origem
 };
 
-struct Cubo_Collision
+// Colisores guardados em Pool (veja "pool.h"), um por nome de objeto: a
+// parte quente  a percorrida pelos tiros e a cada passo da simulao; a
+// fria, a usada apenas ao desenhar ou ao mudar a matriz. O estado das
+// esttuas (tempo observada, caminho de fuga) fica em "statueai.h", na
+// mesma ordem de Cubes_Collisions["statue"].
+struct CuboQuente
 {
-    Cubo cube;
+    WorldBounds limites; // "cube" transformado por Matrix_Model; invalidar ao mudar a matriz
+    int no; // N do grafo de cena de onde vem Matrix_Model (veja "scenegraph.h")
     bool colide;
+};
+
+struct CuboFrio
+{
+    Cubo cube;
     glm::mat4 Matrix_Model;
-    std::string objName;
-    bool visto;
-    float tempoVisto;
-    float t;
-    glm::vec3 Path[4];
     glm::vec3 Ka;
     glm::vec3 Kd;
     glm::vec3 Ks;
     glm::vec3 Ke;
+    int celula; // Clula do mundo que criou o colisor (-1 = cena principal)
 };
 
-struct Sphere_Collision
+struct EsferaQuente
 {
     Esfera bola;
     bool colide;
+};
+
+struct EsferaFria
+{
     glm::mat4 Matrix_Model;
-    std::string objName;
-    bool visto;
-    float tempoVisto;
-    float t;
     glm::vec3 Path[4];
     glm::vec3 Ka;
     glm::vec3 Kd;
     glm::vec3 Ks;
     glm::vec3 Ke;
+    int celula; // Clula do mundo que criou o colisor (-1 = cena principal)
+    WorldBounds limites; // Caixa do objeto transformada por Matrix_Model
+    int no; // N do grafo de cena
 };
 
+typedef Pool<CuboQuente, CuboFrio>     CubosColisores;
+typedef Pool<EsferaQuente, EsferaFria> EsferasColisores;
+
 float collision_Ray_Sphere(Raio ray, Esfera sphere);
 bool collision_Box_Box(Cubo box1, Cubo box2);
 bool collision_Ray_Box(Raio ray, Cubo box);
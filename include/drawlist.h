@@ -0,0 +1,83 @@
+#ifndef _DRAWLIST_H
+#define _DRAWLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "bounds.h"
+#include "renderqueue.h"
+
+// Montagem da lista de desenho de uma vista em várias threads. Os objetos
+// são divididos em blocos de g_DrawListBlockSize, distribuídos com
+// Jobs_ParallelFor() (veja "jobs.h"). Para cada objeto, o bloco faz o descarte pelo
+// volume de visualização, o descarte dos objetos pequenos demais na tela,
+// o preenchimento do RenderItem e o cálculo da chave de ordenação, gravando
+// o resultado na sua própria faixa dos vetores: as threads nunca escrevem
+// na mesma posição. DrawList_Finish() ordena as chaves e codifica o fluxo
+// de comandos, e a thread do OpenGL só chama RenderQueue_Replay().
+//
+// Listas pequenas (menos de g_DrawListParallelThreshold objetos) são
+// montadas na thread atual.
+
+extern size_t g_DrawListBlockSize;
+extern size_t g_DrawListParallelThreshold;
+
+struct DrawListView
+{
+    Frustum   frustum;
+    glm::vec3 olho;
+    float     distancia_maxima; // Distância que corresponde à profundidade 1 da chave
+    float     tamanho_minimo;   // Objetos com raio/distância menor são descartados (0 = nenhum)
+};
+
+// Preenche o item do objeto "indice" e sua esfera envolvente no mundo.
+// Retorna falso se o objeto não deve ser desenhado. Um raio negativo
+// desativa os descartes. A profundidade e a chave são calculadas depois.
+// Chamada por várias threads ao mesmo tempo.
+typedef std::function<bool(size_t indice, RenderItem* item, glm::vec3* centro, float* raio)> DrawListFill;
+
+struct DrawListStats
+{
+    unsigned long frames;
+    unsigned long objects;  // Objetos passados a DrawList_Build()
+    unsigned long culled;   // Fora do volume de visualização
+    unsigned long small;    // Pequenos demais na tela
+    unsigned long items;    // Itens desenhados
+    unsigned long parallel; // DrawList_Build() divididos entre threads
+};
+
+// Contagem de um bloco de objetos
+struct DrawListBlock
+{
+    uint32_t aceitos;
+    uint32_t descartados;
+    uint32_t pequenos;
+};
+
+struct DrawList
+{
+    std::vector<RenderItem>     itens;
+    std::vector<ChaveDeDesenho> chaves;
+    std::vector<ChaveDeDesenho> temp;
+    std::vector<DrawListBlock>  blocos;
+    RenderCommandStream         comandos; // Resultado de DrawList_Finish()
+};
+
+void DrawList_Begin(DrawList* lista);
+
+// Adiciona os objetos 0..n-1 aceitos por "fill" e pela vista.
+void DrawList_Build(DrawList* lista, const DrawListView& vista, size_t n, const DrawListFill& fill);
+
+// Adiciona um item sem descarte (a chave é calculada aqui).
+void DrawList_Append(DrawList* lista, const RenderItem& item);
+
+// Ordena os itens e codifica lista->comandos.
+void DrawList_Finish(DrawList* lista);
+
+DrawListStats DrawList_Stats();
+
+#endif // _DRAWLIST_H
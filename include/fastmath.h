@@ -0,0 +1,35 @@
+#ifndef _FASTMATH_H
+#define _FASTMATH_H
+
+#include <cstddef>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// Operações de matrizes usadas nos laços executados a cada passo (caixas
+// envolventes, colisores, linha de visão). Usam SSE quando disponível e
+// código escalar caso contrário; as funções de "matrices.h" continuam sendo
+// as de referência, escritas para facilitar a leitura.
+//
+// As matrizes seguem a convenção de GLM ("column-major"), e as funções
+// "Affine" supõem que a última linha é [0 0 0 1].
+
+// Produto a*b
+glm::mat4 FastMath_Multiply(const glm::mat4& a, const glm::mat4& b);
+
+// Inversa de uma matriz afim: inverte o bloco 3x3 e reaplica a translação.
+// Mais barata que glm::inverse(), que trata o caso projetivo geral.
+glm::mat4 FastMath_AffineInverse(const glm::mat4& m);
+
+// saida[i] = m * [entrada[i], 1], sem divisão por w. "entrada" e "saida"
+// podem ser o mesmo vetor.
+void FastMath_TransformPoints(const glm::mat4& m, const glm::vec3* entrada, glm::vec3* saida, size_t n);
+
+// Caixa alinhada aos eixos que envolve [min, max] transformada por "m"
+// (método de Arvo, Graphics Gems, 1990): cada coluna contribui com o menor e
+// o maior de seus produtos pelos limites da caixa, sem transformar os oito
+// cantos. O resultado é o mesmo dos oito cantos, a menos de arredondamento.
+void FastMath_TransformAABB(const glm::mat4& m, const glm::vec3& min, const glm::vec3& max,
+                            glm::vec3* min_saida, glm::vec3* max_saida);
+
+#endif // _FASTMATH_H
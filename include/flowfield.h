@@ -0,0 +1,96 @@
+#ifndef _FLOWFIELD_H
+#define _FLOWFIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "navmesh.h"
+
+// Campo de fuga compartilhado por todas as estátuas, para multidões grandes
+// demais para uma rota por estátua (veja "statueai.h").
+//
+// A grade é a das colunas da malha de navegação: uma célula é livre se um
+// polígono da malha a cobre (o mais baixo, se há vários andares), e duas
+// células vizinhas (também nas diagonais, sem cortar cantos) se ligam se a
+// diferença de altura é de até agent_climb. Sobre ela:
+//
+// 1. Dijkstra a partir da célula do jogador dá a distância de cada célula
+//    até ele.
+// 2. Cada célula recebe -FLOWFIELD_FLEE_FACTOR vezes essa distância, e um
+//    segundo Dijkstra, partindo de todas as células, propaga esses valores.
+//    Descer o resultado afasta do jogador sem ficar preso em becos sem
+//    saída próximos, pois o caminho até um lugar mais aberto pode passar
+//    perto dele.
+// 3. A direção de cada célula aponta para a vizinha de menor valor.
+//
+// O campo só é recalculado quando o jogador muda de célula, e o cálculo é
+// dividido em vários passos (veja FlowField_Update()). Enquanto isso, as
+// estátuas continuam usando as direções do campo anterior.
+
+#define FLOWFIELD_FLEE_FACTOR 1.2f
+#define FLOWFIELD_NONE 0xFFFFFFFFu
+
+struct FlowField
+{
+    FlowField() : largura(0), profundidade(0), cell_size(0.0f), agent_climb(0.0f),
+                  fase(0), celula_jogador(FLOWFIELD_NONE), celula_calculo(FLOWFIELD_NONE), pronto(false) {}
+
+    int   largura;      // Colunas em x
+    int   profundidade; // Colunas em z
+    float min_x, min_z; // Canto da grade, no mundo
+    float cell_size;
+    float agent_climb;
+
+    std::vector<uint8_t> livre;  // 1 se a célula está na malha
+    std::vector<float>   altura; // Chão da célula
+    std::vector<uint8_t> ligacoes; // Bit k: ligada à vizinha k (veja flowfield.cpp)
+
+    // Direção (unitária, ou zero) de fuga de cada célula, do último cálculo
+    // terminado
+    std::vector<float> direcao_x;
+    std::vector<float> direcao_z;
+
+    // Cálculo em andamento
+    int      fase;            // 0 = parado, 1 = distâncias, 2 = fuga
+    uint32_t celula_jogador;  // Célula do último cálculo pedido
+    uint32_t celula_calculo;  // Célula do cálculo em andamento
+    std::vector<uint32_t> distancia; // Em décimos de célula
+    std::vector<uint32_t> fuga;
+    std::vector<uint64_t> heap;      // (custo << 32) | célula, como heap de mínimo
+    bool pronto;              // Algum cálculo já terminou
+};
+
+struct FlowFieldStats
+{
+    unsigned long recomputes; // Cálculos completos
+    unsigned long restarts;   // Cálculos abandonados porque o jogador mudou de célula
+    unsigned long steps;      // Chamadas de FlowField_Update() com trabalho a fazer
+    unsigned long nodes;      // Células retiradas dos heaps
+    double        total_ms;   // Tempo gasto nos cálculos
+    double        max_step_ms; // Passo mais demorado
+};
+
+// Cria a grade a partir das colunas da malha de navegação, sem campo
+// calculado.
+void FlowField_Build(FlowField* campo, const NavMesh& navmesh);
+
+// Célula livre em (x, z), ou FLOWFIELD_NONE.
+uint32_t FlowField_Cell(const FlowField& campo, float x, float z);
+
+// Se o jogador mudou de célula, começa um novo cálculo; avança o cálculo em
+// andamento retirando até "orcamento" células dos heaps. Retorna verdadeiro
+// quando um cálculo termina e as direções mudam. Não aloca memória depois
+// do primeiro cálculo.
+bool FlowField_Update(FlowField* campo, const glm::vec3& jogador, size_t orcamento);
+
+// Direção de fuga em (x, z), interpolada entre as quatro células mais
+// próximas (zero fora do campo ou antes do primeiro cálculo).
+glm::vec2 FlowField_Sample(const FlowField& campo, float x, float z);
+
+FlowFieldStats FlowField_Stats();
+
+#endif // _FLOWFIELD_H
@@ -0,0 +1,72 @@
+#ifndef _FRAMEARENA_H
+#define _FRAMEARENA_H
+
+#include <cstddef>
+#include <vector>
+
+// Alocadores lineares para memória temporária: cada alocação apenas avança
+// um ponteiro dentro de um bloco reservado de antemão, e tudo é liberado de
+// uma vez, voltando o ponteiro.
+//
+// - g_FrameArena vale por um quadro: é esvaziada por FrameArena_BeginFrame()
+//   no começo de cada quadro da thread de renderização, e só ela a usa.
+// - Arena_Scratch() devolve a arena de rascunho da thread atual, para
+//   vetores temporários dentro de uma função; ArenaScope devolve ao sair do
+//   escopo o que foi alocado nele.
+//
+// Se um bloco não basta, a alocação vem de um bloco extra (e conta como
+// estouro); no próximo Arena_Reset() a arena passa a ter um bloco único
+// grande o bastante, de modo que, depois dos primeiros quadros, nada é
+// alocado no heap. A memória não é inicializada e destrutores não são
+// chamados: use apenas tipos triviais.
+
+struct Arena
+{
+    unsigned char*      memoria;
+    size_t              capacidade;
+    size_t              usado;
+    size_t              pico;      // Maior "usado" (contando os blocos extras) desde o último Arena_Reset()
+    size_t              maior_pico;
+    unsigned long       estouros;  // Alocações que não couberam no bloco
+    std::vector<void*>  extras;    // Blocos extras, liberados em Arena_Reset()
+    size_t              usado_extras;
+};
+
+void Arena_Init(Arena* arena, size_t capacidade);
+void Arena_Destroy(Arena* arena);
+
+// "align" deve ser uma potência de dois.
+void* Arena_Alloc(Arena* arena, size_t bytes, size_t align);
+
+template <typename T>
+T* Arena_New(Arena* arena, size_t n)
+{
+    return (T*)Arena_Alloc(arena, n * sizeof(T), alignof(T));
+}
+
+// Libera tudo, e aumenta o bloco se houve estouro.
+void Arena_Reset(Arena* arena);
+
+// Posição atual, para liberar com Arena_Rewind() o que foi alocado depois.
+// Não vale para alocações feitas em blocos extras.
+size_t Arena_Mark(const Arena& arena);
+void   Arena_Rewind(Arena* arena, size_t marca);
+
+// Arena de rascunho da thread atual (criada no primeiro uso).
+Arena* Arena_Scratch();
+
+struct ArenaScope
+{
+    Arena* arena;
+    size_t marca;
+
+    explicit ArenaScope(Arena* a) : arena(a), marca(Arena_Mark(*a)) {}
+    ~ArenaScope() { Arena_Rewind(arena, marca); }
+};
+
+extern Arena g_FrameArena;
+
+// Chamada no começo de cada quadro.
+void FrameArena_BeginFrame();
+
+#endif // _FRAMEARENA_H
@@ -0,0 +1,87 @@
+#ifndef _JOBS_H
+#define _JOBS_H
+
+#include <cstddef>
+#include <functional>
+
+// Sistema de tarefas ("jobs") compartilhado pelos módulos que dividem
+// trabalho entre threads. Jobs_Init() cria um conjunto fixo de threads; cada
+// uma, e também a thread que chamou Jobs_Init(), tem a sua fila de duas
+// pontas: a dona insere e retira tarefas do fim (a mais recente, ainda
+// quente na cache), e as threads sem trabalho roubam do começo das filas das
+// outras. Threads que não são do conjunto (a simulação, por exemplo) usam
+// uma fila compartilhada.
+//
+// Uma tarefa pode ter uma tarefa pai, que só termina depois de todas as
+// filhas. Jobs_Wait() não bloqueia a thread: enquanto a tarefa esperada não
+// termina, ela executa outras tarefas das filas.
+//
+// Tarefas de segundo plano (leitura de arquivos, decodificação de imagens)
+// vão para uma fila separada, atendida na ordem de chegada e só pelas
+// threads do conjunto quando não há outro trabalho: Jobs_Wait() nunca as
+// executa, para que a espera por um trabalho curto não fique presa atrás
+// de uma leitura de disco.
+
+struct Job;
+
+typedef std::function<void()> JobFunction;
+
+struct JobStats
+{
+    unsigned long jobs;       // Tarefas executadas
+    unsigned long stolen;     // Retiradas da fila de outra thread
+    unsigned long helped;     // Executadas dentro de Jobs_Wait()
+    unsigned long background; // Tarefas de segundo plano
+};
+
+// Cria as threads (o número de núcleos menos um, entre 1 e 7). Sem
+// Jobs_Init(), Jobs_ParallelFor() executa tudo na thread atual e as tarefas
+// de segundo plano são executadas dentro de Jobs_RunBackground().
+void Jobs_Init();
+
+// Espera as tarefas na fila e termina as threads.
+void Jobs_Shutdown();
+
+// Threads que executam tarefas, contando a que chamou Jobs_Init().
+unsigned int Jobs_NumThreads();
+
+// Cria uma tarefa, que ainda não é executada. Se "pai" não for NULL, ele só
+// termina depois dela; "pai" ainda não pode ter terminado. As tarefas
+// terminadas voltam para um conjunto de tarefas livres e são reaproveitadas.
+Job* Jobs_Create(const JobFunction& funcao, Job* pai = NULL);
+
+// Coloca a tarefa na fila da thread atual.
+void Jobs_Run(Job* job);
+
+// Coloca a tarefa na fila de segundo plano.
+void Jobs_RunBackground(Job* job);
+
+// Espera a tarefa e suas filhas terminarem, executando outras tarefas
+// enquanto isso, e libera a tarefa.
+void Jobs_Wait(Job* job);
+
+// Libera a tarefa sem esperar: ela é destruída quando terminar.
+void Jobs_Release(Job* job);
+
+// Verdadeiro se a tarefa e suas filhas terminaram.
+bool Jobs_Done(const Job* job);
+
+// Implementação de Jobs_ParallelFor(): "chama" recebe de volta "f".
+typedef void (*JobRangeCall)(const void* f, size_t a, size_t b);
+void Jobs_ParallelForCall(size_t inicio, size_t fim, size_t grao, JobRangeCall chama, const void* f);
+
+// Chama f(a, b) para faixas [a, b) que cobrem [inicio, fim), com pelo menos
+// "grao" elementos cada (exceto a última), em paralelo, e retorna quando
+// todas terminarem. A thread atual executa a primeira faixa. "f" não é
+// copiada (nem convertida para std::function): as faixas a chamam por
+// referência, sem alocar memória.
+template <typename Funcao>
+void Jobs_ParallelFor(size_t inicio, size_t fim, size_t grao, const Funcao& f)
+{
+    Jobs_ParallelForCall(inicio, fim, grao,
+                         [](const void* p, size_t a, size_t b) { (*(const Funcao*)p)(a, b); }, &f);
+}
+
+JobStats Jobs_Stats();
+
+#endif // _JOBS_H
@@ -0,0 +1,51 @@
+#ifndef _LINEOFSIGHT_H
+#define _LINEOFSIGHT_H
+
+#include <memory>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "bvh.h"
+
+// Linha de visão contra a geometria do cenário. Cada instância de um objeto
+// do cenário é registrada com a BVH da sua malha (construída uma vez, no
+// sistema do modelo) e a sua matriz de modelagem; o raio é levado ao sistema
+// do modelo de cada instância cuja caixa envolvente ele atravessa.
+//
+// O número de raios por passo da simulação é limitado por
+// g_LineOfSightBudget: quem faz as consultas (veja StatueAI_UpdateLineOfSight()
+// em "statueai.h") distribui os testes entre os passos.
+
+extern int g_LineOfSightBudget; // Raios por passo da simulação
+
+struct LineOfSightStats
+{
+    unsigned long queries;        // Raios lançados
+    unsigned long blocked;        // Raios bloqueados pelo cenário
+    unsigned long instance_tests; // Instâncias cuja BVH foi percorrida
+    BVHQueryStats bvh;            // Trabalho dentro das BVHs
+    int           last_step;      // Raios no último passo
+    int           max_step;       // Maior número de raios em um passo
+    unsigned long deferred;       // Consultas adiadas por falta de orçamento
+};
+
+void LineOfSight_AddOccluder(const std::shared_ptr<const BVH>& bvh, const glm::mat4& model, int celula);
+void LineOfSight_RemoveCell(int celula);
+
+// Início de um passo da simulação: zera o contador de raios do passo.
+void LineOfSight_BeginStep();
+
+// Raios que ainda podem ser lançados no passo atual.
+int LineOfSight_Remaining();
+
+// Registra consultas que ficaram para um passo seguinte.
+void LineOfSight_Defer(unsigned long n);
+
+// Verdadeiro se nenhum triângulo do cenário está entre "origem" e "destino".
+// Conta como um raio do passo atual.
+bool LineOfSight_Visible(const glm::vec3& origem, const glm::vec3& destino);
+
+LineOfSightStats LineOfSight_Stats();
+
+#endif // _LINEOFSIGHT_H
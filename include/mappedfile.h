@@ -0,0 +1,23 @@
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Arquivo mapeado em memória (somente leitura). Em Windows usa
+// CreateFileMapping()/MapViewOfFile(); nos demais sistemas, mmap().
+struct MappedFile
+{
+    const char* data;
+    size_t      size;
+    void*       handle;  // HANDLE do mapeamento (apenas Windows)
+};
+
+bool MappedFile_Open(MappedFile* file, const char* filename);
+void MappedFile_Close(MappedFile* file);
+
+// Tamanho e data de modificação de um arquivo, utilizados para invalidar
+// arquivos derivados (caches). Retorna false se o arquivo não existir.
+bool File_Stamp(const char* filename, uint64_t* size, int64_t* mtime);
+
+#endif // _MAPPEDFILE_H
@@ -214,11 +214,18 @@ float dotproduct(glm::vec4 u, glm::vec4 v)
     float v3 = v.z;
     float v4 = v.w;
 
+#ifdef MATRICES_CHECK_W
+    // Verificação só com -DMATRICES_CHECK_W (os alvos Debug do projeto do
+    // Code::Blocks): esta função é chamada em laços executados a cada quadro.
     if ( u4 != 0.0f || v4 != 0.0f )
     {
         fprintf(stderr, "ERROR: Produto escalar não definido para pontos.\n");
         std::exit(EXIT_FAILURE);
     }
+#else
+    (void)u4;
+    (void)v4;
+#endif
 
     return u1*v1 + u2*v2 + u3*v3;
 }
@@ -0,0 +1,79 @@
+#ifndef _MESHBUFFER_H
+#define _MESHBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// Geometria estática de todas as malhas em um único buffer de vértices e um
+// único buffer de índices, descritos por um só VAO. Cada malha ocupa uma
+// faixa de vértices e uma de índices, reservadas por alocadores TLSF (veja
+// "tlsf.h") e liberadas quando a malha é descarregada. Os índices de uma
+// malha são relativos ao seu primeiro vértice: o desenho usa
+// glDrawElementsBaseVertex(), e trocar de malha não troca de VAO.
+//
+// Os vértices são intercalados, com 28 bytes cada:
+//
+//   posição     3 floats                   (location = 0; w = 1)
+//   normal      GL_INT_2_10_10_10_REV      (location = 1; w ignorado)
+//   textura     2 floats                   (location = 2)
+//   tangente    GL_INT_2_10_10_10_REV      (location = 3; w = sinal da bitangente)
+//
+// Quando não há espaço, os blocos livres são primeiro compactados (se a
+// soma deles bastar) e, senão, o buffer cresce. Nos dois casos os dados são
+// copiados pela própria GPU, com glCopyBufferSubData(), para um buffer novo.
+
+#define MESHBUFFER_VERTEX_SIZE 28
+
+// Faixa de uma malha, para o desenho. Muda quando o buffer é compactado:
+// deve ser consultada a cada quadro.
+struct MeshBufferRange
+{
+    GLint    base_vertex;
+    uint32_t first_index;
+};
+
+struct MeshBufferStats
+{
+    size_t        vertex_bytes;      // Tamanho do buffer de vértices
+    size_t        vertex_bytes_used;
+    size_t        index_bytes;       // Tamanho do buffer de índices
+    size_t        index_bytes_used;
+    unsigned long meshes;            // Malhas no buffer
+    unsigned long free_blocks;       // Blocos livres (vértices e índices)
+    unsigned long grows;             // Vezes que um buffer cresceu
+    unsigned long defragmentations;
+    size_t        bytes_moved;       // Copiados pela GPU ao crescer e compactar
+};
+
+// Cria os buffers e o VAO, com espaço inicial para "vertices" vértices e
+// "indices" índices.
+void MeshBuffer_Init(uint32_t vertices, uint32_t indices);
+void MeshBuffer_Shutdown();
+
+GLuint MeshBuffer_VAO();
+
+// Envia uma malha. "positions", "normals" e "tangents" têm 4 floats por
+// vértice e "texcoords", 2 (como em MalhaPreparada); normals, texcoords e
+// tangents podem ser NULL. Os índices vão de 0 a num_vertices - 1. Retorna
+// o identificador da malha.
+uint32_t MeshBuffer_Upload(const float* positions, const float* normals,
+                           const float* texcoords, const float* tangents, size_t num_vertices,
+                           const uint32_t* indices, size_t num_indices);
+
+// Libera as faixas de uma malha.
+void MeshBuffer_Free(uint32_t mesh);
+
+MeshBufferRange MeshBuffer_Range(uint32_t mesh);
+
+// Bytes de memória de vídeo ocupados por uma malha
+size_t MeshBuffer_Bytes(uint32_t mesh);
+
+// Compacta as malhas no começo dos buffers. Retorna false se já estavam
+// compactadas.
+bool MeshBuffer_Defragment();
+
+MeshBufferStats MeshBuffer_Stats();
+
+#endif // _MESHBUFFER_H
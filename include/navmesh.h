@@ -0,0 +1,142 @@
+#ifndef _NAVMESH_H
+#define _NAVMESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// Malha de navegação das estátuas, construída a partir dos triângulos do
+// cenário (veja CollisionMesh_CollectTriangles() em "collisionmesh.h"):
+//
+// 1. Os triângulos são voxelizados em colunas de células de lado
+//    "cell_size" e altura "cell_height", guardando em cada coluna os
+//    intervalos sólidos; o topo de um intervalo é chão se o triângulo que o
+//    formou tem inclinação de até "max_slope" graus.
+// 2. Um chão só é caminhável se há "agent_height" livres acima dele. Dois
+//    chãos vizinhos se ligam se a diferença de altura é de até
+//    "agent_climb", e a área caminhável é erodida de "agent_radius", para
+//    que os caminhos possam encostar nas bordas.
+// 3. As células ligadas formam regiões (componentes conexas) e são agrupadas
+//    em retângulos de altura quase constante, que são os polígonos
+//    (convexos) da malha. Trechos da borda compartilhados por dois
+//    retângulos são os portais entre eles.
+//
+// As consultas de caminho fazem A* sobre os polígonos e suavizam o
+// resultado com o algoritmo do funil ("string pulling") sobre os portais.
+// Uma consulta não altera a malha, de modo que várias podem ser feitas ao
+// mesmo tempo; NavMesh_FindPaths() divide um lote de consultas entre as
+// threads de "jobs.h". A memória temporária vem da arena de rascunho de
+// cada thread (veja "framearena.h").
+
+#define NAVMESH_MAX_PATH      32 // Máximo de pontos em um caminho
+#define NAVMESH_MAX_POLY_SIZE 24 // Lado máximo de um polígono, em células
+#define NAVMESH_NONE          0xFFFFFFFFu
+
+struct NavMeshParams
+{
+    glm::vec3 min;          // Região voxelizada, no mundo
+    glm::vec3 max;
+    float     cell_size;
+    float     cell_height;
+    float     agent_height;
+    float     agent_radius;
+    float     agent_climb;
+    float     max_slope;    // Graus
+};
+
+// Retângulo [x0, x1] x [z0, z1] (no mundo) à altura "y"
+struct NavPoly
+{
+    float    x0, z0, x1, z1;
+    float    y;
+    uint32_t regiao;
+    uint32_t primeira_ligacao; // Em NavMesh::ligacoes
+    uint32_t num_ligacoes;
+};
+
+// Portal [a, b] do polígono de origem para "vizinho"
+struct NavLink
+{
+    glm::vec3 a;
+    glm::vec3 b;
+    uint32_t  vizinho;
+};
+
+struct NavMesh
+{
+    NavMeshParams params;
+    int largura;     // Colunas em x
+    int profundidade; // Colunas em z
+    uint32_t num_regioes;
+
+    std::vector<NavPoly>  poligonos;
+    std::vector<NavLink>  ligacoes;
+
+    // Polígonos que cobrem cada coluna: os de índice
+    // [inicio_coluna[c], inicio_coluna[c+1]) em poligonos_da_coluna
+    std::vector<uint32_t> inicio_coluna;
+    std::vector<uint32_t> poligonos_da_coluna;
+};
+
+struct NavMeshQuery
+{
+    glm::vec3 inicio;
+    glm::vec3 fim;
+    glm::vec3 extents; // Meia-caixa em que inicio e fim são procurados na malha
+};
+
+struct NavMeshPath
+{
+    uint32_t  num_pontos; // 0 se não há caminho
+    glm::vec3 pontos[NAVMESH_MAX_PATH];
+    float     comprimento;
+    bool      truncado;   // O caminho tinha mais que NAVMESH_MAX_PATH pontos
+    float     microssegundos; // Tempo gasto na consulta
+    uint32_t  nos;            // Polígonos expandidos pelo A*
+};
+
+struct NavMeshStats
+{
+    unsigned long queries;  // Consultas de caminho
+    unsigned long failed;   // Consultas sem caminho
+    unsigned long batches;  // Chamadas a NavMesh_FindPaths()
+    unsigned long nodes;    // Polígonos expandidos
+    double        total_us; // Soma dos tempos das consultas
+    double        max_us;   // Consulta mais demorada
+};
+
+// Constrói a malha a partir de "num_vertices" vértices no mundo, três por
+// triângulo.
+void NavMesh_Build(NavMesh* navmesh, const NavMeshParams& params,
+                   const glm::vec3* vertices, size_t num_vertices);
+
+// Cache da malha. A chave (veja NavMesh_Key()) resume os parâmetros e os
+// triângulos; o arquivo é ignorado se ela não for a mesma ou se os índices
+// nele apontarem para fora dos vetores da malha.
+uint64_t NavMesh_Key(const NavMeshParams& params, const glm::vec3* vertices, size_t num_vertices);
+bool NavMesh_SaveCache(const char* filename, uint64_t chave, const NavMesh& navmesh);
+bool NavMesh_LoadCache(const char* filename, uint64_t chave, NavMesh* navmesh);
+
+// Ponto da malha mais próximo de "p" dentro da caixa p +- extents, apenas
+// na região "regiao" se ela for dada. Retorna NAVMESH_NONE se não há
+// nenhum; senão o polígono, e o ponto em "ponto".
+uint32_t NavMesh_ClosestPoint(const NavMesh& navmesh, const glm::vec3& p, const glm::vec3& extents,
+                              glm::vec3* ponto, uint32_t regiao = NAVMESH_NONE);
+
+// Caminho de query.inicio a query.fim, ambos levados à malha. Retorna falso
+// (e num_pontos = 0) se um deles está fora da malha ou se estão em regiões
+// diferentes. Pode ser chamada de várias threads ao mesmo tempo; não
+// atualiza NavMesh_Stats().
+bool NavMesh_FindPath(const NavMesh& navmesh, const NavMeshQuery& query, NavMeshPath* caminho);
+
+// Responde "n" consultas, em paralelo quando são muitas.
+void NavMesh_FindPaths(const NavMesh& navmesh, const NavMeshQuery* queries, size_t n, NavMeshPath* caminhos);
+
+// Ponto à fração "t" (entre 0 e 1) do comprimento do caminho.
+glm::vec3 NavMesh_PathPoint(const NavMeshPath& caminho, float t);
+
+NavMeshStats NavMesh_Stats();
+
+#endif // _NAVMESH_H
@@ -0,0 +1,44 @@
+#ifndef _NORMALS_H
+#define _NORMALS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Normais dos vértices de malhas cujo arquivo ".obj" não as define.
+//
+// A normal de um vértice é a média ponderada das normais dos triângulos que
+// o compartilham (Gouraud). As normais dos triângulos são calculadas em
+// paralelo (veja "jobs.h"), quatro por vez com SSE; a soma por vértice é uma
+// passada sobre as quinas, na ordem dos triângulos. Com vincos, uma
+// adjacência vértice -> quinas em formato CSR (deslocamentos por vértice e
+// uma única lista de quinas) permite que cada quina some, em paralelo, os
+// triângulos vizinhos que lhe interessam. O resultado não depende do número
+// de threads.
+
+// Peso da normal de cada triângulo na média
+enum NormalsWeight
+{
+    NORMALS_AREA,  // Produto vetorial sem normalizar, proporcional à área
+    NORMALS_ANGLE  // Normal unitária vezes o ângulo do triângulo no vértice
+};
+
+// Com um ângulo de vinco menor que pi (radianos), cada quina usa apenas os
+// triângulos do vértice cuja normal difere da do seu triângulo por no máximo
+// esse ângulo: as arestas mais agudas ficam "duras". Com NORMALS_NO_CREASE
+// todas as quinas de um vértice têm a mesma normal.
+#define NORMALS_NO_CREASE 4.0f
+
+// Opções usadas na leitura dos modelos
+extern NormalsWeight g_NormalsWeight;
+extern float         g_NormalsCreaseAngle;
+
+// A quina q é o vértice q%3 do triângulo q/3, com posição
+// positions[stride*vertices[q] + 0..2]. Escreve a normal unitária de cada
+// quina em normals[normals_stride*q + 0..2]; uma quina sem área em volta
+// fica com normal zero.
+void Normals_Compute(const float* positions, size_t stride, size_t num_vertices,
+                     const uint32_t* vertices, size_t num_corners,
+                     float* normals, size_t normals_stride,
+                     NormalsWeight weight, float crease_angle);
+
+#endif // _NORMALS_H
@@ -0,0 +1,64 @@
+#ifndef _OBJPARSER_H
+#define _OBJPARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+// Leitura de arquivos ".obj" com o mesmo resultado de tinyobj::LoadObj(),
+// mas com o arquivo mapeado em memória (veja "mappedfile.h") e dividido em
+// pedaços de g_ObjParserChunkSize bytes, terminados em fim de linha, lidos
+// em paralelo (veja "jobs.h"):
+//
+//   1. Cada pedaço guarda seus vértices, normais, coordenadas de textura e
+//      faces (já trianguladas), e a posição dos comandos que mudam o estado
+//      da leitura ("g", "o", "usemtl", "mtllib", "t").
+//   2. Somas de prefixos sobre as contagens dos pedaços dão a posição de
+//      cada um nos vetores finais e corrigem os índices relativos
+//      (negativos) das faces.
+//   3. Os comandos são reproduzidos em ordem, na thread atual, decidindo
+//      a que "shape" e a que material pertence cada trecho de faces.
+//   4. Os trechos são copiados para as shapes em paralelo.
+//
+// Os números são convertidos com as mesmas operações de ponto flutuante de
+// tinyobj, trocando as chamadas a pow() por tabelas calculadas com a própria
+// pow(): o resultado é idêntico bit a bit.
+
+extern size_t g_ObjParserChunkSize;
+
+// Mesmos argumentos e resultado de tinyobj::LoadObj(). Os arquivos ".mtl"
+// são lidos por tinyobj::MaterialFileReader.
+bool ObjParser_Load(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                    std::vector<tinyobj::material_t>* materials, std::string* err,
+                    const char* filename, const char* mtl_basepath = NULL,
+                    bool triangulate = true);
+
+// Número de elementos de um arquivo ".obj", contados em paralelo, para
+// reservar de uma vez os vetores preenchidos por
+// ObjParser_LoadWithCallback(). Um arquivo vazio tem todas as contagens
+// zero; retorna false se o arquivo não existir.
+struct ObjParserCounts
+{
+    size_t vertices;  // Linhas "v"
+    size_t normals;   // Linhas "vn"
+    size_t texcoords; // Linhas "vt"
+    size_t faces;     // Linhas "f"
+    size_t triangles; // Triângulos das faces, trianguladas em leque
+};
+
+bool ObjParser_Count(const char* filename, ObjParserCounts* counts);
+
+// Leitura em fluxo, com os mesmos callbacks de tinyobj::LoadObjWithCallback():
+// cada linha é entregue ao callback na ordem do arquivo, sem montar
+// attrib_t e shape_t, e quem chama guarda apenas o que precisa. Os índices
+// das faces são os do arquivo (1 = primeiro, negativos = relativos ao fim,
+// 0 = ausente). Diferente de tinyobj, os materiais não são descartados a
+// cada "mtllib": mtllib_cb recebe os materiais novos e os números passados
+// a usemtl_cb indexam a concatenação de todos eles.
+bool ObjParser_LoadWithCallback(const char* filename, const tinyobj::callback_t& callback,
+                                void* user_data = NULL, tinyobj::MaterialReader* readMatFn = NULL,
+                                std::string* err = NULL);
+
+#endif // _OBJPARSER_H
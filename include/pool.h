@@ -0,0 +1,170 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Conjunto de entidades (colisores, por exemplo) com os dados divididos em
+// duas partes: "Quente", percorrida a cada passo, e "Fria", lida raramente.
+// Cada parte fica em um vetor denso, sem buracos, de modo que percorrer os
+// dados quentes não traz os frios para a cache.
+//
+// Os handles não mudam enquanto a entidade existir: apontam para uma
+// posição de um vetor de indireção, que guarda o índice denso atual e uma
+// geração, incrementada quando a posição é reaproveitada (pela lista de
+// posições livres), para que um handle antigo seja reconhecido como
+// inválido. Depois de Pool_Reserve(), adicionar e remover entidades não
+// aloca memória.
+//
+// Pool_Remove() move a última entidade para o lugar da removida; já
+// Pool_RemoveIf() mantém a ordem das que ficam, para vetores paralelos
+// compactados da mesma forma (veja "statueai.h").
+
+#define POOL_NENHUM 0xFFFFFFFFu
+
+struct PoolHandle
+{
+    uint32_t slot;
+    uint32_t geracao;
+};
+
+template <typename Quente, typename Fria>
+struct Pool
+{
+    std::vector<Quente>   quente;
+    std::vector<Fria>     fria;
+    std::vector<uint32_t> slot_de;  // Posição de indireção de cada entidade
+
+    std::vector<uint32_t> indice;   // Índice denso de cada posição (POOL_NENHUM se livre)
+    std::vector<uint32_t> geracao;
+    std::vector<uint32_t> livres;   // Posições livres, usadas como pilha
+};
+
+template <typename Quente, typename Fria>
+size_t Pool_Size(const Pool<Quente, Fria>& p)
+{
+    return p.quente.size();
+}
+
+template <typename Quente, typename Fria>
+void Pool_Reserve(Pool<Quente, Fria>* p, size_t n)
+{
+    p->quente.reserve(n);
+    p->fria.reserve(n);
+    p->slot_de.reserve(n);
+    p->indice.reserve(n);
+    p->geracao.reserve(n);
+    p->livres.reserve(n);
+}
+
+template <typename Quente, typename Fria>
+PoolHandle Pool_Add(Pool<Quente, Fria>* p, const Quente& quente, const Fria& fria)
+{
+    PoolHandle h;
+    if (!p->livres.empty())
+    {
+        h.slot = p->livres.back();
+        p->livres.pop_back();
+    }
+    else
+    {
+        h.slot = (uint32_t)p->indice.size();
+        p->indice.push_back(POOL_NENHUM);
+        p->geracao.push_back(0);
+    }
+    h.geracao = p->geracao[h.slot];
+
+    p->indice[h.slot] = (uint32_t)p->quente.size();
+    p->quente.push_back(quente);
+    p->fria.push_back(fria);
+    p->slot_de.push_back(h.slot);
+    return h;
+}
+
+template <typename Quente, typename Fria>
+bool Pool_Valid(const Pool<Quente, Fria>& p, PoolHandle h)
+{
+    return h.slot < p.indice.size() && p.indice[h.slot] != POOL_NENHUM && p.geracao[h.slot] == h.geracao;
+}
+
+// Índice denso da entidade, válido até a próxima remoção
+template <typename Quente, typename Fria>
+size_t Pool_Index(const Pool<Quente, Fria>& p, PoolHandle h)
+{
+    return p.indice[h.slot];
+}
+
+template <typename Quente, typename Fria>
+PoolHandle Pool_Handle(const Pool<Quente, Fria>& p, size_t i)
+{
+    PoolHandle h;
+    h.slot    = p.slot_de[i];
+    h.geracao = p.geracao[h.slot];
+    return h;
+}
+
+template <typename Quente, typename Fria>
+inline void Pool_LiberaSlot(Pool<Quente, Fria>* p, uint32_t slot)
+{
+    p->indice[slot]   = POOL_NENHUM;
+    p->geracao[slot] += 1;
+    p->livres.push_back(slot);
+}
+
+// Remove a entidade, se o handle for válido.
+template <typename Quente, typename Fria>
+bool Pool_Remove(Pool<Quente, Fria>* p, PoolHandle h)
+{
+    if (!Pool_Valid(*p, h))
+        return false;
+
+    uint32_t i      = p->indice[h.slot];
+    uint32_t ultimo = (uint32_t)p->quente.size() - 1;
+    if (i != ultimo)
+    {
+        p->quente[i]  = p->quente[ultimo];
+        p->fria[i]    = p->fria[ultimo];
+        p->slot_de[i] = p->slot_de[ultimo];
+        p->indice[p->slot_de[i]] = i;
+    }
+    p->quente.pop_back();
+    p->fria.pop_back();
+    p->slot_de.pop_back();
+    Pool_LiberaSlot(p, h.slot);
+    return true;
+}
+
+// Remove as entidades para as quais remove(quente, fria) é verdadeiro,
+// mantendo a ordem das demais. Retorna quantas foram removidas.
+template <typename Quente, typename Fria, typename Predicado>
+size_t Pool_RemoveIf(Pool<Quente, Fria>* p, Predicado remove)
+{
+    // Até a primeira removida nada muda de lugar: só percorre
+    const size_t n = p->quente.size();
+    size_t i = 0;
+    while (i < n && !remove(p->quente[i], p->fria[i]))
+        ++i;
+
+    size_t j = i;
+    for (; i < n; ++i)
+    {
+        if (remove(p->quente[i], p->fria[i]))
+        {
+            Pool_LiberaSlot(p, p->slot_de[i]);
+            continue;
+        }
+        p->quente[j]  = p->quente[i];
+        p->fria[j]    = p->fria[i];
+        p->slot_de[j] = p->slot_de[i];
+        p->indice[p->slot_de[j]] = (uint32_t)j;
+        j += 1;
+    }
+
+    p->quente.resize(j);
+    p->fria.resize(j);
+    p->slot_de.resize(j);
+    return n - j;
+}
+
+#endif // _POOL_H
@@ -0,0 +1,150 @@
+#ifndef _RENDERQUEUE_H
+#define _RENDERQUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// Fila de desenho de um quadro. Os objetos são coletados com uma chave de
+// 64 bits e ordenados por radix sort. A lista ordenada é então codificada em
+// um fluxo compacto de comandos, com apenas as mudanças de estado (VAO,
+// "object_id", material, caixa envolvente, mapa de normais, teste de
+// profundidade) que de fato alteram o estado atual, e a thread do OpenGL só
+// reproduz esse fluxo. A codificação não usa OpenGL; veja "drawlist.h" para
+// a coleta em várias threads.
+//
+// Chave, do bit mais significativo para o menos:
+//
+//   passo (4) | variante do shader (8) | material (12) | VAO (16) | profundidade (24)
+//
+// de modo que objetos do mesmo passo, variante, material e VAO ficam juntos
+// e, dentro de cada grupo, são desenhados da frente para trás.
+
+// Unidade de textura do mapa de normais ("NormalMap" em
+// "shader_fragment.glsl"). As texturas da cena ocupam as primeiras unidades.
+#define RENDER_NORMAL_MAP_UNIT 15
+
+enum RenderPass
+{
+    RENDERPASS_OPACO      = 0, // Com teste de profundidade
+    RENDERPASS_SOBREPOSTO = 1  // Sem teste de profundidade, depois dos opacos (a arma)
+};
+
+struct RenderMaterial
+{
+    glm::vec3 Ka;
+    glm::vec3 Kd;
+    glm::vec3 Ks;
+    glm::vec3 Ke;
+};
+
+struct RenderItem
+{
+    uint64_t  chave;        // Preenchida por RenderQueue_Add()
+    int       passo;        // RenderPass
+    int       object_id;    // Variante do fragment shader
+    bool      material;     // Se falso, mantém o material atual
+    RenderMaterial coeficientes;
+    GLuint    vao;
+    GLenum    rendering_mode;
+    GLsizei   num_indices;
+    size_t    first_index;
+    GLint     base_vertex;  // Somado aos índices (veja "meshbuffer.h")
+    glm::vec3 bbox_min;     // Caixa do modelo, para o mapeamento de texturas
+    glm::vec3 bbox_max;
+    GLuint    mapa_normal;  // Textura do mapa de normais (0 se não houver)
+    glm::mat4 model;
+    float     profundidade; // Em [0, 1], 0 = mais perto da câmera
+};
+
+// Localizações das variáveis do programa de GPU
+struct RenderUniforms
+{
+    GLuint program;
+    GLint  model;
+    GLint  object_id;
+    GLint  bbox_min;
+    GLint  bbox_max;
+    GLint  Ka;
+    GLint  Kd;
+    GLint  Ks;
+    GLint  Ke;
+    GLint  normal_mapped;
+};
+
+// Comandos emitidos (contados em RenderQueue_Encode())
+struct RenderQueueStats
+{
+    unsigned long frames;
+    unsigned long draws;
+    unsigned long program_changes;
+    unsigned long vao_changes;
+    unsigned long variant_changes;  // glUniform1i de "object_id"
+    unsigned long material_changes; // Ka, Kd, Ks e Ke
+    unsigned long bbox_changes;
+    unsigned long normal_map_changes; // Textura e "normal_mapped"
+    unsigned long depth_changes;    // glEnable/glDisable(GL_DEPTH_TEST)
+};
+
+struct ChaveDeDesenho
+{
+    uint64_t chave;
+    uint32_t item;
+};
+
+// Palavras de 32 bits: o código do comando seguido dos seus argumentos
+// (floats são copiados bit a bit).
+struct RenderCommandStream
+{
+    std::vector<uint32_t> palavras;
+    RenderQueueStats      stats;
+};
+
+struct RenderQueue
+{
+    std::vector<RenderItem>     itens;
+    std::vector<ChaveDeDesenho> ordem;
+    std::vector<ChaveDeDesenho> temp;
+    RenderCommandStream         comandos;
+};
+
+// Esvazia a fila para um novo quadro.
+void RenderQueue_Begin(RenderQueue* q);
+
+// Calcula a chave do item e o adiciona à fila.
+void RenderQueue_Add(RenderQueue* q, const RenderItem& item);
+
+// Chave do item. O campo do material é um resumo dos coeficientes (0 se
+// o item não tem material): materiais iguais ficam juntos.
+uint64_t RenderQueue_Key(const RenderItem& item);
+
+// Ordena as chaves (radix sort de 8 bits por passada, estável); "temp" é
+// usado como área de trabalho.
+void RenderQueue_SortKeys(std::vector<ChaveDeDesenho>* chaves, std::vector<ChaveDeDesenho>* temp);
+void RenderQueue_Sort(RenderQueue* q);
+
+// Palavras de um item no fluxo no pior caso, em que ele emite todos os
+// comandos.
+#define RENDERQUEUE_MAX_PALAVRAS 49
+
+// Codifica os itens na ordem dada, omitindo mudanças de estado redundantes.
+void RenderQueue_Encode(const RenderItem* itens, const std::vector<ChaveDeDesenho>& ordem,
+                        RenderCommandStream* saida);
+
+// Reproduz os comandos na thread do OpenGL. Ao fim, o VAO é desligado e o
+// teste de profundidade fica habilitado.
+void RenderQueue_Replay(const RenderCommandStream& comandos, const RenderUniforms& u);
+
+// RenderQueue_Encode() seguido de RenderQueue_Replay(), na ordem de
+// RenderQueue_Sort().
+void RenderQueue_Submit(RenderQueue* q, const RenderUniforms& u);
+
+RenderQueueStats RenderQueue_LastFrame(); // Do último RenderQueue_Replay()
+RenderQueueStats RenderQueue_Totals();
+
+#endif // _RENDERQUEUE_H
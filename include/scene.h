@@ -0,0 +1,107 @@
+#ifndef _SCENE_H
+#define _SCENE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+// Descrição de uma cena (nível): texturas, malhas, planos de colisão e
+// instâncias com seus colisores e caminhos de fuga (curvas de Bézier).
+//
+// A cena é escrita em um arquivo texto (veja "data/cena.scene") e, na
+// primeira leitura, convertida para uma forma binária ("<arquivo>.bin") cujos
+// registros têm tamanho fixo. A forma binária é mapeada em memória e usada
+// diretamente, sem nenhuma conversão.
+//
+// Uma cena também pode dividir o mundo em células quadradas no plano XZ
+// ("cellsize" e "cell"). Cada célula é outro arquivo de cena, com posições
+// relativas à origem da célula, carregado e descarregado sob demanda (veja
+// "worldstream.h").
+
+#define SCENE_NAME_LEN 64
+#define SCENE_PATH_LEN 128
+
+struct SceneTextureDesc
+{
+    char filename[SCENE_PATH_LEN];
+};
+
+struct SceneMeshDesc
+{
+    char     filename[SCENE_PATH_LEN];
+    char     basepath[SCENE_PATH_LEN]; // Diretório dos arquivos ".mtl" ("" se não houver)
+    uint32_t env;                      // Se 1, os objetos da malha são desenhados como cenário
+};
+
+struct ScenePlaneDesc
+{
+    float n[3]; // Normal
+    float d;    // Distância da origem
+};
+
+enum SceneColliderType
+{
+    SCENE_COLLIDER_CUBE   = 0,
+    SCENE_COLLIDER_SPHERE = 1
+};
+
+struct SceneInstanceDesc
+{
+    char     object[SCENE_NAME_LEN]; // Nome do objeto em g_VirtualScene
+    uint32_t collider;               // SceneColliderType
+    int32_t  material;               // Material da malha copiado para a instância (-1 = nenhum)
+    float    pos[3];
+    float    scale;
+    float    center_offset[3];       // Centro da esfera de colisão relativo a "pos"
+    float    path[4][3];             // Pontos de controle do caminho de fuga
+};
+
+struct SceneCellDesc
+{
+    int32_t x;                      // Coordenadas da célula na grade
+    int32_t z;
+    char    filename[SCENE_PATH_LEN];
+};
+
+struct SceneDescription
+{
+    // Apontam para a memória mapeada (forma binária) ou para os vetores abaixo
+    // (forma texto).
+    const SceneTextureDesc*  textures;
+    const SceneMeshDesc*     meshes;
+    const ScenePlaneDesc*    planes;
+    const SceneInstanceDesc* instances;
+    const SceneCellDesc*     cells;
+    uint32_t num_textures;
+    uint32_t num_meshes;
+    uint32_t num_planes;
+    uint32_t num_instances;
+    uint32_t num_cells;
+    float    cell_size;                // Lado das células (0 se não houver células)
+
+    std::vector<SceneTextureDesc>  texture_storage;
+    std::vector<SceneMeshDesc>     mesh_storage;
+    std::vector<ScenePlaneDesc>    plane_storage;
+    std::vector<SceneInstanceDesc> instance_storage;
+    std::vector<SceneCellDesc>     cell_storage;
+    MappedFile                     baked;
+};
+
+// Lê a forma texto da cena.
+bool Scene_Parse(const char* filename, SceneDescription* scene, std::string* err);
+
+// Grava a forma binária da cena.
+bool Scene_Bake(const SceneDescription& scene, const char* filename, const char* source);
+
+// Mapeia a forma binária da cena.
+bool Scene_LoadBaked(const char* filename, SceneDescription* scene);
+
+// Usa "<filename>.bin" se estiver atualizado; caso contrário lê a forma texto
+// e grava a forma binária para as próximas execuções.
+bool Scene_Load(const char* filename, SceneDescription* scene, std::string* err);
+
+void Scene_Free(SceneDescription* scene);
+
+#endif // _SCENE_H
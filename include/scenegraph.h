@@ -0,0 +1,79 @@
+#ifndef _SCENEGRAPH_H
+#define _SCENEGRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Hierarquia de transformações. Cada nó guarda posição, rotação e escala
+// relativas ao pai (TRS); a matriz no mundo é mundo(pai) * T * R * S e é
+// recalculada a partir dos componentes, nunca acumulada, de modo que mover
+// um objeto muitas vezes não introduz erro na matriz.
+//
+// Os nós ficam em vetores ordenados topologicamente (o pai sempre vem antes
+// do filho), então SceneGraph_Update() percorre os nós uma única vez:
+// um nó é recalculado se os seus componentes mudaram ou se o pai foi
+// recalculado no mesmo Update(). Hierarquias grandes são atualizadas nível a
+// nível, com os nós de cada nível divididos entre várias threads.
+
+struct SceneGraph
+{
+    SceneGraph() : num_sujos(0), houve_mudanca(false), niveis_validos(true) {}
+
+    std::vector<int32_t>   pai;     // -1 nas raízes
+    std::vector<glm::vec3> posicao; // Relativas ao pai
+    std::vector<glm::quat> rotacao;
+    std::vector<glm::vec3> escala;
+    std::vector<glm::mat4> mundo;   // Válida após SceneGraph_Update()
+    std::vector<uint8_t>   sujo;    // Componentes alterados desde o último Update()
+    std::vector<uint8_t>   mudou;   // Matriz recalculada no último Update()
+    std::vector<uint8_t>   livre;   // Posição sem nó (removido), reaproveitável
+    std::vector<int32_t>   nivel;   // Profundidade na hierarquia
+
+    std::set<int32_t> livres;        // Índices livres, em ordem
+    size_t            num_sujos;
+    bool              houve_mudanca; // Algum "mudou" está ligado
+
+    std::vector<std::vector<int32_t> > niveis; // Nós de cada profundidade, para o Update() paralelo
+    bool                               niveis_validos;
+};
+
+struct SceneGraphStats
+{
+    unsigned long updates;    // Chamadas de SceneGraph_Update() com nós sujos
+    unsigned long recomputed; // Matrizes recalculadas
+    unsigned long parallel;   // Updates feitos com várias threads
+};
+
+// Adiciona um nó filho de "pai" (-1 para uma raiz) e retorna o seu índice,
+// que não muda enquanto o nó existir. A matriz no mundo já é calculada, e
+// é válida se a do pai estiver.
+int SceneGraph_Add(SceneGraph* g, int pai, const glm::vec3& posicao,
+                   const glm::quat& rotacao, const glm::vec3& escala);
+
+// Remove o nó e todos os seus descendentes.
+void SceneGraph_Remove(SceneGraph* g, int no);
+
+void SceneGraph_SetPosition(SceneGraph* g, int no, const glm::vec3& posicao);
+void SceneGraph_SetRotation(SceneGraph* g, int no, const glm::quat& rotacao);
+void SceneGraph_SetScale(SceneGraph* g, int no, const glm::vec3& escala);
+
+// Recalcula as matrizes dos nós alterados e dos seus descendentes.
+void SceneGraph_Update(SceneGraph* g);
+
+inline const glm::mat4& SceneGraph_World(const SceneGraph& g, int no) { return g.mundo[no]; }
+
+// Verdadeiro se a matriz do nó foi recalculada no último SceneGraph_Update()
+inline bool SceneGraph_Changed(const SceneGraph& g, int no) { return g.mudou[no] != 0; }
+
+SceneGraphStats SceneGraph_Stats();
+
+// A partir de quantos nós SceneGraph_Update() usa várias threads.
+extern size_t g_SceneGraphParallelThreshold;
+
+#endif // _SCENEGRAPH_H
@@ -0,0 +1,91 @@
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include <functional>
+#include <mutex>
+
+// Simulação com passo fixo, independente da taxa de quadros.
+//
+// A lógica do jogo avança sempre em passos de g_SimulationStep segundos. Na
+// thread de renderização, SimulationClock acumula o tempo de cada quadro e
+// diz quantos passos executar; alternativamente, SimulationThread_Start()
+// executa os passos em uma thread própria, no ritmo do relógio.
+//
+// Em ambos os casos, ao fim de cada passo a simulação publica o estado
+// necessário para desenhar a cena em SimulationSnapshots. A renderização lê
+// os dois últimos estados publicados e interpola entre eles.
+
+extern double g_SimulationStep;     // Duração de um passo (em segundos)
+extern int    g_SimulationMaxSteps; // Máximo de passos recuperados de uma vez
+
+struct SimulationClock
+{
+    double        accumulator; // Tempo ainda não simulado
+    double        time;        // Tempo simulado desde o início
+    unsigned long steps;       // Passos executados
+};
+
+void Simulation_InitClock(SimulationClock* clock);
+
+// Acrescenta "frame_time" segundos e retorna quantos passos devem ser
+// executados. Atrasos maiores que g_SimulationMaxSteps passos são descartados.
+int Simulation_Advance(SimulationClock* clock, double frame_time);
+
+// Fração do próximo passo já decorrida (entre 0 e 1), usada na interpolação.
+float Simulation_Alpha(const SimulationClock& clock);
+
+// Relógio monotônico (em segundos) comum às threads de simulação e renderização.
+double Simulation_Now();
+
+// Executada a cada passo: "dt" é a duração do passo e "time" o instante
+// simulado ao fim dele.
+typedef std::function<void(double dt, double time)> SimulationStepFunction;
+
+// Executa "passo" em uma thread auxiliar, a cada g_SimulationStep segundos de
+// Simulation_Now().
+void SimulationThread_Start(SimulationStepFunction passo);
+void SimulationThread_Stop();
+bool SimulationThread_Running();
+
+// Dois estados publicados pela simulação: o anterior e o atual. Publish()
+// sobrescreve o anterior, que passa a ser o atual.
+template <typename Estado>
+class SimulationSnapshots
+{
+public:
+    SimulationSnapshots() : m_Atual(0), m_Publicados(0)
+    {
+        m_Tempos[0] = m_Tempos[1] = 0.0;
+    }
+
+    void Publish(const Estado& estado, double tempo)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Atual = 1 - m_Atual;
+        m_Estados[m_Atual] = estado;
+        m_Tempos[m_Atual]  = tempo;
+        m_Publicados += 1;
+    }
+
+    // Copia os dois últimos estados. Retorna false se nada foi publicado;
+    // com apenas um estado publicado, "anterior" é igual a "atual".
+    bool Read(Estado* anterior, Estado* atual, double* tempo_atual)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Publicados == 0)
+            return false;
+        *atual       = m_Estados[m_Atual];
+        *anterior    = m_Publicados > 1 ? m_Estados[1 - m_Atual] : m_Estados[m_Atual];
+        *tempo_atual = m_Tempos[m_Atual];
+        return true;
+    }
+
+private:
+    std::mutex    m_Mutex;
+    Estado        m_Estados[2];
+    double        m_Tempos[2];
+    int           m_Atual;
+    unsigned long m_Publicados;
+};
+
+#endif // _SIMULATION_H
@@ -0,0 +1,125 @@
+#ifndef _STATUEAI_H
+#define _STATUEAI_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "bezierpath.h"
+#include "navmesh.h"
+#include "flowfield.h"
+
+// Comportamento das estátuas: uma estátua observada pelo jogador (dentro de
+// um cone de STATUEAI_VIEW_ANGLE graus em torno da direção de visão, sem
+// paredes no caminho) por STATUEAI_WATCH_TIME segundos passa a fugir pelo
+// seu caminho (curva de Bézier cúbica), com a fração percorrida dada por uma
+// sigmoide do tempo.
+//
+// Se há uma malha de navegação (veja "navmesh.h"), StatueAI_PlanEscapes()
+// troca o caminho fixo de cada estátua que começa a fugir por uma rota pela
+// malha, para longe do jogador, e a estátua contorna as paredes em vez de
+// atravessá-las. As estátuas fora da malha, ou além de STATUEAI_MAX_ROTAS
+// rotas ao mesmo tempo, continuam usando o caminho fixo.
+//
+// Com muitas estátuas (a partir de g_StatueAIFlowFieldThreshold), uma rota
+// por estátua fica cara: as que começam a fugir passam a seguir o campo de
+// fuga (veja "flowfield.h"), comum a todas, em StatueAI_Steer(), que também
+// as afasta das estátuas vizinhas (encontradas com uma tabela de espalhamento
+// espacial). A velocidade segue a mesma sigmoide do caminho fixo.
+//
+// O estado de todas as estátuas fica em vetores separados por campo
+// (structure of arrays), na mesma ordem de Cubes_Collisions["statue"]. O
+// teste de visibilidade é feito quatro estátuas por vez com SSE, comparando
+// o cosseno do ângulo com um valor pré-calculado, e grandes quantidades de
+// estátuas são divididas entre várias threads.
+
+#define STATUEAI_VIEW_ANGLE 25.0f // Metade da abertura do cone de visão (graus)
+#define STATUEAI_WATCH_TIME 5.0f  // Tempo observada até começar a fugir (s)
+#define STATUEAI_ESCAPE_DISTANCE 15.0f // Distância (no plano) até o destino da fuga
+#define STATUEAI_MAX_ROTAS 1024   // Rotas pela malha de navegação ao mesmo tempo
+
+#define STATUEAI_ROTA_PENDENTE 0xFFFFFFFFu // Ainda sem rota (não fugiu)
+#define STATUEAI_SEM_ROTA      0xFFFFFFFEu // Usa o caminho fixo
+#define STATUEAI_ROTA_CAMPO    0xFFFFFFFDu // Segue o campo de fuga
+
+#define STATUEAI_SEPARATION_RADIUS 1.5f // Distância mínima desejada entre estátuas
+#define STATUEAI_SEPARATION_WEIGHT 1.5f // Peso da separação em relação ao campo
+
+struct StatueAI
+{
+    StatueAI() : count(0), proxima_consulta(0) {}
+
+    size_t count;
+
+    // Centro da caixa envolvente de cada estátua, no sistema do mundo
+    std::vector<float> centro_x;
+    std::vector<float> centro_y;
+    std::vector<float> centro_z;
+
+    // Deslocamento do centro no último StatueAI_Update()
+    std::vector<float> desloc_x;
+    std::vector<float> desloc_y;
+    std::vector<float> desloc_z;
+
+    std::vector<int32_t> visto;       // 1 se a estátua já está fugindo
+    std::vector<int32_t> desobstruida; // 1 se a última linha de visão testada não foi bloqueada
+    std::vector<float>   tempo_visto;
+    std::vector<float>   t;           // Fração já percorrida do caminho de fuga
+
+    BezierPathBatch caminhos; // Caminhos de fuga
+
+    // Índice em "rotas" da rota de cada estátua pela malha de navegação, ou
+    // STATUEAI_ROTA_PENDENTE/STATUEAI_SEM_ROTA/STATUEAI_ROTA_CAMPO
+    std::vector<uint32_t>    rota;
+    std::vector<NavMeshPath> rotas;        // Com capacidade para STATUEAI_MAX_ROTAS
+    std::vector<uint32_t>    rotas_livres;
+
+    std::vector<int> celula; // Célula do mundo que criou a estátua (-1 = cena principal)
+
+    size_t proxima_consulta; // Primeira estátua da próxima rodada de linhas de visão
+};
+
+void StatueAI_Add(StatueAI* ai, const glm::vec4& centro, const glm::vec3 path[4], int celula);
+
+// Remove as estátuas de uma célula do mundo, mantendo a ordem das demais.
+void StatueAI_RemoveCell(StatueAI* ai, int celula);
+
+// Testa a linha de visão (veja "lineofsight.h") do jogador até as estátuas
+// de [first, first+count) que estão no cone de visão e ainda não fogem,
+// gastando no máximo LineOfSight_Remaining() raios. As que não couberem no
+// orçamento mantêm o resultado anterior e são as primeiras do próximo passo.
+void StatueAI_UpdateLineOfSight(StatueAI* ai, size_t first, size_t count,
+                                const glm::vec4& light_pos, const glm::vec4& view_vector);
+
+// Avança "dt" segundos das estátuas [first, first+count). "light_pos" é o
+// ponto de onde o jogador observa e "view_vector" a direção (unitária) de
+// visão. Só conta como observada a estátua no cone de visão cuja última
+// linha de visão testada estava desobstruída.
+void StatueAI_Update(StatueAI* ai, size_t first, size_t count,
+                     const glm::vec4& light_pos, const glm::vec4& view_vector, float dt);
+
+// Escolhe a rota pela malha de navegação das estátuas de [first,
+// first+count) que começaram a fugir no último StatueAI_Update(): para
+// longe de "light_pos", com as consultas de caminho feitas em lote (veja
+// NavMesh_FindPaths()). Com um campo de fuga ("campo" não NULL), elas o
+// seguem se são muitas estátuas ou se não há caminho. Sem malha nem campo
+// (ambos NULL), seguem o caminho fixo.
+void StatueAI_PlanEscapes(StatueAI* ai, const NavMesh* navmesh, const FlowField* campo,
+                          size_t first, size_t count, const glm::vec4& light_pos);
+
+// Move as estátuas de [first, first+count) que seguem o campo de fuga,
+// depois de StatueAI_Update(), somando o movimento a desloc_x/y/z.
+void StatueAI_Steer(StatueAI* ai, const FlowField& campo, size_t first, size_t count, float dt);
+
+// A partir de quantas estátuas StatueAI_Update() usa várias threads.
+extern size_t g_StatueAIParallelThreshold;
+
+// A partir de quantas estátuas as que fogem seguem o campo de fuga, e a
+// partir de quantas StatueAI_Steer() usa várias threads.
+extern size_t g_StatueAIFlowFieldThreshold;
+extern size_t g_StatueAISteerParallelThreshold;
+
+#endif // _STATUEAI_H
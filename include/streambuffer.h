@@ -0,0 +1,63 @@
+#ifndef _STREAMBUFFER_H
+#define _STREAMBUFFER_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// Buffer circular para dados que mudam a cada quadro (vértices do texto e,
+// futuramente, instâncias e uniform buffers). O buffer é dividido em três
+// regiões, uma por quadro: enquanto a CPU escreve na região do quadro atual,
+// a GPU ainda pode estar lendo as dos dois quadros anteriores. Ao fim do
+// quadro, StreamBuffer_EndFrame() coloca uma fence atrás dos comandos que
+// usam a região; ela só é reutilizada três quadros depois, quando a fence
+// já foi sinalizada. Se não foi, a CPU espera, e a espera é contada em
+// StreamBufferStats::stalls.
+//
+// Com GL_ARB_buffer_storage o buffer fica mapeado o tempo todo (mapeamento
+// persistente e coerente). Sem ele (OpenGL 3.3 puro), cada alocação mapeia
+// a sua faixa com GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT,
+// já que as fences garantem que a GPU não a está lendo, e a faixa precisa
+// ser desmapeada com StreamBuffer_Commit() antes do desenho.
+//
+// Apenas a thread de renderização usa estas funções.
+
+struct StreamAllocation
+{
+    void*    ptr;    // Onde a CPU escreve os "bytes" pedidos
+    GLintptr offset; // Posição correspondente em "buffer"
+    GLuint   buffer; // Muda quando o buffer cresce
+};
+
+struct StreamBufferStats
+{
+    size_t        frame_bytes;    // Tamanho de cada uma das três regiões
+    size_t        peak_bytes;     // Maior uso de uma região em um quadro
+    unsigned long frames;
+    unsigned long allocations;
+    unsigned long stalls;         // Quadros em que a região ainda estava em uso
+    double        stall_ms;       // Tempo total esperando as fences
+    unsigned long grows;          // Regiões que não bastaram para um quadro
+    bool          persistent;     // GL_ARB_buffer_storage disponível
+};
+
+// Cria o buffer com três regiões de "frame_bytes" bytes. Exige um contexto
+// OpenGL atual.
+void StreamBuffer_Init(size_t frame_bytes);
+void StreamBuffer_Shutdown();
+
+// Reserva "bytes" bytes na região do quadro atual, com "offset" múltiplo de
+// "align". Se a região não bastar, o buffer é trocado por um com o dobro do
+// tamanho (os desenhos já emitidos continuam lendo o buffer antigo).
+StreamAllocation StreamBuffer_Allocate(size_t bytes, size_t align);
+
+// Termina as escritas da última alocação: deve ser chamada antes de
+// desenhar com ela. Não faz nada com mapeamento persistente.
+void StreamBuffer_Commit();
+
+// Chamada uma vez por quadro, depois do último desenho que usa o buffer.
+void StreamBuffer_EndFrame();
+
+StreamBufferStats StreamBuffer_Stats();
+
+#endif // _STREAMBUFFER_H
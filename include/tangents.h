@@ -0,0 +1,45 @@
+#ifndef _TANGENTS_H
+#define _TANGENTS_H
+
+#include <cstddef>
+
+// Tangentes dos vértices para mapas de normais, no mesmo espaço tangente de
+// MikkTSpace (o usado pelos programas que geram os mapas):
+//
+//   1. A tangente e a bitangente de cada triângulo saem das derivadas das
+//      coordenadas de textura, normalizadas e com o sentido invertido nos
+//      triângulos de textura espelhada.
+//   2. Em cada quina elas são projetadas no plano da normal da quina e
+//      pesadas pelo ângulo do triângulo nesse plano.
+//   3. As quinas com posição, normal e coordenada de textura iguais são
+//      soldadas, separando as de orientação diferente, e compartilham a soma.
+//
+// O resultado é um vec4: a tangente unitária em xyz e, em w, o sinal da
+// bitangente, calculada no shader como w * cross(normal, tangente). Os
+// triângulos são processados em paralelo (veja "jobs.h"); a soldagem divide
+// as quinas pelos bits mais altos de um hash, e cada parte é resolvida por
+// uma tarefa, somando na ordem das quinas. O resultado não depende do
+// número de threads.
+//
+// Diferença de MikkTSpace: lá os triângulos de um vértice só são somados se
+// estiverem ligados por arestas em volta dele. Aqui basta compartilharem o
+// vértice soldado, o que dá o mesmo resultado em malhas sem arestas com
+// mais de dois triângulos.
+
+// A quina q é o vértice q%3 do triângulo q/3. Lê positions[position_stride*q
+// + 0..2], normals[normal_stride*q + 0..2] e texcoords[texcoord_stride*q +
+// 0..1], e escreve tangents[4*q + 0..3].
+void Tangents_Compute(const float* positions, size_t position_stride,
+                      const float* normals, size_t normal_stride,
+                      const float* texcoords, size_t texcoord_stride,
+                      size_t num_corners, float* tangents);
+
+// Cache das tangentes de uma malha. O arquivo guarda o tamanho e a data de
+// modificação de "source", as opções de "normals.h" (que mudam as normais
+// calculadas) e o número de quinas; um cache que não corresponde é ignorado.
+bool Tangents_SaveCache(const char* filename, const char* source,
+                        const float* tangents, size_t num_corners);
+bool Tangents_LoadCache(const char* filename, const char* source,
+                        size_t num_corners, float* tangents);
+
+#endif // _TANGENTS_H
@@ -0,0 +1,36 @@
+#ifndef _TEXTURECACHE_H
+#define _TEXTURECACHE_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// Cache de texturas pré-processadas. Na primeira execução a imagem original
+// (JPEG/PNG) é decodificada, reduzida em todos os níveis de mipmap e comprimida
+// em blocos BC1 (DXT1), sendo salva em "<arquivo>.tcache". Nas execuções
+// seguintes lemos direto do cache, sem decodificar a imagem.
+//
+// O carregamento envia primeiro os mipmaps pequenos; os níveis maiores são
+// lidos do disco em segundo plano e enviados para a GPU pela fila de
+// "textureupload.h", respeitando um orçamento de memória de vídeo.
+
+// Converte "filename" para o formato do cache, gravando em "cachename".
+bool TextureCache_Build(const char* filename, const char* cachename);
+
+// Carrega a textura "filename" (via cache) no objeto de textura "texture_id",
+// que já deve estar ligado em GL_TEXTURE_2D na unidade "textureunit".
+void TextureCache_Load(const char* filename, GLuint texture_id, GLuint textureunit);
+
+// Carrega a imagem "filename" sem passar pelo cache, sem compressão e sem
+// conversão sRGB, com mipmaps gerados pela GPU: mapas de normais guardam
+// vetores, que BC1 e a curva de gama distorceriam. A imagem vai para a
+// textura ligada em GL_TEXTURE_2D. Retorna false se a imagem não existir.
+bool TextureCache_LoadLinear(const char* filename);
+
+// Bytes de memória de vídeo ocupados pelas texturas do cache.
+size_t TextureCache_VRAMUsed();
+
+// Orçamento de memória de vídeo para texturas (em bytes).
+extern size_t g_TextureVRAMBudget;
+
+#endif // _TEXTURECACHE_H
@@ -0,0 +1,54 @@
+#ifndef _TEXTUREUPLOAD_H
+#define _TEXTUREUPLOAD_H
+
+#include <cstddef>
+#include <functional>
+
+#include <glad/glad.h>
+
+// Fila de envio assíncrono de texturas para a GPU através de Pixel Buffer
+// Objects (PBOs). A thread de renderização mapeia um PBO e tarefas de
+// segundo plano (veja "jobs.h") decodificam os pixels diretamente na memória
+// mapeada. Depois, a cada quadro, TextureUpload_Update() copia os PBOs
+// prontos para as texturas com glTexSubImage2D(), limitado a
+// g_TextureUploadBytesPerFrame bytes, e usa fences para saber quando a cópia
+// terminou e o PBO pode ser reutilizado.
+
+struct TextureUploadDesc
+{
+    GLuint texture_id;
+    GLuint textureunit;    // Unidade onde a textura está ligada
+    GLint  level;          // Nível de mipmap
+    GLint  width;
+    GLint  height;
+    GLenum internalformat; // GL_SRGB8, GL_COMPRESSED_..., etc.
+    bool   compressed;     // Se verdadeiro, usa glCompressedTexSubImage2D()
+    GLenum format;         // Formato e tipo dos pixels (apenas se !compressed)
+    GLenum type;
+    size_t size;           // Bytes escritos pelo produtor no PBO
+};
+
+// Executada em uma thread do sistema de tarefas: escreve desc.size bytes em "dst".
+// Retorna false em caso de erro (o envio é então descartado).
+typedef std::function<bool(unsigned char* dst)> TextureUploadProducer;
+
+// Executada na thread de renderização quando a GPU terminou a cópia.
+typedef std::function<void()> TextureUploadCallback;
+
+void TextureUpload_Request(const TextureUploadDesc& desc, TextureUploadProducer produz, TextureUploadCallback concluido);
+
+// Chamada uma vez por quadro pela thread de renderização.
+void TextureUpload_Update();
+
+// Espera as tarefas de produção e libera os PBOs e as fences, descartando os
+// envios não concluídos. Chamada pela thread de renderização, com o
+// contexto OpenGL ainda ativo.
+void TextureUpload_Shutdown();
+
+// Número de envios ainda não concluídos.
+size_t TextureUpload_Pending();
+
+// Limite de bytes copiados dos PBOs para texturas por quadro.
+extern size_t g_TextureUploadBytesPerFrame;
+
+#endif // _TEXTUREUPLOAD_H
@@ -0,0 +1,80 @@
+#ifndef _TLSF_H
+#define _TLSF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Alocador de faixas de um espaço linear (posições de um buffer da GPU, por
+// exemplo), no estilo TLSF ("two-level segregated fit"): os blocos livres
+// ficam em listas por classe de tamanho, e a classe de um tamanho é um
+// número de ponto flutuante de 8 bits (5 de expoente e 3 de mantissa), o que
+// dá 8 classes por potência de dois e um desperdício máximo de 1/8. Dois
+// níveis de máscaras de bits (32 grupos de 8 classes) acham a menor classe
+// não vazia com duas instruções de "find first set", e alocar e liberar
+// custam O(1). Blocos livres vizinhos são unidos na liberação.
+//
+// O alocador só guarda números: não sabe o que as posições representam, e
+// não usa OpenGL.
+
+#define TLSF_NENHUM 0xFFFFFFFFu
+
+struct TLSFNode
+{
+    uint32_t offset;
+    uint32_t size;
+    uint32_t anterior_na_lista; // Na lista de livres da classe
+    uint32_t proximo_na_lista;
+    uint32_t vizinho_anterior;  // Blocos adjacentes no espaço
+    uint32_t vizinho_proximo;
+    bool     usado;
+};
+
+struct TLSFAllocator
+{
+    uint32_t size;                 // Tamanho total do espaço
+    uint32_t livre;                // Soma dos blocos livres
+    uint32_t alocacoes;            // Blocos em uso
+    uint32_t grupos_usados;        // Bit g: há classe não vazia no grupo g
+    uint8_t  classes_usadas[32];   // Bit c do grupo g: classe 8g+c não vazia
+    uint32_t listas[256];          // Primeiro nó livre de cada classe
+    uint32_t ultimo;               // Nó que termina no fim do espaço
+    std::vector<TLSFNode> nos;
+    std::vector<uint32_t> nos_vagos; // Índices de "nos" reaproveitáveis
+};
+
+struct TLSFAllocation
+{
+    uint32_t offset;
+    uint32_t node; // Para TLSF_Free(); TLSF_NENHUM se a alocação falhou
+};
+
+struct TLSFStats
+{
+    uint32_t size;
+    uint32_t used;
+    uint32_t free;
+    uint32_t largest_free; // Maior bloco livre (fragmentação: free - largest_free)
+    uint32_t allocations;
+    uint32_t free_blocks;
+};
+
+// Começa com um único bloco livre de "size" posições.
+void TLSF_Init(TLSFAllocator* a, uint32_t size);
+
+// Aloca "size" posições (size > 0). Retorna false se não houver um bloco
+// livre grande o bastante.
+bool TLSF_Allocate(TLSFAllocator* a, uint32_t size, TLSFAllocation* out);
+
+// Libera uma alocação feita por TLSF_Allocate().
+void TLSF_Free(TLSFAllocator* a, uint32_t node);
+
+// Aumenta o espaço para "size" posições; as alocações existentes não mudam.
+void TLSF_Grow(TLSFAllocator* a, uint32_t size);
+
+// Tamanho de uma alocação
+uint32_t TLSF_Size(const TLSFAllocator& a, uint32_t node);
+
+TLSFStats TLSF_Stats(const TLSFAllocator& a);
+
+#endif // _TLSF_H
@@ -0,0 +1,75 @@
+#ifndef _WORLDSTREAM_H
+#define _WORLDSTREAM_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <glm/vec4.hpp>
+
+// Carregamento do mundo por células. O plano XZ é dividido em células
+// quadradas de lado "cell_size"; a cada quadro WorldStream_Update() decide,
+// a partir da posição da câmera, quais células são necessárias (dentro de
+// g_WorldStreamRadius) e quais devem ser antecipadas (em torno da posição
+// prevista daqui a g_WorldStreamPrefetchTime segundos, seguindo a direção do
+// movimento).
+//
+// O conteúdo das células é lido por uma tarefa de segundo plano (veja
+// "jobs.h"), uma célula por vez, e depois ativado pela thread de
+// renderização (envio para a GPU, criação dos colisores), limitado a
+// g_WorldStreamActivateMs milissegundos por quadro. Quando a
+// memória ocupada passa de g_WorldStreamBudget, as células que deixaram de
+// ser necessárias são descarregadas, da usada há mais tempo para a mais
+// recente (LRU).
+
+struct WorldCell
+{
+    int         id;       // Índice da célula, único durante a execução
+    int         x;        // Coordenadas da célula na grade
+    int         z;
+    std::string filename;
+};
+
+// Executada em uma thread do sistema de tarefas: lê e prepara o conteúdo da célula. Retorna
+// NULL em caso de erro (a célula não é tentada novamente).
+typedef std::function<std::shared_ptr<void>(const WorldCell& cell)> WorldCellLoader;
+
+// Executada na thread de renderização com o resultado do carregamento.
+// Retorna quantos bytes a célula passa a ocupar.
+typedef std::function<size_t(const WorldCell& cell, const std::shared_ptr<void>& data)> WorldCellActivator;
+
+// Executada na thread de renderização ao descarregar uma célula ativa.
+typedef std::function<void(const WorldCell& cell)> WorldCellReleaser;
+
+struct WorldStreamStats
+{
+    unsigned int  cells_resident;
+    unsigned int  cells_loading;     // Na fila, sendo lidas ou aguardando ativação
+    size_t        bytes_resident;
+    unsigned long loads;             // Células ativadas desde o início
+    unsigned long prefetches;        // ... das quais pedidas por antecipação
+    unsigned long evictions;         // Células descarregadas
+    unsigned long misses;            // Quadros em que a célula da câmera não estava pronta
+    unsigned long hitches;           // Quadros em que as ativações passaram de g_WorldStreamHitchMs
+    double        max_activation_ms; // Maior tempo gasto com ativações em um quadro
+};
+
+void WorldStream_Init(float cell_size, WorldCellLoader carrega, WorldCellActivator ativa, WorldCellReleaser libera);
+void WorldStream_AddCell(int x, int z, const char* filename);
+
+// Chamada uma vez por quadro pela thread de renderização.
+void WorldStream_Update(const glm::vec4& position, float deltaTime);
+
+// Espera a leitura em andamento e descarrega todas as células.
+void WorldStream_Shutdown();
+
+WorldStreamStats WorldStream_Stats();
+
+extern float  g_WorldStreamRadius;       // Raio (em unidades do mundo) das células necessárias
+extern float  g_WorldStreamPrefetchTime; // Antecipação, em segundos de movimento
+extern size_t g_WorldStreamBudget;       // Memória máxima das células ativas (em bytes)
+extern float  g_WorldStreamActivateMs;   // Tempo máximo de ativação por quadro
+extern float  g_WorldStreamHitchMs;      // Acima disso, o quadro conta como engasgo
+
+#endif // _WORLDSTREAM_H
@@ -0,0 +1,97 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloccounter.h"
+
+#ifdef ALLOC_COUNTER
+
+static thread_local unsigned long t_Alocacoes = 0;
+static std::atomic<unsigned long> g_Alocacoes(0);
+
+static void* Aloca(std::size_t bytes)
+{
+    t_Alocacoes += 1;
+    g_Alocacoes.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(bytes > 0 ? bytes : 1);
+}
+
+void* operator new(std::size_t bytes)
+{
+    void* p = Aloca(bytes);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t bytes)
+{
+    void* p = Aloca(bytes);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept
+{
+    return Aloca(bytes);
+}
+
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept
+{
+    return Aloca(bytes);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+bool AllocCounter_Enabled()
+{
+    return true;
+}
+
+unsigned long AllocCounter_Thread()
+{
+    return t_Alocacoes;
+}
+
+unsigned long AllocCounter_Total()
+{
+    return g_Alocacoes.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocCounter_Enabled()
+{
+    return false;
+}
+
+unsigned long AllocCounter_Thread()
+{
+    return 0;
+}
+
+unsigned long AllocCounter_Total()
+{
+    return 0;
+}
+
+#endif // ALLOC_COUNTER
@@ -0,0 +1,203 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BEZIERPATH_SSE 1
+#endif
+
+#include "bezierpath.h"
+
+// Coeficientes na base de potências dos pontos de controle p0..p3.
+static BezierSegment Segmento(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3)
+{
+    BezierSegment s;
+    s.a = p0;
+    s.b = 3.0f * (p1 - p0);
+    s.c = 3.0f * (p0 - 2.0f*p1 + p2);
+    s.d = -p0 + 3.0f*p1 - 3.0f*p2 + p3;
+    return s;
+}
+
+static inline glm::vec3 AvaliaSegmento(const BezierSegment& s, float u)
+{
+    return s.a + u*(s.b + u*(s.c + u*s.d));
+}
+
+void BezierPath_Build(BezierPath* path, const glm::vec3* points, size_t num_points)
+{
+    if (num_points < 4 || (num_points - 1) % 3 != 0)
+    {
+        fprintf(stderr, "ERROR: caminho de Bézier com %lu pontos de controle (esperado 3*n+1).\n", (unsigned long)num_points);
+        std::exit(EXIT_FAILURE);
+    }
+
+    size_t n = (num_points - 1) / 3;
+    path->segmentos.resize(n);
+    for (size_t k = 0; k < n; ++k)
+        path->segmentos[k] = Segmento(points[3*k], points[3*k+1], points[3*k+2], points[3*k+3]);
+
+    // Comprimento aproximado pela soma das cordas entre amostras
+    path->comprimento.resize(n * BEZIERPATH_SAMPLES + 1);
+    path->comprimento[0] = 0.0f;
+    float total = 0.0f;
+    for (size_t k = 0; k < n; ++k)
+    {
+        glm::vec3 anterior = path->segmentos[k].a;
+        for (int j = 1; j <= BEZIERPATH_SAMPLES; ++j)
+        {
+            glm::vec3 p = AvaliaSegmento(path->segmentos[k], (float)j / BEZIERPATH_SAMPLES);
+            glm::vec3 d = p - anterior;
+            total += std::sqrt(d.x*d.x + d.y*d.y + d.z*d.z);
+            path->comprimento[k * BEZIERPATH_SAMPLES + j] = total;
+            anterior = p;
+        }
+    }
+    path->total = total;
+}
+
+glm::vec3 BezierPath_Evaluate(const BezierPath& path, float u)
+{
+    size_t n = path.segmentos.size();
+    float x = std::min(std::max(u, 0.0f), 1.0f) * n;
+    size_t k = std::min((size_t)x, n - 1);
+    return AvaliaSegmento(path.segmentos[k], x - k);
+}
+
+float BezierPath_ParamAtDistance(const BezierPath& path, float s)
+{
+    if (path.total <= 0.0f || s <= 0.0f)
+        return 0.0f;
+    if (s >= path.total)
+        return 1.0f;
+
+    // Primeira amostra com comprimento acumulado maior que "s"
+    std::vector<float>::const_iterator it = std::upper_bound(path.comprimento.begin(), path.comprimento.end(), s);
+    size_t k = (it - path.comprimento.begin()) - 1;
+
+    float inicio = path.comprimento[k];
+    float trecho = path.comprimento[k+1] - inicio;
+    float w = trecho > 0.0f ? (s - inicio) / trecho : 0.0f;
+
+    return (k + w) / (float)(path.comprimento.size() - 1);
+}
+
+glm::vec3 BezierPath_PointAtDistance(const BezierPath& path, float s)
+{
+    return BezierPath_Evaluate(path, BezierPath_ParamAtDistance(path, s));
+}
+
+glm::vec3 BezierPath_PointAtFraction(const BezierPath& path, float f)
+{
+    return BezierPath_PointAtDistance(path, f * path.total);
+}
+
+float BezierPath_EaseInOut(float x)
+{
+    x = std::min(std::max(x, 0.0f), 1.0f);
+    return x*x*(3.0f - 2.0f*x);
+}
+
+float BezierPath_EaseSigmoid(float x, float inclinacao)
+{
+    // Sigmoide centrada em 0.5, reescalada para valer 0 em x = 0 e 1 em x = 1
+    float inicio = 1.0f / (1.0f + std::exp(0.5f*inclinacao));
+    float fim    = 1.0f / (1.0f + std::exp(-0.5f*inclinacao));
+    float s      = 1.0f / (1.0f + std::exp(-inclinacao*(x - 0.5f)));
+    return std::min(std::max((s - inicio) / (fim - inicio), 0.0f), 1.0f);
+}
+
+void BezierPathBatch_Add(BezierPathBatch* batch, const glm::vec3 points[4])
+{
+    BezierPath path;
+    BezierPath_Build(&path, points, 4);
+    const BezierSegment& s = path.segmentos[0];
+
+    batch->coef_x[0].push_back(s.a.x); batch->coef_y[0].push_back(s.a.y); batch->coef_z[0].push_back(s.a.z);
+    batch->coef_x[1].push_back(s.b.x); batch->coef_y[1].push_back(s.b.y); batch->coef_z[1].push_back(s.b.z);
+    batch->coef_x[2].push_back(s.c.x); batch->coef_y[2].push_back(s.c.y); batch->coef_z[2].push_back(s.c.z);
+    batch->coef_x[3].push_back(s.d.x); batch->coef_y[3].push_back(s.d.y); batch->coef_z[3].push_back(s.d.z);
+
+    batch->total.push_back(path.total);
+    for (int j = 0; j < BEZIERPATH_TABLE_SIZE; ++j)
+        batch->tabela.push_back(BezierPath_ParamAtDistance(path, path.total * j / (BEZIERPATH_TABLE_SIZE - 1)));
+
+    batch->count = batch->total.size();
+}
+
+// Remove de "v" os blocos de "largura" elementos marcados em "remover".
+static void Compacta(std::vector<float>& v, const std::vector<uint8_t>& remover, size_t largura)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < remover.size(); ++i)
+    {
+        if (remover[i])
+            continue;
+        if (j != i)
+            std::copy(v.begin() + i*largura, v.begin() + (i+1)*largura, v.begin() + j*largura);
+        j += 1;
+    }
+    v.resize(j * largura);
+}
+
+void BezierPathBatch_Erase(BezierPathBatch* batch, const std::vector<uint8_t>& remover)
+{
+    for (int k = 0; k < 4; ++k)
+    {
+        Compacta(batch->coef_x[k], remover, 1);
+        Compacta(batch->coef_y[k], remover, 1);
+        Compacta(batch->coef_z[k], remover, 1);
+    }
+    Compacta(batch->total, remover, 1);
+    Compacta(batch->tabela, remover, BEZIERPATH_TABLE_SIZE);
+    batch->count = batch->total.size();
+}
+
+// Parâmetro "u" do caminho i após percorrer a fração "f" do comprimento.
+static inline float ParametroNaFracao(const BezierPathBatch& batch, size_t i, float f)
+{
+    float pos = std::min(std::max(f, 0.0f), 1.0f) * (BEZIERPATH_TABLE_SIZE - 1);
+    int   k   = std::min((int)pos, BEZIERPATH_TABLE_SIZE - 2);
+    float w   = pos - k;
+    const float* tabela = &batch.tabela[i * BEZIERPATH_TABLE_SIZE];
+    return tabela[k] + w * (tabela[k+1] - tabela[k]);
+}
+
+void BezierPathBatch_Evaluate(const BezierPathBatch& batch, size_t first, size_t count,
+                              const float* fraction, float* x, float* y, float* z)
+{
+    size_t i   = first;
+    size_t fim = std::min(first + count, batch.count);
+
+#ifdef BEZIERPATH_SSE
+    for (; i + 4 <= fim; i += 4)
+    {
+        __m128 u = _mm_setr_ps(ParametroNaFracao(batch, i,   fraction[i]),
+                               ParametroNaFracao(batch, i+1, fraction[i+1]),
+                               ParametroNaFracao(batch, i+2, fraction[i+2]),
+                               ParametroNaFracao(batch, i+3, fraction[i+3]));
+
+        // Horner: a + u*(b + u*(c + u*d))
+        #define BEZIERPATH_HORNER(coef) \
+            _mm_add_ps(_mm_loadu_ps(&coef[0][i]), _mm_mul_ps(u, \
+            _mm_add_ps(_mm_loadu_ps(&coef[1][i]), _mm_mul_ps(u, \
+            _mm_add_ps(_mm_loadu_ps(&coef[2][i]), _mm_mul_ps(u, _mm_loadu_ps(&coef[3][i])))))))
+
+        _mm_storeu_ps(&x[i], BEZIERPATH_HORNER(batch.coef_x));
+        _mm_storeu_ps(&y[i], BEZIERPATH_HORNER(batch.coef_y));
+        _mm_storeu_ps(&z[i], BEZIERPATH_HORNER(batch.coef_z));
+
+        #undef BEZIERPATH_HORNER
+    }
+#endif
+
+    for (; i < fim; ++i)
+    {
+        float u = ParametroNaFracao(batch, i, fraction[i]);
+        x[i] = batch.coef_x[0][i] + u*(batch.coef_x[1][i] + u*(batch.coef_x[2][i] + u*batch.coef_x[3][i]));
+        y[i] = batch.coef_y[0][i] + u*(batch.coef_y[1][i] + u*(batch.coef_y[2][i] + u*batch.coef_y[3][i]));
+        z[i] = batch.coef_z[0][i] + u*(batch.coef_z[1][i] + u*(batch.coef_z[2][i] + u*batch.coef_z[3][i]));
+    }
+}
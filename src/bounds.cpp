@@ -0,0 +1,84 @@
+#include <cmath>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+#include "bounds.h"
+#include "fastmath.h"
+
+static BoundsStats g_Stats;
+
+void Bounds_Update(WorldBounds* b, const glm::mat4& model,
+                   const glm::vec3& min_local, const glm::vec3& max_local)
+{
+    if (!b->sujo)
+    {
+        g_Stats.reuses += 1;
+        return;
+    }
+    g_Stats.updates += 1;
+
+    FastMath_TransformAABB(model, min_local, max_local, &b->min, &b->max);
+
+    // O centro da caixa de Arvo é a imagem do centro da caixa do modelo. O
+    // raio é o menor entre a esfera do modelo escalada pelo maior fator de
+    // escala e a esfera que circunscreve a caixa no mundo; ambas envolvem
+    // o objeto.
+    float escala = std::max(glm::length(glm::vec3(model[0])),
+                   std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    b->centro = 0.5f * (b->min + b->max);
+    b->raio   = std::min(0.5f * glm::length(max_local - min_local) * escala,
+                         0.5f * glm::length(b->max - b->min));
+    b->sujo   = false;
+}
+
+void Bounds_ExtractFrustum(Frustum* f, const glm::mat4& m)
+{
+    // Linhas da matriz (GLM guarda colunas)
+    glm::vec4 linha[4];
+    for (int i = 0; i < 4; ++i)
+        linha[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    // -w <= x, y, z <= w
+    for (int k = 0; k < 3; ++k)
+    {
+        f->planos[2*k]   = linha[3] + linha[k];
+        f->planos[2*k+1] = linha[3] - linha[k];
+    }
+
+    // Normalizamos para que dot() seja a distância com sinal
+    for (int k = 0; k < 6; ++k)
+    {
+        float n = glm::length(glm::vec3(f->planos[k]));
+        if (n > 0.0f)
+            f->planos[k] /= n;
+    }
+}
+
+bool Bounds_SphereInFrustum(const Frustum& f, const glm::vec3& centro, float raio)
+{
+    for (int k = 0; k < 6; ++k)
+        if (glm::dot(glm::vec3(f.planos[k]), centro) + f.planos[k].w < -raio)
+            return false;
+    return true;
+}
+
+bool Bounds_AABBInFrustum(const Frustum& f, const glm::vec3& min, const glm::vec3& max)
+{
+    for (int k = 0; k < 6; ++k)
+    {
+        // Canto da caixa mais à frente na direção da normal
+        const glm::vec4& p = f.planos[k];
+        glm::vec3 canto(p.x >= 0.0f ? max.x : min.x,
+                        p.y >= 0.0f ? max.y : min.y,
+                        p.z >= 0.0f ? max.z : min.z);
+        if (glm::dot(glm::vec3(p), canto) + p.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+BoundsStats Bounds_Stats()
+{
+    return g_Stats;
+}
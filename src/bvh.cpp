@@ -0,0 +1,659 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include "bvh.h"
+#include "mappedfile.h"
+
+// Triângulo durante a construção: caixa envolvente e centróide
+struct TrianguloDaConstrucao
+{
+    glm::vec3 min, max, centro;
+    uint32_t  indice;
+};
+
+struct Caixa
+{
+    glm::vec3 min, max;
+
+    Caixa() : min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max()) {}
+
+    void Inclui(const glm::vec3& p_min, const glm::vec3& p_max)
+    {
+        min = glm::vec3(std::min(min.x, p_min.x), std::min(min.y, p_min.y), std::min(min.z, p_min.z));
+        max = glm::vec3(std::max(max.x, p_max.x), std::max(max.y, p_max.y), std::max(max.z, p_max.z));
+    }
+
+    float Area() const
+    {
+        glm::vec3 d = max - min;
+        if (d.x < 0.0f)
+            return 0.0f;
+        return 2.0f * (d.x*d.y + d.y*d.z + d.z*d.x);
+    }
+};
+
+// Pilha das consultas: guarda no máximo um irmão pendente por nível, mais
+// os dois filhos do nó atual (veja BVH_MAX_DEPTH).
+#define BVH_PILHA (BVH_MAX_DEPTH + 1)
+
+// Constrói o nó "no", de profundidade "profundidade", sobre os triângulos
+// [inicio, fim) de "tris".
+static void Subdivide(BVH* bvh, std::vector<TrianguloDaConstrucao>& tris, uint32_t no, uint32_t inicio, uint32_t fim,
+                      int profundidade)
+{
+    Caixa caixa, centros;
+    for (uint32_t i = inicio; i < fim; ++i)
+    {
+        caixa.Inclui(tris[i].min, tris[i].max);
+        centros.Inclui(tris[i].centro, tris[i].centro);
+    }
+    bvh->nos[no].min = caixa.min;
+    bvh->nos[no].max = caixa.max;
+
+    uint32_t n = fim - inicio;
+    glm::vec3 extensao = centros.max - centros.min;
+    int eixo = extensao.x > extensao.y ? (extensao.x > extensao.z ? 0 : 2) : (extensao.y > extensao.z ? 1 : 2);
+
+    // Melhor divisão pela SAH entre as faixas do maior eixo
+    bool  sah         = profundidade < BVH_SAH_MAX_DEPTH;
+    int   melhor      = -1;
+    float melhor_custo = n * caixa.Area();
+    if (n > BVH_MAX_LEAF_SIZE && extensao[eixo] > 0.0f && sah)
+    {
+        Caixa    faixas[BVH_BINS];
+        uint32_t contagem[BVH_BINS] = { 0 };
+        float escala = BVH_BINS / extensao[eixo];
+        for (uint32_t i = inicio; i < fim; ++i)
+        {
+            int b = std::min(BVH_BINS - 1, (int)((tris[i].centro[eixo] - centros.min[eixo]) * escala));
+            faixas[b].Inclui(tris[i].min, tris[i].max);
+            contagem[b] += 1;
+        }
+
+        // Áreas acumuladas da direita para a esquerda
+        float    area_direita[BVH_BINS];
+        uint32_t n_direita[BVH_BINS];
+        Caixa    direita;
+        uint32_t soma = 0;
+        for (int b = BVH_BINS - 1; b > 0; --b)
+        {
+            direita.Inclui(faixas[b].min, faixas[b].max);
+            soma += contagem[b];
+            area_direita[b] = direita.Area();
+            n_direita[b]    = soma;
+        }
+
+        Caixa    esquerda;
+        uint32_t n_esquerda = 0;
+        for (int b = 0; b < BVH_BINS - 1; ++b)
+        {
+            esquerda.Inclui(faixas[b].min, faixas[b].max);
+            n_esquerda += contagem[b];
+            if (n_esquerda == 0 || n_direita[b+1] == 0)
+                continue;
+            float custo = n_esquerda * esquerda.Area() + n_direita[b+1] * area_direita[b+1];
+            if (custo < melhor_custo)
+            {
+                melhor_custo = custo;
+                melhor       = b;
+            }
+        }
+    }
+
+    if (melhor < 0)
+    {
+        // Folha. Se ainda houver triângulos demais (por exemplo, todos com
+        // o mesmo centróide, ou abaixo de BVH_SAH_MAX_DEPTH), dividimos pela
+        // mediana; em BVH_MAX_DEPTH a folha fica com todos.
+        if (n <= BVH_MAX_LEAF_SIZE || profundidade >= BVH_MAX_DEPTH || (extensao[eixo] > 0.0f && sah))
+        {
+            bvh->nos[no].inicio         = inicio;
+            bvh->nos[no].num_triangulos = n;
+            return;
+        }
+    }
+
+    uint32_t meio;
+    if (melhor >= 0)
+    {
+        float escala = BVH_BINS / extensao[eixo];
+        float min_eixo = centros.min[eixo];
+        meio = (uint32_t)(std::partition(tris.begin() + inicio, tris.begin() + fim,
+                   [=](const TrianguloDaConstrucao& t){
+                       return std::min(BVH_BINS - 1, (int)((t.centro[eixo] - min_eixo) * escala)) <= melhor;
+                   }) - tris.begin());
+    }
+    else
+    {
+        meio = inicio + n/2;
+        std::nth_element(tris.begin() + inicio, tris.begin() + meio, tris.begin() + fim,
+            [=](const TrianguloDaConstrucao& a, const TrianguloDaConstrucao& b){ return a.centro[eixo] < b.centro[eixo]; });
+    }
+
+    uint32_t filho = (uint32_t)bvh->nos.size();
+    bvh->nos.resize(filho + 2);
+    bvh->nos[no].inicio         = filho;
+    bvh->nos[no].num_triangulos = 0;
+
+    Subdivide(bvh, tris, filho,     inicio, meio, profundidade + 1);
+    Subdivide(bvh, tris, filho + 1, meio,   fim,  profundidade + 1);
+}
+
+void BVH_Build(BVH* bvh, const float* positions, size_t stride,
+               const unsigned int* indices, size_t num_indices)
+{
+    size_t n = num_indices / 3;
+
+    std::vector<BVHTriangle>           originais(n);
+    std::vector<TrianguloDaConstrucao> tris(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const float* a = &positions[indices[3*i]     * stride];
+        const float* b = &positions[indices[3*i + 1] * stride];
+        const float* c = &positions[indices[3*i + 2] * stride];
+        glm::vec3 v0(a[0], a[1], a[2]), v1(b[0], b[1], b[2]), v2(c[0], c[1], c[2]);
+
+        originais[i].v0 = v0;
+        originais[i].e1 = v1 - v0;
+        originais[i].e2 = v2 - v0;
+
+        tris[i].min    = glm::vec3(std::min(v0.x, std::min(v1.x, v2.x)), std::min(v0.y, std::min(v1.y, v2.y)), std::min(v0.z, std::min(v1.z, v2.z)));
+        tris[i].max    = glm::vec3(std::max(v0.x, std::max(v1.x, v2.x)), std::max(v0.y, std::max(v1.y, v2.y)), std::max(v0.z, std::max(v1.z, v2.z)));
+        tris[i].centro = (tris[i].min + tris[i].max) * 0.5f;
+        tris[i].indice = (uint32_t)i;
+    }
+
+    bvh->nos.clear();
+    bvh->nos.reserve(n > 0 ? 2*n : 1);
+    bvh->nos.resize(1);
+    Subdivide(bvh, tris, 0, 0, (uint32_t)n, 0);
+
+    bvh->triangulos.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        bvh->triangulos[i] = originais[tris[i].indice];
+}
+
+// Teste de raio contra a caixa pelo método das placas. Retorna a entrada do
+// raio na caixa, ou infinito se ele não a atinge antes de "tmax".
+static inline float RaioCaixa(const BVHNode& no, const glm::vec3& origem, const glm::vec3& inv_dir, float tmax)
+{
+    float t1 = (no.min.x - origem.x) * inv_dir.x, t2 = (no.max.x - origem.x) * inv_dir.x;
+    float tmin = std::min(t1, t2), tmaior = std::max(t1, t2);
+    t1 = (no.min.y - origem.y) * inv_dir.y; t2 = (no.max.y - origem.y) * inv_dir.y;
+    tmin = std::max(tmin, std::min(t1, t2)); tmaior = std::min(tmaior, std::max(t1, t2));
+    t1 = (no.min.z - origem.z) * inv_dir.z; t2 = (no.max.z - origem.z) * inv_dir.z;
+    tmin = std::max(tmin, std::min(t1, t2)); tmaior = std::min(tmaior, std::max(t1, t2));
+
+    if (tmaior >= std::max(tmin, 0.0f) && tmin < tmax)
+        return tmin;
+    return std::numeric_limits<float>::infinity();
+}
+
+// Möller-Trumbore: "t" do ponto de interseção, ou infinito.
+static inline float RaioTriangulo(const BVHTriangle& tri, const glm::vec3& origem, const glm::vec3& dir)
+{
+    const float eps = 1e-8f;
+    glm::vec3 p = glm::vec3(dir.y*tri.e2.z - dir.z*tri.e2.y, dir.z*tri.e2.x - dir.x*tri.e2.z, dir.x*tri.e2.y - dir.y*tri.e2.x);
+    float det = tri.e1.x*p.x + tri.e1.y*p.y + tri.e1.z*p.z;
+    if (std::fabs(det) < eps)
+        return std::numeric_limits<float>::infinity();
+
+    float inv = 1.0f / det;
+    glm::vec3 s = origem - tri.v0;
+    float u = (s.x*p.x + s.y*p.y + s.z*p.z) * inv;
+    if (u < 0.0f || u > 1.0f)
+        return std::numeric_limits<float>::infinity();
+
+    glm::vec3 q = glm::vec3(s.y*tri.e1.z - s.z*tri.e1.y, s.z*tri.e1.x - s.x*tri.e1.z, s.x*tri.e1.y - s.y*tri.e1.x);
+    float v = (dir.x*q.x + dir.y*q.y + dir.z*q.z) * inv;
+    if (v < 0.0f || u + v > 1.0f)
+        return std::numeric_limits<float>::infinity();
+
+    float t = (tri.e2.x*q.x + tri.e2.y*q.y + tri.e2.z*q.z) * inv;
+    return t > 0.0f ? t : std::numeric_limits<float>::infinity();
+}
+
+// Percorre a árvore do nó mais próximo para o mais distante. Com
+// "qualquer" verdadeiro, para na primeira interseção. Se a pilha não
+// bastar (árvore mais profunda que BVH_MAX_DEPTH), o raio é dado como
+// bloqueado na origem, nunca como livre.
+static bool Percorre(const BVH& bvh, const glm::vec3& origem, const glm::vec3& dir, float tmax,
+                     bool qualquer, float* t_saida, size_t* tri_saida, BVHQueryStats* stats)
+{
+    if (bvh.triangulos.empty())
+        return false;
+
+    glm::vec3 inv_dir = glm::vec3(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+    float     melhor  = tmax;
+    size_t    melhor_tri = 0;
+    bool      achou   = false;
+
+    unsigned long nos_visitados = 0, testes = 0;
+
+    uint32_t pilha[BVH_PILHA];
+    int      topo = 0;
+    pilha[topo++] = 0;
+
+    while (topo > 0)
+    {
+        const BVHNode& no = bvh.nos[pilha[--topo]];
+        nos_visitados += 1;
+        if (RaioCaixa(no, origem, inv_dir, melhor) == std::numeric_limits<float>::infinity())
+            continue;
+
+        if (no.num_triangulos > 0)
+        {
+            for (uint32_t i = no.inicio; i < no.inicio + no.num_triangulos; ++i)
+            {
+                testes += 1;
+                float t = RaioTriangulo(bvh.triangulos[i], origem, dir);
+                if (t < melhor)
+                {
+                    melhor     = t;
+                    melhor_tri = i;
+                    achou      = true;
+                    if (qualquer)
+                        break;
+                }
+            }
+            if (achou && qualquer)
+                break;
+            continue;
+        }
+
+        // Empilhamos o filho mais distante primeiro
+        float t_esq = RaioCaixa(bvh.nos[no.inicio],     origem, inv_dir, melhor);
+        float t_dir = RaioCaixa(bvh.nos[no.inicio + 1], origem, inv_dir, melhor);
+        uint32_t perto = no.inicio, longe = no.inicio + 1;
+        if (t_dir < t_esq)
+        {
+            std::swap(perto, longe);
+            std::swap(t_esq, t_dir);
+        }
+        if (topo + 2 > BVH_PILHA)
+        {
+            melhor     = 0.0f;
+            melhor_tri = 0;
+            achou      = true;
+            break;
+        }
+        if (t_dir != std::numeric_limits<float>::infinity())
+            pilha[topo++] = longe;
+        if (t_esq != std::numeric_limits<float>::infinity())
+            pilha[topo++] = perto;
+    }
+
+    if (stats)
+    {
+        stats->nodes     += nos_visitados;
+        stats->triangles += testes;
+    }
+    if (achou)
+    {
+        if (t_saida)   *t_saida   = melhor;
+        if (tri_saida) *tri_saida = melhor_tri;
+    }
+    return achou;
+}
+
+bool BVH_Occluded(const BVH& bvh, const glm::vec3& origem, const glm::vec3& dir, float tmax,
+                  BVHQueryStats* stats)
+{
+    return Percorre(bvh, origem, dir, tmax, true, NULL, NULL, stats);
+}
+
+bool BVH_Raycast(const BVH& bvh, const glm::vec3& origem, const glm::vec3& dir, float tmax,
+                 float* t, size_t* triangulo, BVHQueryStats* stats)
+{
+    return Percorre(bvh, origem, dir, tmax, false, t, triangulo, stats);
+}
+
+// Percorre os nós cuja caixa passa em "testa_no" e chama "testa_triangulo"
+// nos triângulos das folhas, até que algum retorne verdadeiro. Se a pilha
+// não bastar, há sobreposição: é melhor parar o jogador do que deixá-lo
+// atravessar uma parede.
+template <typename TestaNo, typename TestaTriangulo>
+static bool Sobreposicao(const BVH& bvh, TestaNo testa_no, TestaTriangulo testa_triangulo, BVHQueryStats* stats)
+{
+    if (bvh.triangulos.empty())
+        return false;
+
+    unsigned long nos_visitados = 0, testes = 0;
+    bool achou = false;
+
+    uint32_t pilha[BVH_PILHA];
+    int      topo = 0;
+    pilha[topo++] = 0;
+
+    while (topo > 0 && !achou)
+    {
+        const BVHNode& no = bvh.nos[pilha[--topo]];
+        nos_visitados += 1;
+        if (!testa_no(no))
+            continue;
+
+        if (no.num_triangulos > 0)
+        {
+            for (uint32_t i = no.inicio; i < no.inicio + no.num_triangulos && !achou; ++i)
+            {
+                testes += 1;
+                achou = testa_triangulo(bvh.triangulos[i]);
+            }
+        }
+        else if (topo + 2 <= BVH_PILHA)
+        {
+            pilha[topo++] = no.inicio + 1;
+            pilha[topo++] = no.inicio;
+        }
+        else
+            achou = true;
+    }
+
+    if (stats)
+    {
+        stats->nodes     += nos_visitados;
+        stats->triangles += testes;
+    }
+    return achou;
+}
+
+static inline bool CaixasSobrepostas(const glm::vec3& min1, const glm::vec3& max1, const glm::vec3& min2, const glm::vec3& max2)
+{
+    return min1.x <= max2.x && max1.x >= min2.x
+        && min1.y <= max2.y && max1.y >= min2.y
+        && min1.z <= max2.z && max1.z >= min2.z;
+}
+
+// Projeta o triângulo (v0, v1, v2) e a caixa de semi-eixos "h", centrada na
+// origem, no eixo "a". Verdadeiro se as projeções são disjuntas.
+static inline bool EixoSeparador(const glm::vec3& a, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& h)
+{
+    float p0 = glm::dot(a, v0), p1 = glm::dot(a, v1), p2 = glm::dot(a, v2);
+    float r  = h.x*std::fabs(a.x) + h.y*std::fabs(a.y) + h.z*std::fabs(a.z);
+    return std::max(p0, std::max(p1, p2)) < -r || std::min(p0, std::min(p1, p2)) > r;
+}
+
+// Teste triângulo-caixa pelo teorema dos eixos separadores (Akenine-Möller):
+// as três normais da caixa, a normal do triângulo e os nove produtos
+// vetoriais entre arestas.
+static bool TrianguloCaixa(const BVHTriangle& tri, const glm::vec3& centro, const glm::vec3& h)
+{
+    glm::vec3 v0 = tri.v0 - centro;
+    glm::vec3 v1 = v0 + tri.e1;
+    glm::vec3 v2 = v0 + tri.e2;
+
+    for (int k = 0; k < 3; ++k)
+    {
+        if (std::max(v0[k], std::max(v1[k], v2[k])) < -h[k] || std::min(v0[k], std::min(v1[k], v2[k])) > h[k])
+            return false;
+    }
+
+    glm::vec3 arestas[3] = { v1 - v0, v2 - v1, v0 - v2 };
+    if (EixoSeparador(glm::cross(arestas[0], arestas[1]), v0, v1, v2, h))
+        return false;
+
+    for (int i = 0; i < 3; ++i)
+        for (int k = 0; k < 3; ++k)
+        {
+            glm::vec3 eixo_caixa(0.0f);
+            eixo_caixa[k] = 1.0f;
+            if (EixoSeparador(glm::cross(eixo_caixa, arestas[i]), v0, v1, v2, h))
+                return false;
+        }
+
+    return true;
+}
+
+bool BVH_OverlapsBox(const BVH& bvh, const glm::vec3& min, const glm::vec3& max,
+                     BVHQueryStats* stats)
+{
+    glm::vec3 centro = (min + max) * 0.5f;
+    glm::vec3 h      = (max - min) * 0.5f;
+    return Sobreposicao(bvh,
+        [&](const BVHNode& no){ return CaixasSobrepostas(no.min, no.max, min, max); },
+        [&](const BVHTriangle& tri){ return TrianguloCaixa(tri, centro, h); },
+        stats);
+}
+
+// Ponto do triângulo mais próximo de "p" (Ericson, Real-Time Collision
+// Detection, seção 5.1.5).
+static glm::vec3 PontoMaisProximoNoTriangulo(const glm::vec3& p, const BVHTriangle& tri)
+{
+    glm::vec3 a = tri.v0, ab = tri.e1, ac = tri.e2;
+    glm::vec3 ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+    glm::vec3 bp = p - (a + ab);
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return a + ab;
+
+    float vc = d1*d4 - d3*d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+    glm::vec3 cp = p - (a + ac);
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return a + ac;
+
+    float vb = d5*d2 - d1*d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+    float va = d3*d6 - d5*d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return (a + ab) + (ac - ab) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float denom = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Quadrado da distância entre os segmentos [p1, q1] e [p2, q2] (Ericson,
+// seção 5.1.9).
+static float DistanciaSegmentos2(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2)
+{
+    const float eps = 1e-12f;
+    glm::vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+    float s, t;
+
+    if (a <= eps && e <= eps)
+        return glm::dot(r, r);
+    if (a <= eps)
+    {
+        s = 0.0f;
+        t = std::min(std::max(f / e, 0.0f), 1.0f);
+    }
+    else
+    {
+        float c = glm::dot(d1, r);
+        if (e <= eps)
+        {
+            t = 0.0f;
+            s = std::min(std::max(-c / a, 0.0f), 1.0f);
+        }
+        else
+        {
+            float b = glm::dot(d1, d2);
+            float denom = a*e - b*b;
+            s = denom != 0.0f ? std::min(std::max((b*f - c*e) / denom, 0.0f), 1.0f) : 0.0f;
+            t = (b*s + f) / e;
+            if (t < 0.0f)
+            {
+                t = 0.0f;
+                s = std::min(std::max(-c / a, 0.0f), 1.0f);
+            }
+            else if (t > 1.0f)
+            {
+                t = 1.0f;
+                s = std::min(std::max((b - c) / a, 0.0f), 1.0f);
+            }
+        }
+    }
+
+    glm::vec3 d = (p1 + d1*s) - (p2 + d2*t);
+    return glm::dot(d, d);
+}
+
+static bool TrianguloCapsula(const BVHTriangle& tri, const glm::vec3& a, const glm::vec3& b, float raio2)
+{
+    // O segmento atravessa o triângulo
+    glm::vec3 d = b - a;
+    float t = RaioTriangulo(tri, a, d);
+    if (t <= 1.0f)
+        return true;
+
+    glm::vec3 v1 = tri.v0 + tri.e1, v2 = tri.v0 + tri.e2;
+
+    glm::vec3 pa = PontoMaisProximoNoTriangulo(a, tri) - a;
+    glm::vec3 pb = PontoMaisProximoNoTriangulo(b, tri) - b;
+    return glm::dot(pa, pa) <= raio2
+        || glm::dot(pb, pb) <= raio2
+        || DistanciaSegmentos2(a, b, tri.v0, v1) <= raio2
+        || DistanciaSegmentos2(a, b, v1, v2)     <= raio2
+        || DistanciaSegmentos2(a, b, v2, tri.v0) <= raio2;
+}
+
+bool BVH_OverlapsCapsule(const BVH& bvh, const glm::vec3& a, const glm::vec3& b, float raio,
+                         BVHQueryStats* stats)
+{
+    glm::vec3 min = glm::min(a, b) - glm::vec3(raio);
+    glm::vec3 max = glm::max(a, b) + glm::vec3(raio);
+    float raio2 = raio * raio;
+    return Sobreposicao(bvh,
+        [&](const BVHNode& no){ return CaixasSobrepostas(no.min, no.max, min, max); },
+        [&](const BVHTriangle& tri){ return TrianguloCapsula(tri, a, b, raio2); },
+        stats);
+}
+
+// Cabeçalho do cache. Em seguida, para cada BVH: número de nós e de
+// triângulos (uint32_t cada), os nós e os triângulos.
+struct BVHCacheHeader
+{
+    char     magic[4];     // "FCGB"
+    uint32_t version;
+    uint64_t source_size;  // Tamanho e data de modificação do ".obj"
+    int64_t  source_mtime;
+    uint32_t num_bvhs;
+    uint32_t reservado;
+};
+
+static const uint32_t BVH_CACHE_VERSION = 1;
+
+// Verdadeiro se os filhos de cada nó interno vêm depois dele e existem, as
+// folhas só usam triângulos existentes e nenhum nó passa de BVH_MAX_DEPTH,
+// como nas árvores de BVH_Build(). As consultas contam com isso.
+static bool ArvoreValida(const BVH& bvh)
+{
+    if (bvh.triangulos.empty())
+        return true; // As consultas nem olham os nós
+
+    std::vector<uint8_t> profundidade(bvh.nos.size(), 0);
+    for (size_t i = 0; i < bvh.nos.size(); ++i)
+    {
+        const BVHNode& no = bvh.nos[i];
+        if (no.num_triangulos > 0)
+        {
+            if (no.inicio > bvh.triangulos.size() || no.num_triangulos > bvh.triangulos.size() - no.inicio)
+                return false;
+            continue;
+        }
+        if (no.inicio <= i || (size_t)no.inicio + 1 >= bvh.nos.size() || profundidade[i] >= BVH_MAX_DEPTH)
+            return false;
+        for (uint32_t filho = no.inicio; filho <= no.inicio + 1; ++filho)
+            profundidade[filho] = std::max<uint8_t>(profundidade[filho], profundidade[i] + 1);
+    }
+    return true;
+}
+
+bool BVH_SaveCache(const char* filename, const char* source,
+                   const std::vector<std::shared_ptr<const BVH> >& bvhs)
+{
+    BVHCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "FCGB", 4);
+    header.version  = BVH_CACHE_VERSION;
+    header.num_bvhs = (uint32_t)bvhs.size();
+    if (!File_Stamp(source, &header.source_size, &header.source_mtime))
+        return false;
+
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL)
+        return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (size_t i = 0; i < bvhs.size() && ok; ++i)
+    {
+        uint32_t n[2] = { (uint32_t)bvhs[i]->nos.size(), (uint32_t)bvhs[i]->triangulos.size() };
+        ok = fwrite(n, sizeof(n), 1, f) == 1
+          && fwrite(bvhs[i]->nos.data(),        sizeof(BVHNode),     n[0], f) == n[0]
+          && fwrite(bvhs[i]->triangulos.data(), sizeof(BVHTriangle), n[1], f) == n[1];
+    }
+
+    fclose(f);
+    if (!ok)
+        remove(filename);
+
+    return ok;
+}
+
+bool BVH_LoadCache(const char* filename, const char* source,
+                   const std::vector<size_t>& num_triangles,
+                   std::vector<std::shared_ptr<const BVH> >* bvhs)
+{
+    uint64_t size;
+    int64_t  mtime;
+    if (!File_Stamp(source, &size, &mtime))
+        return false;
+
+    MappedFile file;
+    if (!MappedFile_Open(&file, filename))
+        return false;
+
+    BVHCacheHeader header;
+    bool ok = file.size >= sizeof(header);
+    if (ok)
+    {
+        memcpy(&header, file.data, sizeof(header));
+        ok = memcmp(header.magic, "FCGB", 4) == 0
+          && header.version == BVH_CACHE_VERSION
+          && header.source_size == size && header.source_mtime == mtime
+          && header.num_bvhs == num_triangles.size();
+    }
+
+    std::vector<std::shared_ptr<const BVH> > lidas;
+    size_t pos = sizeof(header);
+    for (uint32_t i = 0; ok && i < header.num_bvhs; ++i)
+    {
+        uint32_t n[2];
+        ok = file.size - pos >= sizeof(n);
+        if (!ok)
+            break;
+        memcpy(n, file.data + pos, sizeof(n));
+        pos += sizeof(n);
+
+        size_t bytes = n[0] * sizeof(BVHNode) + n[1] * sizeof(BVHTriangle);
+        ok = n[1] == num_triangles[i] && n[0] > 0 && file.size - pos >= bytes;
+        if (!ok)
+            break;
+
+        std::shared_ptr<BVH> bvh = std::make_shared<BVH>();
+        bvh->nos.resize(n[0]);
+        bvh->triangulos.resize(n[1]);
+        memcpy(bvh->nos.data(), file.data + pos, n[0] * sizeof(BVHNode));
+        memcpy(bvh->triangulos.data(), file.data + pos + n[0] * sizeof(BVHNode), n[1] * sizeof(BVHTriangle));
+        pos += bytes;
+        ok = ArvoreValida(*bvh);
+        lidas.push_back(bvh);
+    }
+    ok = ok && pos == file.size;
+
+    MappedFile_Close(&file);
+    if (ok)
+        bvhs->swap(lidas);
+    return ok;
+}
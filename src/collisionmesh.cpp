@@ -0,0 +1,130 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+
+#include "collisionmesh.h"
+#include "fastmath.h"
+
+struct InstanciaDeColisao
+{
+    std::shared_ptr<const BVH> bvh;
+    glm::mat4                  inversa; // Do mundo para o sistema do modelo
+    float                      escala;  // Maior fator de escala de "inversa", para o raio das cápsulas
+    glm::vec3                  min;     // Caixa envolvente no mundo
+    glm::vec3                  max;
+    int                        celula;
+};
+
+static std::vector<InstanciaDeColisao> g_Instancias;
+static CollisionMeshStats              g_Stats;
+
+void CollisionMesh_AddInstance(const std::shared_ptr<const BVH>& bvh, const glm::mat4& model, int celula)
+{
+    if (!bvh || bvh->nos.empty() || bvh->triangulos.empty())
+        return;
+
+    InstanciaDeColisao inst;
+    inst.bvh     = bvh;
+    inst.inversa = FastMath_AffineInverse(model);
+    inst.escala  = std::max(glm::length(glm::vec3(inst.inversa[0])),
+                   std::max(glm::length(glm::vec3(inst.inversa[1])), glm::length(glm::vec3(inst.inversa[2]))));
+    inst.celula  = celula;
+    FastMath_TransformAABB(model, bvh->nos[0].min, bvh->nos[0].max, &inst.min, &inst.max);
+
+    g_Instancias.push_back(inst);
+}
+
+void CollisionMesh_RemoveCell(int celula)
+{
+    g_Instancias.erase(std::remove_if(g_Instancias.begin(), g_Instancias.end(),
+                                      [celula](const InstanciaDeColisao& i){ return i.celula == celula; }),
+                       g_Instancias.end());
+}
+
+void CollisionMesh_CollectTriangles(int celula, std::vector<glm::vec3>* vertices)
+{
+    for (size_t i = 0; i < g_Instancias.size(); ++i)
+    {
+        const InstanciaDeColisao& inst = g_Instancias[i];
+        if (inst.celula != celula)
+            continue;
+
+        glm::mat4 model = FastMath_AffineInverse(inst.inversa);
+        const std::vector<BVHTriangle>& tris = inst.bvh->triangulos;
+        size_t primeiro = vertices->size();
+        vertices->resize(primeiro + 3 * tris.size());
+        for (size_t t = 0; t < tris.size(); ++t)
+        {
+            glm::vec3 local[3] = { tris[t].v0, tris[t].v0 + tris[t].e1, tris[t].v0 + tris[t].e2 };
+            FastMath_TransformPoints(model, local, &(*vertices)[primeiro + 3 * t], 3);
+        }
+    }
+}
+
+static inline bool CaixasSobrepostas(const glm::vec3& min1, const glm::vec3& max1, const glm::vec3& min2, const glm::vec3& max2)
+{
+    return min1.x <= max2.x && max1.x >= min2.x
+        && min1.y <= max2.y && max1.y >= min2.y
+        && min1.z <= max2.z && max1.z >= min2.z;
+}
+
+bool CollisionMesh_OverlapsCapsule(const glm::vec3& a, const glm::vec3& b, float raio)
+{
+    g_Stats.queries += 1;
+
+    glm::vec3 min = glm::min(a, b) - glm::vec3(raio);
+    glm::vec3 max = glm::max(a, b) + glm::vec3(raio);
+
+    for (size_t i = 0; i < g_Instancias.size(); ++i)
+    {
+        const InstanciaDeColisao& inst = g_Instancias[i];
+        if (!CaixasSobrepostas(min, max, inst.min, inst.max))
+            continue;
+
+        // Com escala uniforme a cápsula continua sendo uma cápsula no sistema
+        // do modelo; com escala não uniforme, o raio é superestimado.
+        const glm::vec3 segmento[2] = { a, b };
+        glm::vec3 local[2];
+        FastMath_TransformPoints(inst.inversa, segmento, local, 2);
+
+        g_Stats.instance_tests += 1;
+        if (BVH_OverlapsCapsule(*inst.bvh, local[0], local[1], raio * inst.escala, &g_Stats.bvh))
+        {
+            g_Stats.hits += 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CollisionMesh_OverlapsBox(const glm::vec3& min, const glm::vec3& max)
+{
+    g_Stats.queries += 1;
+
+    for (size_t i = 0; i < g_Instancias.size(); ++i)
+    {
+        const InstanciaDeColisao& inst = g_Instancias[i];
+        if (!CaixasSobrepostas(min, max, inst.min, inst.max))
+            continue;
+
+        glm::vec3 min_local, max_local;
+        FastMath_TransformAABB(inst.inversa, min, max, &min_local, &max_local);
+
+        g_Stats.instance_tests += 1;
+        if (BVH_OverlapsBox(*inst.bvh, min_local, max_local, &g_Stats.bvh))
+        {
+            g_Stats.hits += 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+CollisionMeshStats CollisionMesh_Stats()
+{
+    return g_Stats;
+}
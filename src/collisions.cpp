@@ -21,11 +21,17 @@ float dotproductp(glm::vec4 u, glm::vec4 v)
     float v3 = v.z;
     float v4 = v.w;
 
+#ifdef MATRICES_CHECK_W
+    // S verificado com -DMATRICES_CHECK_W (veja dotproduct() em "matrices.h")
     if ( u4 != 0.0f || v4 != 0.0f )
     {
         fprintf(stderr, "ERROR: Produto escalar no definido para pontos.\n");
         std::exit(EXIT_FAILURE);
     }
+#else
+    (void)u4;
+    (void)v4;
+#endif
 
     return u1*v1 + u2*v2 + u3*v3;
 }
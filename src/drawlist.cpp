@@ -0,0 +1,152 @@
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+#include "drawlist.h"
+#include "jobs.h"
+
+size_t g_DrawListBlockSize         = 256;
+size_t g_DrawListParallelThreshold = 1024;
+
+static DrawListStats g_Stats;
+
+// Trabalho de um DrawList_Build()
+struct MontagemDaLista
+{
+    DrawList*           lista;
+    const DrawListView* vista;
+    const DrawListFill* fill;
+    size_t              base; // Primeira posição de lista->itens usada por este trabalho
+    size_t              n;
+};
+
+static void MontaBloco(MontagemDaLista* m, size_t b)
+{
+    const DrawListView& vista = *m->vista;
+    size_t inicio = b * g_DrawListBlockSize;
+    size_t fim    = std::min(inicio + g_DrawListBlockSize, m->n);
+
+    // Os itens aceitos ficam no começo da faixa do bloco
+    RenderItem*     itens  = &m->lista->itens[m->base + inicio];
+    ChaveDeDesenho* chaves = &m->lista->chaves[m->base + inicio];
+    DrawListBlock&  bloco  = m->lista->blocos[b];
+    bloco.aceitos = bloco.descartados = bloco.pequenos = 0;
+
+    for (size_t i = inicio; i < fim; ++i)
+    {
+        RenderItem& item = itens[bloco.aceitos];
+        glm::vec3 centro;
+        float raio;
+        if (!(*m->fill)(i, &item, &centro, &raio))
+            continue;
+
+        float distancia = glm::length(centro - vista.olho);
+        if (raio >= 0.0f)
+        {
+            if (!Bounds_SphereInFrustum(vista.frustum, centro, raio))
+            {
+                bloco.descartados += 1;
+                continue;
+            }
+            if (vista.tamanho_minimo > 0.0f && distancia > raio && raio < vista.tamanho_minimo * distancia)
+            {
+                bloco.pequenos += 1;
+                continue;
+            }
+        }
+
+        item.profundidade = distancia / vista.distancia_maxima;
+        item.chave        = RenderQueue_Key(item);
+        chaves[bloco.aceitos].chave = item.chave;
+        bloco.aceitos += 1;
+    }
+}
+
+void DrawList_Begin(DrawList* lista)
+{
+    lista->itens.clear();
+    lista->chaves.clear();
+}
+
+void DrawList_Build(DrawList* lista, const DrawListView& vista, size_t n, const DrawListFill& fill)
+{
+    g_Stats.objects += n;
+    if (n == 0)
+        return;
+
+    MontagemDaLista m;
+    m.lista = lista;
+    m.vista = &vista;
+    m.fill  = &fill;
+    m.base  = lista->itens.size();
+    m.n     = n;
+    size_t num_blocos = (n + g_DrawListBlockSize - 1) / g_DrawListBlockSize;
+
+    lista->itens.resize(m.base + n);
+    lista->chaves.resize(m.base + n);
+    lista->blocos.resize(num_blocos);
+
+    if (n < g_DrawListParallelThreshold || Jobs_NumThreads() < 2)
+    {
+        for (size_t b = 0; b < num_blocos; ++b)
+            MontaBloco(&m, b);
+    }
+    else
+    {
+        g_Stats.parallel += 1;
+        Jobs_ParallelFor(0, num_blocos, 1, [&m](size_t a, size_t b)
+        {
+            for (size_t k = a; k < b; ++k)
+                MontaBloco(&m, k);
+        });
+    }
+
+    // Juntamos as faixas dos blocos, na ordem dos objetos
+    size_t destino = m.base;
+    for (size_t b = 0; b < num_blocos; ++b)
+    {
+        const DrawListBlock& bloco = lista->blocos[b];
+        size_t origem = m.base + b * g_DrawListBlockSize;
+        for (size_t k = 0; k < bloco.aceitos; ++k, ++destino)
+        {
+            if (destino != origem + k)
+                lista->itens[destino] = lista->itens[origem + k];
+            lista->chaves[destino].chave = lista->chaves[origem + k].chave;
+            lista->chaves[destino].item  = (uint32_t)destino;
+        }
+        g_Stats.culled += bloco.descartados;
+        g_Stats.small  += bloco.pequenos;
+    }
+    lista->itens.resize(destino);
+    lista->chaves.resize(destino);
+}
+
+void DrawList_Append(DrawList* lista, const RenderItem& item)
+{
+    ChaveDeDesenho c;
+    c.chave = RenderQueue_Key(item);
+    c.item  = (uint32_t)lista->itens.size();
+
+    lista->itens.push_back(item);
+    lista->itens.back().chave = c.chave;
+    lista->chaves.push_back(c);
+}
+
+void DrawList_Finish(DrawList* lista)
+{
+    RenderQueue_SortKeys(&lista->chaves, &lista->temp);
+
+    // O fluxo é reservado para todos os objetos já passados a
+    // DrawList_Build(), e não só para os aceitos: ele não cresce quando mais
+    // objetos entram no volume de visualização
+    lista->comandos.palavras.reserve(lista->itens.capacity() * RENDERQUEUE_MAX_PALAVRAS);
+    RenderQueue_Encode(lista->itens.data(), lista->chaves, &lista->comandos);
+
+    g_Stats.frames += 1;
+    g_Stats.items  += lista->itens.size();
+}
+
+DrawListStats DrawList_Stats()
+{
+    return g_Stats;
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/vec4.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FASTMATH_SSE 1
+#endif
+
+#include "fastmath.h"
+
+#ifdef FASTMATH_SSE
+
+// A coluna j de uma glm::mat4 são quatro floats contíguos
+static inline __m128 Coluna(const glm::mat4& m, int j)
+{
+    return _mm_loadu_ps(&m[j][0]);
+}
+
+static inline __m128 Cross(__m128 a, __m128 b)
+{
+    __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c     = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// m[0]*x + m[1]*y + m[2]*z + m[3]
+static inline __m128 TransformaPonto(__m128 c0, __m128 c1, __m128 c2, __m128 c3, float x, float y, float z)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(x)), _mm_mul_ps(c1, _mm_set1_ps(y))),
+                      _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(z)), c3));
+}
+
+glm::mat4 FastMath_Multiply(const glm::mat4& a, const glm::mat4& b)
+{
+    __m128 a0 = Coluna(a, 0), a1 = Coluna(a, 1), a2 = Coluna(a, 2), a3 = Coluna(a, 3);
+
+    glm::mat4 r;
+    for (int j = 0; j < 4; ++j)
+    {
+        __m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[j][0])), _mm_mul_ps(a1, _mm_set1_ps(b[j][1]))),
+                              _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[j][2])), _mm_mul_ps(a3, _mm_set1_ps(b[j][3]))));
+        _mm_storeu_ps(&r[j][0], c);
+    }
+    return r;
+}
+
+glm::mat4 FastMath_AffineInverse(const glm::mat4& m)
+{
+    // Zeramos w para que os produtos vetoriais fiquem com w = 0
+    const __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    __m128 c0 = _mm_and_ps(Coluna(m, 0), xyz);
+    __m128 c1 = _mm_and_ps(Coluna(m, 1), xyz);
+    __m128 c2 = _mm_and_ps(Coluna(m, 2), xyz);
+
+    // As linhas da inversa do bloco 3x3 são os produtos vetoriais das
+    // colunas, divididos pelo determinante.
+    __m128 l0 = Cross(c1, c2);
+    __m128 l1 = Cross(c2, c0);
+    __m128 l2 = Cross(c0, c1);
+    __m128 l3 = _mm_setzero_ps();
+
+    __m128 d = _mm_mul_ps(c0, l0);
+    d = _mm_add_ss(_mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 1, 1, 1))), _mm_movehl_ps(d, d));
+    __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0)));
+
+    // Linhas -> colunas
+    _MM_TRANSPOSE4_PS(l0, l1, l2, l3);
+    l0 = _mm_mul_ps(l0, inv_det);
+    l1 = _mm_mul_ps(l1, inv_det);
+    l2 = _mm_mul_ps(l2, inv_det);
+
+    // Translação: -inversa(R) * t
+    __m128 t = TransformaPonto(l0, l1, l2, _mm_setzero_ps(), m[3][0], m[3][1], m[3][2]);
+    t = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), t);
+
+    glm::mat4 r;
+    _mm_storeu_ps(&r[0][0], l0);
+    _mm_storeu_ps(&r[1][0], l1);
+    _mm_storeu_ps(&r[2][0], l2);
+    _mm_storeu_ps(&r[3][0], t);
+    return r;
+}
+
+void FastMath_TransformPoints(const glm::mat4& m, const glm::vec3* entrada, glm::vec3* saida, size_t n)
+{
+    __m128 c0 = Coluna(m, 0), c1 = Coluna(m, 1), c2 = Coluna(m, 2), c3 = Coluna(m, 3);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        __m128 p = TransformaPonto(c0, c1, c2, c3, entrada[i].x, entrada[i].y, entrada[i].z);
+        // Só x, y e z: um store de 16 bytes invadiria o ponto seguinte
+        _mm_storel_pi((__m64*)&saida[i].x, p);
+        _mm_store_ss(&saida[i].z, _mm_movehl_ps(p, p));
+    }
+}
+
+void FastMath_TransformAABB(const glm::mat4& m, const glm::vec3& min, const glm::vec3& max,
+                            glm::vec3* min_saida, glm::vec3* max_saida)
+{
+    __m128 menor = Coluna(m, 3);
+    __m128 maior = menor;
+    for (int j = 0; j < 3; ++j)
+    {
+        __m128 c = Coluna(m, j);
+        __m128 a = _mm_mul_ps(c, _mm_set1_ps(min[j]));
+        __m128 b = _mm_mul_ps(c, _mm_set1_ps(max[j]));
+        menor = _mm_add_ps(menor, _mm_min_ps(a, b));
+        maior = _mm_add_ps(maior, _mm_max_ps(a, b));
+    }
+
+    float r[8];
+    _mm_storeu_ps(&r[0], menor);
+    _mm_storeu_ps(&r[4], maior);
+    *min_saida = glm::vec3(r[0], r[1], r[2]);
+    *max_saida = glm::vec3(r[4], r[5], r[6]);
+}
+
+#else // FASTMATH_SSE
+
+glm::mat4 FastMath_Multiply(const glm::mat4& a, const glm::mat4& b)
+{
+    glm::mat4 r;
+    for (int j = 0; j < 4; ++j)
+        for (int i = 0; i < 4; ++i)
+            r[j][i] = a[0][i]*b[j][0] + a[1][i]*b[j][1] + a[2][i]*b[j][2] + a[3][i]*b[j][3];
+    return r;
+}
+
+glm::mat4 FastMath_AffineInverse(const glm::mat4& m)
+{
+    glm::vec3 c0 = glm::vec3(m[0]), c1 = glm::vec3(m[1]), c2 = glm::vec3(m[2]);
+
+    // As linhas da inversa do bloco 3x3 são os produtos vetoriais das
+    // colunas, divididos pelo determinante.
+    glm::vec3 l0(c1.y*c2.z - c1.z*c2.y, c1.z*c2.x - c1.x*c2.z, c1.x*c2.y - c1.y*c2.x);
+    glm::vec3 l1(c2.y*c0.z - c2.z*c0.y, c2.z*c0.x - c2.x*c0.z, c2.x*c0.y - c2.y*c0.x);
+    glm::vec3 l2(c0.y*c1.z - c0.z*c1.y, c0.z*c1.x - c0.x*c1.z, c0.x*c1.y - c0.y*c1.x);
+    float inv_det = 1.0f / (c0.x*l0.x + c0.y*l0.y + c0.z*l0.z);
+
+    glm::mat4 r;
+    for (int j = 0; j < 3; ++j)
+        r[j] = glm::vec4(l0[j]*inv_det, l1[j]*inv_det, l2[j]*inv_det, 0.0f);
+
+    // Translação: -inversa(R) * t
+    glm::vec3 t = glm::vec3(r[0])*m[3][0] + glm::vec3(r[1])*m[3][1] + glm::vec3(r[2])*m[3][2];
+    r[3] = glm::vec4(-t, 1.0f);
+    return r;
+}
+
+void FastMath_TransformPoints(const glm::mat4& m, const glm::vec3* entrada, glm::vec3* saida, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        glm::vec3 p = entrada[i];
+        saida[i] = glm::vec3(m[0])*p.x + glm::vec3(m[1])*p.y + glm::vec3(m[2])*p.z + glm::vec3(m[3]);
+    }
+}
+
+void FastMath_TransformAABB(const glm::mat4& m, const glm::vec3& min, const glm::vec3& max,
+                            glm::vec3* min_saida, glm::vec3* max_saida)
+{
+    glm::vec3 menor = glm::vec3(m[3]);
+    glm::vec3 maior = menor;
+    for (int j = 0; j < 3; ++j)
+    {
+        glm::vec3 a = glm::vec3(m[j]) * min[j];
+        glm::vec3 b = glm::vec3(m[j]) * max[j];
+        menor += glm::min(a, b);
+        maior += glm::max(a, b);
+    }
+    *min_saida = menor;
+    *max_saida = maior;
+}
+
+#endif // FASTMATH_SSE
@@ -0,0 +1,278 @@
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+#include "flowfield.h"
+
+#define INFINITO 0xFFFFFFFFu
+
+// Custo dos passos, em décimos de célula
+#define CUSTO_RETO     10
+#define CUSTO_DIAGONAL 14
+
+static FlowFieldStats g_Stats;
+
+// Vizinhas: as quatro retas primeiro, depois as diagonais
+static const int VIZ_X[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+static const int VIZ_Z[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+// Vizinha "k" de "c" ligada a ela, ou FLOWFIELD_NONE. As diagonais exigem
+// que as duas retas ao lado também estejam ligadas.
+static inline uint32_t Vizinha(const FlowField& campo, uint32_t c, int k)
+{
+    int x = (int)(c % (uint32_t)campo.largura), z = (int)(c / (uint32_t)campo.largura);
+    int nx = x + VIZ_X[k], nz = z + VIZ_Z[k];
+    if (nx < 0 || nz < 0 || nx >= campo.largura || nz >= campo.profundidade)
+        return FLOWFIELD_NONE;
+
+    uint32_t n = (uint32_t)(nx + nz * campo.largura);
+    if (!campo.livre[n] || std::fabs(campo.altura[n] - campo.altura[c]) > campo.agent_climb)
+        return FLOWFIELD_NONE;
+
+    if (k >= 4)
+    {
+        uint32_t a = (uint32_t)(nx + z * campo.largura);
+        uint32_t b = (uint32_t)(x + nz * campo.largura);
+        if (!campo.livre[a] || std::fabs(campo.altura[a] - campo.altura[c]) > campo.agent_climb
+         || !campo.livre[b] || std::fabs(campo.altura[b] - campo.altura[c]) > campo.agent_climb)
+            return FLOWFIELD_NONE;
+    }
+    return n;
+}
+
+void FlowField_Build(FlowField* campo, const NavMesh& navmesh)
+{
+    campo->largura      = navmesh.largura;
+    campo->profundidade = navmesh.profundidade;
+    campo->min_x        = navmesh.params.min.x;
+    campo->min_z        = navmesh.params.min.z;
+    campo->cell_size    = navmesh.params.cell_size;
+    campo->agent_climb  = navmesh.params.agent_climb;
+
+    size_t celulas = (size_t)campo->largura * campo->profundidade;
+    campo->livre.assign(celulas, 0);
+    campo->altura.assign(celulas, 0.0f);
+    for (size_t c = 0; c < celulas && c + 1 < navmesh.inicio_coluna.size(); ++c)
+        for (uint32_t k = navmesh.inicio_coluna[c]; k < navmesh.inicio_coluna[c+1]; ++k)
+        {
+            float y = navmesh.poligonos[navmesh.poligonos_da_coluna[k]].y;
+            if (!campo->livre[c] || y < campo->altura[c])
+                campo->altura[c] = y;
+            campo->livre[c] = 1;
+        }
+
+    campo->ligacoes.assign(celulas, 0);
+    for (uint32_t c = 0; c < (uint32_t)celulas; ++c)
+        if (campo->livre[c])
+            for (int k = 0; k < 8; ++k)
+                if (Vizinha(*campo, c, k) != FLOWFIELD_NONE)
+                    campo->ligacoes[c] |= (uint8_t)(1 << k);
+
+    campo->direcao_x.assign(celulas, 0.0f);
+    campo->direcao_z.assign(celulas, 0.0f);
+    campo->distancia.assign(celulas, INFINITO);
+    campo->fuga.assign(celulas, INFINITO);
+
+    // Cada célula entra no heap uma vez por relaxamento, no máximo uma por
+    // vizinha, além da entrada inicial
+    campo->heap.clear();
+    campo->heap.reserve(celulas * 9);
+
+    campo->fase           = 0;
+    campo->celula_jogador = FLOWFIELD_NONE;
+    campo->celula_calculo = FLOWFIELD_NONE;
+    campo->pronto         = false;
+}
+
+uint32_t FlowField_Cell(const FlowField& campo, float x, float z)
+{
+    if (campo.largura == 0)
+        return FLOWFIELD_NONE;
+
+    float fx = std::floor((x - campo.min_x) / campo.cell_size);
+    float fz = std::floor((z - campo.min_z) / campo.cell_size);
+    if (!(fx >= 0.0f && fz >= 0.0f && fx < (float)campo.largura && fz < (float)campo.profundidade))
+        return FLOWFIELD_NONE;
+
+    uint32_t c = (uint32_t)fx + (uint32_t)fz * (uint32_t)campo.largura;
+    return campo.livre[c] ? c : FLOWFIELD_NONE;
+}
+
+static inline void Insere(std::vector<uint64_t>* heap, uint32_t custo, uint32_t c)
+{
+    heap->push_back(((uint64_t)custo << 32) | c);
+    std::push_heap(heap->begin(), heap->end(), std::greater<uint64_t>());
+}
+
+// Retira do heap até "orcamento" células, relaxando as vizinhas em
+// "custo". Retorna quantas foram retiradas.
+static size_t Dijkstra(FlowField* campo, std::vector<uint32_t>* custo, size_t orcamento)
+{
+    int32_t deslocamento[8];
+    for (int k = 0; k < 8; ++k)
+        deslocamento[k] = VIZ_X[k] + VIZ_Z[k] * campo->largura;
+
+    size_t retiradas = 0;
+    while (!campo->heap.empty() && retiradas < orcamento)
+    {
+        std::pop_heap(campo->heap.begin(), campo->heap.end(), std::greater<uint64_t>());
+        uint64_t topo = campo->heap.back();
+        campo->heap.pop_back();
+        retiradas += 1;
+
+        uint32_t c = (uint32_t)topo, valor = (uint32_t)(topo >> 32);
+        if (valor > (*custo)[c])
+            continue; // Entrada antiga
+
+        uint8_t ligacoes = campo->ligacoes[c];
+        for (int k = 0; k < 8; ++k)
+        {
+            if (!(ligacoes & (1 << k)))
+                continue;
+            uint32_t n = c + deslocamento[k];
+            uint32_t novo = valor + (k < 4 ? CUSTO_RETO : CUSTO_DIAGONAL);
+            if (novo < (*custo)[n])
+            {
+                (*custo)[n] = novo;
+                Insere(&campo->heap, novo, n);
+            }
+        }
+    }
+    return retiradas;
+}
+
+// Passa das distâncias ao jogador para o segundo Dijkstra: todas as células
+// alcançáveis entram no heap com -FLOWFIELD_FLEE_FACTOR vezes a distância,
+// somada à maior distância (para que os custos sejam positivos).
+static void ComecaFuga(FlowField* campo)
+{
+    uint32_t maior = 0;
+    for (size_t c = 0; c < campo->distancia.size(); ++c)
+        if (campo->distancia[c] != INFINITO)
+            maior = std::max(maior, campo->distancia[c]);
+
+    float base = FLOWFIELD_FLEE_FACTOR * maior;
+    campo->heap.clear();
+    for (size_t c = 0; c < campo->distancia.size(); ++c)
+    {
+        if (campo->distancia[c] == INFINITO)
+        {
+            campo->fuga[c] = INFINITO;
+            continue;
+        }
+        campo->fuga[c] = (uint32_t)(base - FLOWFIELD_FLEE_FACTOR * campo->distancia[c] + 0.5f);
+        campo->heap.push_back(((uint64_t)campo->fuga[c] << 32) | (uint32_t)c);
+    }
+    std::make_heap(campo->heap.begin(), campo->heap.end(), std::greater<uint64_t>());
+}
+
+// Direção de cada célula para a vizinha de menor valor de fuga
+static void CalculaDirecoes(FlowField* campo)
+{
+    const float diagonal = 0.70710678f;
+    for (uint32_t c = 0; c < (uint32_t)campo->fuga.size(); ++c)
+    {
+        float dx = 0.0f, dz = 0.0f;
+        uint32_t menor = campo->fuga[c];
+        if (menor != INFINITO)
+            for (int k = 0; k < 8; ++k)
+            {
+                uint32_t n = c + VIZ_X[k] + VIZ_Z[k] * campo->largura;
+                if ((campo->ligacoes[c] & (1 << k)) && campo->fuga[n] < menor)
+                {
+                    menor = campo->fuga[n];
+                    dx = k < 4 ? (float)VIZ_X[k] : VIZ_X[k] * diagonal;
+                    dz = k < 4 ? (float)VIZ_Z[k] : VIZ_Z[k] * diagonal;
+                }
+            }
+        campo->direcao_x[c] = dx;
+        campo->direcao_z[c] = dz;
+    }
+}
+
+bool FlowField_Update(FlowField* campo, const glm::vec3& jogador, size_t orcamento)
+{
+    uint32_t celula = FlowField_Cell(*campo, jogador.x, jogador.z);
+    if (celula != FLOWFIELD_NONE && celula != campo->celula_jogador)
+    {
+        if (campo->fase != 0)
+            g_Stats.restarts += 1;
+
+        campo->celula_jogador = celula;
+        campo->celula_calculo = celula;
+        campo->fase = 1;
+        std::fill(campo->distancia.begin(), campo->distancia.end(), INFINITO);
+        campo->distancia[celula] = 0;
+        campo->heap.clear();
+        Insere(&campo->heap, 0, celula);
+    }
+    if (campo->fase == 0)
+        return false;
+
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    bool terminou = false;
+
+    size_t retiradas = 0;
+    if (campo->fase == 1)
+    {
+        retiradas += Dijkstra(campo, &campo->distancia, orcamento);
+        if (campo->heap.empty())
+        {
+            ComecaFuga(campo);
+            campo->fase = 2;
+        }
+    }
+    if (campo->fase == 2 && retiradas < orcamento)
+    {
+        retiradas += Dijkstra(campo, &campo->fuga, orcamento - retiradas);
+        if (campo->heap.empty())
+        {
+            CalculaDirecoes(campo);
+            campo->fase   = 0;
+            campo->pronto = true;
+            terminou      = true;
+            g_Stats.recomputes += 1;
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+    g_Stats.steps    += 1;
+    g_Stats.nodes    += retiradas;
+    g_Stats.total_ms += ms;
+    g_Stats.max_step_ms = std::max(g_Stats.max_step_ms, ms);
+    return terminou;
+}
+
+glm::vec2 FlowField_Sample(const FlowField& campo, float x, float z)
+{
+    glm::vec2 direcao(0.0f);
+    if (!campo.pronto)
+        return direcao;
+
+    // Centros das células em (i + 0.5) * cell_size
+    float gx = (x - campo.min_x) / campo.cell_size - 0.5f;
+    float gz = (z - campo.min_z) / campo.cell_size - 0.5f;
+    float fx = std::floor(gx), fz = std::floor(gz);
+    if (!(fx >= -1.0f && fz >= -1.0f && fx < (float)campo.largura && fz < (float)campo.profundidade))
+        return direcao;
+
+    int x0 = (int)fx, z0 = (int)fz;
+    float sx = gx - fx, sz = gz - fz;
+    for (int k = 0; k < 4; ++k)
+    {
+        int cx = x0 + (k & 1), cz = z0 + (k >> 1);
+        if (cx < 0 || cz < 0 || cx >= campo.largura || cz >= campo.profundidade)
+            continue;
+        size_t c = (size_t)cx + (size_t)cz * campo.largura;
+        float peso = ((k & 1) ? sx : 1.0f - sx) * ((k >> 1) ? sz : 1.0f - sz);
+        direcao.x += peso * campo.direcao_x[c];
+        direcao.y += peso * campo.direcao_z[c];
+    }
+    return direcao;
+}
+
+FlowFieldStats FlowField_Stats()
+{
+    return g_Stats;
+}
@@ -0,0 +1,117 @@
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "framearena.h"
+
+// Capacidade inicial das arenas de rascunho
+#define FRAMEARENA_RASCUNHO (256 * 1024)
+
+Arena g_FrameArena;
+
+static void* AlocaBloco(size_t bytes)
+{
+    void* p = std::malloc(std::max<size_t>(bytes, 1));
+    if (p == NULL)
+    {
+        fprintf(stderr, "ERROR: sem memória para uma arena de %lu bytes.\n", (unsigned long)bytes);
+        std::exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+void Arena_Init(Arena* arena, size_t capacidade)
+{
+    arena->memoria      = (unsigned char*)AlocaBloco(capacidade);
+    arena->capacidade   = capacidade;
+    arena->usado        = 0;
+    arena->pico         = 0;
+    arena->maior_pico   = 0;
+    arena->estouros     = 0;
+    arena->usado_extras = 0;
+    arena->extras.reserve(16);
+}
+
+void Arena_Destroy(Arena* arena)
+{
+    for (size_t i = 0; i < arena->extras.size(); ++i)
+        std::free(arena->extras[i]);
+    arena->extras.clear();
+    std::free(arena->memoria);
+    arena->memoria    = NULL;
+    arena->capacidade = 0;
+    arena->usado      = 0;
+}
+
+void* Arena_Alloc(Arena* arena, size_t bytes, size_t align)
+{
+    size_t inicio = (arena->usado + align - 1) & ~(align - 1);
+    if (inicio + bytes <= arena->capacidade)
+    {
+        arena->usado = inicio + bytes;
+        arena->pico  = std::max(arena->pico, arena->usado + arena->usado_extras);
+        return arena->memoria + inicio;
+    }
+
+    // malloc() já alinha para qualquer tipo fundamental
+    arena->estouros     += 1;
+    arena->usado_extras += bytes + align;
+    arena->pico          = std::max(arena->pico, arena->usado + arena->usado_extras);
+    void* p = AlocaBloco(bytes);
+    arena->extras.push_back(p);
+    return p;
+}
+
+void Arena_Reset(Arena* arena)
+{
+    arena->maior_pico = std::max(arena->maior_pico, arena->pico);
+    if (!arena->extras.empty())
+    {
+        for (size_t i = 0; i < arena->extras.size(); ++i)
+            std::free(arena->extras[i]);
+        arena->extras.clear();
+
+        size_t capacidade = std::max(2 * arena->capacidade, arena->pico);
+        std::free(arena->memoria);
+        arena->memoria    = (unsigned char*)AlocaBloco(capacidade);
+        arena->capacidade = capacidade;
+    }
+    arena->usado        = 0;
+    arena->usado_extras = 0;
+    arena->pico         = 0;
+}
+
+size_t Arena_Mark(const Arena& arena)
+{
+    return arena.usado;
+}
+
+void Arena_Rewind(Arena* arena, size_t marca)
+{
+    arena->usado = marca;
+
+    // Só há blocos extras no rascunho quando o bloco não bastou: ao voltar ao
+    // começo, aproveitamos para aumentá-lo
+    if (marca == 0 && !arena->extras.empty())
+        Arena_Reset(arena);
+}
+
+Arena* Arena_Scratch()
+{
+    static thread_local Arena rascunho;
+    static thread_local bool  iniciada = false;
+    if (!iniciada)
+    {
+        Arena_Init(&rascunho, FRAMEARENA_RASCUNHO);
+        iniciada = true;
+    }
+    return &rascunho;
+}
+
+void FrameArena_BeginFrame()
+{
+    if (g_FrameArena.memoria == NULL)
+        Arena_Init(&g_FrameArena, 1024 * 1024);
+    else
+        Arena_Reset(&g_FrameArena);
+}
@@ -0,0 +1,402 @@
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+
+#include "jobs.h"
+#include "framearena.h"
+
+// Tarefas e posições de cada fila criadas por Jobs_Init(), para que os
+// primeiros quadros não precisem alocar memória
+#define JOBS_TAREFAS_INICIAIS 256
+#define JOBS_FILA_INICIAL     64
+
+struct Job
+{
+    JobFunction      funcao;
+    JobRangeCall     faixa;       // Faixa de Jobs_ParallelFor(), no lugar de "funcao"
+    const void*      faixa_f;
+    size_t           faixa_a;
+    size_t           faixa_b;
+    Job*             pai;
+    Job*             proxima_livre;
+    std::atomic<int> pendentes;   // A própria tarefa (até executar) e as filhas não terminadas
+    std::atomic<int> referencias; // Quem a criou (até Jobs_Wait()/Jobs_Release()) e o sistema (até terminar)
+};
+
+// Fila de duas pontas de uma thread: a dona usa o fim, os ladrões o começo.
+// É um vetor circular que só cresce, para que inserir e retirar tarefas não
+// aloquem memória depois dos primeiros quadros.
+struct FilaDeTarefas
+{
+    std::mutex        mutex;
+    std::vector<Job*> tarefas;
+    size_t            primeira;
+    size_t            quantas;
+
+    FilaDeTarefas() : primeira(0), quantas(0) {}
+};
+
+// Estado criado por Jobs_Init() e destruído só por Jobs_Shutdown(): se o
+// programa terminar com std::exit() com as threads esperando, nada é
+// destruído enquanto elas ainda o usam.
+struct SistemaDeTarefas
+{
+    std::vector<std::thread> threads;
+
+    // filas[0] é da thread que chamou Jobs_Init(), filas[i] da i-ésima
+    // thread do conjunto e a última é compartilhada pelas demais threads.
+    std::vector<FilaDeTarefas*> filas;
+    FilaDeTarefas               segundo_plano;
+
+    std::mutex              mutex;
+    std::condition_variable acorda;
+    bool                    parar;
+};
+
+static SistemaDeTarefas* g_Sistema = NULL;
+
+static std::atomic<size_t>   g_NaFila(0);   // Tarefas em alguma fila, ainda não retiradas
+static std::atomic<unsigned> g_Dormindo(0); // Threads esperando em g_Sistema->acorda
+
+static std::atomic<unsigned long> g_Executadas(0);
+static std::atomic<unsigned long> g_Roubadas(0);
+static std::atomic<unsigned long> g_Ajudadas(0);
+static std::atomic<unsigned long> g_EmSegundoPlano(0);
+
+static thread_local int t_Fila = -1; // Índice da fila da thread atual em g_Sistema->filas
+
+// Tarefas terminadas, para reaproveitamento
+static std::mutex g_LivresMutex;
+static Job*       g_Livres = NULL;
+
+static Job* NovaTarefa()
+{
+    {
+        std::lock_guard<std::mutex> trava(g_LivresMutex);
+        if (g_Livres != NULL)
+        {
+            Job* job = g_Livres;
+            g_Livres = job->proxima_livre;
+            return job;
+        }
+    }
+    return new Job;
+}
+
+static void Solta(Job* job)
+{
+    if (job->referencias.fetch_sub(1) != 1)
+        return;
+
+    // Libera o que a função capturou antes de guardar a tarefa
+    job->funcao = nullptr;
+    std::lock_guard<std::mutex> trava(g_LivresMutex);
+    job->proxima_livre = g_Livres;
+    g_Livres = job;
+}
+
+static void Termina(Job* job)
+{
+    while (job != NULL && job->pendentes.fetch_sub(1) == 1)
+    {
+        Job* pai = job->pai;
+        Solta(job);
+        job = pai;
+    }
+}
+
+static void Executa(Job* job)
+{
+    if (job->faixa != NULL)
+        job->faixa(job->faixa_f, job->faixa_a, job->faixa_b);
+    else if (job->funcao)
+        job->funcao();
+    g_Executadas.fetch_add(1, std::memory_order_relaxed);
+    Termina(job);
+}
+
+static void Insere(FilaDeTarefas* fila, Job* job)
+{
+    {
+        std::lock_guard<std::mutex> trava(fila->mutex);
+        if (fila->quantas == fila->tarefas.size())
+        {
+            // Cheia: desenrolamos o vetor circular em um com o dobro do tamanho
+            std::vector<Job*> maior(std::max<size_t>(JOBS_FILA_INICIAL, 2 * fila->tarefas.size()));
+            for (size_t i = 0; i < fila->quantas; ++i)
+                maior[i] = fila->tarefas[(fila->primeira + i) % fila->tarefas.size()];
+            fila->tarefas.swap(maior);
+            fila->primeira = 0;
+        }
+        fila->tarefas[(fila->primeira + fila->quantas) % fila->tarefas.size()] = job;
+        fila->quantas += 1;
+    }
+    g_NaFila.fetch_add(1);
+
+    // Se alguma thread está para dormir, passamos pelo mutex para que ela
+    // não perca o aviso entre testar g_NaFila e começar a esperar
+    if (g_Dormindo.load() > 0)
+    {
+        { std::lock_guard<std::mutex> trava(g_Sistema->mutex); }
+        g_Sistema->acorda.notify_one();
+    }
+}
+
+static Job* Retira(FilaDeTarefas* fila, bool do_fim)
+{
+    std::lock_guard<std::mutex> trava(fila->mutex);
+    if (fila->quantas == 0)
+        return NULL;
+
+    Job* job;
+    if (do_fim)
+        job = fila->tarefas[(fila->primeira + fila->quantas - 1) % fila->tarefas.size()];
+    else
+    {
+        job = fila->tarefas[fila->primeira];
+        fila->primeira = (fila->primeira + 1) % fila->tarefas.size();
+    }
+    fila->quantas -= 1;
+    g_NaFila.fetch_sub(1);
+    return job;
+}
+
+// Próxima tarefa para a thread atual: da própria fila, roubada de outra ou,
+// se permitido, de segundo plano
+static Job* ProximaTarefa(bool segundo_plano)
+{
+    if (g_NaFila.load() == 0)
+        return NULL;
+
+    const std::vector<FilaDeTarefas*>& filas = g_Sistema->filas;
+    int n = (int)filas.size();
+    if (t_Fila >= 0)
+    {
+        Job* job = Retira(filas[t_Fila], true);
+        if (job != NULL)
+            return job;
+    }
+
+    // Começamos por uma fila diferente a cada vez, para espalhar os roubos
+    static std::atomic<unsigned> proxima(0);
+    int inicio = (int)(proxima.fetch_add(1, std::memory_order_relaxed) % (unsigned)n);
+    for (int k = 0; k < n; ++k)
+    {
+        int i = (inicio + k) % n;
+        if (i == t_Fila)
+            continue;
+        Job* job = Retira(filas[i], false);
+        if (job != NULL)
+        {
+            g_Roubadas.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    if (segundo_plano)
+    {
+        Job* job = Retira(&g_Sistema->segundo_plano, false);
+        if (job != NULL)
+            g_EmSegundoPlano.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+    return NULL;
+}
+
+static void ThreadDeTarefas(int indice)
+{
+    t_Fila = indice;
+
+    // A arena de rascunho da thread (veja "framearena.h") é criada antes da
+    // primeira tarefa, e não na primeira que a usar
+    Arena_Scratch();
+
+    for (;;)
+    {
+        Job* job = ProximaTarefa(true);
+        if (job != NULL)
+        {
+            Executa(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> trava(g_Sistema->mutex);
+        g_Dormindo.fetch_add(1);
+        g_Sistema->acorda.wait(trava, []{ return g_Sistema->parar || g_NaFila.load() > 0; });
+        g_Dormindo.fetch_sub(1);
+        if (g_Sistema->parar && g_NaFila.load() == 0)
+            return;
+    }
+}
+
+void Jobs_Init()
+{
+    if (g_Sistema != NULL)
+        return;
+
+    unsigned int n = std::thread::hardware_concurrency();
+    n = std::max(1u, std::min(n > 1 ? n - 1 : 1u, 7u));
+
+    g_Sistema = new SistemaDeTarefas;
+    g_Sistema->parar = false;
+    for (unsigned int i = 0; i < n + 2; ++i)
+    {
+        g_Sistema->filas.push_back(new FilaDeTarefas);
+        g_Sistema->filas.back()->tarefas.resize(JOBS_FILA_INICIAL);
+    }
+    g_Sistema->segundo_plano.tarefas.resize(JOBS_FILA_INICIAL);
+    t_Fila = 0;
+
+    {
+        std::lock_guard<std::mutex> trava(g_LivresMutex);
+        for (unsigned int i = 0; i < JOBS_TAREFAS_INICIAIS; ++i)
+        {
+            Job* job = new Job;
+            job->proxima_livre = g_Livres;
+            g_Livres = job;
+        }
+    }
+
+    for (unsigned int i = 0; i < n; ++i)
+        g_Sistema->threads.push_back(std::thread(ThreadDeTarefas, (int)i + 1));
+}
+
+void Jobs_Shutdown()
+{
+    if (g_Sistema == NULL)
+        return;
+
+    {
+        std::lock_guard<std::mutex> trava(g_Sistema->mutex);
+        g_Sistema->parar = true;
+    }
+    g_Sistema->acorda.notify_all();
+    for (size_t i = 0; i < g_Sistema->threads.size(); ++i)
+        g_Sistema->threads[i].join();
+
+    for (size_t i = 0; i < g_Sistema->filas.size(); ++i)
+        delete g_Sistema->filas[i];
+    delete g_Sistema;
+    g_Sistema = NULL;
+    t_Fila = -1;
+
+    std::lock_guard<std::mutex> trava(g_LivresMutex);
+    while (g_Livres != NULL)
+    {
+        Job* job = g_Livres;
+        g_Livres = job->proxima_livre;
+        delete job;
+    }
+}
+
+unsigned int Jobs_NumThreads()
+{
+    return g_Sistema != NULL ? (unsigned int)g_Sistema->threads.size() + 1 : 1;
+}
+
+Job* Jobs_Create(const JobFunction& funcao, Job* pai)
+{
+    Job* job = NovaTarefa();
+    job->funcao = funcao;
+    job->faixa  = NULL;
+    job->pai    = pai;
+    job->pendentes.store(1);
+    job->referencias.store(2);
+    if (pai != NULL)
+        pai->pendentes.fetch_add(1);
+    return job;
+}
+
+void Jobs_Run(Job* job)
+{
+    if (g_Sistema == NULL)
+        Executa(job); // Sem Jobs_Init(): não há filas
+    else
+        Insere(g_Sistema->filas[t_Fila >= 0 ? t_Fila : g_Sistema->filas.size() - 1], job);
+}
+
+void Jobs_RunBackground(Job* job)
+{
+    if (g_Sistema == NULL)
+    {
+        g_EmSegundoPlano.fetch_add(1, std::memory_order_relaxed);
+        Executa(job);
+    }
+    else
+        Insere(&g_Sistema->segundo_plano, job);
+}
+
+void Jobs_Wait(Job* job)
+{
+    while (job->pendentes.load() > 0)
+    {
+        Job* outra = ProximaTarefa(false);
+        if (outra != NULL)
+        {
+            g_Ajudadas.fetch_add(1, std::memory_order_relaxed);
+            Executa(outra);
+        }
+        else
+            std::this_thread::yield();
+    }
+    Solta(job);
+}
+
+void Jobs_Release(Job* job)
+{
+    Solta(job);
+}
+
+bool Jobs_Done(const Job* job)
+{
+    return job->pendentes.load() == 0;
+}
+
+void Jobs_ParallelForCall(size_t inicio, size_t fim, size_t grao, JobRangeCall chama, const void* f)
+{
+    if (fim <= inicio)
+        return;
+
+    // Algumas faixas por thread, para que as mais rápidas roubem das demais.
+    // Arredondado para baixo, para que nenhuma faixa tenha menos de "grao"
+    // elementos (a não ser a última).
+    size_t n      = fim - inicio;
+    size_t faixas = n / std::max(grao, (size_t)1);
+    faixas = std::min(faixas, (size_t)4 * Jobs_NumThreads());
+    if (faixas <= 1 || g_Sistema == NULL)
+    {
+        chama(f, inicio, fim);
+        return;
+    }
+
+    size_t tamanho = (n + faixas - 1) / faixas;
+    Job* raiz = Jobs_Create(JobFunction());
+    for (size_t a = inicio + tamanho; a < fim; a += tamanho)
+    {
+        size_t b = std::min(a + tamanho, fim);
+        Job* filha = Jobs_Create(JobFunction(), raiz);
+        filha->faixa   = chama;
+        filha->faixa_f = f;
+        filha->faixa_a = a;
+        filha->faixa_b = b;
+        Jobs_Run(filha);
+        Jobs_Release(filha);
+    }
+
+    Executa(raiz);
+    chama(f, inicio, inicio + tamanho);
+    Jobs_Wait(raiz);
+}
+
+JobStats Jobs_Stats()
+{
+    JobStats s;
+    s.jobs       = g_Executadas.load();
+    s.stolen     = g_Roubadas.load();
+    s.helped     = g_Ajudadas.load();
+    s.background = g_EmSegundoPlano.load();
+    return s;
+}
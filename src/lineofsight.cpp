@@ -0,0 +1,117 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <glm/vec4.hpp>
+
+#include "lineofsight.h"
+#include "fastmath.h"
+
+int g_LineOfSightBudget = 64;
+
+struct Oclusor
+{
+    std::shared_ptr<const BVH> bvh;
+    glm::mat4                  inversa; // Do mundo para o sistema do modelo
+    glm::vec3                  min;     // Caixa envolvente no mundo
+    glm::vec3                  max;
+    int                        celula;
+};
+
+static std::vector<Oclusor> g_Oclusores;
+static LineOfSightStats     g_Stats;
+
+void LineOfSight_AddOccluder(const std::shared_ptr<const BVH>& bvh, const glm::mat4& model, int celula)
+{
+    if (!bvh || bvh->nos.empty() || bvh->triangulos.empty())
+        return;
+
+    Oclusor o;
+    o.bvh     = bvh;
+    o.inversa = FastMath_AffineInverse(model);
+    o.celula  = celula;
+
+    // Caixa no mundo da caixa da raiz
+    const BVHNode& raiz = bvh->nos[0];
+    FastMath_TransformAABB(model, raiz.min, raiz.max, &o.min, &o.max);
+
+    g_Oclusores.push_back(o);
+}
+
+void LineOfSight_RemoveCell(int celula)
+{
+    g_Oclusores.erase(std::remove_if(g_Oclusores.begin(), g_Oclusores.end(),
+                                     [celula](const Oclusor& o){ return o.celula == celula; }),
+                      g_Oclusores.end());
+}
+
+void LineOfSight_BeginStep()
+{
+    g_Stats.last_step = 0;
+}
+
+int LineOfSight_Remaining()
+{
+    return std::max(0, g_LineOfSightBudget - g_Stats.last_step);
+}
+
+void LineOfSight_Defer(unsigned long n)
+{
+    g_Stats.deferred += n;
+}
+
+// Verdadeiro se o segmento [0, 1] de origem + t*d atravessa a caixa.
+static bool SegmentoCaixa(const glm::vec3& origem, const glm::vec3& d, const glm::vec3& min, const glm::vec3& max)
+{
+    float tmin = 0.0f, tmax = 1.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+        if (std::fabs(d[k]) < 1e-12f)
+        {
+            if (origem[k] < min[k] || origem[k] > max[k])
+                return false;
+            continue;
+        }
+        float t1 = (min[k] - origem[k]) / d[k];
+        float t2 = (max[k] - origem[k]) / d[k];
+        tmin = std::max(tmin, std::min(t1, t2));
+        tmax = std::min(tmax, std::max(t1, t2));
+        if (tmin > tmax)
+            return false;
+    }
+    return true;
+}
+
+bool LineOfSight_Visible(const glm::vec3& origem, const glm::vec3& destino)
+{
+    g_Stats.queries   += 1;
+    g_Stats.last_step += 1;
+    g_Stats.max_step   = std::max(g_Stats.max_step, g_Stats.last_step);
+
+    // Segmento paramétrico com t em [0, 1]; o mesmo t vale no sistema do
+    // modelo, pois a transformação é afim.
+    glm::vec3 d = destino - origem;
+
+    for (size_t i = 0; i < g_Oclusores.size(); ++i)
+    {
+        const Oclusor& o = g_Oclusores[i];
+        if (!SegmentoCaixa(origem, d, o.min, o.max))
+            continue;
+
+        glm::vec3 origem_local = glm::vec3(o.inversa * glm::vec4(origem, 1.0f));
+        glm::vec3 d_local      = glm::vec3(o.inversa * glm::vec4(d, 0.0f));
+
+        g_Stats.instance_tests += 1;
+        if (BVH_Occluded(*o.bvh, origem_local, d_local, 1.0f, &g_Stats.bvh))
+        {
+            g_Stats.blocked += 1;
+            return false;
+        }
+    }
+    return true;
+}
+
+LineOfSightStats LineOfSight_Stats()
+{
+    return g_Stats;
+}
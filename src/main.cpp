@@ -13,11 +13,12 @@
 #include <math.h>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 // Headers abaixo são específicos de C++
 #include <map>
+#include <set>
 #include <unordered_map>
-#include <stack>
 #include <string>
 #include <vector>
 #include <limits>
@@ -25,6 +26,8 @@
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 // Headers das bibliotecas OpenGL
 #include <glad/glad.h>   // Criação de contexto OpenGL 3.3
@@ -38,12 +41,33 @@
 // Headers da biblioteca para carregar modelos obj
 #include <tiny_obj_loader.h>
 
-#include <stb_image.h>
-
 // Headers locais, definidos na pasta "include/"
 #include "utils.h"
 #include "matrices.h"
 #include "collisions.h"
+#include "texturecache.h"
+#include "textureupload.h"
+#include "scene.h"
+#include "worldstream.h"
+#include "simulation.h"
+#include "statueai.h"
+#include "bvh.h"
+#include "lineofsight.h"
+#include "collisionmesh.h"
+#include "fastmath.h"
+#include "scenegraph.h"
+#include "renderqueue.h"
+#include "drawlist.h"
+#include "jobs.h"
+#include "objparser.h"
+#include "normals.h"
+#include "tangents.h"
+#include "meshbuffer.h"
+#include "streambuffer.h"
+#include "framearena.h"
+#include "alloccounter.h"
+#include "navmesh.h"
+#include "flowfield.h"
 
 struct ObjModel
 {
@@ -56,7 +80,7 @@ struct ObjModel
         printf("Carregando modelo \"%s\"... ", filename);
 
         std::string err;
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename, basepath, triangulate);
+        bool ret = ObjParser_Load(&attrib, &shapes, &materials, &err, filename, basepath, triangulate);
 
         if (!err.empty())
             fprintf(stderr, "\n%s\n", err.c_str());
@@ -69,14 +93,12 @@ struct ObjModel
 };
 
 
-void PushMatrix(glm::mat4 M);
-void PopMatrix(glm::mat4& M);
-
 void BuildTrianglesAndAddToVirtualScene(ObjModel* model, bool env = false); // Constrói representação de um ObjModel como malha de triângulos para renderização
+void BuildSceneFromFile(const char* filename); // Carrega a cena descrita em um arquivo ".scene"
 void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
 void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
 void LoadTextureImage(const char* filename); // Função que carrega imagens de textura
-void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
+bool FillVirtualObject(const std::string& object_name, int object_id, int passo, const glm::mat4& model, RenderItem* item); // Põe na fila de desenho um objeto armazenado em g_VirtualScene
 GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
 GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
 void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
@@ -87,7 +109,7 @@ void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
 void TextRendering_Parabens(GLFWwindow* window);
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_PrintString(GLFWwindow* window, const char* str, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f);
 void TextRendering_PrintVector(GLFWwindow* window, glm::vec4 v, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProduct(GLFWwindow* window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
@@ -111,18 +133,77 @@ void InputperFrame(GLFWwindow* window);
 struct SceneObject
 {
     std::string  name;        // Nome do objeto
-    size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
+    size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[] da malha (veja malha_na_gpu)
     size_t       num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
     GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
     GLuint       vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
+    uint32_t     malha_na_gpu; // Malha em "meshbuffer.h": first_index é relativo aos seus índices
     glm::vec3    bbox_min; // Axis-Aligned Bounding Box do objeto
     glm::vec3    bbox_max;
+    GLuint       normal_map; // Textura do mapa de normais do material do objeto (0 se não houver)
 };
 
 std::map<std::string, SceneObject> g_VirtualScene;
 
-// Pilha que guardará as matrizes de modelagem.
-std::stack<glm::mat4>  g_MatrixStack;
+// Vetores de atributos e objetos de um modelo, prontos para envio à GPU.
+// Veja PrepareTriangles() e UploadTrianglesToVirtualScene().
+struct MalhaPreparada
+{
+    std::vector<GLuint>      indices;
+    std::vector<float>       model_coefficients;
+    std::vector<float>       normal_coefficients;
+    std::vector<float>       texture_coefficients;
+    std::vector<float>       tangent_coefficients; // Apenas se algum objeto tem mapa de normais
+    std::vector<SceneObject> objetos;
+    std::vector<std::string> mapas_normais; // Arquivo do mapa de normais de cada objeto ("" se não houver)
+    std::vector<std::shared_ptr<const BVH> > bvhs; // BVH de cada objeto (apenas malhas do cenário)
+};
+
+// Espaço de uma malha no buffer de malhas (veja "meshbuffer.h")
+struct MalhaNaGPU
+{
+    uint32_t malha;
+    size_t   bytes; // Memória de vídeo ocupada pelos vértices e índices
+};
+
+void PrepareTriangles(ObjModel* model, MalhaPreparada* malha); // Parte da construção que não usa OpenGL
+void PrepareBVHs(MalhaPreparada* malha, const char* filename); // BVHs usadas na linha de visão e na colisão com o cenário
+void PrepareTangents(MalhaPreparada* malha, const char* filename); // Tangentes para os mapas de normais
+void PrepareNavMesh(const char* filename); // Malha de navegação das estátuas, a partir do cenário da cena principal
+MalhaNaGPU UploadTrianglesToVirtualScene(const MalhaPreparada& malha, bool env); // Envia uma malha preparada para a GPU
+void RemoveTrianglesFromVirtualScene(const std::vector<SceneObject>& objetos, const MalhaNaGPU& gpu); // Libera uma malha da GPU
+
+// Material de uma malha, copiado para as instâncias que o utilizam
+struct MaterialDaCena
+{
+    glm::vec3 Ka;
+    glm::vec3 Kd;
+    glm::vec3 Ks;
+    glm::vec3 Ke;
+};
+
+void PrepareTrianglesFromFile(const char* filename, const char* basepath, MalhaPreparada* malha,
+                              std::vector<MaterialDaCena>* materiais); // Lê um ".obj" em fluxo direto para uma malha preparada
+
+// Malhas carregadas, indexadas pelo nome do arquivo ".obj". As malhas das
+// células do mundo são compartilhadas entre as células que as utilizam e
+// liberadas quando a última delas é descarregada.
+struct MalhaDoMundo
+{
+    int                         referencias;
+    std::vector<SceneObject>    objetos;
+    std::vector<MaterialDaCena> materiais;
+    MalhaNaGPU                  gpu;
+};
+
+std::map<std::string, MalhaDoMundo> g_MalhasDoMundo;
+std::mutex g_MalhasDoMundoMutex; // A thread de carregamento consulta quais malhas já estão na GPU
+std::map<int, std::vector<std::string> > g_MalhasDasCelulas; // Malhas usadas por cada célula ativa
+float g_WorldCellSize = 0.0f;
+
+std::shared_ptr<void> LoadWorldCell(const WorldCell& cell);
+size_t ActivateWorldCell(const WorldCell& cell, const std::shared_ptr<void>& data);
+void ReleaseWorldCell(const WorldCell& cell);
 
 // Razão de proporção da janela (largura/altura). Veja função FramebufferSizeCallback().
 float g_ScreenRatio = 1.0f;
@@ -183,21 +264,123 @@ GLint Ka_uniform;
 GLint Kd_uniform;
 GLint Ks_uniform;
 GLint Ke_uniform;
+GLint normal_mapped_uniform;
+RenderUniforms g_Uniforms; // As variáveis acima usadas por RenderQueue_Replay()
+
+DrawList g_ListaDeDesenho; // Reaproveitada a cada quadro, para não realocar os vetores
 
 GLuint g_NumLoadedTextures = 0;
 
-glm::vec3 cubic_bezier(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 p4, float t);
-std::unordered_map<std::string, std::vector<Cubo_Collision>> Cubes_Collisions;
-std::unordered_map<std::string, std::vector<Sphere_Collision>> Spheres_Collisions;
+std::unordered_map<std::string, CubosColisores> Cubes_Collisions;
+std::unordered_map<std::string, EsferasColisores> Spheres_Collisions;
 std::vector<Plano> Planes_Collisions;
 std::vector<std::string> ObjetosCenaNomes;
+
+// Chaves usadas a cada passo, construídas uma só vez
+const std::string NOME_ESTATUA("statue");
+const std::string NOME_ESFERA("sphere");
+const std::string NOME_PLANO("plane");
+const std::string NOME_ARMA("revolver");
+
+// Nomes dos objetos publicados pela simulação. Nunca são removidos, para que
+// ObjetoDesenhado guarde apenas um ponteiro, válido mesmo depois que a
+// célula do objeto é descarregada.
+std::set<std::string> g_NomesDeObjetos;
+StatueAI g_Estatuas; // Estado das estátuas, na ordem de Cubes_Collisions["statue"]
+SceneGraph g_Cena; // Transformações dos colisores: uma raiz por célula do mundo, com as instâncias como filhas
+std::map<int, int> g_NosDasCelulas; // Célula do mundo (-1 = cena principal) -> nó raiz em g_Cena
+std::map<std::string, std::shared_ptr<const BVH> > g_BVHDosObjetos; // BVHs dos objetos do cenário em g_VirtualScene
+NavMesh g_NavMesh; // Malha de navegação das estátuas (veja PrepareNavMesh())
+bool g_TemNavMesh = false;
+FlowField g_CampoDeFuga; // Campo de fuga das multidões de estátuas, sobre a malha de navegação
+size_t g_CampoDeFugaOrcamento = 4096; // Células do campo de fuga calculadas por passo
 Cubo Player_AABB {glm::vec4(-0.5f, -1.0f, -0.5f, 1.0f), glm::vec4(0.5f, 10.0f, 0.5f, 1.0f)};
+float g_PlayerRadius = 0.5f; // Raio da cápsula do jogador contra o cenário
+float g_PlayerHeight = 3.0f; // Distância dos olhos até a base da cápsula (acima dela, o jogador passa por cima)
 bool Tfinal = false;
 Raio ray;
 float anim_final = 0.0f;
 glm::mat4 anim_model;
 
-static double d2r(double d);
+// Identificadores dos objetos no fragment shader ("object_id")
+#define SPHERE 0
+#define BUNNY  1
+#define PLANE  2
+#define CHEST  3
+#define CUBE  4
+#define GUN 5
+#define STATUEI 6
+#define STATUEG 7
+#define STATUER 8
+
+// Entrada do jogador, lida a cada quadro pela thread de renderização e
+// consumida pela simulação a cada passo.
+struct EntradaDoJogador
+{
+    bool frente;
+    bool tras;
+    bool esquerda;
+    bool direita;
+    glm::vec4 view_vector;      // camera_view_vector no momento da leitura
+    std::vector<Raio> disparos; // Cliques ainda não processados pela simulação
+};
+
+// Instância a ser desenhada, copiada do estado da simulação
+struct ObjetoDesenhado
+{
+    const std::string* object; // Nome do objeto em g_VirtualScene (veja NomeDeObjeto())
+    int         object_id;
+    bool        material;  // Se verdadeiro, envia Ka, Kd, Ks e Ke ao shader
+    glm::mat4   model;
+    glm::vec3   Ka;
+    glm::vec3   Kd;
+    glm::vec3   Ks;
+    glm::vec3   Ke;
+    glm::vec3   centro;    // Esfera envolvente no mundo, para o descarte
+    float       raio;      // pelo volume de visualização
+};
+
+// Estado publicado pela simulação ao fim de cada passo: tudo o que a
+// renderização precisa, sem acessar os vetores de colisores.
+struct EstadoDoJogo
+{
+    glm::vec4 camera_position;
+    float     anim_final;
+    bool      estatua_final;
+    bool      Tfinal;
+    std::vector<ObjetoDesenhado> objetos;
+};
+
+SimulationClock g_SimulationClock;
+SimulationSnapshots<EstadoDoJogo> g_EstadosDoJogo;
+bool g_SimulationOnThread = false;
+
+// Protege o estado da simulação (colisores, posição da câmera e animação
+// final) quando a simulação roda em outra thread.
+std::mutex g_EstadoMutex;
+
+EntradaDoJogador g_Entrada = { false, false, false, false, glm::vec4(0.0f), std::vector<Raio>() };
+std::mutex g_EntradaMutex;
+
+// Usados apenas por SimulationStep(), e mantidos entre os passos para que
+// os vetores não sejam realocados
+EntradaDoJogador g_EntradaDoPasso;
+EstadoDoJogo     g_EstadoDoPasso;
+
+// Com "--zero-alloc", o programa termina com erro se um quadro estável (veja
+// "alloccounter.h") alocar memória na thread de renderização.
+bool g_ZeroAlloc = false;
+unsigned long g_ZeroAllocWarmup = 120; // Quadros iniciais ignorados
+
+void SimulationStep(double dt, double tempo); // Avança a lógica do jogo em um passo fixo
+float InterpolateGameState(const EstadoDoJogo& anterior, EstadoDoJogo* estado, float alpha);
+const std::string* NomeDeObjeto(const std::string& nome);
+void MovePlayer(const EntradaDoJogador& entrada, float dt);
+void ShootRay(const Raio& ray);
+const WorldBounds& LimitesDoColisor(CubosColisores* cubos, size_t i);
+void PosicionaEstatua(const CubosColisores& estatuas, size_t i, const glm::vec3& centro);
+int NoDaCelula(int celula, const glm::vec3& origem);
+
 # define M_PI           3.14159265358979323846
 
 int main(int argc, char* argv[])
@@ -211,6 +394,11 @@ int main(int argc, char* argv[])
 
     glfwSetErrorCallback(ErrorCallback);
 
+    // Threads do sistema de tarefas, usadas pelo carregamento do mundo e das
+    // texturas, pelas estátuas, pelo grafo de cena e pela lista de desenho.
+    // Veja "jobs.h".
+    Jobs_Init();
+
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
@@ -258,280 +446,44 @@ int main(int argc, char* argv[])
 
     printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
 
+    // Buffer único com a geometria de todas as malhas, que cresce conforme
+    // necessário
+    MeshBuffer_Init(256 * 1024, 256 * 1024);
+
+    // Buffer circular para os dados reescritos a cada quadro (o texto, por
+    // enquanto)
+    StreamBuffer_Init(256 * 1024);
+
     // Carregamos os shaders de vértices e de fragmentos que serão utilizados
     // para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
     //
     LoadShadersFromFiles();
 
-    // Carregamos duas imagens para serem utilizadas como textura
-    LoadTextureImage("../data/StoneColor.png"); // TextureImage0
-    LoadTextureImage("../data/GoldColor.png"); // TextureImage1
-    LoadTextureImage("../data/Grass.jpg"); // TextureImage2
-
-    // Construímos a representação de objetos geométricos através de malhas de triângulos
-    glm::vec4 pos, centro, bbox_min, bbox_max;
-    std::string Obj_Name;
-    float scale = 1.0f;
+    // Carregamos as texturas, as malhas de triângulos e as instâncias (com
+    // seus colisores e caminhos de fuga) descritas no arquivo de cena.
+    BuildSceneFromFile("../data/cena.scene");
 
     Player_AABB.newCentro(camera_position_c);
 
-
-//-------------------------------------------------------------------
-
-    scale = 0.005f;
-    ObjModel spheremodel("../data/snowglobe.obj","../data/");
-    ComputeNormals(&spheremodel);
-    BuildTrianglesAndAddToVirtualScene(&spheremodel);
-
-    pos = glm::vec4(8.44f, 1.8f, 0.61f, 1.0f);
+    // Com "--sim-thread", a simulação é executada em uma thread própria.
+    // Veja "--zero-alloc" em g_ZeroAlloc.
+    int argumento = 1;
+    while ( argc > argumento && strncmp(argv[argumento], "--", 2) == 0 )
     {
-        Sphere_Collision temp =
-        {
-            {
-                pos + glm::vec4(0.0f, 0.2f, 0.01f, 0.0f),
-                (norm(g_VirtualScene["sphere"].bbox_min)) * scale
-            }, // Esfera
-            false,
-            Matrix_Translate(pos.x, pos.y, pos.z)
-          * Matrix_Scale(scale, scale, scale),
-            "sphere",
-            false,
-            0.0f,
-            0.0f,
-            {
-                glm::vec3(pos.x, pos.y, pos.z),
-                glm::vec3(pos.x, pos.y + 5.0f, pos.z),
-                glm::vec3(-pos.x, pos.y + 5.0f, -pos.z),
-                glm::vec3(-pos.x, pos.y, -pos.z)
-            },
-            glm::vec3(spheremodel.materials[0].ambient[0],spheremodel.materials[0].ambient[1], spheremodel.materials[0].ambient[2]),
-            glm::vec3(spheremodel.materials[0].diffuse[0],spheremodel.materials[0].diffuse[1], spheremodel.materials[0].diffuse[2]),
-            glm::vec3(spheremodel.materials[0].specular[0],spheremodel.materials[0].specular[1], spheremodel.materials[0].specular[2]),
-            glm::vec3(spheremodel.materials[0].transmittance[0],spheremodel.materials[0].transmittance[1], spheremodel.materials[0].transmittance[2])
-        };
-        Spheres_Collisions["sphere"].push_back(temp);
-    }
-
-//-------------------------------------------------------------------
-
-    ObjModel planemodel("../data/plane.obj");
-    ComputeNormals(&planemodel);
-    BuildTrianglesAndAddToVirtualScene(&planemodel);
-
-    {
-        Plano temp =
-        {
-            glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f),
-            25.0f
-        };
-
-        Planes_Collisions.push_back(temp);
-
-        temp =
-        {
-            glm::vec4(0.0f, 0.0f, -1.0f, 0.0f),
-            20.0f
-        };
-
-        Planes_Collisions.push_back(temp);
-    }
-
-//-------------------------------------------------------------------
-    ObjModel isomodel("../data/iso_flat1piece.obj","../data/");
-    ComputeNormals(&isomodel);
-    BuildTrianglesAndAddToVirtualScene(&isomodel, true);
-
-    scale = 1.5f;
-    Obj_Name = "iso_flat";
-
-    bbox_min = glm::vec4(g_VirtualScene[Obj_Name].bbox_min.x,
-                          g_VirtualScene[Obj_Name].bbox_min.y,
-                          g_VirtualScene[Obj_Name].bbox_min.z,
-                          1.0f);
-    bbox_max = glm::vec4(g_VirtualScene[Obj_Name].bbox_max.x,
-                          g_VirtualScene[Obj_Name].bbox_max.y,
-                          g_VirtualScene[Obj_Name].bbox_max.z,
-                          1.0f);
-
-    centro = (bbox_max + bbox_min)/2.0f;
-    pos = glm::vec4(5.0f, 1.0f, 1.0f, 1.0f);
-    {
-        Cubo_Collision temp = {
-            {
-                bbox_min,
-                bbox_max
-            }, // Cube
-            false, // bool colide
-            Matrix_Translate(pos.x, pos.y, pos.z)
-          * Matrix_Scale(scale, scale, scale), // Matrix do Modelo
-            Obj_Name, // Nome do objeto na cena virtual
-            false,
-            0.0f,
-            0.0f,
-            {
-                glm::vec3(pos.x, pos.y, pos.z),
-                glm::vec3(pos.x, pos.y + 5.0f, pos.z),
-                glm::vec3(-pos.x, pos.y + 5.0f, -pos.z),
-                glm::vec3(-pos.x, pos.y, -pos.z)
-            },
-            glm::vec3(isomodel.materials[0].ambient[0],isomodel.materials[0].ambient[1], isomodel.materials[0].ambient[2]),
-            glm::vec3(isomodel.materials[0].diffuse[0],isomodel.materials[0].diffuse[1], isomodel.materials[0].diffuse[2]),
-            glm::vec3(isomodel.materials[0].specular[0],isomodel.materials[0].specular[1], isomodel.materials[0].specular[2]),
-            glm::vec3(isomodel.materials[0].transmittance[0],isomodel.materials[0].transmittance[1], isomodel.materials[0].transmittance[2])
-        };
-        Cubes_Collisions[Obj_Name].push_back(temp);
-    }
-
-//-------------------------------------------------------------------
-
-    ObjModel statuemodel("../data/statue.obj","../data/");
-    ComputeNormals(&statuemodel);
-    BuildTrianglesAndAddToVirtualScene(&statuemodel);
-    Obj_Name = "statue";
-
-    bbox_min = glm::vec4(g_VirtualScene[Obj_Name].bbox_min.x,
-                          g_VirtualScene[Obj_Name].bbox_min.y,
-                          g_VirtualScene[Obj_Name].bbox_min.z,
-                          1.0f);
-    bbox_max = glm::vec4(g_VirtualScene[Obj_Name].bbox_max.x,
-                          g_VirtualScene[Obj_Name].bbox_max.y,
-                          g_VirtualScene[Obj_Name].bbox_max.z,
-                          1.0f);
-
-    centro = (bbox_max + bbox_min)/2.0f;
-
-    // GOLDEN
-    pos = glm::vec4(19.29f, 0.1f, 9.78f, 1.0f);
-    scale = 0.01f;
-    {
-        Cubo_Collision temp = {
-            {
-                bbox_min,
-                bbox_max
-            }, // Cube
-            false, // bool colide
-            Matrix_Translate(pos.x, pos.y, pos.z)
-          * Matrix_Scale(scale, scale, scale), // Matrix do Modelo
-            Obj_Name, // Nome do objeto na cena virtual
-            false, // Se o objeto está sendo observado
-            0.0f, // Tempo sendo visto
-            0.0f, // t usado pela curva de bezier
-            {
-                glm::vec3(pos.x, pos.y + 0.3f, pos.z),
-                glm::vec3(18.18f, 7.0f, -5.76f),
-                glm::vec3(-18.0f, 5.0f, -4.25f),
-                glm::vec3(-14.59f, 0.1f, 13.28f)
-            }, // Pontos do caminho de fuga
-        };
-        Cubes_Collisions[Obj_Name].push_back(temp);
-    }
-
-    pos = glm::vec4(-1.68f, 0.2f, -7.15f, 1.0f);
-    scale = 0.0045f;
-    {
-        Cubo_Collision temp = {
-            {
-                bbox_min,
-                bbox_max
-            }, // Cube
-            false, // bool colide
-            Matrix_Translate(pos.x, pos.y, pos.z)
-          * Matrix_Scale(scale, scale, scale), // Matrix do Modelo
-            Obj_Name, // Nome do objeto na cena virtual
-            false, // Se o objeto está sendo observado
-            0.0f, // Tempo sendo visto
-            0.0f, // t usado pela curva de bezier
-            {
-                glm::vec3(pos.x, pos.y + 0.57f, pos.z),
-                glm::vec3(6.88f, 10.0f, -5.37f),
-                glm::vec3(-2.45f, 1.0f, 9.71),
-                glm::vec3(7.31f, 0.1f, 1.52)
-            } // Pontos do caminho de fuga
-        };
-        Cubes_Collisions[Obj_Name].push_back(temp);
-    }
-
-    pos = glm::vec4(18.74f, 0.2f, -6.72f, 1.0f);
-    {
-        Cubo_Collision temp = {
-            {
-                bbox_min,
-                bbox_max
-            }, // Cube
-            false, // bool colide
-            Matrix_Translate(pos.x, pos.y, pos.z)
-          * Matrix_Scale(scale, scale, scale), // Matrix do Modelo
-            Obj_Name, // Nome do objeto na cena virtual
-            false, // Se o objeto está sendo observado
-            0.0f, // Tempo sendo visto
-            0.0f, // t usado pela curva de bezier
-            {
-                glm::vec3(pos.x, pos.y + 0.57f, pos.z),
-                glm::vec3(21.10f, 1.0f, -11.73f),
-                glm::vec3(11.73f, 5.0f, -10.43),
-                glm::vec3(4.73f, 0.1f, -10.54f)
-            } // Pontos do caminho de fuga
-        };
-        Cubes_Collisions[Obj_Name].push_back(temp);
-    }
-
-    pos = glm::vec4(-10.80f, 0.1f, 1.60f, 1.0f);
-    {
-        Cubo_Collision temp = {
-            {
-                bbox_min,
-                bbox_max
-            }, // Cube
-            false, // bool colide
-            Matrix_Translate(pos.x, pos.y, pos.z)
-          * Matrix_Scale(scale, scale, scale), // Matrix do Modelo
-            Obj_Name, // Nome do objeto na cena virtual
-            false, // Se o objeto está sendo observado
-            0.0f, // Tempo sendo visto
-            0.0f, // t usado pela curva de bezier
-            {
-                glm::vec3(pos.x, pos.y + 0.57f, pos.z),
-                glm::vec3(4.44f, 5.0f, 27.86f),
-                glm::vec3(28.08f, 10.0f, 4.86f),
-                glm::vec3(14.32f, 0.1f, 4.33f)
-            } // Pontos do caminho de fuga
-        };
-        Cubes_Collisions[Obj_Name].push_back(temp);
-    }
-
-    pos = glm::vec4(-12.71f, 0.1f, 19.09f, 1.0f);
-    {
-        Cubo_Collision temp = {
-            {
-                bbox_min,
-                bbox_max
-            }, // Cube
-            false, // bool colide
-            Matrix_Translate(pos.x, pos.y, pos.z)
-          * Matrix_Scale(scale, scale, scale), // Matrix do Modelo
-            Obj_Name, // Nome do objeto na cena virtual
-            false, // Se o objeto está sendo observado
-            0.0f, // Tempo sendo visto
-            0.0f, // t usado pela curva de bezier
-            {
-                glm::vec3(pos.x, pos.y + 0.57f, pos.z),
-                glm::vec3(-0.20f, 5.0f, 12.55f),
-                glm::vec3(-14.0f, 2.0f, 6.52f),
-                glm::vec3(-3.31f, 0.5f, 4.51f)
-            } // Pontos do caminho de fuga
-        };
-        Cubes_Collisions[Obj_Name].push_back(temp);
+        if ( strcmp(argv[argumento], "--sim-thread") == 0 )
+            g_SimulationOnThread = true;
+        else if ( strcmp(argv[argumento], "--zero-alloc") == 0 )
+            g_ZeroAlloc = true;
+        else
+            fprintf(stderr, "WARNING: opção \"%s\" desconhecida.\n", argv[argumento]);
+        argumento += 1;
     }
+    if ( g_ZeroAlloc && !AllocCounter_Enabled() )
+        fprintf(stderr, "WARNING: \"--zero-alloc\" exige um build com ALLOC_COUNTER (alvo Debug).\n");
 
-//-------------------------------------------------------------------
-
-    ObjModel revolvermodel("../data/revolver.obj");
-    ComputeNormals(&revolvermodel);
-    BuildTrianglesAndAddToVirtualScene(&revolvermodel);
-
-    if ( argc > 1 )
+    if ( argc > argumento )
     {
-        ObjModel model(argv[1]);
+        ObjModel model(argv[argumento]);
         BuildTrianglesAndAddToVirtualScene(&model);
     }
 
@@ -546,12 +498,27 @@ int main(int argc, char* argv[])
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
+    // Publicamos o estado inicial e, se for o caso, iniciamos a simulação em
+    // sua própria thread. Veja "simulation.h".
+    Simulation_InitClock(&g_SimulationClock);
+    SimulationStep(0.0, Simulation_Now());
+    if (g_SimulationOnThread)
+        SimulationThread_Start(SimulationStep);
+
+    // Estados lidos a cada quadro, mantidos entre os quadros para que a
+    // cópia reaproveite os vetores
+    EstadoDoJogo anterior, estado;
+
+    // Quadros estáveis: sem células do mundo ativadas ou descarregadas e sem
+    // texturas sendo enviadas
+    unsigned long quadros = 0, quadros_estaveis = 0, quadros_com_alocacao = 0;
+    unsigned long celulas_antes = 0;
+
     // Ficamos em loop, renderizando, até que o usuário feche a janela
     while (!glfwWindowShouldClose(window))
     {
-        // Calcula da Iluminação e da posição da câmera
-        ray.dir = camera_view_vector;
-        ray.origem = camera_position_c;
+        unsigned long alocacoes_antes = AllocCounter_Thread();
+        FrameArena_BeginFrame();
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -569,23 +536,46 @@ int main(int argc, char* argv[])
 
         InputperFrame(window);
 
-        // Se todas as estátuas foram destruidas
-        bool estatua_final = true;
-        if(!Spheres_Collisions["sphere"][0].colide) estatua_final = false;
-        for(unsigned int i = 1; i < Cubes_Collisions["statue"].size(); i++)
+        // Avançamos a simulação em passos fixos. Se ela roda em outra thread,
+        // apenas lemos o que foi publicado.
+        if (!g_SimulationOnThread)
         {
-            if(!Cubes_Collisions["statue"][i].colide) estatua_final = false;
+            int passos = Simulation_Advance(&g_SimulationClock, deltaTime);
+            for (int i = 0; i < passos; ++i)
+                SimulationStep(g_SimulationStep, g_SimulationClock.time - (passos - 1 - i)*g_SimulationStep);
         }
 
-        Tfinal = Cubes_Collisions["statue"][0].colide;
+        // Desenhamos o estado interpolado entre os dois últimos passos
+        double tempo_estado = 0.0;
+        g_EstadosDoJogo.Read(&anterior, &estado, &tempo_estado);
+
+        float alpha;
+        if (g_SimulationOnThread)
+            alpha = (float)std::min(1.0, std::max(0.0, (Simulation_Now() - tempo_estado) / g_SimulationStep));
+        else
+            alpha = Simulation_Alpha(g_SimulationClock);
+        float anim = InterpolateGameState(anterior, &estado, alpha);
+
+        // Calcula da Iluminação e da posição da câmera
+        ray.dir = camera_view_vector;
+        ray.origem = estado.camera_position;
+
+        // Copia para as texturas os PBOs preenchidos pelas threads auxiliares
+        TextureUpload_Update();
+
+        // Carrega e descarrega as células do mundo em torno da câmera
+        {
+            std::lock_guard<std::mutex> lock(g_EstadoMutex);
+            WorldStream_Update(estado.camera_position, deltaTime);
+        }
 
         glm::mat4 view;
         glm::vec4 LightPos;
-        if((estatua_final && anim_final >= 0) || Tfinal)
+        bool animacao_final = (estado.estatua_final && estado.anim_final >= 0) || estado.Tfinal;
+        if(animacao_final)
         {
-            anim_final += deltaTime;
             glm::vec4 newOrigem = glm::vec4(-50.0f, 0.0f, -50.0f, 1.0f);
-            anim_model = Matrix_Translate(-50.0f, 0.0f, -50.0f) * Matrix_Rotate_Y(anim_final * 1.22f) * Matrix_Scale(0.002f,0.002f,0.002f);
+            anim_model = Matrix_Translate(-50.0f, 0.0f, -50.0f) * Matrix_Rotate_Y(anim * 1.22f) * Matrix_Scale(0.002f,0.002f,0.002f);
             camera_pos_anim = newOrigem + glm::vec4(0.0f, 0.5f, 0.35f, 0.0f);
             camera_view_anim = (newOrigem + glm::vec4(0.0f, 0.3f, 0.0f, 0.0f)) - camera_pos_anim;
 
@@ -595,16 +585,13 @@ int main(int argc, char* argv[])
             glUniform4f(light_pos_uniform, LightPos.x, LightPos.y, LightPos.z, 1.0f);
             glUniform4f(light_dir_uniform, LightDir.x, LightDir.y, LightDir.z, 0.0f);
 
-            if((anim_final >= 5) && !Tfinal) anim_final = -1.0f;
-
         } else
         {
-            anim_model = Cubes_Collisions["statue"][0].Matrix_Model;
             camera_view_vector = glm::normalize(direction);
-            view = Matrix_Camera_View(camera_position_c, camera_view_vector, camera_up_vector);
+            view = Matrix_Camera_View(estado.camera_position, camera_view_vector, camera_up_vector);
 
             // Passa a posição da fonte de luz
-            LightPos = camera_position_c + camera_view_vector;
+            LightPos = estado.camera_position + camera_view_vector;
             glUniform4f(light_pos_uniform, LightPos.x, LightPos.y, LightPos.z, 1.0f);
 
             // Passa a direção da fonte de luz
@@ -633,186 +620,750 @@ int main(int argc, char* argv[])
         glUniformMatrix4fv(view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
         glUniformMatrix4fv(projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
 
-        // Desenho dos Objetos
-        glm::mat4 model = Matrix_Identity();
-        #define SPHERE 0
-        #define BUNNY  1
-        #define PLANE  2
-        #define CHEST  3
-        #define CUBE  4
-        #define GUN 5
-        #define STATUEI 6
-        #define STATUEG 7
-        #define STATUER 8
-
-        // Desenhamos os modelos das estatuas
-        Obj_Name = "statue";
-        if(estatua_final)
-        {
-                Cubo_Collision* modelo = &(Cubes_Collisions[Obj_Name][0]);
-                centro = ((modelo->Matrix_Model * modelo->cube.vert_min) + (modelo->Matrix_Model * modelo->cube.vert_max)) * 0.5f;
+        // Desenho dos Objetos: montamos a lista de desenho, ordenada para
+        // reduzir as trocas de estado, e reproduzimos os seus comandos (veja
+        // "drawlist.h" e "renderqueue.h")
+        DrawList_Begin(&g_ListaDeDesenho);
+        RenderItem item;
+
+        // O plano do chão
+        glm::mat4 model = Matrix_Translate(0.0f,-1.0f,0.0f) * Matrix_Scale(500.0f, 1.0f, 500.0f);
+        if (FillVirtualObject(NOME_PLANO, PLANE, RENDERPASS_OPACO, model, &item))
+            DrawList_Append(&g_ListaDeDesenho, item);
+
+        // As estátuas, o cenário e a esfera publicados pela simulação,
+        // exceto os que estão fora do volume de visualização ou são pequenos
+        // demais para aparecer. Os objetos são preenchidos por várias
+        // threads; g_VirtualScene só é lida enquanto esta thread espera.
+        DrawListView vista;
+        Bounds_ExtractFrustum(&vista.frustum, projection * view);
+        vista.olho             = glm::vec3(animacao_final ? camera_pos_anim : estado.camera_position);
+        vista.distancia_maxima = -farplane;
+        vista.tamanho_minimo   = 0.001f;
+        DrawList_Build(&g_ListaDeDesenho, vista, estado.objetos.size(),
+            [&estado, animacao_final](size_t i, RenderItem* item, glm::vec3* centro, float* raio)
+            {
+                const ObjetoDesenhado& objeto = estado.objetos[i];
+
+                // A estátua dourada gira durante a animação final
+                bool girando = objeto.object_id == STATUEG && animacao_final;
+                if (!FillVirtualObject(*objeto.object, objeto.object_id, RENDERPASS_OPACO,
+                                       girando ? anim_model : objeto.model, item))
+                    return false;
 
-                glm::vec4 l = (LightPos - centro)/norm(LightPos - centro);
-                float angle = dotproduct(-l, camera_view_vector);
-                if(modelo->visto)
+                item->material = objeto.material;
+                if (objeto.material)
                 {
-                    modelo->tempoVisto += deltaTime;
+                    item->coeficientes.Ka = objeto.Ka;
+                    item->coeficientes.Kd = objeto.Kd;
+                    item->coeficientes.Ks = objeto.Ks;
+                    item->coeficientes.Ke = objeto.Ke;
+                }
+                *centro = objeto.centro;
+                *raio   = girando ? -1.0f : objeto.raio;
+                return true;
+            });
+
+        // A arma, por cima de tudo
+        if(!estado.estatua_final || estado.anim_final == -1.0f)
+        {
+            model = Matrix_Translate(0.23f,-1.0f,-2.0f) * Matrix_Scale(0.002f, 0.002f, 0.002f);
+            if (FillVirtualObject(NOME_ARMA, GUN, RENDERPASS_SOBREPOSTO, model, &item))
+                DrawList_Append(&g_ListaDeDesenho, item);
+        }
+
+        DrawList_Finish(&g_ListaDeDesenho);
+        RenderQueue_Replay(g_ListaDeDesenho.comandos, g_Uniforms);
+
+        TextRendering_ShowFramesPerSecond(window);
+
+        if(estado.Tfinal)
+            TextRendering_Parabens(window);
+        else
+            TextRendering_ShowCrossHair(window);
 
-                    glm::vec3 oldPos = glm::vec3(centro.x, centro.y, centro.z);
-                    glm::vec3 newPos = cubic_bezier(modelo->Path[0], modelo->Path[1], modelo->Path[2], modelo->Path[3], modelo->t);
-                    glm::vec3 deltaPos = newPos - oldPos;
-                    modelo->Matrix_Model = Matrix_Translate(deltaPos.x, deltaPos.y, deltaPos.z) * modelo->Matrix_Model;
+        // Marca o fim dos desenhos que leem a região do quadro no buffer
+        // circular
+        StreamBuffer_EndFrame();
 
-                    modelo->t = 1 / (1 + exp(-2*(modelo->tempoVisto-5))); // Função Sigmoid
+        glfwSwapBuffers(window);
 
-                } else if(acos(angle) < d2r(25))
+        glfwPollEvents();
+
+        // As alocações do quadro, na thread de renderização (que também
+        // executa a simulação, se ela não tem thread própria)
+        unsigned long alocacoes = AllocCounter_Thread() - alocacoes_antes;
+        WorldStreamStats mundo = WorldStream_Stats();
+        unsigned long celulas = mundo.loads + mundo.evictions;
+        quadros += 1;
+        if (quadros > g_ZeroAllocWarmup && celulas == celulas_antes && TextureUpload_Pending() == 0)
+        {
+            quadros_estaveis += 1;
+            if (alocacoes > 0)
+            {
+                quadros_com_alocacao += 1;
+                if (g_ZeroAlloc)
                 {
-                    modelo->tempoVisto += deltaTime;
-                    if(modelo->tempoVisto >= 5 && !modelo->visto)
-                    {
-                        modelo->visto = true;
-                        modelo->tempoVisto = 0;
-                    }
-                } else modelo->tempoVisto = 0;
-
-                glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(anim_model));
-                glUniform1i(object_id_uniform, STATUEG);
-                DrawVirtualObject(Obj_Name.c_str());
+                    fprintf(stderr, "ERROR: o quadro %lu, estável, fez %lu alocações de memória.\n", quadros, alocacoes);
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+        }
+        celulas_antes = celulas;
+    }
+
+    if (AllocCounter_Enabled())
+        printf("Alocações: %lu de %lu quadros estáveis alocaram memória; %.1f KB de pico na memória do quadro.\n",
+               quadros_com_alocacao, quadros_estaveis, std::max(g_FrameArena.maior_pico, g_FrameArena.pico) / 1024.0);
+
+    WorldStreamStats stats = WorldStream_Stats();
+    if (stats.loads > 0)
+        printf("Células do mundo: %lu carregadas (%lu antecipadas), %lu descarregadas, %lu quadros sem a célula da câmera, %lu engasgos (pior ativação %.2f ms).\n",
+               stats.loads, stats.prefetches, stats.evictions, stats.misses, stats.hitches, stats.max_activation_ms);
+
+    // Finalizamos o uso dos recursos do sistema operacional
+    SimulationThread_Stop();
+
+    BoundsStats limites = Bounds_Stats();
+    if (limites.updates > 0)
+        printf("Volumes envolventes: %lu recalculados, %lu reaproveitados.\n", limites.updates, limites.reuses);
+
+    DrawListStats lista = DrawList_Stats();
+    if (lista.frames > 0)
+        printf("Lista de desenho: %lu objetos, %lu fora do volume de visualização, %lu pequenos demais, %lu itens desenhados; %lu de %lu quadros montados em paralelo.\n",
+               lista.objects, lista.culled, lista.small, lista.items, lista.parallel, lista.frames);
+
+    RenderQueueStats desenho = RenderQueue_Totals();
+    if (desenho.frames > 0)
+        printf("Fila de desenho, por quadro: %.1f objetos, %.1f trocas de VAO, %.1f de object_id, %.1f de material, %.1f de caixa, %.1f de mapa de normais, %.1f de teste de profundidade.\n",
+               (double)desenho.draws / desenho.frames, (double)desenho.vao_changes / desenho.frames,
+               (double)desenho.variant_changes / desenho.frames, (double)desenho.material_changes / desenho.frames,
+               (double)desenho.bbox_changes / desenho.frames, (double)desenho.normal_map_changes / desenho.frames,
+               (double)desenho.depth_changes / desenho.frames);
+
+    SceneGraphStats grafo = SceneGraph_Stats();
+    if (grafo.updates > 0)
+        printf("Grafo de cena: %lu atualizações (%lu em paralelo), %lu matrizes recalculadas.\n",
+               grafo.updates, grafo.parallel, grafo.recomputed);
+
+    LineOfSightStats visao = LineOfSight_Stats();
+    if (visao.queries > 0)
+        printf("Linha de visão: %lu raios (%lu bloqueados, no máximo %d por passo), %lu adiados, %lu nós e %lu triângulos testados.\n",
+               visao.queries, visao.blocked, visao.max_step, visao.deferred, visao.bvh.nodes, visao.bvh.triangles);
+
+    NavMeshStats navegacao = NavMesh_Stats();
+    if (navegacao.queries > 0)
+        printf("Malha de navegação: %lu caminhos (%lu sem caminho) em %lu lotes, %lu polígonos expandidos, %.1f us por caminho (no máximo %.1f us).\n",
+               navegacao.queries, navegacao.failed, navegacao.batches, navegacao.nodes,
+               navegacao.total_us / navegacao.queries, navegacao.max_us);
+
+    FlowFieldStats fuga = FlowField_Stats();
+    if (fuga.steps > 0)
+        printf("Campo de fuga: %lu cálculos (%lu abandonados) em %lu passos, %lu células, %.2f ms no total (no máximo %.2f ms por passo).\n",
+               fuga.recomputes, fuga.restarts, fuga.steps, fuga.nodes, fuga.total_ms, fuga.max_step_ms);
+
+    MeshBufferStats malhas = MeshBuffer_Stats();
+    printf("Buffer de malhas: %lu malhas, %.1f de %.1f MB de vértices e %.1f de %.1f MB de índices, %lu blocos livres; %lu crescimentos, %lu compactações, %.1f MB copiados.\n",
+           malhas.meshes, malhas.vertex_bytes_used / 1048576.0, malhas.vertex_bytes / 1048576.0,
+           malhas.index_bytes_used / 1048576.0, malhas.index_bytes / 1048576.0, malhas.free_blocks,
+           malhas.grows, malhas.defragmentations, malhas.bytes_moved / 1048576.0);
+
+    StreamBufferStats circular = StreamBuffer_Stats();
+    if (circular.frames > 0)
+        printf("Buffer circular%s: 3 x %lu KB, pico de %lu KB por quadro, %lu alocações em %lu quadros, %lu esperas pela GPU (%.2f ms), %lu crescimentos.\n",
+               circular.persistent ? " (mapeamento persistente)" : "",
+               (unsigned long)(circular.frame_bytes / 1024), (unsigned long)(circular.peak_bytes / 1024),
+               circular.allocations, circular.frames, circular.stalls, circular.stall_ms, circular.grows);
+
+    WorldStream_Shutdown();
+    TextureUpload_Shutdown();
+    MeshBuffer_Shutdown();
+    StreamBuffer_Shutdown();
+
+    unsigned int threads = Jobs_NumThreads();
+    Jobs_Shutdown();
+    JobStats tarefas = Jobs_Stats();
+    printf("Tarefas: %lu executadas em %u threads (%lu roubadas, %lu durante esperas, %lu de segundo plano).\n",
+           tarefas.jobs, threads, tarefas.stolen, tarefas.helped, tarefas.background);
+
+    glfwTerminate();
+
+    // Fim do programa
+    return 0;
+}
+
+// Avança em "dt" segundos a lógica do jogo: movimento do jogador, disparos,
+// estátuas que fogem quando observadas e a animação final. Ao fim, publica em
+// g_EstadosDoJogo o estado usado pela renderização.
+void SimulationStep(double dt_passo, double tempo)
+{
+    float dt = (float)dt_passo;
+
+    EntradaDoJogador& entrada = g_EntradaDoPasso;
+    {
+        std::lock_guard<std::mutex> lock(g_EntradaMutex);
+        entrada = g_Entrada;
+        g_Entrada.disparos.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(g_EstadoMutex);
+
+    MovePlayer(entrada, dt);
+    for (size_t i = 0; i < entrada.disparos.size(); ++i)
+        ShootRay(entrada.disparos[i]);
+
+    CubosColisores& estatuas = Cubes_Collisions[NOME_ESTATUA];
+    EsferasColisores& esferas = Spheres_Collisions[NOME_ESFERA];
+    EsferaQuente* esfera = &esferas.quente[0];
+    const EsferaFria& esfera_fria = esferas.fria[0];
+
+    // Se todas as estátuas foram destruidas
+    bool estatua_final = true;
+    if(!esfera->colide) estatua_final = false;
+    for(unsigned int i = 1; i < Pool_Size(estatuas); i++)
+    {
+        if(!estatuas.quente[i].colide) estatua_final = false;
+    }
+
+    Tfinal = estatuas.quente[0].colide;
+
+    glm::vec4 LightPos;
+    if((estatua_final && anim_final >= 0) || Tfinal)
+    {
+        anim_final += dt;
+        LightPos = glm::vec4(-50.0f, 3.0f, -50.0f, 1.0f);
+
+        if((anim_final >= 5) && !Tfinal) anim_final = -1.0f;
+    }
+    else
+        LightPos = camera_position_c + entrada.view_vector;
+
+    EstadoDoJogo& estado = g_EstadoDoPasso;
+    estado.objetos.clear();
+    estado.camera_position = camera_position_c;
+    estado.estatua_final   = estatua_final;
+    estado.Tfinal          = Tfinal;
+
+    // Atualizamos as estátuas: apenas a dourada quando as demais foram
+    // destruídas, ou todas as outras caso contrário.
+    assert(g_Estatuas.count == Pool_Size(estatuas));
+
+    size_t primeira = estatua_final ? 0 : 1;
+    size_t quantas  = estatua_final ? 1 : std::max<size_t>(Pool_Size(estatuas), 1) - 1;
+    LineOfSight_BeginStep();
+    StatueAI_UpdateLineOfSight(&g_Estatuas, primeira, quantas, LightPos, entrada.view_vector);
+    StatueAI_Update(&g_Estatuas, primeira, quantas, LightPos, entrada.view_vector, dt);
+    if (g_TemNavMesh)
+        FlowField_Update(&g_CampoDeFuga, glm::vec3(camera_position_c), g_CampoDeFugaOrcamento);
+    StatueAI_PlanEscapes(&g_Estatuas, g_TemNavMesh ? &g_NavMesh : NULL, g_TemNavMesh ? &g_CampoDeFuga : NULL,
+                         primeira, quantas, LightPos);
+    if (g_TemNavMesh)
+        StatueAI_Steer(&g_Estatuas, g_CampoDeFuga, primeira, quantas, dt);
+
+    // As estátuas que fugiram são reposicionadas a partir do centro
+    // calculado pela IA, e não somando deslocamentos à matriz.
+    for (size_t i = primeira; i < primeira + quantas; ++i)
+        if (g_Estatuas.desloc_x[i] != 0.0f || g_Estatuas.desloc_y[i] != 0.0f || g_Estatuas.desloc_z[i] != 0.0f)
+            PosicionaEstatua(estatuas, i, glm::vec3(g_Estatuas.centro_x[i], g_Estatuas.centro_y[i], g_Estatuas.centro_z[i]));
+    SceneGraph_Update(&g_Cena);
+
+    for (size_t i = primeira; i < primeira + quantas; ++i)
+    {
+        CuboQuente* modelo = &estatuas.quente[i];
+        if (SceneGraph_Changed(g_Cena, modelo->no))
+        {
+            estatuas.fria[i].Matrix_Model = SceneGraph_World(g_Cena, modelo->no);
+            Bounds_Invalidate(&modelo->limites);
+        }
+
+        if (estatua_final || !modelo->colide)
+        {
+            const WorldBounds& limites = LimitesDoColisor(&estatuas, i);
+            ObjetoDesenhado objeto = { NomeDeObjeto(NOME_ESTATUA), estatua_final ? STATUEG : STATUEI, false, estatuas.fria[i].Matrix_Model,
+                                       glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f),
+                                       limites.centro, limites.raio };
+            estado.objetos.push_back(objeto);
+        }
+    }
+
+    // Cenário
+    for(const std::string& Obj_Name: ObjetosCenaNomes)
+    {
+        std::unordered_map<std::string, CubosColisores>::iterator cubos = Cubes_Collisions.find(Obj_Name);
+        if (cubos == Cubes_Collisions.end())
+            continue;
+
+        const std::string* nome = NomeDeObjeto(Obj_Name);
+        for(unsigned int i = 0; i < Pool_Size(cubos->second); i++)
+        {
+            if(!(cubos->second.quente[i].colide))
+            {
+                const WorldBounds& limites = LimitesDoColisor(&cubos->second, i);
+                const CuboFrio* modelo = &cubos->second.fria[i];
+                ObjetoDesenhado objeto = { nome, 99, true, modelo->Matrix_Model, modelo->Ka, modelo->Kd, modelo->Ks, modelo->Ke,
+                                           limites.centro, limites.raio };
+                estado.objetos.push_back(objeto);
+            }
         }
-        else for(unsigned int i = 1; i < Cubes_Collisions[Obj_Name].size(); i++)
+    }
+
+    if(!(esfera->colide))
+    {
+        ObjetoDesenhado objeto = { NomeDeObjeto(NOME_ESFERA), SPHERE, true, esfera_fria.Matrix_Model, esfera_fria.Ka, esfera_fria.Kd, esfera_fria.Ks, esfera_fria.Ke,
+                                   esfera_fria.limites.centro, esfera_fria.limites.raio };
+        estado.objetos.push_back(objeto);
+    }
+
+    estado.anim_final = anim_final;
+    g_EstadosDoJogo.Publish(estado, tempo);
+}
+
+// Nome de objeto com endereço fixo (veja g_NomesDeObjetos). Se o nome já
+// existe, não aloca memória.
+const std::string* NomeDeObjeto(const std::string& nome)
+{
+    return &*g_NomesDeObjetos.insert(nome).first;
+}
+
+// Leva o centro da caixa da estátua a "centro" (no mundo), alterando a
+// posição do seu nó em relação à raiz da célula, que só tem translação.
+void PosicionaEstatua(const CubosColisores& estatuas, size_t i, const glm::vec3& centro)
+{
+    int no = estatuas.quente[i].no;
+    const Cubo& cube = estatuas.fria[i].cube;
+    glm::vec3 centro_local = glm::vec3(cube.vert_min + cube.vert_max) * 0.5f;
+    glm::vec3 origem       = glm::vec3(SceneGraph_World(g_Cena, g_Cena.pai[no])[3]);
+    glm::vec3 deslocamento = glm::mat3_cast(g_Cena.rotacao[no]) * (g_Cena.escala[no] * centro_local);
+    SceneGraph_SetPosition(&g_Cena, no, centro - origem - deslocamento);
+}
+
+// Interpola entre os dois últimos estados publicados pela simulação, sendo
+// "alpha" a fração do passo já decorrida. Retorna anim_final interpolado; o
+// valor em "estado" continua sendo o do último passo, pois é usado em testes.
+float InterpolateGameState(const EstadoDoJogo& anterior, EstadoDoJogo* estado, float alpha)
+{
+    estado->camera_position = anterior.camera_position + alpha*(estado->camera_position - anterior.camera_position);
+
+    // Objetos só são interpolados se a lista não mudou entre os dois passos
+    if (anterior.objetos.size() == estado->objetos.size())
+        for (size_t i = 0; i < estado->objetos.size(); ++i)
+            if (anterior.objetos[i].object == estado->objetos[i].object)
+            {
+                ObjetoDesenhado& objeto = estado->objetos[i];
+                objeto.model = anterior.objetos[i].model + alpha*(objeto.model - anterior.objetos[i].model);
+
+                // O centro é linear na matriz; o raio fica o maior dos dois
+                objeto.centro = anterior.objetos[i].centro + alpha*(objeto.centro - anterior.objetos[i].centro);
+                objeto.raio   = std::max(objeto.raio, anterior.objetos[i].raio);
+            }
+
+    // anim_final volta para -1 ao fim da animação; nesse caso não interpolamos
+    if (estado->anim_final < anterior.anim_final)
+        return estado->anim_final;
+    return anterior.anim_final + alpha*(estado->anim_final - anterior.anim_final);
+}
+
+// Materiais de cada objeto de um modelo, indexados pelo número do material
+std::vector<MaterialDaCena> MateriaisDoModelo(const std::vector<tinyobj::material_t>& materials)
+{
+    std::vector<MaterialDaCena> mats(materials.size());
+    for (size_t m = 0; m < materials.size(); ++m)
+    {
+        const tinyobj::material_t& mat = materials[m];
+        mats[m].Ka = glm::vec3(mat.ambient[0], mat.ambient[1], mat.ambient[2]);
+        mats[m].Kd = glm::vec3(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2]);
+        mats[m].Ks = glm::vec3(mat.specular[0], mat.specular[1], mat.specular[2]);
+        mats[m].Ke = glm::vec3(mat.transmittance[0], mat.transmittance[1], mat.transmittance[2]);
+    }
+    return mats;
+}
+
+// Nó raiz da célula do mundo em g_Cena, criado na primeira instância dela
+int NoDaCelula(int celula, const glm::vec3& origem)
+{
+    std::map<int, int>::iterator no = g_NosDasCelulas.find(celula);
+    if (no != g_NosDasCelulas.end())
+        return no->second;
+
+    int raiz = SceneGraph_Add(&g_Cena, -1, origem, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    g_NosDasCelulas[celula] = raiz;
+    return raiz;
+}
+
+// Adiciona uma instância da cena aos vetores de colisores, deslocada por
+// "origem" (a origem da célula do mundo, ou zero na cena principal).
+void AddSceneInstance(const char* filename, const SceneInstanceDesc& inst, glm::vec3 origem,
+                      const std::vector<MaterialDaCena>* mats, int celula)
+{
+    std::string Obj_Name = inst.object;
+
+    std::map<std::string, SceneObject>::iterator obj = g_VirtualScene.find(Obj_Name);
+    if (obj == g_VirtualScene.end())
+    {
+        fprintf(stderr, "ERROR: Scene \"%s\" uses unknown object \"%s\".\n", filename, inst.object);
+        std::exit(EXIT_FAILURE);
+    }
+
+    MaterialDaCena mat = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f) };
+    if (inst.material >= 0)
+    {
+        if (mats == NULL || (size_t)inst.material >= mats->size())
         {
-            Cubo_Collision* modelo = &(Cubes_Collisions[Obj_Name][i]);
-            centro = ((modelo->Matrix_Model * modelo->cube.vert_min) + (modelo->Matrix_Model * modelo->cube.vert_max)) * 0.5f;
+            fprintf(stderr, "ERROR: Scene \"%s\": object \"%s\" has no material %d.\n", filename, inst.object, inst.material);
+            std::exit(EXIT_FAILURE);
+        }
+        mat = (*mats)[inst.material];
+    }
+
+    glm::vec4 pos = glm::vec4(inst.pos[0] + origem.x, inst.pos[1] + origem.y, inst.pos[2] + origem.z, 1.0f);
+    float scale = inst.scale;
+
+    glm::vec3 path[4];
+    for (int k = 0; k < 4; ++k)
+        path[k] = glm::vec3(inst.path[k][0], inst.path[k][1], inst.path[k][2]) + origem;
 
-            glm::vec4 l = (LightPos - centro)/norm(LightPos - centro);
-            float angle = dotproduct(-l, camera_view_vector);
-            if(modelo->visto)
+    // A instância é filha do nó da célula, que guarda "origem"
+    int no = SceneGraph_Add(&g_Cena, NoDaCelula(celula, origem),
+                            glm::vec3(inst.pos[0], inst.pos[1], inst.pos[2]),
+                            glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(scale));
+
+    if (inst.collider == SCENE_COLLIDER_CUBE)
+    {
+        CuboQuente quente;
+        quente.no     = no;
+        quente.colide = false;
+        Bounds_Invalidate(&quente.limites);
+
+        CuboFrio frio = {
             {
-                modelo->tempoVisto += deltaTime;
+                glm::vec4(obj->second.bbox_min, 1.0f),
+                glm::vec4(obj->second.bbox_max, 1.0f)
+            }, // Cube
+            SceneGraph_World(g_Cena, no), // Matrix do Modelo
+            mat.Ka,
+            mat.Kd,
+            mat.Ks,
+            mat.Ke,
+            celula
+        };
+
+        CubosColisores* cubos = &Cubes_Collisions[Obj_Name];
+        PoolHandle h = Pool_Add(cubos, quente, frio);
+        const WorldBounds& limites = LimitesDoColisor(cubos, Pool_Index(*cubos, h));
+
+        // O comportamento das estátuas fica em "statueai.h"
+        if (Obj_Name == NOME_ESTATUA)
+            StatueAI_Add(&g_Estatuas, glm::vec4(limites.centro, 1.0f), path, celula);
+
+        // Objetos do cenário bloqueiam a linha de visão e o jogador
+        std::map<std::string, std::shared_ptr<const BVH> >::iterator bvh = g_BVHDosObjetos.find(Obj_Name);
+        if (bvh != g_BVHDosObjetos.end())
+        {
+            LineOfSight_AddOccluder(bvh->second, frio.Matrix_Model, celula);
+            CollisionMesh_AddInstance(bvh->second, frio.Matrix_Model, celula);
+        }
+    }
+    else
+    {
+        EsferaQuente quente =
+        {
+            {
+                pos + glm::vec4(inst.center_offset[0], inst.center_offset[1], inst.center_offset[2], 0.0f),
+                (norm(obj->second.bbox_min)) * scale
+            }, // Esfera
+            false
+        };
+
+        EsferaFria fria =
+        {
+            SceneGraph_World(g_Cena, no),
+            { path[0], path[1], path[2], path[3] },
+            mat.Ka,
+            mat.Kd,
+            mat.Ks,
+            mat.Ke,
+            celula
+        };
+        fria.no = no;
+        Bounds_Invalidate(&fria.limites);
+        Bounds_Update(&fria.limites, fria.Matrix_Model, obj->second.bbox_min, obj->second.bbox_max);
+        Pool_Add(&Spheres_Collisions[Obj_Name], quente, fria);
+    }
+}
+
+// Carrega a cena descrita em "filename" (veja "scene.h") e constrói
+// diretamente os vetores de colisores usados pelo laço de renderização.
+// As células do mundo, se houver, são apenas registradas em "worldstream.h"
+// e carregadas conforme a câmera se aproxima delas.
+void BuildSceneFromFile(const char* filename)
+{
+    SceneDescription scene;
+    std::string err;
+    if (!Scene_Load(filename, &scene, &err))
+    {
+        fprintf(stderr, "ERROR: %s\n", err.c_str());
+        std::exit(EXIT_FAILURE);
+    }
 
-                glm::vec3 oldPos = glm::vec3(centro.x, centro.y, centro.z);
-                glm::vec3 newPos = cubic_bezier(modelo->Path[0], modelo->Path[1], modelo->Path[2], modelo->Path[3], modelo->t);
-                glm::vec3 deltaPos = newPos - oldPos;
-                modelo->Matrix_Model = Matrix_Translate(deltaPos.x, deltaPos.y, deltaPos.z) * modelo->Matrix_Model;
+    for (uint32_t i = 0; i < scene.num_textures; ++i)
+        LoadTextureImage(scene.textures[i].filename);
+
+    // Materiais de cada objeto, indexados pelo nome do objeto em g_VirtualScene
+    std::map<std::string, std::vector<MaterialDaCena> > materiais;
+
+    for (uint32_t i = 0; i < scene.num_meshes; ++i)
+    {
+        const SceneMeshDesc& mesh = scene.meshes[i];
+        MalhaPreparada malha;
+        std::vector<MaterialDaCena> mats;
+        PrepareTrianglesFromFile(mesh.filename, mesh.basepath[0] != '\0' ? mesh.basepath : NULL, &malha, &mats);
+        PrepareTangents(&malha, mesh.filename);
+        if (mesh.env)
+            PrepareBVHs(&malha, mesh.filename);
+        MalhaNaGPU gpu = UploadTrianglesToVirtualScene(malha, mesh.env != 0);
+
+        for (size_t objeto = 0; objeto < malha.objetos.size(); ++objeto)
+            materiais[malha.objetos[objeto].name] = mats;
+
+        // As malhas da cena principal ficam sempre carregadas; registrá-las
+        // permite que as células do mundo as reutilizem.
+        MalhaDoMundo registro;
+        registro.referencias = 1;
+        registro.objetos     = malha.objetos;
+        registro.materiais   = mats;
+        registro.gpu         = gpu;
+
+        std::lock_guard<std::mutex> lock(g_MalhasDoMundoMutex);
+        g_MalhasDoMundo[mesh.filename] = registro;
+    }
+
+    for (uint32_t i = 0; i < scene.num_planes; ++i)
+    {
+        const ScenePlaneDesc& plane = scene.planes[i];
+        Plano temp =
+        {
+            glm::vec4(plane.n[0], plane.n[1], plane.n[2], 0.0f),
+            plane.d
+        };
+        Planes_Collisions.push_back(temp);
+    }
+
+    // Reservamos o espaço de todas as instâncias de cada objeto de uma vez
+    std::map<std::string, size_t> num_cubos;
+    std::map<std::string, size_t> num_esferas;
+    for (uint32_t i = 0; i < scene.num_instances; ++i)
+    {
+        if (scene.instances[i].collider == SCENE_COLLIDER_CUBE)
+            num_cubos[scene.instances[i].object] += 1;
+        else
+            num_esferas[scene.instances[i].object] += 1;
+    }
+    for (auto& n : num_cubos)
+        Pool_Reserve(&Cubes_Collisions[n.first], Pool_Size(Cubes_Collisions[n.first]) + n.second);
+    for (auto& n : num_esferas)
+        Pool_Reserve(&Spheres_Collisions[n.first], Pool_Size(Spheres_Collisions[n.first]) + n.second);
+
+    for (uint32_t i = 0; i < scene.num_instances; ++i)
+    {
+        const SceneInstanceDesc& inst = scene.instances[i];
+        std::map<std::string, std::vector<MaterialDaCena> >::iterator mats = materiais.find(inst.object);
+        AddSceneInstance(filename, inst, glm::vec3(0.0f), mats != materiais.end() ? &mats->second : NULL, -1);
+    }
+
+    PrepareNavMesh(filename);
+
+    if (scene.num_cells > 0)
+    {
+        WorldStream_Init(scene.cell_size, LoadWorldCell, ActivateWorldCell, ReleaseWorldCell);
+        for (uint32_t i = 0; i < scene.num_cells; ++i)
+            WorldStream_AddCell(scene.cells[i].x, scene.cells[i].z, scene.cells[i].filename);
+        g_WorldCellSize = scene.cell_size;
+    }
+
+    Scene_Free(&scene);
+}
+
+// Malha de uma célula lida pela thread de carregamento. Se a malha já estava
+// na GPU quando a célula foi lida, ela não é preparada novamente.
+struct MalhaDaCelula
+{
+    SceneMeshDesc               desc;
+    bool                        preparada;
+    MalhaPreparada              malha;
+    std::vector<MaterialDaCena> materiais;
+};
+
+struct CelulaCarregada
+{
+    std::string                    filename;
+    std::vector<MalhaDaCelula>     malhas;
+    std::vector<SceneInstanceDesc> instancias;
+};
+
+// Lê o arquivo ".obj" de uma malha e prepara seus triângulos.
+static bool PreparaMalhaDaCelula(MalhaDaCelula* m)
+{
+    try
+    {
+        PrepareTrianglesFromFile(m->desc.filename, m->desc.basepath[0] != '\0' ? m->desc.basepath : NULL,
+                                 &m->malha, &m->materiais);
+        PrepareTangents(&m->malha, m->desc.filename);
+        if (m->desc.env)
+            PrepareBVHs(&m->malha, m->desc.filename);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "ERROR: %s (\"%s\")\n", e.what(), m->desc.filename);
+        return false;
+    }
+    m->preparada = true;
+    return true;
+}
 
-                modelo->t = 1 / (1 + exp(-2*(modelo->tempoVisto-5))); // Função Sigmoid
+// Executada pela thread de carregamento de "worldstream.h".
+std::shared_ptr<void> LoadWorldCell(const WorldCell& cell)
+{
+    SceneDescription scene;
+    std::string err;
+    if (!Scene_Load(cell.filename.c_str(), &scene, &err))
+    {
+        fprintf(stderr, "ERROR: %s\n", err.c_str());
+        return std::shared_ptr<void>();
+    }
 
-            } else if(acos(angle) < d2r(25))
-            {
-                modelo->tempoVisto += deltaTime;
-                if(modelo->tempoVisto >= 5 && !modelo->visto)
-                {
-                    modelo->visto = true;
-                    modelo->tempoVisto = 0;
-                }
-            } else modelo->tempoVisto = 0;
+    // Texturas ocupam unidades fixas do shader e planos de colisão são
+    // infinitos; ambos pertencem apenas à cena principal.
+    if (scene.num_textures > 0 || scene.num_planes > 0 || scene.num_cells > 0)
+        fprintf(stderr, "WARNING: World cell \"%s\": textures, planes and cells are ignored.\n", cell.filename.c_str());
 
+    std::shared_ptr<CelulaCarregada> dados = std::make_shared<CelulaCarregada>();
+    dados->filename = cell.filename;
+    dados->instancias.assign(scene.instances, scene.instances + scene.num_instances);
+    dados->malhas.resize(scene.num_meshes);
 
-            model = modelo->Matrix_Model;
+    bool ok = true;
+    for (uint32_t i = 0; i < scene.num_meshes && ok; ++i)
+    {
+        MalhaDaCelula& m = dados->malhas[i];
+        m.desc = scene.meshes[i];
+        m.preparada = false;
 
-            if(!(Cubes_Collisions[Obj_Name][i].colide))
-            {
-                glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-                glUniform1i(object_id_uniform, STATUEI);
-                DrawVirtualObject(Obj_Name.c_str());
-            }
+        bool residente;
+        {
+            std::lock_guard<std::mutex> lock(g_MalhasDoMundoMutex);
+            residente = g_MalhasDoMundo.count(m.desc.filename) > 0;
         }
+        if (!residente)
+            ok = PreparaMalhaDaCelula(&m);
+    }
 
-        // Desenhamos o plano do chão
+    Scene_Free(&scene);
 
-        model = Matrix_Translate(0.0f,-1.0f,0.0f) * Matrix_Scale(500.0f, 1.0f, 500.0f);
-        glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-        glUniform1i(object_id_uniform, PLANE);
-        DrawVirtualObject("plane");
+    if (!ok)
+        return std::shared_ptr<void>();
+    return dados;
+}
 
-        // Desenha cenário
+// Executada pela thread de renderização: envia as malhas ainda não
+// carregadas para a GPU e cria os colisores das instâncias da célula.
+size_t ActivateWorldCell(const WorldCell& cell, const std::shared_ptr<void>& data)
+{
+    CelulaCarregada* dados = (CelulaCarregada*)data.get();
+    std::vector<std::string>& malhas_da_celula = g_MalhasDasCelulas[cell.id];
 
-        for(std::string Obj_Name: ObjetosCenaNomes)
-        {
-            for(unsigned int i = 0; i < Cubes_Collisions[Obj_Name].size(); i++)
-            {
-                Cubo_Collision* modelo = &(Cubes_Collisions[Obj_Name][i]);
-                if(!(Cubes_Collisions[Obj_Name][i].colide))
-                {
-                    glUniform3f(Ka_uniform, modelo->Ka.x, modelo->Ka.y, modelo->Ka.z);
-                    glUniform3f(Kd_uniform, modelo->Kd.x, modelo->Kd.y, modelo->Kd.z);
-                    glUniform3f(Ks_uniform, modelo->Ks.x, modelo->Ks.y, modelo->Ks.z);
-                    glUniform3f(Ke_uniform, modelo->Ke.x, modelo->Ke.y, modelo->Ke.z);
-                    glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(Cubes_Collisions[Obj_Name][i].Matrix_Model));
-                    glUniform1i(object_id_uniform, 99);
-                    DrawVirtualObject(Obj_Name.c_str());
-                }
-            }
-        }
+    // Materiais de cada objeto, indexados pelo nome do objeto em g_VirtualScene
+    std::map<std::string, const std::vector<MaterialDaCena>*> materiais;
 
-        Obj_Name = "sphere";
-        Sphere_Collision* modelo = &(Spheres_Collisions[Obj_Name][0]);
-        if(!(Spheres_Collisions[Obj_Name][0].colide))
-        {
-            glUniform3f(Ka_uniform, modelo->Ka.x, modelo->Ka.y, modelo->Ka.z);
-            glUniform3f(Kd_uniform, modelo->Kd.x, modelo->Kd.y, modelo->Kd.z);
-            glUniform3f(Ks_uniform, modelo->Ks.x, modelo->Ks.y, modelo->Ks.z);
-            glUniform3f(Ke_uniform, modelo->Ke.x, modelo->Ke.y, modelo->Ke.z);
-            glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(modelo->Matrix_Model));
-            glUniform1i(object_id_uniform, SPHERE);
-            DrawVirtualObject(Obj_Name.c_str());
-        }
+    // Estimativa conservadora: malhas compartilhadas são contadas em cada
+    // célula que as utiliza.
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < dados->malhas.size(); ++i)
+    {
+        MalhaDaCelula& m = dados->malhas[i];
 
-        if(!estatua_final || anim_final == -1.0f)
+        std::map<std::string, MalhaDoMundo>::iterator registro = g_MalhasDoMundo.find(m.desc.filename);
+        if (registro == g_MalhasDoMundo.end())
         {
-            glDisable(GL_DEPTH_TEST);
-            model = Matrix_Translate(0.23f,-1.0f,-2.0f) * Matrix_Scale(0.002f, 0.002f, 0.002f);
-            glUniformMatrix4fv(model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(object_id_uniform, GUN);
-            DrawVirtualObject("revolver");
-            glEnable(GL_DEPTH_TEST);
+            // A malha pode ter sido descarregada depois que a célula foi lida.
+            if (!m.preparada && !PreparaMalhaDaCelula(&m))
+                continue;
+
+            MalhaDoMundo novo;
+            novo.referencias = 0;
+            novo.objetos     = m.malha.objetos;
+            novo.materiais   = m.materiais;
+            novo.gpu         = UploadTrianglesToVirtualScene(m.malha, m.desc.env != 0);
+
+            std::lock_guard<std::mutex> lock(g_MalhasDoMundoMutex);
+            registro = g_MalhasDoMundo.insert(std::make_pair(std::string(m.desc.filename), novo)).first;
         }
 
-        TextRendering_ShowFramesPerSecond(window);
-
-        if(Tfinal)
-            TextRendering_Parabens(window);
-        else
-            TextRendering_ShowCrossHair(window);
-
-        glfwSwapBuffers(window);
+        registro->second.referencias += 1;
+        bytes += registro->second.gpu.bytes;
+        malhas_da_celula.push_back(registro->first);
 
-        glfwPollEvents();
+        for (size_t k = 0; k < registro->second.objetos.size(); ++k)
+            materiais[registro->second.objetos[k].name] = &registro->second.materiais;
     }
 
-    // Finalizamos o uso dos recursos do sistema operacional
-    glfwTerminate();
+    glm::vec3 origem = glm::vec3(cell.x * g_WorldCellSize, 0.0f, cell.z * g_WorldCellSize);
+    for (size_t i = 0; i < dados->instancias.size(); ++i)
+    {
+        const SceneInstanceDesc& inst = dados->instancias[i];
+        std::map<std::string, const std::vector<MaterialDaCena>*>::iterator mats = materiais.find(inst.object);
+        AddSceneInstance(dados->filename.c_str(), inst, origem, mats != materiais.end() ? mats->second : NULL, cell.id);
+        bytes += inst.collider == SCENE_COLLIDER_CUBE ? sizeof(CuboQuente) + sizeof(CuboFrio)
+                                                       : sizeof(EsferaQuente) + sizeof(EsferaFria);
+    }
 
-    // Fim do programa
-    return 0;
+    return bytes;
 }
 
-glm::vec3 cubic_bezier(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 p4, float t)
+// Mantém a ordem dos que ficam, como StatueAI_RemoveCell()
+template <typename Quente, typename Fria>
+static void RemoveColisoresDaCelula(std::unordered_map<std::string, Pool<Quente, Fria> >& colisores, int celula)
 {
-    return (float)(pow((1-t),3)) * p1 + (float)(3*t*pow((1-t),2)) * p2 + (float)(3*t*t*(1-t)) * p3 + (float)(t*t*t)*p4;
+    for (auto& c : colisores)
+        Pool_RemoveIf(&c.second, [celula](const Quente&, const Fria& x){ return x.celula == celula; });
 }
 
-// Função que carrega uma imagem para ser utilizada como textura
-void LoadTextureImage(const char* filename)
+// Executada pela thread de renderização ao descarregar uma célula.
+void ReleaseWorldCell(const WorldCell& cell)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    RemoveColisoresDaCelula(Cubes_Collisions, cell.id);
+    RemoveColisoresDaCelula(Spheres_Collisions, cell.id);
+    StatueAI_RemoveCell(&g_Estatuas, cell.id);
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
-
-    if ( data == NULL )
+    std::map<int, int>::iterator no = g_NosDasCelulas.find(cell.id);
+    if (no != g_NosDasCelulas.end())
     {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
+        SceneGraph_Remove(&g_Cena, no->second);
+        g_NosDasCelulas.erase(no);
     }
+    LineOfSight_RemoveCell(cell.id);
+    CollisionMesh_RemoveCell(cell.id);
+
+    std::vector<std::string>& malhas_da_celula = g_MalhasDasCelulas[cell.id];
+    for (size_t i = 0; i < malhas_da_celula.size(); ++i)
+    {
+        std::map<std::string, MalhaDoMundo>::iterator registro = g_MalhasDoMundo.find(malhas_da_celula[i]);
+        registro->second.referencias -= 1;
+        if (registro->second.referencias > 0)
+            continue;
 
-    printf("OK (%dx%d).\n", width, height);
+        RemoveTrianglesFromVirtualScene(registro->second.objetos, registro->second.gpu);
 
-    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
+        std::lock_guard<std::mutex> lock(g_MalhasDoMundoMutex);
+        g_MalhasDoMundo.erase(registro);
+    }
+    g_MalhasDasCelulas.erase(cell.id);
+}
+
+// Função que carrega uma imagem para ser utilizada como textura
+void LoadTextureImage(const char* filename)
+{
+    // Criamos objetos na GPU com OpenGL para armazenar a textura
     GLuint texture_id;
     GLuint sampler_id;
     glGenTextures(1, &texture_id);
@@ -826,7 +1377,6 @@ void LoadTextureImage(const char* filename)
     glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Agora enviamos a imagem lida do disco para a GPU
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
@@ -835,46 +1385,47 @@ void LoadTextureImage(const char* filename)
     GLuint textureunit = g_NumLoadedTextures;
     glActiveTexture(GL_TEXTURE0 + textureunit);
     glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
 
-    stbi_image_free(data);
+    // A imagem é lida do cache de texturas comprimidas com mipmaps prontos,
+    // gerado na primeira execução. Os níveis maiores chegam em segundo plano
+    // através de TextureUpload_Update(). Veja "texturecache.cpp".
+    TextureCache_Load(filename, texture_id, textureunit);
+    glBindSampler(textureunit, sampler_id);
 
     g_NumLoadedTextures += 1;
 }
 
-// Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
+// Função que prepara o desenho de um objeto armazenado em g_VirtualScene. Veja definição
 // dos objetos na função BuildTrianglesAndAddToVirtualScene().
-void DrawVirtualObject(const char* object_name)
-{
-    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
-    // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
-    // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
-
-    // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
-    // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
-
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-    // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
-    // a documentação da função glDrawElements() em
-    // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
-    );
-
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+bool FillVirtualObject(const std::string& object_name, int object_id, int passo, const glm::mat4& model, RenderItem* item)
+{
+    // O objeto pode ter sido descarregado junto com sua célula do mundo
+    // depois que a simulação publicou o estado sendo desenhado.
+    std::map<std::string, SceneObject>::const_iterator obj = g_VirtualScene.find(object_name);
+    if (obj == g_VirtualScene.end())
+        return false;
+
+    // O item guarda o VAO compartilhado por todas as malhas, a faixa do
+    // buffer de índices a ser rasterizada (que muda quando o buffer é
+    // compactado), o vértice base da malha e a axis-aligned bounding
+    // box (AABB) do modelo, passada ao fragment shader em "bbox_min" e
+    // "bbox_max". O desenho em si, com glDrawElementsBaseVertex(), é feito por
+    // RenderQueue_Replay(). Veja a documentação em http://docs.gl/gl3/glDrawElementsBaseVertex.
+    item->passo          = passo;
+    item->object_id      = object_id;
+    item->material       = false;
+    item->vao            = obj->second.vertex_array_object_id;
+    item->rendering_mode = obj->second.rendering_mode;
+    item->num_indices    = (GLsizei)obj->second.num_indices;
+    MeshBufferRange faixa = MeshBuffer_Range(obj->second.malha_na_gpu);
+    item->first_index    = faixa.first_index + obj->second.first_index;
+    item->base_vertex    = faixa.base_vertex;
+    item->bbox_min       = obj->second.bbox_min;
+    item->bbox_max       = obj->second.bbox_max;
+    item->mapa_normal    = obj->second.normal_map;
+    item->model          = model;
+    item->profundidade   = 0.0f;
+    return true;
 }
 
 // Função que carrega os shaders de vértices e de fragmentos que serão
@@ -928,31 +1479,18 @@ void LoadShadersFromFiles()
     glUniform1i(glGetUniformLocation(program_id, "TextureImage0"), 0);
     glUniform1i(glGetUniformLocation(program_id, "TextureImage1"), 1);
     glUniform1i(glGetUniformLocation(program_id, "TextureImage2"), 2);
+    glUniform1i(glGetUniformLocation(program_id, "NormalMap"), RENDER_NORMAL_MAP_UNIT);
+    normal_mapped_uniform = glGetUniformLocation(program_id, "normal_mapped");
     Ka_uniform          = glGetUniformLocation(program_id, "MKa");
     Kd_uniform          = glGetUniformLocation(program_id, "MKd");
     Ks_uniform          = glGetUniformLocation(program_id, "MKs");
     Ke_uniform          = glGetUniformLocation(program_id, "MKe");
     glUseProgram(0);
-}
 
-// Função que pega a matriz M e guarda a mesma no topo da pilha
-void PushMatrix(glm::mat4 M)
-{
-    g_MatrixStack.push(M);
-}
-
-// Função que remove a matriz atualmente no topo da pilha e armazena a mesma na variável M
-void PopMatrix(glm::mat4& M)
-{
-    if ( g_MatrixStack.empty() )
-    {
-        M = Matrix_Identity();
-    }
-    else
-    {
-        M = g_MatrixStack.top();
-        g_MatrixStack.pop();
-    }
+    // As mesmas variáveis, para a fila de desenho
+    RenderUniforms uniforms = { program_id, model_uniform, object_id_uniform, bbox_min_uniform, bbox_max_uniform,
+                                Ka_uniform, Kd_uniform, Ks_uniform, Ke_uniform, normal_mapped_uniform };
+    g_Uniforms = uniforms;
 }
 
 // Função que computa as normais de um ObjModel, caso elas não tenham sido
@@ -962,73 +1500,50 @@ void ComputeNormals(ObjModel* model)
     if ( !model->attrib.normals.empty() )
         return;
 
-    // Primeiro computamos as normais para todos os TRIÂNGULOS.
-    // Segundo, computamos as normais dos VÉRTICES através do método proposto
-    // por Gouraud, onde a normal de cada vértice vai ser a média das normais de
-    // todas as faces que compartilham este vértice.
-
-    size_t num_vertices = model->attrib.vertices.size() / 3;
-
-    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
-    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
-
+    // As normais são calculadas para cada vértice de cada triângulo (veja
+    // "normals.h"): com vincos, um mesmo vértice pode ter várias normais.
+    std::vector<uint32_t> vertices;
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
-        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
-
-        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        const tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+        for (size_t triangle = 0; triangle < mesh.num_face_vertices.size(); ++triangle)
         {
-            assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
-
-            glm::vec4  vertices[3];
-            for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
-                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
-                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
-            }
-
-            const glm::vec4  a = vertices[0];
-            const glm::vec4  b = vertices[1];
-            const glm::vec4  c = vertices[2];
-
-            const glm::vec4  n = crossproduct(b-a,c-a);
-
+            assert(mesh.num_face_vertices[triangle] == 3);
             for (size_t vertex = 0; vertex < 3; ++vertex)
-            {
-                tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
-                num_triangles_per_vertex[idx.vertex_index] += 1;
-                vertex_normals[idx.vertex_index] += n;
-                model->shapes[shape].mesh.indices[3*triangle + vertex].normal_index = idx.vertex_index;
-            }
+                vertices.push_back(mesh.indices[3*triangle + vertex].vertex_index);
         }
     }
 
-    model->attrib.normals.resize( 3*num_vertices );
+    model->attrib.normals.resize(3 * vertices.size());
+    Normals_Compute(model->attrib.vertices.data(), 3, model->attrib.vertices.size() / 3, vertices.data(), vertices.size(),
+                    model->attrib.normals.data(), 3, g_NormalsWeight, g_NormalsCreaseAngle);
 
-    for (size_t i = 0; i < vertex_normals.size(); ++i)
+    int quina = 0;
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
-        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
-        n /= norm(n);
-        model->attrib.normals[3*i + 0] = n.x;
-        model->attrib.normals[3*i + 1] = n.y;
-        model->attrib.normals[3*i + 2] = n.z;
+        std::vector<tinyobj::index_t>& indices = model->shapes[shape].mesh.indices;
+        for (size_t i = 0; i < indices.size(); ++i)
+            indices[i].normal_index = quina++;
     }
 }
 
 // Constrói triângulos para futura renderização a partir de um ObjModel.
 void BuildTrianglesAndAddToVirtualScene(ObjModel* model, bool env)
 {
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
+    MalhaPreparada malha;
+    PrepareTriangles(model, &malha);
+    UploadTrianglesToVirtualScene(malha, env);
+}
 
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
+// Primeira parte da construção, que não usa OpenGL e por isso pode ser
+// executada fora da thread de renderização: monta os vetores de atributos e os
+// objetos da malha.
+void PrepareTriangles(ObjModel* model, MalhaPreparada* malha)
+{
+    std::vector<GLuint>& indices              = malha->indices;
+    std::vector<float>&  model_coefficients   = malha->model_coefficients;
+    std::vector<float>&  normal_coefficients  = malha->normal_coefficients;
+    std::vector<float>&  texture_coefficients = malha->texture_coefficients;
 
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
@@ -1100,70 +1615,516 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model, bool env)
         theobject.first_index    = first_index; // Primeiro índice
         theobject.num_indices    = last_index - first_index + 1; // Número de indices
         theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-        theobject.vertex_array_object_id = vertex_array_object_id;
+        theobject.vertex_array_object_id = 0;          // Definido em UploadTrianglesToVirtualScene()
+        theobject.malha_na_gpu   = 0;                  // Idem
+        theobject.normal_map     = 0;
 
         theobject.bbox_min = bbox_min;
         theobject.bbox_max = bbox_max;
 
+        malha->objetos.push_back(theobject);
+        malha->mapas_normais.push_back("");
+    }
+}
+
+// Estado da leitura em fluxo de PrepareTrianglesFromFile(). Os callbacks de
+// ObjParser_LoadWithCallback() escrevem os vértices de cada triângulo
+// diretamente nos vetores da malha, sem montar attrib_t e shape_t.
+struct MalhaEmFluxo
+{
+    MalhaPreparada*                  malha;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      basepath; // Diretório dos arquivos ".mtl" e das suas texturas
+    int                              material; // Último "usemtl" (-1 = nenhum)
+
+    // Listas do arquivo, indexadas pelas faces
+    std::vector<float> posicoes;  // 3 por "v"
+    std::vector<float> normais;   // 3 por "vn"
+    std::vector<float> texcoords; // 2 por "vt"
+
+    // Objeto atual, equivalente a uma "shape" de tinyobj
+    SceneObject objeto;
+    size_t      poligonos;
+    std::string nome;
+    int         material_do_objeto; // Material da primeira face do objeto
+
+    // Posição de cada vértice dos triângulos, enquanto o arquivo não tiver
+    // normais: nesse caso elas são calculadas no fim, como em ComputeNormals().
+    std::vector<uint32_t> vertice_da_quina;
+    bool                  normal_pendente; // Face que usa normais antes de qualquer "vn"
+
+    std::string erro;
+};
+
+static void IniciaObjetoEmFluxo(MalhaEmFluxo* m)
+{
+    const float minval = std::numeric_limits<float>::min();
+    const float maxval = std::numeric_limits<float>::max();
+
+    m->objeto.first_index = m->malha->indices.size();
+    m->objeto.bbox_min    = glm::vec3(maxval,maxval,maxval);
+    m->objeto.bbox_max    = glm::vec3(minval,minval,minval);
+    m->poligonos          = 0;
+}
+
+// Como tinyobj, um grupo sem faces não gera objeto
+static void FechaObjetoEmFluxo(MalhaEmFluxo* m)
+{
+    if (m->poligonos == 0)
+        return;
+
+    m->objeto.name           = m->nome;
+    m->objeto.num_indices    = m->malha->indices.size() - m->objeto.first_index;
+    m->objeto.rendering_mode = GL_TRIANGLES;
+    m->objeto.vertex_array_object_id = 0; // Definido em UploadTrianglesToVirtualScene()
+    m->objeto.malha_na_gpu   = 0;         // Idem
+    m->objeto.normal_map     = 0;         // Idem
+    m->malha->objetos.push_back(m->objeto);
+
+    // O mapa de normais do objeto é o do material da sua primeira face.
+    // Arquivos ".mtl" costumam usar "bump" também para mapas de normais.
+    std::string mapa;
+    int material = m->material_do_objeto;
+    if (material >= 0 && (size_t)material < m->materials.size())
+    {
+        const tinyobj::material_t& mat = m->materials[material];
+        const std::string& textura = !mat.normal_texname.empty() ? mat.normal_texname : mat.bump_texname;
+        if (!textura.empty())
+            mapa = m->basepath + textura;
+    }
+    m->malha->mapas_normais.push_back(mapa);
+
+    IniciaObjetoEmFluxo(m);
+}
+
+static void VerticeEmFluxo(void* user_data, float x, float y, float z, float)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    m->posicoes.push_back(x);
+    m->posicoes.push_back(y);
+    m->posicoes.push_back(z);
+}
+
+static void NormalEmFluxo(void* user_data, float x, float y, float z)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    m->normais.push_back(x);
+    m->normais.push_back(y);
+    m->normais.push_back(z);
+
+    // O arquivo tem normais: não vamos calculá-las
+    if (m->normais.size() == 3)
+        std::vector<uint32_t>().swap(m->vertice_da_quina);
+}
+
+static void TexCoordEmFluxo(void* user_data, float u, float v, float)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    m->texcoords.push_back(u);
+    m->texcoords.push_back(v);
+}
+
+// Índice do arquivo (1 = primeiro, negativo = relativo ao fim) para índice
+// da lista; -1 se estiver fora dela
+static inline int IndiceEmFluxo(int indice, size_t n)
+{
+    int i = indice > 0 ? indice - 1 : (int)n + indice;
+    return (i >= 0 && (size_t)i < n) ? i : -1;
+}
+
+// Um vértice de um triângulo, com os mesmos vetores de PrepareTriangles()
+static void QuinaEmFluxo(MalhaEmFluxo* m, const tinyobj::index_t& idx)
+{
+    MalhaPreparada* malha = m->malha;
+
+    // Como em tinyobj, o índice de vértice 0 é tratado como o primeiro
+    int v = idx.vertex_index == 0 ? 0 : IndiceEmFluxo(idx.vertex_index, m->posicoes.size() / 3);
+    if (v < 0 || m->posicoes.empty())
+    {
+        m->erro = "Face references an undefined vertex.";
+        return;
+    }
+
+    malha->indices.push_back(malha->indices.size());
+
+    const float vx = m->posicoes[3*v + 0];
+    const float vy = m->posicoes[3*v + 1];
+    const float vz = m->posicoes[3*v + 2];
+    malha->model_coefficients.push_back( vx ); // X
+    malha->model_coefficients.push_back( vy ); // Y
+    malha->model_coefficients.push_back( vz ); // Z
+    malha->model_coefficients.push_back( 1.0f ); // W
+
+    glm::vec3& bbox_min = m->objeto.bbox_min;
+    glm::vec3& bbox_max = m->objeto.bbox_max;
+    bbox_min.x = std::min(bbox_min.x, vx);
+    bbox_min.y = std::min(bbox_min.y, vy);
+    bbox_min.z = std::min(bbox_min.z, vz);
+    bbox_max.x = std::max(bbox_max.x, vx);
+    bbox_max.y = std::max(bbox_max.y, vy);
+    bbox_max.z = std::max(bbox_max.z, vz);
+
+    if (m->normais.empty())
+    {
+        m->vertice_da_quina.push_back(v);
+        if (idx.normal_index != 0)
+            m->normal_pendente = true;
+    }
+    else if (idx.normal_index != 0)
+    {
+        int n = IndiceEmFluxo(idx.normal_index, m->normais.size() / 3);
+        if (n < 0)
+        {
+            m->erro = "Face references an undefined normal.";
+            return;
+        }
+        malha->normal_coefficients.push_back( m->normais[3*n + 0] ); // X
+        malha->normal_coefficients.push_back( m->normais[3*n + 1] ); // Y
+        malha->normal_coefficients.push_back( m->normais[3*n + 2] ); // Z
+        malha->normal_coefficients.push_back( 0.0f ); // W
+    }
+
+    if (idx.texcoord_index != 0)
+    {
+        int t = IndiceEmFluxo(idx.texcoord_index, m->texcoords.size() / 2);
+        if (t < 0)
+        {
+            m->erro = "Face references an undefined texture coordinate.";
+            return;
+        }
+        malha->texture_coefficients.push_back( m->texcoords[2*t + 0] );
+        malha->texture_coefficients.push_back( m->texcoords[2*t + 1] );
+    }
+}
+
+static void FaceEmFluxo(void* user_data, tinyobj::index_t* indices, int num_indices)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    if (!m->erro.empty())
+        return;
+
+    // Leque de triângulos, como a triangulação de tinyobj
+    if (m->poligonos == 0)
+        m->material_do_objeto = m->material;
+    m->poligonos += 1;
+    for (int k = 2; k < num_indices && m->erro.empty(); ++k)
+    {
+        QuinaEmFluxo(m, indices[0]);
+        QuinaEmFluxo(m, indices[k-1]);
+        QuinaEmFluxo(m, indices[k]);
+    }
+}
+
+static void GrupoEmFluxo(void* user_data, const char** names, int num_names)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    FechaObjetoEmFluxo(m);
+    m->nome = num_names > 0 ? names[0] : "";
+}
+
+static void ObjetoEmFluxo(void* user_data, const char* name)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    FechaObjetoEmFluxo(m);
+    m->nome = name;
+}
+
+static void MaterialEmFluxo(void* user_data, const char*, int material_id)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    m->material = material_id;
+}
+
+static void MateriaisEmFluxo(void* user_data, const tinyobj::material_t* materials, int num_materials)
+{
+    MalhaEmFluxo* m = (MalhaEmFluxo*)user_data;
+    m->materials.insert(m->materials.end(), materials, materials + num_materials);
+}
+
+// Normais de um arquivo sem normais, calculadas por "normals.h" a partir
+// das posições de cada vértice dos triângulos
+static void CalculaNormaisEmFluxo(MalhaEmFluxo* m)
+{
+    MalhaPreparada* malha = m->malha;
+    size_t num_quinas = m->vertice_da_quina.size();
+
+    // w = 0 para vetores
+    malha->normal_coefficients.assign(4 * num_quinas, 0.0f);
+    Normals_Compute(m->posicoes.data(), 3, m->posicoes.size() / 3, m->vertice_da_quina.data(), num_quinas,
+                    malha->normal_coefficients.data(), 4, g_NormalsWeight, g_NormalsCreaseAngle);
+}
+
+// Lê um arquivo ".obj" direto para os vetores de uma malha preparada, com o
+// mesmo resultado de ObjModel, ComputeNormals() e PrepareTriangles(), mas
+// sem as cópias intermediárias: uma contagem prévia do arquivo (veja
+// ObjParser_Count()) permite reservar os vetores finais de uma vez, e as
+// faces são trianguladas à medida que são lidas. Lança std::runtime_error
+// em caso de erro, como ObjModel. Única diferença: tinyobj descarta as faces
+// de um grupo fechado por "g" ou "o" logo depois de um "usemtl"; aqui elas
+// são mantidas.
+void PrepareTrianglesFromFile(const char* filename, const char* basepath, MalhaPreparada* malha,
+                              std::vector<MaterialDaCena>* materiais)
+{
+    printf("Carregando modelo \"%s\"... ", filename);
+
+    MalhaEmFluxo m;
+    m.malha              = malha;
+    m.basepath           = basepath != NULL ? basepath : "";
+    m.material           = -1;
+    m.material_do_objeto = -1;
+    m.normal_pendente    = false;
+    IniciaObjetoEmFluxo(&m);
+
+    ObjParserCounts contagem;
+    if (ObjParser_Count(filename, &contagem))
+    {
+        size_t quinas = 3 * contagem.triangles;
+        m.posicoes.reserve(3 * contagem.vertices);
+        m.normais.reserve(3 * contagem.normals);
+        m.texcoords.reserve(2 * contagem.texcoords);
+        if (contagem.normals == 0)
+            m.vertice_da_quina.reserve(quinas);
+
+        malha->indices.reserve(malha->indices.size() + quinas);
+        malha->model_coefficients.reserve(malha->model_coefficients.size() + 4 * quinas);
+        malha->normal_coefficients.reserve(malha->normal_coefficients.size() + 4 * quinas);
+        if (contagem.texcoords > 0)
+            malha->texture_coefficients.reserve(malha->texture_coefficients.size() + 2 * quinas);
+    }
+
+    tinyobj::callback_t callback;
+    callback.vertex_cb   = VerticeEmFluxo;
+    callback.normal_cb   = NormalEmFluxo;
+    callback.texcoord_cb = TexCoordEmFluxo;
+    callback.index_cb    = FaceEmFluxo;
+    callback.usemtl_cb   = MaterialEmFluxo;
+    callback.mtllib_cb   = MateriaisEmFluxo;
+    callback.group_cb    = GrupoEmFluxo;
+    callback.object_cb   = ObjetoEmFluxo;
+
+    tinyobj::MaterialFileReader leitor_mtl(m.basepath);
+
+    std::string err;
+    bool ret = ObjParser_LoadWithCallback(filename, callback, &m, &leitor_mtl, &err);
+
+    if (ret && m.erro.empty() && m.normal_pendente && !m.normais.empty())
+        m.erro = "Face references a normal defined later in the file.";
+    if (!m.erro.empty())
+    {
+        err += m.erro;
+        ret = false;
+    }
+
+    if (!err.empty())
+        fprintf(stderr, "\n%s\n", err.c_str());
+
+    if (!ret)
+        throw std::runtime_error("Erro ao carregar modelo.");
+
+    FechaObjetoEmFluxo(&m);
+    if (m.normais.empty())
+        CalculaNormaisEmFluxo(&m);
+
+    *materiais = MateriaisDoModelo(m.materials);
+
+    printf("OK.\n");
+}
+
+// Obtém, para cada objeto da malha lida de "filename", a BVH dos seus
+// triângulos no sistema do modelo: do cache "<filename>.bvh" se ele estiver
+// atualizado, ou construindo-a e gravando o cache. Assim como
+// PrepareTriangles(), não usa OpenGL e pode executar na thread de
+// carregamento do mundo.
+void PrepareBVHs(MalhaPreparada* malha, const char* filename)
+{
+    std::string cache = std::string(filename) + ".bvh";
+
+    std::vector<size_t> num_triangulos;
+    for (size_t i = 0; i < malha->objetos.size(); ++i)
+        num_triangulos.push_back(malha->objetos[i].num_indices / 3);
+
+    malha->bvhs.clear();
+    if (BVH_LoadCache(cache.c_str(), filename, num_triangulos, &malha->bvhs))
+        return;
+
+    for (size_t i = 0; i < malha->objetos.size(); ++i)
+    {
+        const SceneObject& objeto = malha->objetos[i];
+        std::shared_ptr<BVH> bvh = std::make_shared<BVH>();
+        BVH_Build(bvh.get(), malha->model_coefficients.data(), 4,
+                  &malha->indices[objeto.first_index], objeto.num_indices);
+        malha->bvhs.push_back(bvh);
+    }
+
+    if (!BVH_SaveCache(cache.c_str(), filename, malha->bvhs))
+        fprintf(stderr, "WARNING: Cannot write BVH cache \"%s\".\n", cache.c_str());
+}
+
+// Constrói a malha de navegação (veja "navmesh.h") sobre o cenário da cena
+// principal e o plano do chão, ou a lê do cache "<filename>.nav" se os
+// triângulos e os parâmetros não mudaram. As células do mundo não entram
+// na malha: as suas estátuas usam os caminhos fixos.
+void PrepareNavMesh(const char* filename)
+{
+    std::vector<glm::vec3> vertices;
+    CollisionMesh_CollectTriangles(-1, &vertices);
+    if (vertices.empty())
+        return;
+
+    printf("Preparando malha de navegação... ");
+    fflush(stdout);
+
+    glm::vec3 min = vertices[0], max = vertices[0];
+    for (size_t i = 1; i < vertices.size(); ++i)
+    {
+        min = glm::min(min, vertices[i]);
+        max = glm::max(max, vertices[i]);
+    }
+
+    // O plano do chão (em y = -1, veja o laço de renderização) cobre a
+    // região em volta do cenário
+    const float chao   = -1.0f;
+    const float margem = 6.0f;
+
+    NavMeshParams params;
+    params.min          = glm::vec3(min.x - margem, chao - 1.0f, min.z - margem);
+    params.max          = glm::vec3(max.x + margem, max.y + 2.0f, max.z + margem);
+    params.cell_size    = 0.3f;
+    params.cell_height  = 0.1f;
+    params.agent_height = 1.8f;
+    params.agent_radius = 0.4f;
+    params.agent_climb  = 0.4f;
+    params.max_slope    = 45.0f;
+
+    glm::vec3 a(params.min.x, chao, params.min.z), b(params.max.x, chao, params.min.z);
+    glm::vec3 c(params.max.x, chao, params.max.z), d(params.min.x, chao, params.max.z);
+    const glm::vec3 plano[6] = { a, c, b, a, d, c };
+    vertices.insert(vertices.end(), plano, plano + 6);
+
+    std::string cache = std::string(filename) + ".nav";
+    uint64_t chave = NavMesh_Key(params, vertices.data(), vertices.size());
+    bool lida = NavMesh_LoadCache(cache.c_str(), chave, &g_NavMesh);
+    if (!lida)
+    {
+        NavMesh_Build(&g_NavMesh, params, vertices.data(), vertices.size());
+        if (!NavMesh_SaveCache(cache.c_str(), chave, g_NavMesh))
+            fprintf(stderr, "WARNING: Cannot write navigation mesh cache \"%s\".\n", cache.c_str());
+    }
+    g_TemNavMesh = !g_NavMesh.poligonos.empty();
+    if (g_TemNavMesh)
+        FlowField_Build(&g_CampoDeFuga, g_NavMesh);
+
+    printf("%lu polígonos, %lu portais, %u regiões%s.\n", (unsigned long)g_NavMesh.poligonos.size(),
+           (unsigned long)g_NavMesh.ligacoes.size(), g_NavMesh.num_regioes, lida ? " (cache)" : "");
+}
+
+// Tangentes dos vértices (veja "tangents.h"), calculadas apenas se algum
+// objeto da malha tem mapa de normais: do cache "<filename>.tan" se ele
+// estiver atualizado, ou calculando-as e gravando o cache. Como
+// PrepareBVHs(), não usa OpenGL.
+void PrepareTangents(MalhaPreparada* malha, const char* filename)
+{
+    malha->tangent_coefficients.clear();
+    if (std::find_if(malha->mapas_normais.begin(), malha->mapas_normais.end(),
+                     [](const std::string& mapa) { return !mapa.empty(); }) == malha->mapas_normais.end())
+        return;
+
+    // Todas as quinas precisam de coordenadas de textura
+    size_t num_quinas = malha->model_coefficients.size() / 4;
+    if (malha->texture_coefficients.size() != 2 * num_quinas || malha->normal_coefficients.size() != 4 * num_quinas)
+    {
+        fprintf(stderr, "WARNING: \"%s\" has normal maps but not all faces have texture coordinates; normal maps are ignored.\n", filename);
+        std::fill(malha->mapas_normais.begin(), malha->mapas_normais.end(), std::string());
+        return;
+    }
+
+    std::string cache = std::string(filename) + ".tan";
+    malha->tangent_coefficients.resize(4 * num_quinas);
+    if (Tangents_LoadCache(cache.c_str(), filename, num_quinas, malha->tangent_coefficients.data()))
+        return;
+
+    Tangents_Compute(malha->model_coefficients.data(), 4, malha->normal_coefficients.data(), 4,
+                     malha->texture_coefficients.data(), 2, num_quinas, malha->tangent_coefficients.data());
+
+    if (!Tangents_SaveCache(cache.c_str(), filename, malha->tangent_coefficients.data(), num_quinas))
+        fprintf(stderr, "WARNING: Cannot write tangent cache \"%s\".\n", cache.c_str());
+}
+
+// Textura de um mapa de normais. Os mapas são compartilhados pelos objetos
+// que os usam e ficam carregados até o fim do programa, como as texturas da
+// cena.
+GLuint LoadNormalMap(const std::string& filename)
+{
+    static std::map<std::string, GLuint> mapas;
+    std::map<std::string, GLuint>::iterator mapa = mapas.find(filename);
+    if (mapa != mapas.end())
+        return mapa->second;
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glActiveTexture(GL_TEXTURE0 + RENDER_NORMAL_MAP_UNIT);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    if (!TextureCache_LoadLinear(filename.c_str()))
+    {
+        fprintf(stderr, "WARNING: Cannot open normal map \"%s\".\n", filename.c_str());
+        glDeleteTextures(1, &texture_id);
+        texture_id = 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    mapas[filename] = texture_id;
+    return texture_id;
+}
+
+// Segunda parte da construção: envia os atributos para o buffer de malhas
+// (veja "meshbuffer.h") e adiciona os objetos da malha em g_VirtualScene.
+// Retorna a malha no buffer, para que ela possa ser removida depois.
+MalhaNaGPU UploadTrianglesToVirtualScene(const MalhaPreparada& malha, bool env)
+{
+    size_t num_vertices = malha.model_coefficients.size() / 4;
+
+    // Atributos ausentes (ou que não cobrem todos os vértices) ficam zerados
+    const float* normais   = malha.normal_coefficients.size()  == 4 * num_vertices ? malha.normal_coefficients.data()  : NULL;
+    const float* texturas  = malha.texture_coefficients.size() == 2 * num_vertices ? malha.texture_coefficients.data() : NULL;
+    const float* tangentes = malha.tangent_coefficients.size() == 4 * num_vertices ? malha.tangent_coefficients.data() : NULL;
+
+    MalhaNaGPU gpu;
+    gpu.malha = MeshBuffer_Upload(malha.model_coefficients.data(), normais, texturas, tangentes, num_vertices,
+                                  malha.indices.data(), malha.indices.size());
+    gpu.bytes = MeshBuffer_Bytes(gpu.malha);
+
+    for (size_t i = 0; i < malha.objetos.size(); ++i)
+    {
+        SceneObject theobject = malha.objetos[i];
+        theobject.vertex_array_object_id = MeshBuffer_VAO();
+        theobject.malha_na_gpu           = gpu.malha;
+        if (tangentes != NULL && i < malha.mapas_normais.size() && !malha.mapas_normais[i].empty())
+            theobject.normal_map = LoadNormalMap(malha.mapas_normais[i]);
+
         if(env) ObjetosCenaNomes.push_back(theobject.name);
         printf(theobject.name.c_str());
         std::cout << '\n';
 
-        g_VirtualScene[model->shapes[shape].name] = theobject;
-    }
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0;
-    GLint  number_of_dimensions = 4;
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    if ( !normal_coefficients.empty() )
-    {
-        GLuint VBO_normal_coefficients_id;
-        glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-        location = 1; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-
-    if ( !texture_coefficients.empty() )
-    {
-        GLuint VBO_texture_coefficients_id;
-        glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
-        location = 2; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-
-    GLuint indices_id;
-    glGenBuffers(1, &indices_id);
-
-    // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
-    //
+        g_VirtualScene[theobject.name] = theobject;
+        if (env && i < malha.bvhs.size())
+            g_BVHDosObjetos[theobject.name] = malha.bvhs[i];
+    }
+
+    return gpu;
+}
+
+// Remove de g_VirtualScene os objetos de uma malha e libera o seu espaço no
+// buffer de malhas.
+void RemoveTrianglesFromVirtualScene(const std::vector<SceneObject>& objetos, const MalhaNaGPU& gpu)
+{
+    for (size_t i = 0; i < objetos.size(); ++i)
+    {
+        g_VirtualScene.erase(objetos[i].name);
+        g_BVHDosObjetos.erase(objetos[i].name);
+        ObjetosCenaNomes.erase(std::remove(ObjetosCenaNomes.begin(), ObjetosCenaNomes.end(), objetos[i].name), ObjetosCenaNomes.end());
+    }
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+    MeshBuffer_Free(gpu.malha);
 }
 
 // Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
@@ -1340,23 +2301,41 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 // Função callback chamada sempre que o usuário aperta algum dos botões do mouse
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
+    // O disparo é processado pela simulação no próximo passo (veja ShootRay())
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
     {
-            for(auto& c: Cubes_Collisions)
-                for(auto& v: c.second)
-                {
-                    if(v.objName != "statue") continue;
-                    glm::vec4 bbMin = v.Matrix_Model * (glm::vec4(v.cube.vert_min.x, v.cube.vert_min.y, v.cube.vert_min.z, 1.0f));
-                    glm::vec4 bbMax = v.Matrix_Model * (glm::vec4(v.cube.vert_max.x, v.cube.vert_max.y, v.cube.vert_max.z, 1.0f));
-                    Cubo temp {bbMin, bbMax};
-                    v.colide = (collision(ray, temp) || v.colide);
+        std::lock_guard<std::mutex> lock(g_EntradaMutex);
+        g_Entrada.disparos.push_back(ray);
+    }
+}
 
-                }
+// Volumes envolventes do cubo "i" no mundo, recalculados se a matriz mudou
+const WorldBounds& LimitesDoColisor(CubosColisores* cubos, size_t i)
+{
+    // Só lê a parte fria do colisor se a matriz mudou
+    WorldBounds* limites = &cubos->quente[i].limites;
+    if (limites->sujo)
+    {
+        const CuboFrio& c = cubos->fria[i];
+        Bounds_Update(limites, c.Matrix_Model, glm::vec3(c.cube.vert_min), glm::vec3(c.cube.vert_max));
+    }
+    return *limites;
+}
 
-            for(auto& s: Spheres_Collisions)
-                for(auto& v: s.second)
-                    v.colide = (collision(ray, v.bola) || v.colide);
+// Marca como atingidos os colisores de estátuas e esferas atravessados pelo raio
+void ShootRay(const Raio& ray)
+{
+    CubosColisores& estatuas = Cubes_Collisions[NOME_ESTATUA];
+    for(size_t i = 0; i < Pool_Size(estatuas); i++)
+    {
+        const WorldBounds& limites = LimitesDoColisor(&estatuas, i);
+        Cubo temp {glm::vec4(limites.min, 1.0f), glm::vec4(limites.max, 1.0f)};
+        estatuas.quente[i].colide = (collision(ray, temp) || estatuas.quente[i].colide);
     }
+
+    for(auto& s: Spheres_Collisions)
+        for(auto& v: s.second.quente)
+            v.colide = (collision(ray, v.bola) || v.colide);
 }
 
 // Função callback chamada sempre que o usuário movimentar o cursor do mouse em
@@ -1468,9 +2447,6 @@ void ErrorCallback(int error, const char* description)
 }
 
 void InputperFrame(GLFWwindow* window){
-    const float cameraSpeed = 5.2f * deltaTime; // Usa o deltaTime para que a diferença de framerate não afete a velocidade
-    const glm::vec4 dir_vec = glm::vec4(camera_view_vector.x, 0.0f, camera_view_vector.z, 0.0f)/norm(glm::vec4(camera_view_vector.x, 0.0f, camera_view_vector.z, 0.0f));
-
     double mouse_x, mouse_y;
 	glfwGetCursorPos(window, &mouse_x, &mouse_y);
 	glfwSetCursorPos(window, (double)(800 / 2), (double)(600 / 2));
@@ -1493,14 +2469,30 @@ void InputperFrame(GLFWwindow* window){
     if (g_CameraPhi < phimin)
         g_CameraPhi = phimin;
 
+    // O movimento é aplicado pela simulação, em passos fixos (veja MovePlayer())
+    std::lock_guard<std::mutex> lock(g_EntradaMutex);
+    g_Entrada.frente   = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    g_Entrada.tras     = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    g_Entrada.esquerda = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    g_Entrada.direita  = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    g_Entrada.view_vector = camera_view_vector;
+}
+
+// Move o jogador durante "dt" segundos, conforme as teclas pressionadas
+void MovePlayer(const EntradaDoJogador& entrada, float dt)
+{
+    const float cameraSpeed = 5.2f * dt;
+    const glm::vec4 view_vector = entrada.view_vector;
+    const glm::vec4 dir_vec = glm::vec4(view_vector.x, 0.0f, view_vector.z, 0.0f)/norm(glm::vec4(view_vector.x, 0.0f, view_vector.z, 0.0f));
+
     glm::vec4 nextPos = camera_position_c;
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (entrada.frente)
         nextPos = camera_position_c + (cameraSpeed * dir_vec);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (entrada.tras)
         nextPos = camera_position_c - (cameraSpeed * dir_vec);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (entrada.esquerda)
         nextPos = camera_position_c - (glm::normalize(crossproduct(dir_vec, camera_up_vector)) * cameraSpeed);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (entrada.direita)
         nextPos = camera_position_c + (glm::normalize(crossproduct(dir_vec, camera_up_vector)) * cameraSpeed);
 
     Cubo PlayerTemp = Player_AABB;
@@ -1508,13 +2500,19 @@ void InputperFrame(GLFWwindow* window){
 
     bool NpodeMover = false;
 
-    if(PlayerTemp.vert_max.x >= 20.0f)
-        NpodeMover = true;
-
-    if(PlayerTemp.vert_max.z >= 20.0f)
-        NpodeMover = true;
+    // Paredes e móveis do cenário. Se o jogador já está em contato (por
+    // exemplo, na posição inicial), deixamos que ele se afaste.
+    glm::vec3 olhos = glm::vec3(nextPos);
+    glm::vec3 base  = olhos - glm::vec3(0.0f, g_PlayerHeight, 0.0f);
+    if (CollisionMesh_OverlapsCapsule(base, olhos, g_PlayerRadius))
+    {
+        glm::vec3 olhos_atual = glm::vec3(camera_position_c);
+        glm::vec3 base_atual  = olhos_atual - glm::vec3(0.0f, g_PlayerHeight, 0.0f);
+        if (!CollisionMesh_OverlapsCapsule(base_atual, olhos_atual, g_PlayerRadius))
+            NpodeMover = true;
+    }
 
-    for(Plano p: Planes_Collisions)
+    for(const Plano& p: Planes_Collisions)
     {
         NpodeMover = collision(PlayerTemp, p) || NpodeMover;
     }
@@ -1845,7 +2843,3 @@ void PrintObjModelInfo(ObjModel* model)
 
 // set makeprg=cd\ ..\ &&\ make\ run\ >/dev/null
 // vim: set spell spelllang=pt_br :
-
-static double d2r(double d) {
-  return (d / 180.0) * ((double) M_PI);
-}
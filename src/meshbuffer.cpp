@@ -0,0 +1,363 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "meshbuffer.h"
+#include "tlsf.h"
+#include "jobs.h"
+
+// Vértices por tarefa no empacotamento
+#define MESHBUFFER_GRAO 8192
+
+// Um dos dois buffers, com o alocador das suas posições
+struct ArenaNaGPU
+{
+    GLuint        buffer;
+    TLSFAllocator alocador;
+    uint32_t      bytes_por_posicao;
+};
+
+struct MalhaNoBuffer
+{
+    TLSFAllocation vertices; // node = TLSF_NENHUM se a malha não tem vértices
+    TLSFAllocation indices;
+    uint32_t       num_vertices;
+    uint32_t       num_indices;
+    bool           viva;
+};
+
+static GLuint     g_VAO = 0;
+static ArenaNaGPU g_Vertices;
+static ArenaNaGPU g_Indices;
+
+static std::vector<MalhaNoBuffer> g_Malhas;
+static std::vector<uint32_t>      g_MalhasVagas;
+
+static unsigned long g_Crescimentos  = 0;
+static unsigned long g_Compactacoes  = 0;
+static size_t        g_BytesCopiados = 0;
+
+// Atributos do VAO apontando para os buffers atuais
+static void ConfiguraVAO()
+{
+    glBindVertexArray(g_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, g_Vertices.buffer);
+
+    // Veja o formato em "meshbuffer.h" e as localizações em "shader_vertex.glsl"
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESHBUFFER_VERTEX_SIZE, (void*)0);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, MESHBUFFER_VERTEX_SIZE, (void*)12);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, MESHBUFFER_VERTEX_SIZE, (void*)16);
+    glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, MESHBUFFER_VERTEX_SIZE, (void*)24);
+    for (GLuint location = 0; location < 4; ++location)
+        glEnableVertexAttribArray(location);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_Indices.buffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Buffer vazio de "bytes" bytes. Usamos GL_COPY_WRITE_BUFFER para não
+// alterar o GL_ELEMENT_ARRAY_BUFFER do VAO que estiver ligado.
+static GLuint NovoBuffer(size_t bytes)
+{
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+    return buffer;
+}
+
+static void IniciaArena(ArenaNaGPU* a, uint32_t posicoes, uint32_t bytes_por_posicao)
+{
+    a->bytes_por_posicao = bytes_por_posicao;
+    a->buffer = NovoBuffer((size_t)posicoes * bytes_por_posicao);
+    TLSF_Init(&a->alocador, posicoes);
+}
+
+void MeshBuffer_Init(uint32_t vertices, uint32_t indices)
+{
+    glGenVertexArrays(1, &g_VAO);
+    IniciaArena(&g_Vertices, std::max(vertices, 1u), MESHBUFFER_VERTEX_SIZE);
+    IniciaArena(&g_Indices, std::max(indices, 1u), sizeof(GLuint));
+    ConfiguraVAO();
+}
+
+void MeshBuffer_Shutdown()
+{
+    glDeleteVertexArrays(1, &g_VAO);
+    glDeleteBuffers(1, &g_Vertices.buffer);
+    glDeleteBuffers(1, &g_Indices.buffer);
+    g_VAO = g_Vertices.buffer = g_Indices.buffer = 0;
+    g_Malhas.clear();
+    g_MalhasVagas.clear();
+}
+
+GLuint MeshBuffer_VAO()
+{
+    return g_VAO;
+}
+
+// Aumenta a arena para caber mais "minimo" posições, ao menos dobrando
+static void Cresce(ArenaNaGPU* a, uint32_t minimo)
+{
+    uint32_t antigo = a->alocador.size;
+    uint32_t novo   = antigo + std::max(antigo, minimo);
+    size_t   bytes  = (size_t)antigo * a->bytes_por_posicao;
+
+    GLuint buffer = NovoBuffer((size_t)novo * a->bytes_por_posicao);
+    glBindBuffer(GL_COPY_READ_BUFFER, a->buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+    glDeleteBuffers(1, &a->buffer);
+    a->buffer = buffer;
+
+    TLSF_Grow(&a->alocador, novo);
+    g_Crescimentos  += 1;
+    g_BytesCopiados += bytes;
+}
+
+// Faixa de uma malha em uma das arenas
+static TLSFAllocation& FaixaDaMalha(MalhaNoBuffer& m, const ArenaNaGPU* a)
+{
+    return a == &g_Vertices ? m.vertices : m.indices;
+}
+
+// Move as faixas das malhas para o começo de um buffer novo, na ordem em
+// que estavam. Retorna false se não havia buracos.
+static bool Compacta(ArenaNaGPU* a)
+{
+    const TLSFAllocator& alocador = a->alocador;
+    bool compactada = alocador.livre == 0
+                   || (alocador.nos[alocador.ultimo].size == alocador.livre && !alocador.nos[alocador.ultimo].usado);
+    if (compactada)
+        return false;
+
+    std::vector<uint32_t> malhas;
+    for (uint32_t i = 0; i < g_Malhas.size(); ++i)
+        if (g_Malhas[i].viva && FaixaDaMalha(g_Malhas[i], a).node != TLSF_NENHUM)
+            malhas.push_back(i);
+    std::sort(malhas.begin(), malhas.end(), [a](uint32_t x, uint32_t y)
+    {
+        return FaixaDaMalha(g_Malhas[x], a).offset < FaixaDaMalha(g_Malhas[y], a).offset;
+    });
+
+    uint32_t tamanho = alocador.size;
+    GLuint buffer = NovoBuffer((size_t)tamanho * a->bytes_por_posicao);
+    glBindBuffer(GL_COPY_READ_BUFFER, a->buffer);
+
+    std::vector<uint32_t> tamanhos(malhas.size());
+    for (size_t k = 0; k < malhas.size(); ++k)
+        tamanhos[k] = TLSF_Size(alocador, FaixaDaMalha(g_Malhas[malhas[k]], a).node);
+
+    // Alocando em ordem a partir de um espaço vazio, cada faixa começa onde
+    // a anterior termina
+    TLSF_Init(&a->alocador, tamanho);
+    for (size_t k = 0; k < malhas.size(); ++k)
+    {
+        TLSFAllocation& faixa = FaixaDaMalha(g_Malhas[malhas[k]], a);
+        TLSFAllocation nova;
+        TLSF_Allocate(&a->alocador, tamanhos[k], &nova);
+
+        size_t bytes = (size_t)tamanhos[k] * a->bytes_por_posicao;
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            (GLintptr)faixa.offset * a->bytes_por_posicao,
+                            (GLintptr)nova.offset * a->bytes_por_posicao, bytes);
+        g_BytesCopiados += bytes;
+        faixa = nova;
+    }
+
+    glDeleteBuffers(1, &a->buffer);
+    a->buffer = buffer;
+    return true;
+}
+
+bool MeshBuffer_Defragment()
+{
+    bool vertices = Compacta(&g_Vertices);
+    bool indices  = Compacta(&g_Indices);
+    if (!vertices && !indices)
+        return false;
+
+    ConfiguraVAO();
+    g_Compactacoes += 1;
+    return true;
+}
+
+// Reserva "n" posições, compactando ou aumentando a arena se preciso
+static TLSFAllocation Reserva(ArenaNaGPU* a, uint32_t n)
+{
+    TLSFAllocation faixa;
+    faixa.offset = 0;
+    faixa.node   = TLSF_NENHUM;
+    if (n == 0 || TLSF_Allocate(&a->alocador, n, &faixa))
+        return faixa;
+
+    // Os blocos livres somam o bastante: basta juntá-los
+    if (a->alocador.livre >= n && Compacta(a))
+    {
+        ConfiguraVAO();
+        g_Compactacoes += 1;
+        if (TLSF_Allocate(&a->alocador, n, &faixa))
+            return faixa;
+    }
+
+    Cresce(a, n);
+    ConfiguraVAO();
+    if (!TLSF_Allocate(&a->alocador, n, &faixa))
+    {
+        fprintf(stderr, "ERROR: Cannot allocate %lu entries in the mesh buffer.\n", (unsigned long)n);
+        std::exit(EXIT_FAILURE);
+    }
+    return faixa;
+}
+
+// Vetor em 10 bits por coordenada (com sinal, normalizado) e w em 2 bits.
+// w = 1 e w = -2 valem 1 e -1 nas duas regras de conversão de OpenGL (a
+// de 3.3 e a de 4.2); w = 0 vale 1/3 em 3.3, por isso o shader ignora o w
+// da normal.
+static inline uint32_t Empacota(float x, float y, float z, int w)
+{
+    float v[3] = { x, y, z };
+    uint32_t bits = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        float c = std::max(-1.0f, std::min(1.0f, v[i]));
+        int q = (int)std::floor(c * 511.0f + 0.5f);
+        bits |= ((uint32_t)q & 0x3FFu) << (10 * i);
+    }
+    return bits | (((uint32_t)w & 0x3u) << 30);
+}
+
+static void EmpacotaVertices(unsigned char* destino, const float* positions, const float* normals,
+                             const float* texcoords, const float* tangents, size_t a, size_t b)
+{
+    for (size_t v = a; v < b; ++v)
+    {
+        unsigned char* d = destino + v * MESHBUFFER_VERTEX_SIZE;
+
+        memcpy(d, positions + 4*v, 3 * sizeof(float));
+
+        uint32_t n = 0;
+        if (normals != NULL)
+            n = Empacota(normals[4*v + 0], normals[4*v + 1], normals[4*v + 2], 0);
+        memcpy(d + 12, &n, sizeof(n));
+
+        float t[2] = { 0.0f, 0.0f };
+        if (texcoords != NULL)
+            t[0] = texcoords[2*v + 0], t[1] = texcoords[2*v + 1];
+        memcpy(d + 16, t, sizeof(t));
+
+        uint32_t tg = 0;
+        if (tangents != NULL)
+            tg = Empacota(tangents[4*v + 0], tangents[4*v + 1], tangents[4*v + 2], tangents[4*v + 3] < 0.0f ? -2 : 1);
+        memcpy(d + 24, &tg, sizeof(tg));
+    }
+}
+
+uint32_t MeshBuffer_Upload(const float* positions, const float* normals,
+                           const float* texcoords, const float* tangents, size_t num_vertices,
+                           const uint32_t* indices, size_t num_indices)
+{
+    uint32_t id;
+    if (!g_MalhasVagas.empty())
+    {
+        id = g_MalhasVagas.back();
+        g_MalhasVagas.pop_back();
+    }
+    else
+    {
+        id = (uint32_t)g_Malhas.size();
+        g_Malhas.push_back(MalhaNoBuffer());
+    }
+
+    MalhaNoBuffer& m = g_Malhas[id];
+    m.num_vertices = (uint32_t)num_vertices;
+    m.num_indices  = (uint32_t)num_indices;
+    m.viva         = true;
+    m.vertices.node = m.indices.node = TLSF_NENHUM;
+    m.vertices      = Reserva(&g_Vertices, m.num_vertices);
+    m.indices       = Reserva(&g_Indices, m.num_indices);
+
+    if (num_vertices > 0)
+    {
+        // Os vértices são empacotados direto na memória do buffer, em
+        // paralelo; sem o mapeamento, em um vetor temporário
+        size_t bytes = num_vertices * MESHBUFFER_VERTEX_SIZE;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_Vertices.buffer);
+        unsigned char* destino = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER,
+                                                                 (GLintptr)m.vertices.offset * MESHBUFFER_VERTEX_SIZE, bytes,
+                                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        std::vector<unsigned char> temporario;
+        if (destino == NULL)
+        {
+            temporario.resize(bytes);
+            destino = temporario.data();
+        }
+
+        Jobs_ParallelFor(0, num_vertices, MESHBUFFER_GRAO, [&](size_t a, size_t b)
+        {
+            EmpacotaVertices(destino, positions, normals, texcoords, tangents, a, b);
+        });
+
+        if (temporario.empty())
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        else
+            glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)m.vertices.offset * MESHBUFFER_VERTEX_SIZE, bytes, destino);
+    }
+
+    if (num_indices > 0)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_Indices.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)m.indices.offset * sizeof(GLuint),
+                        num_indices * sizeof(GLuint), indices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return id;
+}
+
+void MeshBuffer_Free(uint32_t mesh)
+{
+    MalhaNoBuffer& m = g_Malhas[mesh];
+    if (m.vertices.node != TLSF_NENHUM)
+        TLSF_Free(&g_Vertices.alocador, m.vertices.node);
+    if (m.indices.node != TLSF_NENHUM)
+        TLSF_Free(&g_Indices.alocador, m.indices.node);
+    m.viva = false;
+    g_MalhasVagas.push_back(mesh);
+}
+
+MeshBufferRange MeshBuffer_Range(uint32_t mesh)
+{
+    const MalhaNoBuffer& m = g_Malhas[mesh];
+    MeshBufferRange faixa;
+    faixa.base_vertex = (GLint)m.vertices.offset;
+    faixa.first_index = m.indices.offset;
+    return faixa;
+}
+
+size_t MeshBuffer_Bytes(uint32_t mesh)
+{
+    const MalhaNoBuffer& m = g_Malhas[mesh];
+    return (size_t)m.num_vertices * MESHBUFFER_VERTEX_SIZE + (size_t)m.num_indices * sizeof(GLuint);
+}
+
+MeshBufferStats MeshBuffer_Stats()
+{
+    TLSFStats v = TLSF_Stats(g_Vertices.alocador);
+    TLSFStats i = TLSF_Stats(g_Indices.alocador);
+
+    MeshBufferStats s;
+    s.vertex_bytes      = (size_t)v.size * MESHBUFFER_VERTEX_SIZE;
+    s.vertex_bytes_used = (size_t)v.used * MESHBUFFER_VERTEX_SIZE;
+    s.index_bytes       = (size_t)i.size * sizeof(GLuint);
+    s.index_bytes_used  = (size_t)i.used * sizeof(GLuint);
+    s.meshes            = (unsigned long)(g_Malhas.size() - g_MalhasVagas.size());
+    s.free_blocks       = v.free_blocks + i.free_blocks;
+    s.grows             = g_Crescimentos;
+    s.defragmentations  = g_Compactacoes;
+    s.bytes_moved       = g_BytesCopiados;
+    return s;
+}
@@ -0,0 +1,985 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include "navmesh.h"
+#include "framearena.h"
+#include "jobs.h"
+#include "mappedfile.h"
+
+// A partir de quantas consultas NavMesh_FindPaths() usa várias threads
+#define NAVMESH_PARALLEL_THRESHOLD 8
+
+static NavMeshStats g_Stats;
+
+// Intervalo sólido [smin, smax] (em células) de uma coluna, durante a
+// voxelização. Os intervalos de uma coluna formam uma lista ordenada.
+struct Intervalo
+{
+    uint16_t smin;
+    uint16_t smax;
+    uint8_t  chao;    // O topo é caminhável
+    uint32_t proximo;
+};
+
+// Espaço livre acima de um chão caminhável: [y, topo] em células
+struct CelulaAberta
+{
+    uint16_t y;
+    uint16_t topo;
+    uint32_t vizinho[4]; // Em +x, +z, -x, -z (NAVMESH_NONE se não há ligação)
+    uint32_t regiao;
+    uint32_t poligono;
+    bool     removida;   // Erodida
+};
+
+static const int DIR_X[4] = { 1, 0, -1, 0 };
+static const int DIR_Z[4] = { 0, 1, 0, -1 };
+
+struct Voxelizacao
+{
+    int largura, profundidade, altura;
+    std::vector<uint32_t>  cabeca; // Primeiro intervalo de cada coluna
+    std::vector<Intervalo> intervalos;
+    uint32_t               livre;  // Lista de intervalos descartados
+};
+
+static uint32_t NovoIntervalo(Voxelizacao* v)
+{
+    if (v->livre != NAVMESH_NONE)
+    {
+        uint32_t i = v->livre;
+        v->livre = v->intervalos[i].proximo;
+        return i;
+    }
+    v->intervalos.push_back(Intervalo());
+    return (uint32_t)v->intervalos.size() - 1;
+}
+
+// Insere [smin, smax] na coluna, fundindo-o com os intervalos que toca. O
+// intervalo resultante é chão se o seu topo veio de um triângulo pouco
+// inclinado; topos a até uma célula de distância contam como o mesmo.
+static void AdicionaIntervalo(Voxelizacao* v, int coluna, uint16_t smin, uint16_t smax, bool chao)
+{
+    uint32_t anterior = NAVMESH_NONE;
+    uint32_t atual    = v->cabeca[coluna];
+    while (atual != NAVMESH_NONE)
+    {
+        Intervalo& a = v->intervalos[atual];
+        if (a.smin > smax)
+            break;
+        if (a.smax < smin)
+        {
+            anterior = atual;
+            atual    = a.proximo;
+            continue;
+        }
+
+        if (std::abs((int)a.smax - (int)smax) <= 1)
+            chao = chao || a.chao;
+        else if (a.smax > smax)
+            chao = a.chao != 0;
+        smin = std::min(smin, a.smin);
+        smax = std::max(smax, a.smax);
+
+        uint32_t proximo = a.proximo;
+        a.proximo = v->livre;
+        v->livre  = atual;
+        if (anterior == NAVMESH_NONE)
+            v->cabeca[coluna] = proximo;
+        else
+            v->intervalos[anterior].proximo = proximo;
+        atual = proximo;
+    }
+
+    uint32_t novo = NovoIntervalo(v);
+    Intervalo& n = v->intervalos[novo];
+    n.smin = smin;
+    n.smax = smax;
+    n.chao = chao ? 1 : 0;
+    if (anterior == NAVMESH_NONE)
+    {
+        n.proximo = v->cabeca[coluna];
+        v->cabeca[coluna] = novo;
+    }
+    else
+    {
+        n.proximo = v->intervalos[anterior].proximo;
+        v->intervalos[anterior].proximo = novo;
+    }
+}
+
+// Divide o polígono convexo "entrada" pelo plano p[eixo] = corte: a parte
+// com p[eixo] <= corte vai para "menor" e o resto para "maior".
+static void DividePoligono(const glm::vec3* entrada, int n, glm::vec3* menor, int* n_menor,
+                           glm::vec3* maior, int* n_maior, float corte, int eixo)
+{
+    float d[12];
+    for (int i = 0; i < n; ++i)
+        d[i] = corte - entrada[i][eixo];
+
+    int m = 0, M = 0;
+    for (int i = 0, j = n - 1; i < n; j = i, ++i)
+    {
+        bool dentro_i = d[i] >= 0.0f;
+        bool dentro_j = d[j] >= 0.0f;
+        if (dentro_i != dentro_j)
+        {
+            float s = d[j] / (d[j] - d[i]);
+            glm::vec3 p = entrada[j] + (entrada[i] - entrada[j]) * s;
+            menor[m++] = p;
+            maior[M++] = p;
+            // O ponto exatamente no corte fica só do lado menor
+            if (d[i] > 0.0f)
+                menor[m++] = entrada[i];
+            else if (d[i] < 0.0f)
+                maior[M++] = entrada[i];
+            continue;
+        }
+        if (d[i] >= 0.0f)
+        {
+            menor[m++] = entrada[i];
+            if (d[i] != 0.0f)
+                continue;
+        }
+        maior[M++] = entrada[i];
+    }
+    *n_menor = m;
+    *n_maior = M;
+}
+
+static void RasterizaTriangulo(Voxelizacao* v, const NavMeshParams& p, const glm::vec3* tri, bool chao)
+{
+    glm::vec3 tmin = glm::min(tri[0], glm::min(tri[1], tri[2]));
+    glm::vec3 tmax = glm::max(tri[0], glm::max(tri[1], tri[2]));
+    if (tmin.x > p.max.x || tmax.x < p.min.x || tmin.y > p.max.y || tmax.y < p.min.y
+     || tmin.z > p.max.z || tmax.z < p.min.z)
+        return;
+
+    const float cs = p.cell_size;
+    int z0 = std::max((int)std::floor((tmin.z - p.min.z) / cs), -1);
+    int z1 = std::min((int)std::floor((tmax.z - p.min.z) / cs), v->profundidade - 1);
+
+    glm::vec3 buf[4][12];
+    glm::vec3* resto = buf[0];
+    glm::vec3* linha = buf[1];
+    glm::vec3* celula = buf[2];
+    glm::vec3* lixo = buf[3];
+    int n_resto = 3;
+    resto[0] = tri[0];
+    resto[1] = tri[1];
+    resto[2] = tri[2];
+
+    for (int z = z0; z <= z1; ++z)
+    {
+        int n_linha;
+        DividePoligono(resto, n_resto, linha, &n_linha, lixo, &n_resto, p.min.z + (z + 1) * cs, 2);
+        std::swap(resto, lixo);
+        if (n_linha < 3 || z < 0)
+            continue;
+
+        float lmin = linha[0].x, lmax = linha[0].x;
+        for (int i = 1; i < n_linha; ++i)
+        {
+            lmin = std::min(lmin, linha[i].x);
+            lmax = std::max(lmax, linha[i].x);
+        }
+        int x0 = std::max((int)std::floor((lmin - p.min.x) / cs), -1);
+        int x1 = std::min((int)std::floor((lmax - p.min.x) / cs), v->largura - 1);
+
+        for (int x = x0; x <= x1; ++x)
+        {
+            int n_celula, n_linha_resto;
+            DividePoligono(linha, n_linha, celula, &n_celula, lixo, &n_linha_resto, p.min.x + (x + 1) * cs, 0);
+            std::swap(linha, lixo);
+            n_linha = n_linha_resto;
+            if (n_celula < 3 || x < 0)
+                continue;
+
+            float ymin = celula[0].y, ymax = celula[0].y;
+            for (int i = 1; i < n_celula; ++i)
+            {
+                ymin = std::min(ymin, celula[i].y);
+                ymax = std::max(ymax, celula[i].y);
+            }
+            ymin -= p.min.y;
+            ymax -= p.min.y;
+            if (ymax < 0.0f || ymin > p.max.y - p.min.y)
+                continue;
+
+            int smin = std::max((int)std::floor(ymin / p.cell_height), 0);
+            int smax = std::min((int)std::ceil(ymax / p.cell_height), v->altura);
+            smax = std::max(smax, smin + 1);
+            AdicionaIntervalo(v, x + z * v->largura, (uint16_t)smin, (uint16_t)smax, chao);
+        }
+    }
+}
+
+// Agrupa as células abertas em retângulos, a partir da célula "inicio" na
+// coluna (x, z). Escreve as células do retângulo, linha a linha, em
+// "celulas" e retorna a largura e a altura.
+static void CresceRetangulo(const std::vector<CelulaAberta>& abertas, uint32_t inicio,
+                            std::vector<uint32_t>* celulas, int* largura, int* altura)
+{
+    const CelulaAberta& c = abertas[inicio];
+    celulas->clear();
+    celulas->push_back(inicio);
+
+    // Altura quase constante, para que o polígono seja plano
+    auto serve = [&](uint32_t i)
+    {
+        return i != NAVMESH_NONE && !abertas[i].removida && abertas[i].poligono == NAVMESH_NONE
+            && abertas[i].regiao == c.regiao && std::abs((int)abertas[i].y - (int)c.y) <= 1;
+    };
+
+    uint32_t atual = inicio;
+    int w = 1;
+    while (w < NAVMESH_MAX_POLY_SIZE && serve(abertas[atual].vizinho[0]))
+    {
+        atual = abertas[atual].vizinho[0];
+        celulas->push_back(atual);
+        w += 1;
+    }
+
+    int h = 1;
+    while (h < NAVMESH_MAX_POLY_SIZE)
+    {
+        size_t linha = celulas->size() - w;
+        bool ok = true;
+        for (int k = 0; k < w && ok; ++k)
+        {
+            uint32_t n = abertas[(*celulas)[linha + k]].vizinho[1];
+            ok = serve(n) && (k == 0 || abertas[celulas->back()].vizinho[0] == n);
+            if (ok)
+                celulas->push_back(n);
+        }
+        if (!ok)
+        {
+            celulas->resize(linha + w);
+            break;
+        }
+        h += 1;
+    }
+
+    *largura = w;
+    *altura  = h;
+}
+
+void NavMesh_Build(NavMesh* navmesh, const NavMeshParams& p,
+                   const glm::vec3* vertices, size_t num_vertices)
+{
+    const float cs = p.cell_size;
+    const float ch = p.cell_height;
+
+    Voxelizacao v;
+    v.largura      = std::max((int)std::ceil((p.max.x - p.min.x) / cs), 1);
+    v.profundidade = std::max((int)std::ceil((p.max.z - p.min.z) / cs), 1);
+    v.altura       = std::min((int)std::ceil((p.max.y - p.min.y) / ch), 0xFFFF);
+    v.cabeca.assign((size_t)v.largura * v.profundidade, NAVMESH_NONE);
+    v.intervalos.reserve((size_t)v.largura * v.profundidade * 2);
+    v.livre = NAVMESH_NONE;
+
+    // 1. Voxelização
+    const float cos_inclinacao = std::cos(p.max_slope * 3.14159265358979323846f / 180.0f);
+    for (size_t i = 0; i + 2 < num_vertices; i += 3)
+    {
+        glm::vec3 n = glm::cross(vertices[i+1] - vertices[i], vertices[i+2] - vertices[i]);
+        float comprimento = glm::length(n);
+        bool chao = comprimento > 0.0f && std::fabs(n.y) >= cos_inclinacao * comprimento;
+        RasterizaTriangulo(&v, p, &vertices[i], chao);
+    }
+
+    // 2. Chãos com espaço livre para o agente, e ligações entre vizinhos
+    const int altura_agente = (int)std::ceil(p.agent_height / ch);
+    const int degrau        = (int)std::floor(p.agent_climb / ch);
+
+    size_t colunas = (size_t)v.largura * v.profundidade;
+    std::vector<uint32_t>     inicio(colunas + 1);
+    std::vector<CelulaAberta> abertas;
+    for (size_t c = 0; c < colunas; ++c)
+    {
+        inicio[c] = (uint32_t)abertas.size();
+        for (uint32_t i = v.cabeca[c]; i != NAVMESH_NONE; i = v.intervalos[i].proximo)
+        {
+            const Intervalo& s = v.intervalos[i];
+            int topo = s.proximo != NAVMESH_NONE ? v.intervalos[s.proximo].smin : 0xFFFF;
+            if (!s.chao || topo - (int)s.smax < altura_agente)
+                continue;
+
+            CelulaAberta a;
+            a.y        = s.smax;
+            a.topo     = (uint16_t)topo;
+            a.regiao   = NAVMESH_NONE;
+            a.poligono = NAVMESH_NONE;
+            a.removida = false;
+            for (int d = 0; d < 4; ++d)
+                a.vizinho[d] = NAVMESH_NONE;
+            abertas.push_back(a);
+        }
+    }
+    inicio[colunas] = (uint32_t)abertas.size();
+
+    for (int z = 0; z < v.profundidade; ++z)
+        for (int x = 0; x < v.largura; ++x)
+        {
+            size_t c = x + (size_t)z * v.largura;
+            for (uint32_t i = inicio[c]; i < inicio[c+1]; ++i)
+                for (int d = 0; d < 4; ++d)
+                {
+                    int nx = x + DIR_X[d], nz = z + DIR_Z[d];
+                    if (nx < 0 || nz < 0 || nx >= v.largura || nz >= v.profundidade)
+                        continue;
+                    size_t nc = nx + (size_t)nz * v.largura;
+                    for (uint32_t j = inicio[nc]; j < inicio[nc+1]; ++j)
+                    {
+                        int base = std::max(abertas[i].y, abertas[j].y);
+                        int topo = std::min(abertas[i].topo, abertas[j].topo);
+                        if (topo - base >= altura_agente && std::abs((int)abertas[j].y - (int)abertas[i].y) <= degrau)
+                        {
+                            abertas[i].vizinho[d] = j;
+                            break;
+                        }
+                    }
+                }
+        }
+
+    // Erosão pelo raio do agente: a cada rodada, saem as células na borda
+    std::vector<uint32_t> borda;
+    int rodadas = (int)std::ceil(p.agent_radius / cs);
+    for (int r = 0; r < rodadas; ++r)
+    {
+        borda.clear();
+        for (uint32_t i = 0; i < abertas.size(); ++i)
+        {
+            if (abertas[i].removida)
+                continue;
+            for (int d = 0; d < 4; ++d)
+            {
+                uint32_t n = abertas[i].vizinho[d];
+                if (n == NAVMESH_NONE || abertas[n].removida)
+                {
+                    borda.push_back(i);
+                    break;
+                }
+            }
+        }
+        for (size_t k = 0; k < borda.size(); ++k)
+            abertas[borda[k]].removida = true;
+    }
+    for (size_t i = 0; i < abertas.size(); ++i)
+        for (int d = 0; d < 4; ++d)
+            if (abertas[i].vizinho[d] != NAVMESH_NONE && abertas[abertas[i].vizinho[d]].removida)
+                abertas[i].vizinho[d] = NAVMESH_NONE;
+
+    // 3. Regiões conexas
+    uint32_t regioes = 0;
+    std::vector<uint32_t> pilha;
+    for (uint32_t i = 0; i < abertas.size(); ++i)
+    {
+        if (abertas[i].removida || abertas[i].regiao != NAVMESH_NONE)
+            continue;
+        abertas[i].regiao = regioes;
+        pilha.push_back(i);
+        while (!pilha.empty())
+        {
+            uint32_t a = pilha.back();
+            pilha.pop_back();
+            for (int d = 0; d < 4; ++d)
+            {
+                uint32_t n = abertas[a].vizinho[d];
+                if (n != NAVMESH_NONE && abertas[n].regiao == NAVMESH_NONE)
+                {
+                    abertas[n].regiao = regioes;
+                    pilha.push_back(n);
+                }
+            }
+        }
+        regioes += 1;
+    }
+
+    // Retângulos: origem (em células) e tamanho de cada polígono
+    struct Retangulo { int x, z, w, h; };
+    std::vector<Retangulo> retangulos;
+    std::vector<uint32_t>  celulas;
+
+    navmesh->params       = p;
+    navmesh->largura      = v.largura;
+    navmesh->profundidade = v.profundidade;
+    navmesh->num_regioes  = regioes;
+    navmesh->poligonos.clear();
+    navmesh->ligacoes.clear();
+
+    for (int z = 0; z < v.profundidade; ++z)
+        for (int x = 0; x < v.largura; ++x)
+        {
+            size_t c = x + (size_t)z * v.largura;
+            for (uint32_t i = inicio[c]; i < inicio[c+1]; ++i)
+            {
+                if (abertas[i].removida || abertas[i].poligono != NAVMESH_NONE)
+                    continue;
+
+                Retangulo r = { x, z, 0, 0 };
+                CresceRetangulo(abertas, i, &celulas, &r.w, &r.h);
+
+                uint32_t id = (uint32_t)navmesh->poligonos.size();
+                float soma = 0.0f;
+                for (size_t k = 0; k < celulas.size(); ++k)
+                {
+                    abertas[celulas[k]].poligono = id;
+                    soma += abertas[celulas[k]].y;
+                }
+
+                NavPoly poly;
+                poly.x0 = p.min.x + x * cs;
+                poly.z0 = p.min.z + z * cs;
+                poly.x1 = p.min.x + (x + r.w) * cs;
+                poly.z1 = p.min.z + (z + r.h) * cs;
+                poly.y  = p.min.y + (soma / celulas.size()) * ch;
+                poly.regiao           = abertas[i].regiao;
+                poly.primeira_ligacao = 0;
+                poly.num_ligacoes     = 0;
+                navmesh->poligonos.push_back(poly);
+                retangulos.push_back(r);
+            }
+        }
+
+    // Célula aberta do polígono "id" na coluna (x, z)
+    auto celula_do_poligono = [&](int x, int z, uint32_t id)
+    {
+        size_t c = x + (size_t)z * v.largura;
+        for (uint32_t i = inicio[c]; i < inicio[c+1]; ++i)
+            if (abertas[i].poligono == id)
+                return i;
+        return NAVMESH_NONE;
+    };
+
+    // Portais: trechos contíguos de cada lado do retângulo que dão para um
+    // mesmo polígono vizinho
+    for (uint32_t id = 0; id < navmesh->poligonos.size(); ++id)
+    {
+        NavPoly& poly = navmesh->poligonos[id];
+        const Retangulo& r = retangulos[id];
+        poly.primeira_ligacao = (uint32_t)navmesh->ligacoes.size();
+
+        for (int d = 0; d < 4; ++d)
+        {
+            // Células do lado "d" e o eixo ao longo do qual elas seguem
+            bool ao_longo_de_z = DIR_X[d] != 0;
+            int n = ao_longo_de_z ? r.h : r.w;
+            int fixo_x = d == 0 ? r.x + r.w - 1 : r.x;
+            int fixo_z = d == 1 ? r.z + r.h - 1 : r.z;
+
+            uint32_t anterior = NAVMESH_NONE;
+            int trecho = 0;
+            for (int k = 0; k <= n; ++k)
+            {
+                uint32_t vizinho = NAVMESH_NONE;
+                if (k < n)
+                {
+                    int cx = ao_longo_de_z ? fixo_x : r.x + k;
+                    int cz = ao_longo_de_z ? r.z + k : fixo_z;
+                    uint32_t a = celula_do_poligono(cx, cz, id);
+                    uint32_t b = a != NAVMESH_NONE ? abertas[a].vizinho[d] : NAVMESH_NONE;
+                    vizinho = b != NAVMESH_NONE ? abertas[b].poligono : NAVMESH_NONE;
+                }
+                if (vizinho == anterior)
+                    continue;
+
+                if (anterior != NAVMESH_NONE)
+                {
+                    const NavPoly& outro = navmesh->poligonos[anterior];
+                    float y = 0.5f * (poly.y + outro.y);
+                    float borda_x = d == 0 ? poly.x1 : poly.x0;
+                    float borda_z = d == 1 ? poly.z1 : poly.z0;
+
+                    NavLink l;
+                    if (ao_longo_de_z)
+                    {
+                        l.a = glm::vec3(borda_x, y, p.min.z + (r.z + trecho) * cs);
+                        l.b = glm::vec3(borda_x, y, p.min.z + (r.z + k) * cs);
+                    }
+                    else
+                    {
+                        l.a = glm::vec3(p.min.x + (r.x + trecho) * cs, y, borda_z);
+                        l.b = glm::vec3(p.min.x + (r.x + k) * cs, y, borda_z);
+                    }
+                    l.vizinho = anterior;
+                    navmesh->ligacoes.push_back(l);
+                }
+                anterior = vizinho;
+                trecho   = k;
+            }
+        }
+        poly.num_ligacoes = (uint32_t)navmesh->ligacoes.size() - poly.primeira_ligacao;
+    }
+
+    // Índice das colunas
+    navmesh->inicio_coluna.resize(colunas + 1);
+    navmesh->poligonos_da_coluna.clear();
+    for (size_t c = 0; c < colunas; ++c)
+    {
+        navmesh->inicio_coluna[c] = (uint32_t)navmesh->poligonos_da_coluna.size();
+        for (uint32_t i = inicio[c]; i < inicio[c+1]; ++i)
+            if (abertas[i].poligono != NAVMESH_NONE)
+                navmesh->poligonos_da_coluna.push_back(abertas[i].poligono);
+    }
+    navmesh->inicio_coluna[colunas] = (uint32_t)navmesh->poligonos_da_coluna.size();
+}
+
+// FNV-1a de 64 bits
+static uint64_t Resumo(uint64_t h, const void* dados, size_t bytes)
+{
+    const unsigned char* p = (const unsigned char*)dados;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t NavMesh_Key(const NavMeshParams& params, const glm::vec3* vertices, size_t num_vertices)
+{
+    uint64_t h = 14695981039346656037ull;
+    h = Resumo(h, &params, sizeof(params));
+    h = Resumo(h, vertices, num_vertices * sizeof(glm::vec3));
+    return h;
+}
+
+// Cabeçalho do cache. Em seguida: os polígonos, as ligações, inicio_coluna
+// e poligonos_da_coluna.
+struct NavMeshCacheHeader
+{
+    char          magic[4];     // "FCGN"
+    uint32_t      version;
+    uint64_t      chave;
+    NavMeshParams params;
+    int32_t       largura;
+    int32_t       profundidade;
+    uint32_t      num_regioes;
+    uint32_t      num_poligonos;
+    uint32_t      num_ligacoes;
+    uint32_t      num_poligonos_da_coluna;
+};
+
+static const uint32_t NAVMESH_CACHE_VERSION = 1;
+
+bool NavMesh_SaveCache(const char* filename, uint64_t chave, const NavMesh& navmesh)
+{
+    NavMeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "FCGN", 4);
+    header.version      = NAVMESH_CACHE_VERSION;
+    header.chave        = chave;
+    header.params       = navmesh.params;
+    header.largura      = navmesh.largura;
+    header.profundidade = navmesh.profundidade;
+    header.num_regioes  = navmesh.num_regioes;
+    header.num_poligonos = (uint32_t)navmesh.poligonos.size();
+    header.num_ligacoes  = (uint32_t)navmesh.ligacoes.size();
+    header.num_poligonos_da_coluna = (uint32_t)navmesh.poligonos_da_coluna.size();
+
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL)
+        return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(navmesh.poligonos.data(), sizeof(NavPoly), navmesh.poligonos.size(), f) == navmesh.poligonos.size()
+           && fwrite(navmesh.ligacoes.data(), sizeof(NavLink), navmesh.ligacoes.size(), f) == navmesh.ligacoes.size()
+           && fwrite(navmesh.inicio_coluna.data(), sizeof(uint32_t), navmesh.inicio_coluna.size(), f) == navmesh.inicio_coluna.size()
+           && fwrite(navmesh.poligonos_da_coluna.data(), sizeof(uint32_t), navmesh.poligonos_da_coluna.size(), f) == navmesh.poligonos_da_coluna.size();
+
+    fclose(f);
+    if (!ok)
+        remove(filename);
+
+    return ok;
+}
+
+// Os índices de uma malha lida do cache apontam para dentro dos vetores:
+// um arquivo corrompido com o tamanho certo não pode fazer as consultas
+// lerem fora deles
+static bool MalhaValida(const NavMesh& navmesh)
+{
+    uint32_t num_poligonos = (uint32_t)navmesh.poligonos.size();
+    uint32_t num_ligacoes  = (uint32_t)navmesh.ligacoes.size();
+    for (uint32_t i = 0; i < num_poligonos; ++i)
+    {
+        const NavPoly& poly = navmesh.poligonos[i];
+        if (poly.primeira_ligacao > num_ligacoes || poly.num_ligacoes > num_ligacoes - poly.primeira_ligacao
+         || poly.regiao >= navmesh.num_regioes)
+            return false;
+    }
+    for (uint32_t k = 0; k < num_ligacoes; ++k)
+        if (navmesh.ligacoes[k].vizinho >= num_poligonos)
+            return false;
+
+    const std::vector<uint32_t>& inicio = navmesh.inicio_coluna;
+    for (size_t c = 0; c + 1 < inicio.size(); ++c)
+        if (inicio[c] > inicio[c + 1])
+            return false;
+    if (inicio.front() != 0 || inicio.back() != navmesh.poligonos_da_coluna.size())
+        return false;
+    for (size_t i = 0; i < navmesh.poligonos_da_coluna.size(); ++i)
+        if (navmesh.poligonos_da_coluna[i] >= num_poligonos)
+            return false;
+    return true;
+}
+
+bool NavMesh_LoadCache(const char* filename, uint64_t chave, NavMesh* navmesh)
+{
+    MappedFile file;
+    if (!MappedFile_Open(&file, filename))
+        return false;
+
+    NavMeshCacheHeader header;
+    bool ok = file.size >= sizeof(header);
+    size_t colunas = 0;
+    if (ok)
+    {
+        memcpy(&header, file.data, sizeof(header));
+        ok = memcmp(header.magic, "FCGN", 4) == 0
+          && header.version == NAVMESH_CACHE_VERSION
+          && header.chave == chave
+          && header.largura > 0 && header.profundidade > 0;
+        colunas = (size_t)header.largura * header.profundidade + 1;
+    }
+    ok = ok && file.size == sizeof(header) + header.num_poligonos * sizeof(NavPoly)
+                                           + header.num_ligacoes * sizeof(NavLink)
+                                           + (colunas + header.num_poligonos_da_coluna) * sizeof(uint32_t);
+
+    if (ok)
+    {
+        const char* p = file.data + sizeof(header);
+        navmesh->params       = header.params;
+        navmesh->largura      = header.largura;
+        navmesh->profundidade = header.profundidade;
+        navmesh->num_regioes  = header.num_regioes;
+        navmesh->poligonos.resize(header.num_poligonos);
+        navmesh->ligacoes.resize(header.num_ligacoes);
+        navmesh->inicio_coluna.resize(colunas);
+        navmesh->poligonos_da_coluna.resize(header.num_poligonos_da_coluna);
+
+        memcpy(navmesh->poligonos.data(), p, header.num_poligonos * sizeof(NavPoly));
+        p += header.num_poligonos * sizeof(NavPoly);
+        memcpy(navmesh->ligacoes.data(), p, header.num_ligacoes * sizeof(NavLink));
+        p += header.num_ligacoes * sizeof(NavLink);
+        memcpy(navmesh->inicio_coluna.data(), p, colunas * sizeof(uint32_t));
+        p += colunas * sizeof(uint32_t);
+        memcpy(navmesh->poligonos_da_coluna.data(), p, header.num_poligonos_da_coluna * sizeof(uint32_t));
+        ok = MalhaValida(*navmesh);
+    }
+
+    MappedFile_Close(&file);
+    return ok;
+}
+
+uint32_t NavMesh_ClosestPoint(const NavMesh& navmesh, const glm::vec3& p, const glm::vec3& extents,
+                              glm::vec3* ponto, uint32_t regiao)
+{
+    const NavMeshParams& params = navmesh.params;
+    int x0 = std::max((int)std::floor((p.x - extents.x - params.min.x) / params.cell_size), 0);
+    int z0 = std::max((int)std::floor((p.z - extents.z - params.min.z) / params.cell_size), 0);
+    int x1 = std::min((int)std::floor((p.x + extents.x - params.min.x) / params.cell_size), navmesh.largura - 1);
+    int z1 = std::min((int)std::floor((p.z + extents.z - params.min.z) / params.cell_size), navmesh.profundidade - 1);
+
+    uint32_t melhor = NAVMESH_NONE;
+    float    melhor_d2 = 0.0f;
+    for (int z = z0; z <= z1; ++z)
+        for (int x = x0; x <= x1; ++x)
+        {
+            size_t c = x + (size_t)z * navmesh.largura;
+            for (uint32_t k = navmesh.inicio_coluna[c]; k < navmesh.inicio_coluna[c+1]; ++k)
+            {
+                uint32_t id = navmesh.poligonos_da_coluna[k];
+                const NavPoly& poly = navmesh.poligonos[id];
+                if (std::fabs(poly.y - p.y) > extents.y || (regiao != NAVMESH_NONE && poly.regiao != regiao))
+                    continue;
+
+                glm::vec3 q(glm::clamp(p.x, poly.x0, poly.x1), poly.y, glm::clamp(p.z, poly.z0, poly.z1));
+                glm::vec3 d = q - p;
+                float d2 = glm::dot(d, d);
+                if (melhor == NAVMESH_NONE || d2 < melhor_d2)
+                {
+                    melhor    = id;
+                    melhor_d2 = d2;
+                    *ponto    = q;
+                }
+            }
+        }
+    return melhor;
+}
+
+// Área (com sinal) do triângulo abc projetado no plano xz, vezes dois.
+// Positiva se c está à direita de a->b, no sentido usado pelo funil.
+static inline float Area2(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    return (c.x - a.x) * (b.z - a.z) - (b.x - a.x) * (c.z - a.z);
+}
+
+static inline bool Iguais(const glm::vec3& a, const glm::vec3& b)
+{
+    glm::vec3 d = a - b;
+    return glm::dot(d, d) < 1e-8f;
+}
+
+static void AdicionaPonto(NavMeshPath* caminho, const glm::vec3& p)
+{
+    uint32_t n = caminho->num_pontos;
+    if (n > 0 && Iguais(caminho->pontos[n - 1], p))
+        return;
+
+    // O funil pode parar em pontos alinhados ao seguir uma borda reta
+    if (n > 1)
+    {
+        const glm::vec3& a = caminho->pontos[n - 2];
+        const glm::vec3& b = caminho->pontos[n - 1];
+        if (std::fabs(Area2(a, b, p)) < 1e-4f && glm::dot(b - a, p - b) > 0.0f)
+        {
+            caminho->pontos[n - 1] = p;
+            return;
+        }
+    }
+
+    if (caminho->num_pontos == NAVMESH_MAX_PATH)
+    {
+        caminho->truncado = true;
+        return;
+    }
+    caminho->pontos[caminho->num_pontos++] = p;
+}
+
+// Algoritmo do funil sobre os portais (esquerda[i], direita[i]); o primeiro
+// e o último são o início e o fim do caminho.
+static void Funil(const glm::vec3* esquerda, const glm::vec3* direita, size_t n, NavMeshPath* caminho)
+{
+    glm::vec3 apice = esquerda[0], lado_esq = esquerda[0], lado_dir = direita[0];
+    size_t i_apice = 0, i_esq = 0, i_dir = 0;
+    AdicionaPonto(caminho, apice);
+
+    for (size_t i = 1; i < n && !caminho->truncado; ++i)
+    {
+        const glm::vec3& esq = esquerda[i];
+        const glm::vec3& dir = direita[i];
+
+        // Estreita o lado direito
+        if (Area2(apice, lado_dir, dir) <= 0.0f)
+        {
+            if (Iguais(apice, lado_dir) || Area2(apice, lado_esq, dir) > 0.0f)
+            {
+                lado_dir = dir;
+                i_dir = i;
+            }
+            else
+            {
+                // O lado direito cruzou o esquerdo: o esquerdo é um canto
+                AdicionaPonto(caminho, lado_esq);
+                apice = lado_dir = lado_esq;
+                i_apice = i_dir = i_esq;
+                i = i_apice;
+                continue;
+            }
+        }
+
+        // Estreita o lado esquerdo
+        if (Area2(apice, lado_esq, esq) >= 0.0f)
+        {
+            if (Iguais(apice, lado_esq) || Area2(apice, lado_dir, esq) < 0.0f)
+            {
+                lado_esq = esq;
+                i_esq = i;
+            }
+            else
+            {
+                AdicionaPonto(caminho, lado_dir);
+                apice = lado_esq = lado_dir;
+                i_apice = i_esq = i_dir;
+                i = i_apice;
+                continue;
+            }
+        }
+    }
+    AdicionaPonto(caminho, esquerda[n - 1]);
+}
+
+struct NoAberto
+{
+    float    f;
+    uint32_t poligono;
+
+    bool operator<(const NoAberto& o) const { return f > o.f; } // Menor "f" no topo do heap
+};
+
+bool NavMesh_FindPath(const NavMesh& navmesh, const NavMeshQuery& query, NavMeshPath* caminho)
+{
+    caminho->num_pontos  = 0;
+    caminho->comprimento = 0.0f;
+    caminho->truncado    = false;
+    caminho->nos         = 0;
+
+    glm::vec3 inicio, fim;
+    uint32_t origem  = NavMesh_ClosestPoint(navmesh, query.inicio, query.extents, &inicio);
+    uint32_t destino = NavMesh_ClosestPoint(navmesh, query.fim, query.extents, &fim);
+    if (origem == NAVMESH_NONE || destino == NAVMESH_NONE
+     || navmesh.poligonos[origem].regiao != navmesh.poligonos[destino].regiao)
+        return false;
+
+    Arena* rascunho = Arena_Scratch();
+    ArenaScope escopo(rascunho);
+
+    // A*: o custo de entrar em um polígono é medido até o meio do portal
+    // por onde se entra, que também é o ponto de partida para os vizinhos
+    size_t n = navmesh.poligonos.size();
+    float*     g       = Arena_New<float>(rascunho, n);
+    uint32_t*  pai     = Arena_New<uint32_t>(rascunho, n);
+    uint32_t*  ligacao = Arena_New<uint32_t>(rascunho, n);   // Por onde se chegou do pai
+    glm::vec3* entrada = Arena_New<glm::vec3>(rascunho, n);
+    uint8_t*   fechado = Arena_New<uint8_t>(rascunho, n);
+    NoAberto*  heap    = Arena_New<NoAberto>(rascunho, navmesh.ligacoes.size() + 1);
+    size_t     abertos = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        g[i] = -1.0f;
+        fechado[i] = 0;
+    }
+
+    g[origem]       = 0.0f;
+    pai[origem]     = NAVMESH_NONE;
+    entrada[origem] = inicio;
+    heap[abertos++] = { glm::distance(inicio, fim), origem };
+
+    bool encontrado = false;
+    while (abertos > 0)
+    {
+        std::pop_heap(heap, heap + abertos);
+        uint32_t u = heap[--abertos].poligono;
+        if (fechado[u])
+            continue;
+        fechado[u] = 1;
+        caminho->nos += 1;
+        if (u == destino)
+        {
+            encontrado = true;
+            break;
+        }
+
+        const NavPoly& poly = navmesh.poligonos[u];
+        for (uint32_t k = poly.primeira_ligacao; k < poly.primeira_ligacao + poly.num_ligacoes; ++k)
+        {
+            const NavLink& l = navmesh.ligacoes[k];
+            uint32_t w = l.vizinho;
+            if (fechado[w])
+                continue;
+
+            glm::vec3 meio = 0.5f * (l.a + l.b);
+            float custo = g[u] + glm::distance(entrada[u], meio);
+            if (w == destino)
+                custo += glm::distance(meio, fim);
+            if (g[w] >= 0.0f && custo >= g[w])
+                continue;
+
+            g[w]       = custo;
+            pai[w]     = u;
+            ligacao[w] = k;
+            entrada[w] = meio;
+            heap[abertos++] = { custo + glm::distance(meio, fim), w };
+            std::push_heap(heap, heap + abertos);
+        }
+    }
+    if (!encontrado)
+        return false;
+
+    // Corredor de polígonos, do destino para a origem
+    size_t num_portais = 0;
+    uint32_t* corredor = Arena_New<uint32_t>(rascunho, n);
+    for (uint32_t u = destino; u != origem; u = pai[u])
+        corredor[num_portais++] = u;
+
+    glm::vec3* esquerda = Arena_New<glm::vec3>(rascunho, num_portais + 2);
+    glm::vec3* direita  = Arena_New<glm::vec3>(rascunho, num_portais + 2);
+    esquerda[0] = direita[0] = inicio;
+    for (size_t i = 0; i < num_portais; ++i)
+    {
+        uint32_t para = corredor[num_portais - 1 - i];
+        const NavLink& l = navmesh.ligacoes[ligacao[para]];
+
+        // Orienta o portal pela direção de travessia, do pai para o
+        // vizinho; só a componente normal ao portal importa
+        const NavPoly& a = navmesh.poligonos[pai[para]];
+        const NavPoly& b = navmesh.poligonos[para];
+        glm::vec3 dir(0.5f * (b.x0 + b.x1 - a.x0 - a.x1), 0.0f, 0.5f * (b.z0 + b.z1 - a.z0 - a.z1));
+        glm::vec3 meio = 0.5f * (l.a + l.b);
+        if (dir.x * (l.a.z - meio.z) - dir.z * (l.a.x - meio.x) < 0.0f)
+        {
+            direita[i + 1]  = l.a;
+            esquerda[i + 1] = l.b;
+        }
+        else
+        {
+            direita[i + 1]  = l.b;
+            esquerda[i + 1] = l.a;
+        }
+    }
+    esquerda[num_portais + 1] = direita[num_portais + 1] = fim;
+
+    Funil(esquerda, direita, num_portais + 2, caminho);
+
+    for (uint32_t i = 1; i < caminho->num_pontos; ++i)
+        caminho->comprimento += glm::distance(caminho->pontos[i - 1], caminho->pontos[i]);
+    return true;
+}
+
+void NavMesh_FindPaths(const NavMesh& navmesh, const NavMeshQuery* queries, size_t n, NavMeshPath* caminhos)
+{
+    auto responde = [&](size_t a, size_t b)
+    {
+        for (size_t i = a; i < b; ++i)
+        {
+            std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+            NavMesh_FindPath(navmesh, queries[i], &caminhos[i]);
+            caminhos[i].microssegundos = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - inicio).count();
+        }
+    };
+
+    if (n < NAVMESH_PARALLEL_THRESHOLD || Jobs_NumThreads() < 2)
+        responde(0, n);
+    else
+        Jobs_ParallelFor(0, n, 1, responde);
+
+    g_Stats.batches += 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        g_Stats.queries  += 1;
+        g_Stats.failed   += caminhos[i].num_pontos == 0;
+        g_Stats.nodes    += caminhos[i].nos;
+        g_Stats.total_us += caminhos[i].microssegundos;
+        g_Stats.max_us    = std::max(g_Stats.max_us, (double)caminhos[i].microssegundos);
+    }
+}
+
+glm::vec3 NavMesh_PathPoint(const NavMeshPath& caminho, float t)
+{
+    if (caminho.num_pontos == 0)
+        return glm::vec3(0.0f);
+
+    float resta = glm::clamp(t, 0.0f, 1.0f) * caminho.comprimento;
+    for (uint32_t i = 1; i < caminho.num_pontos; ++i)
+    {
+        float trecho = glm::distance(caminho.pontos[i - 1], caminho.pontos[i]);
+        if (resta <= trecho && trecho > 0.0f)
+            return caminho.pontos[i - 1] + (caminho.pontos[i] - caminho.pontos[i - 1]) * (resta / trecho);
+        resta -= trecho;
+    }
+    return caminho.pontos[caminho.num_pontos - 1];
+}
+
+NavMeshStats NavMesh_Stats()
+{
+    return g_Stats;
+}
@@ -0,0 +1,201 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NORMALS_SSE 1
+#endif
+
+#include "normals.h"
+#include "jobs.h"
+
+NormalsWeight g_NormalsWeight      = NORMALS_AREA;
+float         g_NormalsCreaseAngle = NORMALS_NO_CREASE;
+
+// Elementos (triângulos, vértices ou quinas) por tarefa
+#define NORMALS_GRAO 4096
+
+static inline glm::vec3 Posicao(const float* positions, size_t stride, uint32_t v)
+{
+    const float* p = positions + stride * v;
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+static inline glm::vec3 Normaliza(const glm::vec3& n)
+{
+    float comprimento = std::sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
+    return comprimento > 0.0f ? n / comprimento : glm::vec3(0.0f);
+}
+
+// (b - a) x (c - a), sem normalizar: o comprimento é o dobro da área
+static inline glm::vec3 NormalDoTriangulo(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    glm::vec3 u = b - a;
+    glm::vec3 v = c - a;
+    return glm::vec3(u.y*v.z - u.z*v.y, u.z*v.x - u.x*v.z, u.x*v.y - u.y*v.x);
+}
+
+#ifdef NORMALS_SSE
+// O mesmo para quatro triângulos de uma vez: cada registrador guarda uma
+// coordenada dos quatro, e as operações são as mesmas da versão escalar.
+static inline void NormaisDe4Triangulos(const glm::vec3 p[4][3], glm::vec3 saida[4])
+{
+    __m128 ax = _mm_setr_ps(p[0][0].x, p[1][0].x, p[2][0].x, p[3][0].x);
+    __m128 ay = _mm_setr_ps(p[0][0].y, p[1][0].y, p[2][0].y, p[3][0].y);
+    __m128 az = _mm_setr_ps(p[0][0].z, p[1][0].z, p[2][0].z, p[3][0].z);
+
+    __m128 ux = _mm_sub_ps(_mm_setr_ps(p[0][1].x, p[1][1].x, p[2][1].x, p[3][1].x), ax);
+    __m128 uy = _mm_sub_ps(_mm_setr_ps(p[0][1].y, p[1][1].y, p[2][1].y, p[3][1].y), ay);
+    __m128 uz = _mm_sub_ps(_mm_setr_ps(p[0][1].z, p[1][1].z, p[2][1].z, p[3][1].z), az);
+
+    __m128 vx = _mm_sub_ps(_mm_setr_ps(p[0][2].x, p[1][2].x, p[2][2].x, p[3][2].x), ax);
+    __m128 vy = _mm_sub_ps(_mm_setr_ps(p[0][2].y, p[1][2].y, p[2][2].y, p[3][2].y), ay);
+    __m128 vz = _mm_sub_ps(_mm_setr_ps(p[0][2].z, p[1][2].z, p[2][2].z, p[3][2].z), az);
+
+    float nx[4], ny[4], nz[4];
+    _mm_storeu_ps(nx, _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(uz, vy)));
+    _mm_storeu_ps(ny, _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(ux, vz)));
+    _mm_storeu_ps(nz, _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(uy, vx)));
+
+    for (int k = 0; k < 4; ++k)
+        saida[k] = glm::vec3(nx[k], ny[k], nz[k]);
+}
+#endif
+
+// Ângulo entre duas arestas que saem do mesmo vértice
+static inline float Angulo(const glm::vec3& e1, const glm::vec3& e2)
+{
+    float comprimentos = std::sqrt(glm::dot(e1, e1) * glm::dot(e2, e2));
+    if (comprimentos <= 0.0f)
+        return 0.0f;
+    return std::acos(std::max(-1.0f, std::min(1.0f, glm::dot(e1, e2) / comprimentos)));
+}
+
+void Normals_Compute(const float* positions, size_t stride, size_t num_vertices,
+                     const uint32_t* vertices, size_t num_corners,
+                     float* normals, size_t normals_stride,
+                     NormalsWeight weight, float crease_angle)
+{
+    size_t num_triangulos = num_corners / 3;
+    size_t num_quinas     = 3 * num_triangulos;
+
+    bool vincos = crease_angle < 3.14159265f;
+    bool angulo = weight == NORMALS_ANGLE;
+
+    // 1. Normais dos triângulos; as unitárias e os ângulos das quinas apenas
+    //    quando usados.
+    std::vector<glm::vec3> faces(num_triangulos);
+    std::vector<glm::vec3> unitarias(vincos || angulo ? num_triangulos : 0);
+    std::vector<float>     angulos(angulo ? num_quinas : 0);
+
+    Jobs_ParallelFor(0, num_triangulos, NORMALS_GRAO, [&](size_t a, size_t b)
+    {
+        size_t t = a;
+#ifdef NORMALS_SSE
+        for (; t + 4 <= b; t += 4)
+        {
+            glm::vec3 p[4][3];
+            for (int k = 0; k < 4; ++k)
+                for (int j = 0; j < 3; ++j)
+                    p[k][j] = Posicao(positions, stride, vertices[3*(t + k) + j]);
+            NormaisDe4Triangulos(p, &faces[t]);
+        }
+#endif
+        for (; t < b; ++t)
+            faces[t] = NormalDoTriangulo(Posicao(positions, stride, vertices[3*t + 0]),
+                                         Posicao(positions, stride, vertices[3*t + 1]),
+                                         Posicao(positions, stride, vertices[3*t + 2]));
+
+        if (!unitarias.empty())
+            for (t = a; t < b; ++t)
+                unitarias[t] = Normaliza(faces[t]);
+
+        if (angulo)
+        {
+            for (t = a; t < b; ++t)
+            {
+                glm::vec3 p[3];
+                for (int j = 0; j < 3; ++j)
+                    p[j] = Posicao(positions, stride, vertices[3*t + j]);
+                for (int j = 0; j < 3; ++j)
+                    angulos[3*t + j] = Angulo(p[(j + 1) % 3] - p[j], p[(j + 2) % 3] - p[j]);
+            }
+        }
+    });
+
+    // Contribuição da quina r para a normal do seu vértice
+    auto contribuicao = [&](uint32_t r) -> glm::vec3
+    {
+        return angulo ? unitarias[r / 3] * angulos[r] : faces[r / 3];
+    };
+
+    // 2. Normal de cada vértice, com todos os seus triângulos. A soma é uma
+    //    única passada sobre as quinas, barata demais para compensar uma
+    //    divisão entre threads.
+    std::vector<glm::vec3> suaves(num_vertices, glm::vec3(0.0f));
+    for (size_t q = 0; q < num_quinas; ++q)
+        suaves[vertices[q]] += contribuicao((uint32_t)q);
+
+    Jobs_ParallelFor(0, num_vertices, NORMALS_GRAO, [&](size_t a, size_t b)
+    {
+        for (size_t v = a; v < b; ++v)
+            suaves[v] = Normaliza(suaves[v]);
+    });
+
+    // 3. Com vincos, cada quina soma apenas parte dos triângulos do vértice:
+    //    a adjacência vértice -> quinas, em ordem crescente de quina, permite
+    //    que cada quina leia os triângulos vizinhos sem escrever em posições
+    //    compartilhadas.
+    std::vector<uint32_t> inicio;
+    std::vector<uint32_t> quinas;
+    if (vincos)
+    {
+        inicio.assign(num_vertices + 1, 0);
+        for (size_t q = 0; q < num_quinas; ++q)
+            inicio[vertices[q] + 1] += 1;
+        for (size_t v = 0; v < num_vertices; ++v)
+            inicio[v + 1] += inicio[v];
+
+        quinas.resize(num_quinas);
+        std::vector<uint32_t> proxima(inicio.begin(), inicio.end() - 1);
+        for (size_t q = 0; q < num_quinas; ++q)
+            quinas[proxima[vertices[q]]++] = (uint32_t)q;
+    }
+
+    // 4. Normal de cada quina: a do vértice, ou, com vincos, a dos triângulos
+    //    do vértice próximos do triângulo da quina
+    float cos_vinco = std::cos(crease_angle);
+    Jobs_ParallelFor(0, num_quinas, NORMALS_GRAO, [&](size_t a, size_t b)
+    {
+        for (size_t q = a; q < b; ++q)
+        {
+            uint32_t v = vertices[q];
+            glm::vec3 n = suaves[v];
+
+            if (vincos)
+            {
+                const glm::vec3& propria = unitarias[q / 3];
+                glm::vec3 soma(0.0f);
+                for (uint32_t k = inicio[v]; k < inicio[v + 1]; ++k)
+                {
+                    uint32_t r = quinas[k];
+                    if (glm::dot(unitarias[r / 3], propria) >= cos_vinco)
+                        soma += contribuicao(r);
+                }
+
+                // Triângulo degenerado: fica a normal do vértice
+                if (soma != glm::vec3(0.0f))
+                    n = Normaliza(soma);
+            }
+
+            float* saida = normals + normals_stride * q;
+            saida[0] = n.x;
+            saida[1] = n.y;
+            saida[2] = n.z;
+        }
+    });
+}
@@ -0,0 +1,1038 @@
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <algorithm>
+
+#include "objparser.h"
+#include "mappedfile.h"
+#include "jobs.h"
+
+size_t g_ObjParserChunkSize = 256u * 1024u;
+
+#define ESPACO(c)  ((c) == ' ' || (c) == '\t')
+#define DIGITO(c)  ((unsigned int)((c) - '0') < 10u)
+#define FIM_DE_LINHA(c) ((c) == '\r' || (c) == '\n' || (c) == '\0')
+
+// Potências usadas na conversão de números de tinyobj: 10^-k e 5^e
+#define OBJPARSER_POTENCIAS_10 32
+#define OBJPARSER_POTENCIAS_5  64 // e em [-64, 64]
+
+struct Potencias
+{
+    double dez[OBJPARSER_POTENCIAS_10];
+    double cinco[2 * OBJPARSER_POTENCIAS_5 + 1];
+
+    Potencias()
+    {
+        for (int k = 0; k < OBJPARSER_POTENCIAS_10; ++k)
+            dez[k] = pow(10.0, -k);
+        for (int e = -OBJPARSER_POTENCIAS_5; e <= OBJPARSER_POTENCIAS_5; ++e)
+            cinco[e + OBJPARSER_POTENCIAS_5] = pow(5.0, e);
+    }
+};
+
+static const Potencias g_Potencias;
+
+static inline double DezALaMenos(int k)
+{
+    return k < OBJPARSER_POTENCIAS_10 ? g_Potencias.dez[k] : pow(10.0, -k);
+}
+
+static inline double CincoA(int e)
+{
+    return (e >= -OBJPARSER_POTENCIAS_5 && e <= OBJPARSER_POTENCIAS_5)
+         ? g_Potencias.cinco[e + OBJPARSER_POTENCIAS_5] : pow(5.0, e);
+}
+
+// Mesmo algoritmo (e mesmas operações) de tryParseDouble() de tinyobj,
+// lendo no máximo até "fim"
+static bool LeDouble(const char* s, const char* fim, double* resultado)
+{
+    double mantissa = 0.0;
+    int expoente = 0;
+    char sinal = '+';
+    char sinal_expoente = '+';
+    const char* p = s;
+    int lidos = 0;
+    bool antes_do_fim = false;
+
+    if (s >= fim)
+        return false;
+
+    if (*p == '+' || *p == '-')
+        sinal = *p++;
+    else if (!DIGITO(*p))
+        return false;
+
+    // Parte inteira
+    antes_do_fim = p != fim;
+    while (antes_do_fim && DIGITO(*p))
+    {
+        mantissa *= 10;
+        mantissa += static_cast<int>(*p - '0');
+        p++;
+        lidos++;
+        antes_do_fim = p != fim;
+    }
+    if (lidos == 0)
+        return false;
+    if (!antes_do_fim)
+        goto monta;
+
+    // Parte decimal
+    if (*p == '.')
+    {
+        p++;
+        lidos = 1;
+        antes_do_fim = p != fim;
+        while (antes_do_fim && DIGITO(*p))
+        {
+            mantissa += static_cast<int>(*p - '0') * DezALaMenos(lidos);
+            lidos++;
+            p++;
+            antes_do_fim = p != fim;
+        }
+    }
+    else if (*p != 'e' && *p != 'E')
+        goto monta;
+
+    if (!antes_do_fim)
+        goto monta;
+
+    // Expoente
+    if (*p == 'e' || *p == 'E')
+    {
+        p++;
+        antes_do_fim = p != fim;
+        if (antes_do_fim && (*p == '+' || *p == '-'))
+            sinal_expoente = *p++;
+        else if (!antes_do_fim || !DIGITO(*p))
+            return false;
+
+        lidos = 0;
+        antes_do_fim = p != fim;
+        while (antes_do_fim && DIGITO(*p))
+        {
+            expoente *= 10;
+            expoente += static_cast<int>(*p - '0');
+            p++;
+            lidos++;
+            antes_do_fim = p != fim;
+        }
+        expoente *= (sinal_expoente == '+' ? 1 : -1);
+        if (lidos == 0)
+            return false;
+    }
+
+monta:
+    *resultado = (sinal == '+' ? 1 : -1) * ldexp(mantissa * CincoA(expoente), expoente);
+    return true;
+}
+
+// As funções abaixo seguem as de tinyobj, mas a linha termina em "e" em
+// vez de em '\0'.
+
+static inline const char* PulaEspacos(const char* p, const char* e)
+{
+    while (p < e && ESPACO(*p))
+        ++p;
+    return p;
+}
+
+// strcspn(p, "/ \t\r")
+static inline const char* AteDelimitador(const char* p, const char* e)
+{
+    while (p < e && *p != '/' && !ESPACO(*p) && *p != '\r')
+        ++p;
+    return p;
+}
+
+static inline float LeFloat(const char** p, const char* e, double padrao = 0.0)
+{
+    const char* s = PulaEspacos(*p, e);
+    const char* fim = s;
+    while (fim < e && !ESPACO(*fim) && *fim != '\r')
+        ++fim;
+
+    double valor = padrao;
+    LeDouble(s, fim, &valor);
+    *p = fim;
+    return static_cast<float>(valor);
+}
+
+// atoi()
+static inline int LeInteiro(const char* p, const char* e)
+{
+    while (p < e && (ESPACO(*p) || *p == '\r' || *p == '\v' || *p == '\f'))
+        ++p;
+    bool negativo = false;
+    if (p < e && (*p == '+' || *p == '-'))
+        negativo = *p++ == '-';
+    int v = 0;
+    while (p < e && DIGITO(*p))
+        v = 10 * v + (*p++ - '0');
+    return negativo ? -v : v;
+}
+
+// sscanf(p, "%s", ...)
+static std::string PrimeiraPalavra(const char* p, const char* e)
+{
+    while (p < e && isspace((unsigned char)*p))
+        ++p;
+    const char* s = p;
+    while (p < e && !isspace((unsigned char)*p))
+        ++p;
+    return std::string(s, p);
+}
+
+// Índices de um vértice da face como escritos no arquivo
+struct VerticeBruto
+{
+    int v, vn, vt;
+    int presentes; // 2 = vn, 4 = vt
+};
+
+static inline VerticeBruto LeVerticeBruto(const char** p, const char* e)
+{
+    VerticeBruto vi;
+    vi.v = vi.vn = vi.vt = 0;
+    vi.presentes = 0;
+
+    vi.v = LeInteiro(*p, e);
+    *p = AteDelimitador(*p, e);
+    if (*p >= e || **p != '/')
+        return vi;
+    ++*p;
+
+    // i//k
+    if (*p < e && **p == '/')
+    {
+        ++*p;
+        vi.vn = LeInteiro(*p, e);
+        vi.presentes |= 2;
+        *p = AteDelimitador(*p, e);
+        return vi;
+    }
+
+    // i/j/k ou i/j
+    vi.vt = LeInteiro(*p, e);
+    vi.presentes |= 4;
+    *p = AteDelimitador(*p, e);
+    if (*p >= e || **p != '/')
+        return vi;
+
+    ++*p;
+    vi.vn = LeInteiro(*p, e);
+    vi.presentes |= 2;
+    *p = AteDelimitador(*p, e);
+    return vi;
+}
+
+// Palavras de uma linha "g"; a primeira é o próprio "g"
+static void NomesDoGrupo(const char* t, const char* e, std::vector<std::string>* nomes)
+{
+    nomes->clear();
+    while (t < e && !FIM_DE_LINHA(*t))
+    {
+        t = PulaEspacos(t, e);
+        const char* s = t;
+        while (t < e && !ESPACO(*t) && *t != '\r')
+            ++t;
+        nomes->push_back(std::string(s, t));
+        while (t < e && (ESPACO(*t) || *t == '\r'))
+            ++t;
+    }
+}
+
+// Vértice de uma face. Os índices negativos (relativos ao fim das listas)
+// são resolvidos com as contagens do próprio pedaço e marcados em
+// "relativo", para somar depois as contagens dos pedaços anteriores.
+struct VerticeDaFace
+{
+    int v, vn, vt;
+    int relativo; // 1 = v, 2 = vn, 4 = vt
+};
+
+static inline int CorrigeIndice(int indice, int n, int bit, int* relativo)
+{
+    if (indice > 0)
+        return indice - 1;
+    if (indice == 0)
+        return 0;
+    *relativo |= bit;
+    return n + indice;
+}
+
+static inline VerticeDaFace LeVertice(const char** p, const char* e, int nv, int nvn, int nvt)
+{
+    VerticeBruto bruto = LeVerticeBruto(p, e);
+
+    VerticeDaFace vi;
+    vi.relativo = 0;
+    vi.v  = CorrigeIndice(bruto.v, nv, 1, &vi.relativo);
+    vi.vn = (bruto.presentes & 2) ? CorrigeIndice(bruto.vn, nvn, 2, &vi.relativo) : -1;
+    vi.vt = (bruto.presentes & 4) ? CorrigeIndice(bruto.vt, nvt, 4, &vi.relativo) : -1;
+    return vi;
+}
+
+enum TipoDeLinha
+{
+    OBJ_IGNORADA, // Vazia, comentário ou comando desconhecido
+    OBJ_VERTICE,  // "v"
+    OBJ_NORMAL,   // "vn"
+    OBJ_TEXCOORD, // "vt"
+    OBJ_FACE,     // "f"
+    OBJ_USEMTL,
+    OBJ_MTLLIB,
+    OBJ_GRUPO,    // "g"
+    OBJ_OBJETO,   // "o"
+    OBJ_TAG       // "t"
+};
+
+static inline bool Comeca(const char* t, const char* e, const char* comando, size_t n)
+{
+    return (size_t)(e - t) > n && strncmp(t, comando, n) == 0 && ESPACO(t[n]);
+}
+
+// Lê a próxima linha de [*p, fim): "t" aponta para o comando (sem os espaços
+// iniciais) e "e" para o fim da linha (sem '\r' e '\n'). Retorna o tipo da
+// linha, na mesma ordem de testes de tinyobj.
+static inline bool ProximaLinha(const char** p, const char* fim, const char** t, const char** e, TipoDeLinha* tipo)
+{
+    if (*p >= fim)
+        return false;
+
+    const char* linha = *p;
+    const char* nl = (const char*)memchr(linha, '\n', fim - linha);
+    *e = nl != NULL ? nl : fim;
+    *p = nl != NULL ? nl + 1 : fim;
+
+    if (*e > linha && (*e)[-1] == '\r')
+        --*e;
+
+    *t = PulaEspacos(linha, *e);
+    const char* c = *t;
+    if (c == *e || *c == '#' || *c == '\0')
+    {
+        *tipo = OBJ_IGNORADA;
+        return true;
+    }
+
+    char c1 = c + 1 < *e ? c[1] : '\0';
+    char c2 = c + 2 < *e ? c[2] : '\0';
+
+    if (c[0] == 'v' && ESPACO(c1))
+        *tipo = OBJ_VERTICE;
+    else if (c[0] == 'v' && c1 == 'n' && ESPACO(c2))
+        *tipo = OBJ_NORMAL;
+    else if (c[0] == 'v' && c1 == 't' && ESPACO(c2))
+        *tipo = OBJ_TEXCOORD;
+    else if (c[0] == 'f' && ESPACO(c1))
+        *tipo = OBJ_FACE;
+    else if (Comeca(c, *e, "usemtl", 6))
+        *tipo = OBJ_USEMTL;
+    else if (Comeca(c, *e, "mtllib", 6))
+        *tipo = OBJ_MTLLIB;
+    else if (c[0] == 'g' && ESPACO(c1))
+        *tipo = OBJ_GRUPO;
+    else if (c[0] == 'o' && ESPACO(c1))
+        *tipo = OBJ_OBJETO;
+    else if (c[0] == 't' && ESPACO(c1))
+        *tipo = OBJ_TAG;
+    else
+        *tipo = OBJ_IGNORADA;
+    return true;
+}
+
+// Divide [inicio, fim) em pedaços de cerca de g_ObjParserChunkSize bytes,
+// terminados em fim de linha. O pedaço i é [limites[i], limites[i+1]).
+static void DivideEmPedacos(const char* inicio, const char* fim, std::vector<const char*>* limites)
+{
+    limites->clear();
+    limites->push_back(inicio);
+    for (const char* p = inicio; p < fim; )
+    {
+        const char* q = p + std::min((size_t)(fim - p), std::max(g_ObjParserChunkSize, (size_t)1));
+        if (q < fim)
+        {
+            const char* nl = (const char*)memchr(q - 1, '\n', fim - (q - 1));
+            q = nl != NULL ? nl + 1 : fim;
+        }
+        limites->push_back(q);
+        p = q;
+    }
+}
+
+// Comando que muda o estado da leitura, com as contagens do pedaço no
+// momento em que apareceu
+struct ComandoObj
+{
+    TipoDeLinha tipo;
+    size_t      poligonos;
+    size_t      faces;
+    size_t      indices;
+    const char* inicio; // Linha, sem os espaços iniciais
+    const char* fim;
+};
+
+struct PedacoObj
+{
+    const char* inicio;
+    const char* fim;
+
+    std::vector<float>             v;
+    std::vector<float>             vn;
+    std::vector<float>             vt;
+    std::vector<tinyobj::index_t>  indices;
+    std::vector<unsigned char>     num_face_vertices;
+    size_t                         poligonos; // Faces do arquivo (antes da triangulação)
+    std::vector<size_t>            relativos; // 3*índice + componente (0 = v, 1 = vn, 2 = vt)
+    std::vector<ComandoObj>        comandos;
+
+    size_t base_v, base_vn, base_vt; // Floats dos pedaços anteriores
+};
+
+static inline void EmiteVertice(PedacoObj* pedaco, const VerticeDaFace& vi)
+{
+    size_t q = pedaco->indices.size();
+    tinyobj::index_t idx;
+    idx.vertex_index   = vi.v;
+    idx.normal_index   = vi.vn;
+    idx.texcoord_index = vi.vt;
+    pedaco->indices.push_back(idx);
+
+    if (vi.relativo & 1) pedaco->relativos.push_back(3 * q + 0);
+    if (vi.relativo & 2) pedaco->relativos.push_back(3 * q + 1);
+    if (vi.relativo & 4) pedaco->relativos.push_back(3 * q + 2);
+}
+
+static void LePedaco(PedacoObj* pedaco, bool triangulate)
+{
+    std::vector<VerticeDaFace> face;
+
+    const char* p = pedaco->inicio;
+    const char* t;
+    const char* e;
+    TipoDeLinha tipo;
+    while (ProximaLinha(&p, pedaco->fim, &t, &e, &tipo))
+    {
+        switch (tipo)
+        {
+        case OBJ_IGNORADA:
+            break;
+
+        case OBJ_VERTICE:
+        case OBJ_NORMAL:
+        {
+            std::vector<float>& destino = tipo == OBJ_VERTICE ? pedaco->v : pedaco->vn;
+            t += tipo == OBJ_VERTICE ? 2 : 3;
+            float x = LeFloat(&t, e);
+            float y = LeFloat(&t, e);
+            float z = LeFloat(&t, e);
+            destino.push_back(x);
+            destino.push_back(y);
+            destino.push_back(z);
+            break;
+        }
+
+        case OBJ_TEXCOORD:
+        {
+            t += 3;
+            float x = LeFloat(&t, e);
+            float y = LeFloat(&t, e);
+            pedaco->vt.push_back(x);
+            pedaco->vt.push_back(y);
+            break;
+        }
+
+        case OBJ_FACE:
+        {
+            t = PulaEspacos(t + 2, e);
+
+            face.clear();
+            while (t < e && !FIM_DE_LINHA(*t))
+            {
+                face.push_back(LeVertice(&t, e, (int)(pedaco->v.size() / 3), (int)(pedaco->vn.size() / 3),
+                                         (int)(pedaco->vt.size() / 2)));
+                while (t < e && (ESPACO(*t) || *t == '\r'))
+                    ++t;
+            }
+
+            pedaco->poligonos += 1;
+            size_t n = face.size();
+            if (triangulate)
+            {
+                // Leque de triângulos
+                for (size_t k = 2; k < n; ++k)
+                {
+                    EmiteVertice(pedaco, face[0]);
+                    EmiteVertice(pedaco, face[k - 1]);
+                    EmiteVertice(pedaco, face[k]);
+                    pedaco->num_face_vertices.push_back(3);
+                }
+            }
+            else
+            {
+                for (size_t k = 0; k < n; ++k)
+                    EmiteVertice(pedaco, face[k]);
+                pedaco->num_face_vertices.push_back(static_cast<unsigned char>(n));
+            }
+            break;
+        }
+
+        default:
+        {
+            ComandoObj comando;
+            comando.tipo      = tipo;
+            comando.poligonos = pedaco->poligonos;
+            comando.faces     = pedaco->num_face_vertices.size();
+            comando.indices   = pedaco->indices.size();
+            comando.inicio    = t;
+            comando.fim       = e;
+            pedaco->comandos.push_back(comando);
+            break;
+        }
+        }
+    }
+}
+
+// Linha "t nome i/f/s ...", como em tinyobj
+static tinyobj::tag_t LeTag(const char* inicio, const char* fim)
+{
+    std::string linha(inicio, fim);
+    const char* e = linha.c_str() + linha.size();
+    const char* token = linha.c_str() + 2;
+
+    tinyobj::tag_t tag;
+    tag.name = PrimeiraPalavra(token, e);
+    token = std::min(token + tag.name.size() + 1, e);
+
+    int num_ints = 0, num_floats = 0, num_strings = 0;
+    num_ints = atoi(token);
+    token += strcspn(token, "/ \t\r");
+    if (token[0] == '/')
+    {
+        token++;
+        num_floats = atoi(token);
+        token += strcspn(token, "/ \t\r");
+        if (token[0] == '/')
+        {
+            token++;
+            num_strings = atoi(token);
+            token = std::min(token + strcspn(token, "/ \t\r") + 1, e);
+        }
+    }
+
+    tag.intValues.resize(static_cast<size_t>(std::max(num_ints, 0)));
+    for (size_t i = 0; i < tag.intValues.size(); ++i)
+    {
+        tag.intValues[i] = atoi(token);
+        token = std::min(token + strcspn(token, "/ \t\r") + 1, e);
+    }
+
+    tag.floatValues.resize(static_cast<size_t>(std::max(num_floats, 0)));
+    for (size_t i = 0; i < tag.floatValues.size(); ++i)
+    {
+        tag.floatValues[i] = LeFloat(&token, e);
+        token = std::min(token + strcspn(token, "/ \t\r") + 1, e);
+    }
+
+    tag.stringValues.resize(static_cast<size_t>(std::max(num_strings, 0)));
+    for (size_t i = 0; i < tag.stringValues.size(); ++i)
+    {
+        tag.stringValues[i] = PrimeiraPalavra(token, e);
+        token = std::min(token + tag.stringValues[i].size() + 1, e);
+    }
+    return tag;
+}
+
+// Faces consecutivas de um pedaço com o mesmo material
+struct TrechoObj
+{
+    size_t pedaco;
+    size_t face_inicio, face_fim;
+    size_t indice_inicio, indice_fim;
+    int    material;
+
+    size_t destino_faces; // Posição na shape
+    size_t destino_indices;
+    size_t shape;
+};
+
+struct ShapeObj
+{
+    std::string                 nome;
+    std::vector<tinyobj::tag_t> tags;
+    std::vector<TrechoObj>      trechos;
+};
+
+// Posição da leitura: o pedaço e as contagens dentro dele
+struct PosicaoObj
+{
+    size_t pedaco;
+    size_t poligonos;
+    size_t faces;
+    size_t indices;
+};
+
+// Estado reproduzido na ordem do arquivo, como em tinyobj::LoadObj()
+struct LeituraObj
+{
+    const std::vector<PedacoObj>* pedacos;
+
+    std::string                 nome;
+    int                         material;
+    std::map<std::string, int>  material_map;
+    std::vector<tinyobj::tag_t> tags;
+
+    ShapeObj              shape;
+    PosicaoObj            grupo; // Início das faces ainda não exportadas ("faceGroup")
+    std::vector<ShapeObj> prontas;
+};
+
+// exportFaceGroupToShape(): as faces entre o início do grupo e "ate" vão
+// para a shape atual com o material atual
+static bool Exporta(LeituraObj* l, const PosicaoObj& ate)
+{
+    const std::vector<PedacoObj>& pedacos = *l->pedacos;
+
+    size_t poligonos = 0;
+    for (size_t c = l->grupo.pedaco; c <= ate.pedaco; ++c)
+        poligonos += (c == ate.pedaco ? ate.poligonos : pedacos[c].poligonos)
+                   - (c == l->grupo.pedaco ? l->grupo.poligonos : 0);
+    if (poligonos == 0)
+        return false;
+
+    for (size_t c = l->grupo.pedaco; c <= ate.pedaco; ++c)
+    {
+        TrechoObj trecho;
+        trecho.pedaco        = c;
+        trecho.face_inicio   = c == l->grupo.pedaco ? l->grupo.faces : 0;
+        trecho.face_fim      = c == ate.pedaco ? ate.faces : pedacos[c].num_face_vertices.size();
+        trecho.indice_inicio = c == l->grupo.pedaco ? l->grupo.indices : 0;
+        trecho.indice_fim    = c == ate.pedaco ? ate.indices : pedacos[c].indices.size();
+        trecho.material      = l->material;
+        if (trecho.face_fim > trecho.face_inicio)
+            l->shape.trechos.push_back(trecho);
+    }
+
+    l->shape.nome = l->nome;
+    l->shape.tags = l->tags;
+    return true;
+}
+
+bool ObjParser_Load(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                    std::vector<tinyobj::material_t>* materials, std::string* err,
+                    const char* filename, const char* mtl_basepath, bool triangulate)
+{
+    MappedFile arquivo;
+    if (!MappedFile_Open(&arquivo, filename))
+    {
+        // Arquivo inexistente ou vazio: tinyobj dá a mesma mensagem de erro
+        return tinyobj::LoadObj(attrib, shapes, materials, err, filename, mtl_basepath, triangulate);
+    }
+
+    attrib->vertices.clear();
+    attrib->normals.clear();
+    attrib->texcoords.clear();
+    shapes->clear();
+
+    std::vector<const char*> limites;
+    DivideEmPedacos(arquivo.data, arquivo.data + arquivo.size, &limites);
+
+    std::vector<PedacoObj> pedacos(limites.size() - 1);
+    for (size_t c = 0; c < pedacos.size(); ++c)
+    {
+        pedacos[c].inicio    = limites[c];
+        pedacos[c].fim       = limites[c + 1];
+        pedacos[c].poligonos = 0;
+    }
+
+    Jobs_ParallelFor(0, pedacos.size(), 1, [&pedacos, triangulate](size_t a, size_t b)
+    {
+        for (size_t c = a; c < b; ++c)
+            LePedaco(&pedacos[c], triangulate);
+    });
+
+    // Somas de prefixos: posição de cada pedaço nos vetores de atributos
+    size_t total_v = 0, total_vn = 0, total_vt = 0;
+    for (size_t c = 0; c < pedacos.size(); ++c)
+    {
+        pedacos[c].base_v  = total_v;
+        pedacos[c].base_vn = total_vn;
+        pedacos[c].base_vt = total_vt;
+        total_v  += pedacos[c].v.size();
+        total_vn += pedacos[c].vn.size();
+        total_vt += pedacos[c].vt.size();
+    }
+    attrib->vertices.resize(total_v);
+    attrib->normals.resize(total_vn);
+    attrib->texcoords.resize(total_vt);
+
+    Jobs_ParallelFor(0, pedacos.size(), 1, [&pedacos, attrib](size_t a, size_t b)
+    {
+        for (size_t c = a; c < b; ++c)
+        {
+            PedacoObj& pedaco = pedacos[c];
+            if (!pedaco.v.empty())
+                memcpy(&attrib->vertices[pedaco.base_v], pedaco.v.data(), pedaco.v.size() * sizeof(float));
+            if (!pedaco.vn.empty())
+                memcpy(&attrib->normals[pedaco.base_vn], pedaco.vn.data(), pedaco.vn.size() * sizeof(float));
+            if (!pedaco.vt.empty())
+                memcpy(&attrib->texcoords[pedaco.base_vt], pedaco.vt.data(), pedaco.vt.size() * sizeof(float));
+
+            for (size_t k = 0; k < pedaco.relativos.size(); ++k)
+            {
+                tinyobj::index_t& idx = pedaco.indices[pedaco.relativos[k] / 3];
+                switch (pedaco.relativos[k] % 3)
+                {
+                case 0: idx.vertex_index   += (int)(pedaco.base_v / 3);  break;
+                case 1: idx.normal_index   += (int)(pedaco.base_vn / 3); break;
+                case 2: idx.texcoord_index += (int)(pedaco.base_vt / 2); break;
+                }
+            }
+        }
+    });
+
+    // Reproduzimos os comandos na ordem do arquivo
+    LeituraObj l;
+    l.pedacos  = &pedacos;
+    l.material = -1;
+    memset(&l.grupo, 0, sizeof(l.grupo));
+
+    std::string basepath = mtl_basepath != NULL ? mtl_basepath : "";
+    tinyobj::MaterialFileReader leitor_mtl(basepath);
+
+    for (size_t c = 0; c < pedacos.size(); ++c)
+    {
+        for (size_t k = 0; k < pedacos[c].comandos.size(); ++k)
+        {
+            const ComandoObj& comando = pedacos[c].comandos[k];
+            PosicaoObj aqui = { c, comando.poligonos, comando.faces, comando.indices };
+
+            switch (comando.tipo)
+            {
+            case OBJ_USEMTL:
+            {
+                std::string nome = PrimeiraPalavra(comando.inicio + 7, comando.fim);
+                std::map<std::string, int>::const_iterator m = l.material_map.find(nome);
+                int material = m != l.material_map.end() ? m->second : -1;
+                if (material != l.material)
+                {
+                    Exporta(&l, aqui);
+                    l.grupo    = aqui;
+                    l.material = material;
+                }
+                break;
+            }
+            case OBJ_MTLLIB:
+            {
+                std::string nome = PrimeiraPalavra(comando.inicio + 7, comando.fim);
+                std::string err_mtl;
+                bool ok = leitor_mtl(nome, materials, &l.material_map, &err_mtl);
+                if (err)
+                    (*err) += err_mtl;
+                if (!ok)
+                {
+                    MappedFile_Close(&arquivo);
+                    return false;
+                }
+                break;
+            }
+            case OBJ_GRUPO:
+            case OBJ_OBJETO:
+            {
+                if (Exporta(&l, aqui))
+                    l.prontas.push_back(l.shape);
+                l.shape = ShapeObj();
+                l.grupo = aqui;
+
+                if (comando.tipo == OBJ_OBJETO)
+                    l.nome = PrimeiraPalavra(comando.inicio + 2, comando.fim);
+                else
+                {
+                    std::vector<std::string> nomes;
+                    NomesDoGrupo(comando.inicio, comando.fim, &nomes);
+                    l.nome = nomes.size() > 1 ? nomes[1] : "";
+                }
+                break;
+            }
+            case OBJ_TAG:
+                l.tags.push_back(LeTag(comando.inicio, comando.fim));
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    if (!pedacos.empty())
+    {
+        const PedacoObj& ultimo = pedacos.back();
+        PosicaoObj ultima = { pedacos.size() - 1, ultimo.poligonos, ultimo.num_face_vertices.size(), ultimo.indices.size() };
+        if (Exporta(&l, ultima))
+            l.prontas.push_back(l.shape);
+    }
+
+    // Copiamos os trechos para as shapes
+    std::vector<TrechoObj> trechos;
+    shapes->resize(l.prontas.size());
+    for (size_t s = 0; s < l.prontas.size(); ++s)
+    {
+        ShapeObj& pronta = l.prontas[s];
+        tinyobj::shape_t& shape = (*shapes)[s];
+        shape.name = pronta.nome;
+        shape.mesh.tags.swap(pronta.tags);
+
+        size_t faces = 0, indices = 0;
+        for (size_t k = 0; k < pronta.trechos.size(); ++k)
+        {
+            TrechoObj trecho = pronta.trechos[k];
+            trecho.shape           = s;
+            trecho.destino_faces   = faces;
+            trecho.destino_indices = indices;
+            faces   += trecho.face_fim - trecho.face_inicio;
+            indices += trecho.indice_fim - trecho.indice_inicio;
+            trechos.push_back(trecho);
+        }
+        shape.mesh.indices.resize(indices);
+        shape.mesh.num_face_vertices.resize(faces);
+        shape.mesh.material_ids.resize(faces);
+    }
+
+    Jobs_ParallelFor(0, trechos.size(), 1, [&trechos, &pedacos, shapes](size_t a, size_t b)
+    {
+        for (size_t k = a; k < b; ++k)
+        {
+            const TrechoObj& trecho = trechos[k];
+            const PedacoObj& pedaco = pedacos[trecho.pedaco];
+            tinyobj::mesh_t& mesh   = (*shapes)[trecho.shape].mesh;
+
+            size_t faces   = trecho.face_fim - trecho.face_inicio;
+            size_t indices = trecho.indice_fim - trecho.indice_inicio;
+            if (indices > 0)
+                memcpy(&mesh.indices[trecho.destino_indices], &pedaco.indices[trecho.indice_inicio],
+                       indices * sizeof(tinyobj::index_t));
+            memcpy(&mesh.num_face_vertices[trecho.destino_faces], &pedaco.num_face_vertices[trecho.face_inicio], faces);
+            std::fill(mesh.material_ids.begin() + trecho.destino_faces,
+                      mesh.material_ids.begin() + trecho.destino_faces + faces, trecho.material);
+        }
+    });
+
+    MappedFile_Close(&arquivo);
+    return true;
+}
+
+static void ContaPedaco(const char* inicio, const char* fim, ObjParserCounts* contagem)
+{
+    const char* p = inicio;
+    const char* t;
+    const char* e;
+    TipoDeLinha tipo;
+    while (ProximaLinha(&p, fim, &t, &e, &tipo))
+    {
+        switch (tipo)
+        {
+        case OBJ_VERTICE:  contagem->vertices  += 1; break;
+        case OBJ_NORMAL:   contagem->normals   += 1; break;
+        case OBJ_TEXCOORD: contagem->texcoords += 1; break;
+        case OBJ_FACE:
+        {
+            // Os vértices são contados com a mesma leitura de ObjParser_Load()
+            size_t n = 0;
+            t = PulaEspacos(t + 2, e);
+            while (t < e && !FIM_DE_LINHA(*t))
+            {
+                LeVerticeBruto(&t, e);
+                n += 1;
+                while (t < e && (ESPACO(*t) || *t == '\r'))
+                    ++t;
+            }
+            contagem->faces     += 1;
+            contagem->triangles += n >= 3 ? n - 2 : 0;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+bool ObjParser_Count(const char* filename, ObjParserCounts* counts)
+{
+    memset(counts, 0, sizeof(*counts));
+
+    MappedFile arquivo;
+    if (!MappedFile_Open(&arquivo, filename))
+    {
+        // Um arquivo vazio não tem nada a contar
+        uint64_t tamanho;
+        int64_t modificacao;
+        return File_Stamp(filename, &tamanho, &modificacao);
+    }
+
+    std::vector<const char*> limites;
+    DivideEmPedacos(arquivo.data, arquivo.data + arquivo.size, &limites);
+
+    std::vector<ObjParserCounts> parciais(limites.size() - 1);
+    memset(parciais.data(), 0, parciais.size() * sizeof(ObjParserCounts));
+    Jobs_ParallelFor(0, parciais.size(), 1, [&limites, &parciais](size_t a, size_t b)
+    {
+        for (size_t c = a; c < b; ++c)
+            ContaPedaco(limites[c], limites[c + 1], &parciais[c]);
+    });
+
+    for (size_t c = 0; c < parciais.size(); ++c)
+    {
+        counts->vertices  += parciais[c].vertices;
+        counts->normals   += parciais[c].normals;
+        counts->texcoords += parciais[c].texcoords;
+        counts->faces     += parciais[c].faces;
+        counts->triangles += parciais[c].triangles;
+    }
+
+    MappedFile_Close(&arquivo);
+    return true;
+}
+
+bool ObjParser_LoadWithCallback(const char* filename, const tinyobj::callback_t& callback, void* user_data,
+                                tinyobj::MaterialReader* readMatFn, std::string* err)
+{
+    MappedFile arquivo;
+    if (!MappedFile_Open(&arquivo, filename))
+    {
+        uint64_t tamanho;
+        int64_t modificacao;
+        if (File_Stamp(filename, &tamanho, &modificacao))
+            return true; // Arquivo vazio
+        if (err)
+            (*err) += "Cannot open file [" + std::string(filename) + "]\n";
+        return false;
+    }
+
+    std::map<std::string, int>       material_map;
+    int                              material_id = -1;
+    std::vector<tinyobj::material_t> materials;
+    std::vector<tinyobj::index_t>    indices;
+    std::vector<std::string>         nomes;
+    std::vector<const char*>         nomes_out;
+
+    const char* p = arquivo.data;
+    const char* t;
+    const char* e;
+    TipoDeLinha tipo;
+    while (ProximaLinha(&p, arquivo.data + arquivo.size, &t, &e, &tipo))
+    {
+        switch (tipo)
+        {
+        case OBJ_VERTICE:
+        {
+            t += 2;
+            float x = LeFloat(&t, e);
+            float y = LeFloat(&t, e);
+            float z = LeFloat(&t, e);
+            float w = LeFloat(&t, e, 1.0);
+            if (callback.vertex_cb)
+                callback.vertex_cb(user_data, x, y, z, w);
+            break;
+        }
+
+        case OBJ_NORMAL:
+        case OBJ_TEXCOORD:
+        {
+            t += 3;
+            float x = LeFloat(&t, e);
+            float y = LeFloat(&t, e);
+            float z = LeFloat(&t, e);
+            if (tipo == OBJ_NORMAL && callback.normal_cb)
+                callback.normal_cb(user_data, x, y, z);
+            if (tipo == OBJ_TEXCOORD && callback.texcoord_cb)
+                callback.texcoord_cb(user_data, x, y, z);
+            break;
+        }
+
+        case OBJ_FACE:
+        {
+            t = PulaEspacos(t + 2, e);
+
+            indices.clear();
+            while (t < e && !FIM_DE_LINHA(*t))
+            {
+                VerticeBruto bruto = LeVerticeBruto(&t, e);
+                tinyobj::index_t idx;
+                idx.vertex_index   = bruto.v;
+                idx.normal_index   = (bruto.presentes & 2) ? bruto.vn : 0;
+                idx.texcoord_index = (bruto.presentes & 4) ? bruto.vt : 0;
+                indices.push_back(idx);
+                while (t < e && (ESPACO(*t) || *t == '\r'))
+                    ++t;
+            }
+
+            if (callback.index_cb && !indices.empty())
+                callback.index_cb(user_data, &indices[0], static_cast<int>(indices.size()));
+            break;
+        }
+
+        case OBJ_USEMTL:
+        {
+            std::string nome = PrimeiraPalavra(t + 7, e);
+            std::map<std::string, int>::const_iterator m = material_map.find(nome);
+            material_id = m != material_map.end() ? m->second : -1;
+            if (callback.usemtl_cb)
+                callback.usemtl_cb(user_data, nome.c_str(), material_id);
+            break;
+        }
+
+        case OBJ_MTLLIB:
+        {
+            if (readMatFn == NULL)
+                break;
+
+            std::string nome = PrimeiraPalavra(t + 7, e);
+            std::string err_mtl;
+            size_t antes = materials.size();
+            bool ok = (*readMatFn)(nome, &materials, &material_map, &err_mtl);
+            if (err)
+                (*err) += err_mtl;
+            if (!ok)
+            {
+                MappedFile_Close(&arquivo);
+                return false;
+            }
+
+            if (callback.mtllib_cb)
+                callback.mtllib_cb(user_data, materials.size() > antes ? &materials[antes] : NULL,
+                                   static_cast<int>(materials.size() - antes));
+            break;
+        }
+
+        case OBJ_GRUPO:
+        {
+            NomesDoGrupo(t, e, &nomes);
+            nomes_out.clear();
+            for (size_t k = 1; k < nomes.size(); ++k)
+                nomes_out.push_back(nomes[k].c_str());
+            if (callback.group_cb)
+                callback.group_cb(user_data, nomes_out.empty() ? NULL : &nomes_out[0], static_cast<int>(nomes_out.size()));
+            break;
+        }
+
+        case OBJ_OBJETO:
+        {
+            std::string nome = PrimeiraPalavra(t + 2, e);
+            if (callback.object_cb)
+                callback.object_cb(user_data, nome.c_str());
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    MappedFile_Close(&arquivo);
+    return true;
+}
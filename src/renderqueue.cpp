@@ -0,0 +1,280 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "renderqueue.h"
+
+static RenderQueueStats g_UltimoQuadro;
+static RenderQueueStats g_Totais;
+
+enum ComandoDeDesenho
+{
+    CMD_PROFUNDIDADE = 1, // 1 argumento: teste de profundidade ligado
+    CMD_VAO,              // 1: VAO
+    CMD_OBJECT_ID,        // 1: object_id
+    CMD_MATERIAL,         // 12 floats: Ka, Kd, Ks, Ke
+    CMD_CAIXA,            // 6 floats: bbox_min, bbox_max
+    CMD_MAPA_NORMAL,      // 1: textura (0 = sem mapa de normais)
+    CMD_DESENHO           // 4 + 16: modo, número de índices, primeiro índice, vértice base, matriz "model"
+};
+
+void RenderQueue_Begin(RenderQueue* q)
+{
+    q->itens.clear();
+    q->ordem.clear();
+}
+
+// Resumo de 12 bits dos coeficientes (FNV-1a sobre os bytes), nunca zero
+static uint32_t ResumoDoMaterial(const RenderMaterial& m)
+{
+    const unsigned char* bytes = (const unsigned char*)&m;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(RenderMaterial); ++i)
+        h = (h ^ bytes[i]) * 16777619u;
+    return h % 0xFFF + 1;
+}
+
+uint64_t RenderQueue_Key(const RenderItem& item)
+{
+    float d = item.profundidade;
+    uint64_t p = (uint64_t)((d <= 0.0f ? 0.0f : d >= 1.0f ? 1.0f : d) * 0xFFFFFF);
+    uint64_t material = item.material ? ResumoDoMaterial(item.coeficientes) : 0;
+    return ((uint64_t)(item.passo & 0xF)      << 60)
+         | ((uint64_t)(item.object_id & 0xFF) << 52)
+         | (material                          << 40)
+         | ((uint64_t)(item.vao & 0xFFFF)     << 24)
+         | (p & 0xFFFFFF);
+}
+
+void RenderQueue_Add(RenderQueue* q, const RenderItem& item)
+{
+    ChaveDeDesenho c;
+    c.chave = RenderQueue_Key(item);
+    c.item  = (uint32_t)q->itens.size();
+
+    q->itens.push_back(item);
+    q->itens.back().chave = c.chave;
+    q->ordem.push_back(c);
+}
+
+void RenderQueue_SortKeys(std::vector<ChaveDeDesenho>* chaves, std::vector<ChaveDeDesenho>* temp)
+{
+    std::vector<ChaveDeDesenho>& v = *chaves;
+    size_t n = v.size();
+    if (n < 2)
+        return;
+    temp->resize(n);
+
+    for (int byte = 0; byte < 8; ++byte)
+    {
+        int deslocamento = 8 * byte;
+
+        size_t contagem[256];
+        memset(contagem, 0, sizeof(contagem));
+        for (size_t i = 0; i < n; ++i)
+            contagem[(v[i].chave >> deslocamento) & 0xFF] += 1;
+
+        // Byte igual em todas as chaves: a passada não muda a ordem
+        if (contagem[(v[0].chave >> deslocamento) & 0xFF] == n)
+            continue;
+
+        size_t inicio = 0;
+        for (int b = 0; b < 256; ++b)
+        {
+            size_t c = contagem[b];
+            contagem[b] = inicio;
+            inicio += c;
+        }
+        for (size_t i = 0; i < n; ++i)
+            (*temp)[contagem[(v[i].chave >> deslocamento) & 0xFF]++] = v[i];
+        v.swap(*temp);
+    }
+}
+
+void RenderQueue_Sort(RenderQueue* q)
+{
+    RenderQueue_SortKeys(&q->ordem, &q->temp);
+}
+
+static inline void Emite(std::vector<uint32_t>& p, uint32_t palavra)
+{
+    p.push_back(palavra);
+}
+
+static inline void EmiteFloats(std::vector<uint32_t>& p, const float* f, size_t n)
+{
+    size_t inicio = p.size();
+    p.resize(inicio + n);
+    memcpy(&p[inicio], f, n * sizeof(float));
+}
+
+void RenderQueue_Encode(const RenderItem* itens, const std::vector<ChaveDeDesenho>& ordem,
+                        RenderCommandStream* saida)
+{
+    std::vector<uint32_t>& p = saida->palavras;
+    p.clear();
+
+    RenderQueueStats& s = saida->stats;
+    memset(&s, 0, sizeof(s));
+    s.frames = 1;
+    s.program_changes = 1; // RenderQueue_Replay() sempre liga o programa
+
+    // No começo do quadro o estado é desconhecido: o primeiro item emite tudo
+    bool primeiro = true;
+    const RenderItem* atual = NULL;
+    bool material = false;
+    RenderMaterial coeficientes;
+    memset(&coeficientes, 0, sizeof(coeficientes));
+
+    for (size_t k = 0; k < ordem.size(); ++k)
+    {
+        const RenderItem& item = itens[ordem[k].item];
+
+        bool teste = item.passo != RENDERPASS_SOBREPOSTO;
+        if (primeiro || teste != (atual->passo != RENDERPASS_SOBREPOSTO))
+        {
+            Emite(p, CMD_PROFUNDIDADE);
+            Emite(p, teste ? 1 : 0);
+            s.depth_changes += 1;
+        }
+        if (primeiro || item.vao != atual->vao)
+        {
+            Emite(p, CMD_VAO);
+            Emite(p, item.vao);
+            s.vao_changes += 1;
+        }
+        if (primeiro || item.object_id != atual->object_id)
+        {
+            Emite(p, CMD_OBJECT_ID);
+            Emite(p, (uint32_t)item.object_id);
+            s.variant_changes += 1;
+        }
+        if (item.material && (!material || memcmp(&item.coeficientes, &coeficientes, sizeof(RenderMaterial)) != 0))
+        {
+            Emite(p, CMD_MATERIAL);
+            EmiteFloats(p, &item.coeficientes.Ka.x, 12);
+            material     = true;
+            coeficientes = item.coeficientes;
+            s.material_changes += 1;
+        }
+        if (primeiro || item.bbox_min != atual->bbox_min || item.bbox_max != atual->bbox_max)
+        {
+            Emite(p, CMD_CAIXA);
+            EmiteFloats(p, &item.bbox_min.x, 3);
+            EmiteFloats(p, &item.bbox_max.x, 3);
+            s.bbox_changes += 1;
+        }
+        if (primeiro || item.mapa_normal != atual->mapa_normal)
+        {
+            Emite(p, CMD_MAPA_NORMAL);
+            Emite(p, item.mapa_normal);
+            s.normal_map_changes += 1;
+        }
+        primeiro = false;
+        atual    = &item;
+
+        Emite(p, CMD_DESENHO);
+        Emite(p, item.rendering_mode);
+        Emite(p, (uint32_t)item.num_indices);
+        Emite(p, (uint32_t)item.first_index);
+        Emite(p, (uint32_t)item.base_vertex);
+        EmiteFloats(p, &item.model[0][0], 16);
+        s.draws += 1;
+    }
+}
+
+static inline float LeFloat(const uint32_t* p)
+{
+    float f;
+    memcpy(&f, p, sizeof(float));
+    return f;
+}
+
+void RenderQueue_Replay(const RenderCommandStream& comandos, const RenderUniforms& u)
+{
+    glUseProgram(u.program);
+
+    bool profundidade = true;
+    const uint32_t* p   = comandos.palavras.data();
+    const uint32_t* fim = p + comandos.palavras.size();
+    while (p < fim)
+    {
+        switch (*p++)
+        {
+        case CMD_PROFUNDIDADE:
+            profundidade = *p++ != 0;
+            if (profundidade)
+                glEnable(GL_DEPTH_TEST);
+            else
+                glDisable(GL_DEPTH_TEST);
+            break;
+        case CMD_VAO:
+            glBindVertexArray(*p++);
+            break;
+        case CMD_OBJECT_ID:
+            glUniform1i(u.object_id, (GLint)*p++);
+            break;
+        case CMD_MATERIAL:
+            glUniform3f(u.Ka, LeFloat(p + 0), LeFloat(p + 1),  LeFloat(p + 2));
+            glUniform3f(u.Kd, LeFloat(p + 3), LeFloat(p + 4),  LeFloat(p + 5));
+            glUniform3f(u.Ks, LeFloat(p + 6), LeFloat(p + 7),  LeFloat(p + 8));
+            glUniform3f(u.Ke, LeFloat(p + 9), LeFloat(p + 10), LeFloat(p + 11));
+            p += 12;
+            break;
+        case CMD_CAIXA:
+            glUniform4f(u.bbox_min, LeFloat(p + 0), LeFloat(p + 1), LeFloat(p + 2), 1.0f);
+            glUniform4f(u.bbox_max, LeFloat(p + 3), LeFloat(p + 4), LeFloat(p + 5), 1.0f);
+            p += 6;
+            break;
+        case CMD_MAPA_NORMAL:
+            glActiveTexture(GL_TEXTURE0 + RENDER_NORMAL_MAP_UNIT);
+            glBindTexture(GL_TEXTURE_2D, *p);
+            glUniform1i(u.normal_mapped, *p != 0 ? 1 : 0);
+            p += 1;
+            break;
+        case CMD_DESENHO:
+            glUniformMatrix4fv(u.model, 1, GL_FALSE, (const GLfloat*)(p + 4));
+            glDrawElementsBaseVertex((GLenum)p[0], (GLsizei)p[1], GL_UNSIGNED_INT,
+                                     (void*)((size_t)p[2] * sizeof(GLuint)), (GLint)p[3]);
+            p += 4 + 16;
+            break;
+        default:
+            fprintf(stderr, "ERROR: comando de desenho %u inválido.\n", p[-1]);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    // Deixamos o estado como o resto do programa espera
+    glBindVertexArray(0);
+    if (!profundidade)
+        glEnable(GL_DEPTH_TEST);
+
+    const RenderQueueStats& s = comandos.stats;
+    g_UltimoQuadro = s;
+    g_Totais.frames           += s.frames;
+    g_Totais.draws            += s.draws;
+    g_Totais.program_changes  += s.program_changes;
+    g_Totais.vao_changes      += s.vao_changes;
+    g_Totais.variant_changes  += s.variant_changes;
+    g_Totais.material_changes += s.material_changes;
+    g_Totais.bbox_changes     += s.bbox_changes;
+    g_Totais.normal_map_changes += s.normal_map_changes;
+    g_Totais.depth_changes    += s.depth_changes;
+}
+
+void RenderQueue_Submit(RenderQueue* q, const RenderUniforms& u)
+{
+    RenderQueue_Encode(q->itens.data(), q->ordem, &q->comandos);
+    RenderQueue_Replay(q->comandos, u);
+}
+
+RenderQueueStats RenderQueue_LastFrame()
+{
+    return g_UltimoQuadro;
+}
+
+RenderQueueStats RenderQueue_Totals()
+{
+    return g_Totais;
+}
@@ -0,0 +1,377 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "scene.h"
+
+// Cabeçalho da forma binária. Logo após vêm, em sequência, os vetores de
+// texturas, malhas, planos, instâncias e células.
+struct SceneBakedHeader
+{
+    char     magic[4];     // "FCGS"
+    uint32_t version;
+    uint64_t source_size;  // Tamanho e data de modificação do arquivo texto
+    int64_t  source_mtime;
+    uint32_t num_textures;
+    uint32_t num_meshes;
+    uint32_t num_planes;
+    uint32_t num_instances;
+    uint32_t num_cells;
+    float    cell_size;
+};
+
+static const uint32_t SCENE_BAKED_VERSION = 2;
+
+static void InicializaCena(SceneDescription* scene)
+{
+    scene->textures      = NULL;
+    scene->meshes        = NULL;
+    scene->planes        = NULL;
+    scene->instances     = NULL;
+    scene->cells         = NULL;
+    scene->num_textures  = 0;
+    scene->num_meshes    = 0;
+    scene->num_planes    = 0;
+    scene->num_instances = 0;
+    scene->num_cells     = 0;
+    scene->cell_size     = 0.0f;
+    scene->texture_storage.clear();
+    scene->mesh_storage.clear();
+    scene->plane_storage.clear();
+    scene->instance_storage.clear();
+    scene->cell_storage.clear();
+    scene->baked.data   = NULL;
+    scene->baked.size   = 0;
+    scene->baked.handle = NULL;
+}
+
+// Divide uma linha em palavras separadas por espaços (modifica a linha).
+static std::vector<char*> Palavras(char* linha)
+{
+    std::vector<char*> palavras;
+    char* p = linha;
+    for (;;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r')
+            ++p;
+        if (*p == '\0' || *p == '#')
+            break;
+        palavras.push_back(p);
+        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r')
+            ++p;
+        if (*p == '\0')
+            break;
+        *p++ = '\0';
+    }
+    return palavras;
+}
+
+static bool LeFloats(const std::vector<char*>& palavras, size_t* i, int n, float* out)
+{
+    for (int k = 0; k < n; ++k)
+    {
+        if (*i + 1 >= palavras.size())
+            return false;
+        char* fim;
+        out[k] = strtof(palavras[++(*i)], &fim);
+        if (*fim != '\0')
+            return false;
+    }
+    return true;
+}
+
+static bool CopiaNome(char* dst, size_t tamanho, const char* src)
+{
+    if (strlen(src) >= tamanho)
+        return false;
+    strcpy(dst, src);
+    return true;
+}
+
+bool Scene_Parse(const char* filename, SceneDescription* scene, std::string* err)
+{
+    InicializaCena(scene);
+
+    MappedFile file;
+    if (!MappedFile_Open(&file, filename))
+    {
+        *err = std::string("Cannot open scene file \"") + filename + "\".";
+        return false;
+    }
+
+    const char* p   = file.data;
+    const char* fim = file.data + file.size;
+    int numero_linha = 0;
+    char linha[1024];
+    bool ok = true;
+
+    while (ok && p < fim)
+    {
+        const char* eol = (const char*)memchr(p, '\n', fim - p);
+        if (eol == NULL)
+            eol = fim;
+        numero_linha += 1;
+
+        size_t tamanho = eol - p;
+        if (tamanho >= sizeof(linha))
+        {
+            ok = false;
+            break;
+        }
+        memcpy(linha, p, tamanho);
+        linha[tamanho] = '\0';
+        p = eol + 1;
+
+        std::vector<char*> palavras = Palavras(linha);
+        if (palavras.empty())
+            continue;
+
+        const char* comando = palavras[0];
+
+        if (strcmp(comando, "texture") == 0 && palavras.size() == 2)
+        {
+            SceneTextureDesc texture;
+            memset(&texture, 0, sizeof(texture));
+            ok = CopiaNome(texture.filename, SCENE_PATH_LEN, palavras[1]);
+            scene->texture_storage.push_back(texture);
+        }
+        else if ((strcmp(comando, "mesh") == 0 || strcmp(comando, "env") == 0)
+              && (palavras.size() == 2 || palavras.size() == 3))
+        {
+            SceneMeshDesc mesh;
+            memset(&mesh, 0, sizeof(mesh));
+            mesh.env = strcmp(comando, "env") == 0;
+            ok = CopiaNome(mesh.filename, SCENE_PATH_LEN, palavras[1])
+              && (palavras.size() == 2 || CopiaNome(mesh.basepath, SCENE_PATH_LEN, palavras[2]));
+            scene->mesh_storage.push_back(mesh);
+        }
+        else if (strcmp(comando, "plane") == 0)
+        {
+            ScenePlaneDesc plane;
+            float v[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            size_t i = 0;
+            ok = LeFloats(palavras, &i, 4, v) && i + 1 == palavras.size();
+            plane.n[0] = v[0];
+            plane.n[1] = v[1];
+            plane.n[2] = v[2];
+            plane.d    = v[3];
+            scene->plane_storage.push_back(plane);
+        }
+        else if ((strcmp(comando, "cube") == 0 || strcmp(comando, "sphere") == 0) && palavras.size() >= 2)
+        {
+            SceneInstanceDesc inst;
+            memset(&inst, 0, sizeof(inst));
+            inst.collider = strcmp(comando, "cube") == 0 ? SCENE_COLLIDER_CUBE : SCENE_COLLIDER_SPHERE;
+            inst.material = -1;
+            inst.scale    = 1.0f;
+            ok = CopiaNome(inst.object, SCENE_NAME_LEN, palavras[1]);
+
+            bool tem_path = false;
+            for (size_t i = 2; ok && i < palavras.size(); ++i)
+            {
+                const char* chave = palavras[i];
+                if (strcmp(chave, "pos") == 0)
+                    ok = LeFloats(palavras, &i, 3, inst.pos);
+                else if (strcmp(chave, "scale") == 0)
+                    ok = LeFloats(palavras, &i, 1, &inst.scale);
+                else if (strcmp(chave, "offset") == 0)
+                    ok = LeFloats(palavras, &i, 3, inst.center_offset);
+                else if (strcmp(chave, "path") == 0)
+                    ok = tem_path = LeFloats(palavras, &i, 12, &inst.path[0][0]);
+                else if (strcmp(chave, "material") == 0)
+                {
+                    float m;
+                    ok = LeFloats(palavras, &i, 1, &m);
+                    inst.material = (int32_t)m;
+                }
+                else
+                    ok = false;
+            }
+
+            // Sem caminho de fuga, a instância permanece parada.
+            if (!tem_path)
+                for (int k = 0; k < 4; ++k)
+                    memcpy(inst.path[k], inst.pos, sizeof(inst.pos));
+
+            scene->instance_storage.push_back(inst);
+        }
+        else if (strcmp(comando, "cellsize") == 0)
+        {
+            size_t i = 0;
+            ok = LeFloats(palavras, &i, 1, &scene->cell_size) && i + 1 == palavras.size() && scene->cell_size > 0.0f;
+        }
+        else if (strcmp(comando, "cell") == 0 && palavras.size() == 4)
+        {
+            SceneCellDesc cell;
+            memset(&cell, 0, sizeof(cell));
+            char* fim_x;
+            char* fim_z;
+            cell.x = (int32_t)strtol(palavras[1], &fim_x, 10);
+            cell.z = (int32_t)strtol(palavras[2], &fim_z, 10);
+            ok = *fim_x == '\0' && *fim_z == '\0'
+              && CopiaNome(cell.filename, SCENE_PATH_LEN, palavras[3]);
+            scene->cell_storage.push_back(cell);
+        }
+        else
+            ok = false;
+    }
+
+    MappedFile_Close(&file);
+
+    if (ok && !scene->cell_storage.empty() && scene->cell_size <= 0.0f)
+    {
+        *err = std::string("Scene file \"") + filename + "\" has cells but no \"cellsize\".";
+        return false;
+    }
+
+    if (!ok)
+    {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "\", line %d.", numero_linha);
+        *err = std::string("Syntax error in scene file \"") + filename + buffer;
+        return false;
+    }
+
+    scene->textures      = scene->texture_storage.data();
+    scene->meshes        = scene->mesh_storage.data();
+    scene->planes        = scene->plane_storage.data();
+    scene->instances     = scene->instance_storage.data();
+    scene->cells         = scene->cell_storage.data();
+    scene->num_textures  = (uint32_t)scene->texture_storage.size();
+    scene->num_meshes    = (uint32_t)scene->mesh_storage.size();
+    scene->num_planes    = (uint32_t)scene->plane_storage.size();
+    scene->num_instances = (uint32_t)scene->instance_storage.size();
+    scene->num_cells     = (uint32_t)scene->cell_storage.size();
+
+    return true;
+}
+
+bool Scene_Bake(const SceneDescription& scene, const char* filename, const char* source)
+{
+    SceneBakedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "FCGS", 4);
+    header.version       = SCENE_BAKED_VERSION;
+    header.num_textures  = scene.num_textures;
+    header.num_meshes    = scene.num_meshes;
+    header.num_planes    = scene.num_planes;
+    header.num_instances = scene.num_instances;
+    header.num_cells     = scene.num_cells;
+    header.cell_size     = scene.cell_size;
+    File_Stamp(source, &header.source_size, &header.source_mtime);
+
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL)
+        return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(scene.textures,  sizeof(SceneTextureDesc),  scene.num_textures,  f) == scene.num_textures
+           && fwrite(scene.meshes,    sizeof(SceneMeshDesc),     scene.num_meshes,    f) == scene.num_meshes
+           && fwrite(scene.planes,    sizeof(ScenePlaneDesc),    scene.num_planes,    f) == scene.num_planes
+           && fwrite(scene.instances, sizeof(SceneInstanceDesc), scene.num_instances, f) == scene.num_instances
+           && fwrite(scene.cells,     sizeof(SceneCellDesc),     scene.num_cells,     f) == scene.num_cells;
+
+    fclose(f);
+    if (!ok)
+        remove(filename);
+
+    return ok;
+}
+
+bool Scene_LoadBaked(const char* filename, SceneDescription* scene)
+{
+    InicializaCena(scene);
+
+    if (!MappedFile_Open(&scene->baked, filename))
+        return false;
+
+    const char* data = scene->baked.data;
+    size_t size = scene->baked.size;
+
+    SceneBakedHeader header;
+    if (size < sizeof(header))
+    {
+        MappedFile_Close(&scene->baked);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    size_t esperado = sizeof(header)
+                    + header.num_textures  * sizeof(SceneTextureDesc)
+                    + header.num_meshes    * sizeof(SceneMeshDesc)
+                    + header.num_planes    * sizeof(ScenePlaneDesc)
+                    + header.num_instances * sizeof(SceneInstanceDesc)
+                    + header.num_cells     * sizeof(SceneCellDesc);
+
+    if (memcmp(header.magic, "FCGS", 4) != 0 || header.version != SCENE_BAKED_VERSION || size != esperado)
+    {
+        MappedFile_Close(&scene->baked);
+        return false;
+    }
+
+    const char* p = data + sizeof(header);
+    scene->textures  = (const SceneTextureDesc*)p;
+    p += header.num_textures * sizeof(SceneTextureDesc);
+    scene->meshes    = (const SceneMeshDesc*)p;
+    p += header.num_meshes * sizeof(SceneMeshDesc);
+    scene->planes    = (const ScenePlaneDesc*)p;
+    p += header.num_planes * sizeof(ScenePlaneDesc);
+    scene->instances = (const SceneInstanceDesc*)p;
+    p += header.num_instances * sizeof(SceneInstanceDesc);
+    scene->cells     = (const SceneCellDesc*)p;
+
+    scene->num_textures  = header.num_textures;
+    scene->num_meshes    = header.num_meshes;
+    scene->num_planes    = header.num_planes;
+    scene->num_instances = header.num_instances;
+    scene->num_cells     = header.num_cells;
+    scene->cell_size     = header.cell_size;
+
+    return true;
+}
+
+// A forma binária é válida se foi gerada a partir da versão atual do arquivo
+// texto (ou se o arquivo texto não existe).
+static bool BinarioAtualizado(const char* filename, const char* bakedname)
+{
+    FILE* f = fopen(bakedname, "rb");
+    if (f == NULL)
+        return false;
+
+    SceneBakedHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1;
+    fclose(f);
+    if (!ok)
+        return false;
+
+    uint64_t size;
+    int64_t  mtime;
+    if (!File_Stamp(filename, &size, &mtime))
+        return true;
+
+    return size == header.source_size && mtime == header.source_mtime;
+}
+
+bool Scene_Load(const char* filename, SceneDescription* scene, std::string* err)
+{
+    std::string bakedname = std::string(filename) + ".bin";
+
+    if (BinarioAtualizado(filename, bakedname.c_str()) && Scene_LoadBaked(bakedname.c_str(), scene))
+        return true;
+
+    if (!Scene_Parse(filename, scene, err))
+        return false;
+
+    if (!Scene_Bake(*scene, bakedname.c_str(), filename))
+        fprintf(stderr, "WARNING: Cannot write baked scene \"%s\".\n", bakedname.c_str());
+
+    return true;
+}
+
+void Scene_Free(SceneDescription* scene)
+{
+    MappedFile_Close(&scene->baked);
+    InicializaCena(scene);
+}
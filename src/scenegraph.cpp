@@ -0,0 +1,274 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+#include "scenegraph.h"
+#include "fastmath.h"
+#include "jobs.h"
+#include "framearena.h"
+
+size_t g_SceneGraphParallelThreshold = 16384;
+
+static SceneGraphStats g_Stats;
+
+// T * R * S, montada diretamente a partir das colunas de R
+static inline glm::mat4 MatrizTRS(const glm::vec3& t, const glm::quat& r, const glm::vec3& s)
+{
+    glm::mat3 rot = glm::mat3_cast(r);
+    return glm::mat4(glm::vec4(rot[0] * s.x, 0.0f),
+                     glm::vec4(rot[1] * s.y, 0.0f),
+                     glm::vec4(rot[2] * s.z, 0.0f),
+                     glm::vec4(t, 1.0f));
+}
+
+static inline glm::mat4 MatrizNoMundo(const SceneGraph& g, int i)
+{
+    glm::mat4 local = MatrizTRS(g.posicao[i], g.rotacao[i], g.escala[i]);
+    return g.pai[i] < 0 ? local : FastMath_Multiply(g.mundo[g.pai[i]], local);
+}
+
+static void VerificaNo(const SceneGraph& g, int no)
+{
+    if (no < 0 || (size_t)no >= g.pai.size() || g.livre[no])
+    {
+        fprintf(stderr, "ERROR: nó %d inexistente no grafo de cena.\n", no);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+int SceneGraph_Add(SceneGraph* g, int pai, const glm::vec3& posicao,
+                   const glm::quat& rotacao, const glm::vec3& escala)
+{
+    if (pai >= 0)
+        VerificaNo(*g, pai);
+
+    // Reaproveitamos a primeira posição livre depois do pai, para manter a
+    // ordem topológica; se não houver, o nó vai para o fim.
+    int i;
+    std::set<int32_t>::iterator livre = g->livres.lower_bound(pai + 1);
+    if (livre != g->livres.end())
+    {
+        i = *livre;
+        g->livres.erase(livre);
+    }
+    else
+    {
+        i = (int)g->pai.size();
+        g->pai.push_back(-1);
+        g->posicao.push_back(glm::vec3(0.0f));
+        g->rotacao.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        g->escala.push_back(glm::vec3(1.0f));
+        g->mundo.push_back(glm::mat4(1.0f));
+        g->sujo.push_back(0);
+        g->mudou.push_back(0);
+        g->livre.push_back(0);
+        g->nivel.push_back(0);
+    }
+
+    g->pai[i]     = pai;
+    g->posicao[i] = posicao;
+    g->rotacao[i] = rotacao;
+    g->escala[i]  = escala;
+    g->sujo[i]    = 0;
+    g->mudou[i]   = 0;
+    g->livre[i]   = 0;
+    g->nivel[i]   = pai < 0 ? 0 : g->nivel[pai] + 1;
+    g->mundo[i]   = MatrizNoMundo(*g, i);
+
+    g->niveis_validos = false;
+    return i;
+}
+
+void SceneGraph_Remove(SceneGraph* g, int no)
+{
+    VerificaNo(*g, no);
+
+    // Descendentes vêm depois do nó: basta uma passada marcando quem tem o
+    // pai marcado.
+    ArenaScope rascunho(Arena_Scratch());
+    size_t num_remover = g->pai.size() - no;
+    uint8_t* remover = Arena_New<uint8_t>(rascunho.arena, num_remover);
+    memset(remover, 0, num_remover);
+    remover[0] = 1;
+    for (size_t i = no + 1; i < g->pai.size(); ++i)
+        if (!g->livre[i] && g->pai[i] >= no && remover[g->pai[i] - no])
+            remover[i - no] = 1;
+
+    for (size_t k = 0; k < num_remover; ++k)
+    {
+        if (!remover[k])
+            continue;
+        size_t i = no + k;
+        if (g->sujo[i])
+            g->num_sujos -= 1;
+        g->livre[i] = 1;
+        g->sujo[i]  = 0;
+        g->mudou[i] = 0;
+        g->pai[i]   = -1;
+        g->livres.insert((int32_t)i);
+    }
+
+    // Posições livres no fim são descartadas
+    while (!g->pai.empty() && g->livre.back())
+    {
+        g->livres.erase((int32_t)g->pai.size() - 1);
+        g->pai.pop_back();
+        g->posicao.pop_back();
+        g->rotacao.pop_back();
+        g->escala.pop_back();
+        g->mundo.pop_back();
+        g->sujo.pop_back();
+        g->mudou.pop_back();
+        g->livre.pop_back();
+        g->nivel.pop_back();
+    }
+
+    g->niveis_validos = false;
+}
+
+static inline void MarcaSujo(SceneGraph* g, int no)
+{
+    if (!g->sujo[no])
+    {
+        g->sujo[no] = 1;
+        g->num_sujos += 1;
+    }
+}
+
+void SceneGraph_SetPosition(SceneGraph* g, int no, const glm::vec3& posicao)
+{
+    VerificaNo(*g, no);
+    g->posicao[no] = posicao;
+    MarcaSujo(g, no);
+}
+
+void SceneGraph_SetRotation(SceneGraph* g, int no, const glm::quat& rotacao)
+{
+    VerificaNo(*g, no);
+    g->rotacao[no] = rotacao;
+    MarcaSujo(g, no);
+}
+
+void SceneGraph_SetScale(SceneGraph* g, int no, const glm::vec3& escala)
+{
+    VerificaNo(*g, no);
+    g->escala[no] = escala;
+    MarcaSujo(g, no);
+}
+
+// Atualiza o nó "i", cujo pai (se houver) já foi atualizado. Retorna 1 se
+// a matriz foi recalculada.
+static inline unsigned long AtualizaNo(SceneGraph* g, int i)
+{
+    int pai = g->pai[i];
+    uint8_t m = g->sujo[i] | (pai >= 0 ? g->mudou[pai] : 0);
+    g->mudou[i] = m;
+    if (!m)
+        return 0;
+    g->mundo[i] = MatrizNoMundo(*g, i);
+    g->sujo[i]  = 0;
+    return 1;
+}
+
+static void AtualizaFaixa(SceneGraph* g, const int32_t* nos, size_t n, unsigned long* recalculados)
+{
+    unsigned long r = 0;
+    for (size_t k = 0; k < n; ++k)
+        r += AtualizaNo(g, nos[k]);
+    *recalculados = r;
+}
+
+// Os vetores de cada nível são esvaziados, e não destruídos, para que
+// reconstruí-los depois de adicionar ou remover nós não aloque memória.
+static void MontaNiveis(SceneGraph* g)
+{
+    for (size_t d = 0; d < g->niveis.size(); ++d)
+        g->niveis[d].clear();
+    size_t profundidade = 0;
+    for (size_t i = 0; i < g->pai.size(); ++i)
+    {
+        if (g->livre[i])
+            continue;
+        size_t d = g->nivel[i];
+        if (g->niveis.size() <= d)
+            g->niveis.resize(d + 1);
+        g->niveis[d].push_back((int32_t)i);
+        profundidade = std::max(profundidade, d + 1);
+    }
+    g->niveis.resize(profundidade);
+    g->niveis_validos = true;
+}
+
+static bool UpdateParalelo(const SceneGraph& g)
+{
+    return g.pai.size() - g.livres.size() >= g_SceneGraphParallelThreshold && Jobs_NumThreads() >= 2;
+}
+
+void SceneGraph_Update(SceneGraph* g)
+{
+    // Os níveis são montados no primeiro Update() depois de uma mudança na
+    // hierarquia, mesmo sem nós alterados, e não no primeiro em que algum
+    // nó se move
+    if (!g->niveis_validos && UpdateParalelo(*g))
+        MontaNiveis(g);
+
+    if (g->num_sujos == 0)
+    {
+        // Nada mudou: só desligamos os "mudou" do Update() anterior
+        if (g->houve_mudanca)
+        {
+            std::fill(g->mudou.begin(), g->mudou.end(), 0);
+            g->houve_mudanca = false;
+        }
+        return;
+    }
+
+    g_Stats.updates += 1;
+    unsigned long recalculados = 0;
+
+    if (!UpdateParalelo(*g))
+    {
+        for (size_t i = 0; i < g->pai.size(); ++i)
+            if (!g->livre[i])
+                recalculados += AtualizaNo(g, (int)i);
+    }
+    else
+    {
+        g_Stats.parallel += 1;
+
+        // Cada nível depende só do anterior. Níveis pequenos ficam com a
+        // thread atual; os grandes são divididos em faixas (veja "jobs.h").
+        for (size_t d = 0; d < g->niveis.size(); ++d)
+        {
+            const std::vector<int32_t>& nivel = g->niveis[d];
+            unsigned long parcial;
+            if (nivel.size() < g_SceneGraphParallelThreshold / 4)
+            {
+                AtualizaFaixa(g, nivel.data(), nivel.size(), &parcial);
+                recalculados += parcial;
+                continue;
+            }
+
+            std::atomic<unsigned long> total(0);
+            Jobs_ParallelFor(0, nivel.size(), g_SceneGraphParallelThreshold / 16, [g, &nivel, &total](size_t a, size_t b)
+            {
+                unsigned long r;
+                AtualizaFaixa(g, nivel.data() + a, b - a, &r);
+                total.fetch_add(r);
+            });
+            recalculados += total.load();
+        }
+    }
+
+    g->num_sujos     = 0;
+    g->houve_mudanca = recalculados > 0;
+    g_Stats.recomputed += recalculados;
+}
+
+SceneGraphStats SceneGraph_Stats()
+{
+    return g_Stats;
+}
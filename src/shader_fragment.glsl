@@ -13,6 +13,9 @@ in vec4 position_model;
 // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
 in vec2 texcoords;
 
+// Tangente e sinal da bitangente, para os mapas de normais
+in vec4 tangent;
+
 in vec3 cor;
 
 // Matrizes computadas no cdigo C++ e enviadas para a GPU
@@ -44,6 +47,10 @@ uniform vec4 light_dir;
 uniform sampler2D TextureImage0;
 uniform sampler2D TextureImage1;
 uniform sampler2D TextureImage2;
+
+// Mapa de normais do material do objeto, no espao tangente de MikkTSpace
+uniform sampler2D NormalMap;
+uniform bool normal_mapped;
 uniform vec3 MKa;
 uniform vec3 MKd;
 uniform vec3 MKs;
@@ -68,6 +75,18 @@ void main()
     // normais de cada vrtice.
     vec4 n = normalize(normal);
 
+    // Com mapa de normais, a normal lida da textura  levada do espao
+    // tangente para o mundo pela base tangente, bitangente e normal, com a
+    // bitangente calculada como em MikkTSpace.
+    if ( normal_mapped )
+    {
+        vec3 N = n.xyz;
+        vec3 T = normalize(tangent.xyz);
+        vec3 B = tangent.w * cross(N, T);
+        vec3 m = texture(NormalMap, texcoords).rgb * 2.0 - 1.0;
+        n = vec4(normalize(m.x*T + m.y*B + m.z*N), 0.0);
+    }
+
     // Vetor que define o sentido da fonte de luz em relao ao ponto atual.
     vec4 l = normalize(light_pos - p);
 
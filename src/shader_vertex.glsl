@@ -1,10 +1,14 @@
 #version 330 core
 
 // Atributos de vértice recebidos como entrada ("in") pelo Vertex Shader.
-// Veja a função BuildTrianglesAndAddToVirtualScene() em "main.cpp".
+// Veja o formato dos vértices em "meshbuffer.h": normais e tangentes chegam
+// com 10 bits por coordenada, já convertidas para [-1,1].
 layout (location = 0) in vec4 model_coefficients;
 layout (location = 1) in vec4 normal_coefficients;
 layout (location = 2) in vec2 texture_coefficients;
+// Tangente (xyz) e sinal da bitangente (w), apenas nas malhas com mapas de
+// normais. Veja "tangents.h".
+layout (location = 3) in vec4 tangent_coefficients;
 
 // Matrizes computadas no código C++ e enviadas para a GPU
 uniform mat4 model;
@@ -29,6 +33,7 @@ out vec4 position_world;
 out vec4 position_model;
 out vec4 normal;
 out vec2 texcoords;
+out vec4 tangent;
 out vec3 cor;
 
 void main()
@@ -42,11 +47,15 @@ void main()
 
     position_model = model_coefficients;
 
-    normal = inverse(transpose(model)) * normal_coefficients;
-    normal.w = 0.0;
+    normal = inverse(transpose(model)) * vec4(normal_coefficients.xyz, 0.0);
 
     texcoords = texture_coefficients;
 
+    // A tangente acompanha a superfície: é transformada pela própria matriz
+    // "model", e não pela inversa transposta como a normal. Sem tangentes o
+    // atributo vale zero, por isso ela só é normalizada no fragment shader.
+    tangent = vec4(mat3(model) * tangent_coefficients.xyz, tangent_coefficients.w);
+
     if(object_id == 0)
     {
         vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
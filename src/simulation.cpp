@@ -0,0 +1,95 @@
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "simulation.h"
+
+double g_SimulationStep     = 1.0 / 120.0;
+int    g_SimulationMaxSteps = 8;
+
+static std::thread       g_Simulador;
+static std::atomic<bool> g_EncerraSimulador(false);
+
+void Simulation_InitClock(SimulationClock* clock)
+{
+    clock->accumulator = 0.0;
+    clock->time        = 0.0;
+    clock->steps       = 0;
+}
+
+int Simulation_Advance(SimulationClock* clock, double frame_time)
+{
+    clock->accumulator += std::max(0.0, frame_time);
+
+    int passos = 0;
+    while (clock->accumulator >= g_SimulationStep && passos < g_SimulationMaxSteps)
+    {
+        clock->accumulator -= g_SimulationStep;
+        clock->time        += g_SimulationStep;
+        passos += 1;
+    }
+
+    // Se a simulação não acompanha o relógio (por exemplo, depois de uma
+    // pausa longa), descartamos o atraso em vez de acumulá-lo.
+    if (clock->accumulator >= g_SimulationStep)
+        clock->accumulator = std::fmod(clock->accumulator, g_SimulationStep);
+
+    clock->steps += passos;
+    return passos;
+}
+
+float Simulation_Alpha(const SimulationClock& clock)
+{
+    return (float)(clock.accumulator / g_SimulationStep);
+}
+
+double Simulation_Now()
+{
+    static const std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+static void Simulador(SimulationStepFunction passo)
+{
+    double proximo = Simulation_Now() + g_SimulationStep;
+
+    while (!g_EncerraSimulador)
+    {
+        double agora = Simulation_Now();
+
+        int passos = 0;
+        while (proximo <= agora && passos < g_SimulationMaxSteps)
+        {
+            passo(g_SimulationStep, proximo);
+            proximo += g_SimulationStep;
+            passos += 1;
+        }
+        if (proximo <= agora)
+            proximo = agora + g_SimulationStep;
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(proximo - Simulation_Now()));
+    }
+}
+
+void SimulationThread_Start(SimulationStepFunction passo)
+{
+    if (g_Simulador.joinable())
+        return;
+    g_EncerraSimulador = false;
+    g_Simulador = std::thread(Simulador, passo);
+}
+
+void SimulationThread_Stop()
+{
+    if (!g_Simulador.joinable())
+        return;
+    g_EncerraSimulador = true;
+    g_Simulador.join();
+}
+
+bool SimulationThread_Running()
+{
+    return g_Simulador.joinable();
+}
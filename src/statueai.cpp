@@ -0,0 +1,659 @@
+#include <cmath>
+#include <functional>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STATUEAI_SSE 1
+#endif
+
+#include "statueai.h"
+#include "lineofsight.h"
+#include "jobs.h"
+#include "framearena.h"
+
+size_t g_StatueAIParallelThreshold = 16384;
+size_t g_StatueAIFlowFieldThreshold = 64;
+size_t g_StatueAISteerParallelThreshold = 512;
+
+void StatueAI_Add(StatueAI* ai, const glm::vec4& centro, const glm::vec3 path[4], int celula)
+{
+    ai->centro_x.push_back(centro.x);
+    ai->centro_y.push_back(centro.y);
+    ai->centro_z.push_back(centro.z);
+    ai->desloc_x.push_back(0.0f);
+    ai->desloc_y.push_back(0.0f);
+    ai->desloc_z.push_back(0.0f);
+    ai->visto.push_back(0);
+    ai->desobstruida.push_back(0);
+    ai->tempo_visto.push_back(0.0f);
+    ai->t.push_back(0.0f);
+    BezierPathBatch_Add(&ai->caminhos, path);
+    ai->rota.push_back(STATUEAI_ROTA_PENDENTE);
+    ai->celula.push_back(celula);
+
+    // As rotas são criadas durante o jogo, sem alocar memória
+    if (ai->rotas.capacity() == 0)
+    {
+        ai->rotas.reserve(STATUEAI_MAX_ROTAS);
+        ai->rotas_livres.reserve(STATUEAI_MAX_ROTAS);
+    }
+    ai->count = ai->celula.size();
+}
+
+// Remove de "v" os elementos da célula "removida", mantendo a ordem.
+template <typename T>
+static void Compacta(std::vector<T>& v, const std::vector<int>& celula, int removida)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < v.size(); ++i)
+        if (celula[i] != removida)
+            v[j++] = v[i];
+    v.resize(j);
+}
+
+void StatueAI_RemoveCell(StatueAI* ai, int celula)
+{
+    if (std::find(ai->celula.begin(), ai->celula.end(), celula) == ai->celula.end())
+        return;
+
+    std::vector<uint8_t> remover(ai->count);
+    for (size_t i = 0; i < ai->count; ++i)
+    {
+        remover[i] = ai->celula[i] == celula;
+        if (remover[i] && ai->rota[i] < STATUEAI_ROTA_CAMPO)
+            ai->rotas_livres.push_back(ai->rota[i]);
+    }
+    BezierPathBatch_Erase(&ai->caminhos, remover);
+
+    Compacta(ai->centro_x, ai->celula, celula);
+    Compacta(ai->centro_y, ai->celula, celula);
+    Compacta(ai->centro_z, ai->celula, celula);
+    Compacta(ai->desloc_x, ai->celula, celula);
+    Compacta(ai->desloc_y, ai->celula, celula);
+    Compacta(ai->desloc_z, ai->celula, celula);
+    Compacta(ai->visto, ai->celula, celula);
+    Compacta(ai->desobstruida, ai->celula, celula);
+    Compacta(ai->tempo_visto, ai->celula, celula);
+    Compacta(ai->t, ai->celula, celula);
+    Compacta(ai->rota, ai->celula, celula);
+    Compacta(ai->celula, ai->celula, celula); // Por último, pois é a chave
+    ai->count = ai->celula.size();
+    ai->proxima_consulta = 0;
+}
+
+struct ParametrosDoPasso
+{
+    float lx, ly, lz;  // Ponto de observação
+    float vx, vy, vz;  // Direção de visão
+    float cos_visao;   // Cosseno de STATUEAI_VIEW_ANGLE
+    float dt;
+};
+
+static ParametrosDoPasso Parametros(const glm::vec4& light_pos, const glm::vec4& view_vector, float dt)
+{
+    ParametrosDoPasso p;
+    p.lx = light_pos.x;
+    p.ly = light_pos.y;
+    p.lz = light_pos.z;
+    p.vx = view_vector.x;
+    p.vy = view_vector.y;
+    p.vz = view_vector.z;
+    p.cos_visao = std::cos(STATUEAI_VIEW_ANGLE * 3.14159265358979323846f / 180.0f);
+    p.dt = dt;
+    return p;
+}
+
+// Verdadeiro se o centro da estátua está no cone de visão.
+static inline bool NoConeDeVisao(const StatueAI* ai, size_t i, const ParametrosDoPasso& p)
+{
+    float lx = p.lx - ai->centro_x[i];
+    float ly = p.ly - ai->centro_y[i];
+    float lz = p.lz - ai->centro_z[i];
+    float comprimento = std::sqrt(lx*lx + ly*ly + lz*lz);
+
+    // cos(ângulo entre -l e a visão) > cos(STATUEAI_VIEW_ANGLE)
+    return -(lx*p.vx + ly*p.vy + lz*p.vz) > p.cos_visao * comprimento;
+}
+
+// Teste de visibilidade e cronômetro de uma estátua que ainda não foge.
+static inline void AtualizaEstatuaParada(StatueAI* ai, size_t i, const ParametrosDoPasso& p)
+{
+    bool olhando = ai->desobstruida[i] && NoConeDeVisao(ai, i, p);
+
+    if (olhando)
+    {
+        ai->tempo_visto[i] += p.dt;
+        if (ai->tempo_visto[i] >= STATUEAI_WATCH_TIME)
+        {
+            ai->visto[i] = 1;
+            ai->tempo_visto[i] = 0.0f;
+        }
+    }
+    else
+        ai->tempo_visto[i] = 0.0f;
+}
+
+// Move ao longo do caminho as estátuas [i, i+n), que estão fugindo. Como no
+// código original, a posição usa o "t" do passo anterior.
+static inline void AtualizaEstatuasFugindo(StatueAI* ai, size_t i, size_t n, float dt)
+{
+    for (size_t j = i; j < i + n; ++j)
+    {
+        ai->desloc_x[j] = -ai->centro_x[j];
+        ai->desloc_y[j] = -ai->centro_y[j];
+        ai->desloc_z[j] = -ai->centro_z[j];
+    }
+
+    BezierPathBatch_Evaluate(ai->caminhos, i, n, ai->t.data(),
+                             ai->centro_x.data(), ai->centro_y.data(), ai->centro_z.data());
+
+    for (size_t j = i; j < i + n; ++j)
+        if (ai->rota[j] < STATUEAI_ROTA_CAMPO)
+        {
+            glm::vec3 centro = NavMesh_PathPoint(ai->rotas[ai->rota[j]], ai->t[j]);
+            ai->centro_x[j] = centro.x;
+            ai->centro_y[j] = centro.y;
+            ai->centro_z[j] = centro.z;
+        }
+        else if (ai->rota[j] == STATUEAI_ROTA_CAMPO)
+        {
+            // Fica onde estava; StatueAI_Steer() a move
+            ai->centro_x[j] = -ai->desloc_x[j];
+            ai->centro_y[j] = -ai->desloc_y[j];
+            ai->centro_z[j] = -ai->desloc_z[j];
+        }
+
+    for (size_t j = i; j < i + n; ++j)
+    {
+        ai->desloc_x[j] += ai->centro_x[j];
+        ai->desloc_y[j] += ai->centro_y[j];
+        ai->desloc_z[j] += ai->centro_z[j];
+
+        ai->tempo_visto[j] += dt;
+        ai->t[j] = 1.0f / (1.0f + std::exp(-2.0f*(ai->tempo_visto[j] - STATUEAI_WATCH_TIME))); // Função Sigmoid
+    }
+}
+
+static void AtualizaFaixa(StatueAI* ai, size_t inicio, size_t fim, const ParametrosDoPasso& p)
+{
+    size_t i = inicio;
+
+#ifdef STATUEAI_SSE
+    // Quatro estátuas por vez. As que estão fugindo são movidas em seguida,
+    // também em grupos de quatro quando possível.
+    const __m128 lx = _mm_set1_ps(p.lx), ly = _mm_set1_ps(p.ly), lz = _mm_set1_ps(p.lz);
+    const __m128 vx = _mm_set1_ps(p.vx), vy = _mm_set1_ps(p.vy), vz = _mm_set1_ps(p.vz);
+    const __m128 cos_visao = _mm_set1_ps(p.cos_visao);
+    const __m128 dt        = _mm_set1_ps(p.dt);
+    const __m128 limite    = _mm_set1_ps(STATUEAI_WATCH_TIME);
+    const __m128 zero      = _mm_setzero_ps();
+    const __m128i um       = _mm_set1_epi32(1);
+
+    for (; i + 4 <= fim; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(lx, _mm_loadu_ps(&ai->centro_x[i]));
+        __m128 dy = _mm_sub_ps(ly, _mm_loadu_ps(&ai->centro_y[i]));
+        __m128 dz = _mm_sub_ps(lz, _mm_loadu_ps(&ai->centro_z[i]));
+
+        __m128 comprimento = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        __m128 cosseno     = _mm_sub_ps(zero, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, vx), _mm_mul_ps(dy, vy)), _mm_mul_ps(dz, vz)));
+        __m128 no_cone     = _mm_cmpgt_ps(cosseno, _mm_mul_ps(cos_visao, comprimento));
+        __m128 olhando     = _mm_and_ps(no_cone, _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)&ai->desobstruida[i]), um)));
+
+        __m128i visto_i = _mm_loadu_si128((const __m128i*)&ai->visto[i]);
+        __m128  visto   = _mm_castsi128_ps(_mm_cmpeq_epi32(visto_i, um));
+
+        __m128 tempo     = _mm_add_ps(_mm_loadu_ps(&ai->tempo_visto[i]), dt);
+        __m128 vira_visto = _mm_andnot_ps(visto, _mm_and_ps(olhando, _mm_cmpge_ps(tempo, limite)));
+
+        // Paradas: o tempo só continua contando enquanto a estátua é
+        // observada, e zera quando ela começa a fugir.
+        __m128 tempo_parada = _mm_andnot_ps(vira_visto, _mm_and_ps(olhando, tempo));
+        __m128 novo_tempo   = _mm_or_ps(_mm_and_ps(visto, _mm_loadu_ps(&ai->tempo_visto[i])),
+                                        _mm_andnot_ps(visto, tempo_parada));
+        _mm_storeu_ps(&ai->tempo_visto[i], novo_tempo);
+
+        __m128i novo_visto = _mm_or_si128(visto_i, _mm_and_si128(_mm_castps_si128(vira_visto), um));
+        _mm_storeu_si128((__m128i*)&ai->visto[i], novo_visto);
+
+        _mm_storeu_ps(&ai->desloc_x[i], zero);
+        _mm_storeu_ps(&ai->desloc_y[i], zero);
+        _mm_storeu_ps(&ai->desloc_z[i], zero);
+
+        int fugindo = _mm_movemask_ps(visto);
+        if (fugindo == 0xF)
+            AtualizaEstatuasFugindo(ai, i, 4, p.dt);
+        else for (int k = 0; fugindo != 0; ++k, fugindo >>= 1)
+            if (fugindo & 1)
+                AtualizaEstatuasFugindo(ai, i + k, 1, p.dt);
+    }
+#endif
+
+    for (; i < fim; ++i)
+    {
+        ai->desloc_x[i] = ai->desloc_y[i] = ai->desloc_z[i] = 0.0f;
+        if (ai->visto[i])
+            AtualizaEstatuasFugindo(ai, i, 1, p.dt);
+        else
+            AtualizaEstatuaParada(ai, i, p);
+    }
+}
+
+void StatueAI_UpdateLineOfSight(StatueAI* ai, size_t first, size_t count,
+                                const glm::vec4& light_pos, const glm::vec4& view_vector)
+{
+    size_t fim = std::min(first + count, ai->count);
+    if (first >= fim)
+        return;
+
+    ParametrosDoPasso p = Parametros(light_pos, view_vector, 0.0f);
+    glm::vec3 olho = glm::vec3(light_pos);
+
+    // Rodízio: começamos pelas estátuas que ficaram sem teste no passo anterior
+    size_t i = ai->proxima_consulta;
+    if (i < first || i >= fim)
+        i = first;
+
+    size_t adiadas = 0, primeira_adiada = i;
+    for (size_t k = first; k < fim; ++k, i = (i + 1 < fim) ? i + 1 : first)
+    {
+        if (ai->visto[i])
+            continue;
+
+        // Fora do cone a estátua não é observada, com ou sem paredes
+        if (!NoConeDeVisao(ai, i, p))
+        {
+            ai->desobstruida[i] = 0;
+            continue;
+        }
+
+        if (LineOfSight_Remaining() == 0)
+        {
+            if (adiadas++ == 0)
+                primeira_adiada = i;
+            continue;
+        }
+
+        glm::vec3 centro = glm::vec3(ai->centro_x[i], ai->centro_y[i], ai->centro_z[i]);
+        ai->desobstruida[i] = LineOfSight_Visible(olho, centro) ? 1 : 0;
+    }
+
+    if (adiadas > 0)
+    {
+        ai->proxima_consulta = primeira_adiada;
+        LineOfSight_Defer(adiadas);
+    }
+}
+
+void StatueAI_Update(StatueAI* ai, size_t first, size_t count,
+                     const glm::vec4& light_pos, const glm::vec4& view_vector, float dt)
+{
+    ParametrosDoPasso p = Parametros(light_pos, view_vector, dt);
+
+    size_t fim = std::min(first + count, ai->count);
+    if (first >= fim)
+        return;
+
+    if (fim - first < g_StatueAIParallelThreshold || Jobs_NumThreads() < 2)
+    {
+        AtualizaFaixa(ai, first, fim, p);
+        return;
+    }
+
+    // Dividimos em grupos de 4 estátuas, para que só a última faixa tenha
+    // um grupo incompleto. Veja "jobs.h".
+    size_t grupos = (fim - first + 3) / 4;
+    Jobs_ParallelFor(0, grupos, 1024, [ai, first, fim, &p](size_t a, size_t b)
+    {
+        AtualizaFaixa(ai, first + 4 * a, std::min(first + 4 * b, fim), p);
+    });
+}
+
+// Destino da fuga da estátua "i": entre as direções que se afastam do
+// jogador, o ponto da malha (na mesma região da estátua) mais longe dele.
+static bool DestinoDaFuga(const StatueAI* ai, size_t i, const NavMesh& navmesh, const glm::vec3& jogador,
+                          const glm::vec3& extents, glm::vec3* destino)
+{
+    glm::vec3 centro(ai->centro_x[i], ai->centro_y[i], ai->centro_z[i]);
+    glm::vec3 inicio;
+    uint32_t origem = NavMesh_ClosestPoint(navmesh, centro, extents, &inicio);
+    if (origem == NAVMESH_NONE)
+        return false;
+
+    float fx = centro.x - jogador.x, fz = centro.z - jogador.z;
+    float comprimento = std::sqrt(fx*fx + fz*fz);
+    if (comprimento > 0.0f)
+    {
+        fx /= comprimento;
+        fz /= comprimento;
+    }
+    else
+    {
+        fx = 1.0f;
+        fz = 0.0f;
+    }
+
+    // Em frente, a 45 e a 90 graus para cada lado; em regiões pequenas (um
+    // cômodo, por exemplo) só os alvos mais próximos caem na região
+    static const float angulos[5] = { 0.0f, 0.785398f, -0.785398f, 1.570796f, -1.570796f };
+    bool  achou = false;
+    float melhor = 0.0f;
+    for (int k = 0; k < 15; ++k)
+    {
+        float c = std::cos(angulos[k % 5]), s = std::sin(angulos[k % 5]);
+        float distancia_alvo = STATUEAI_ESCAPE_DISTANCE / (float)(1 << (k / 5));
+        glm::vec3 alvo = inicio + distancia_alvo * glm::vec3(c*fx - s*fz, 0.0f, s*fx + c*fz);
+
+        glm::vec3 ponto;
+        glm::vec3 busca(distancia_alvo * 0.5f, extents.y, distancia_alvo * 0.5f);
+        if (NavMesh_ClosestPoint(navmesh, alvo, busca, &ponto, navmesh.poligonos[origem].regiao) == NAVMESH_NONE)
+            continue;
+
+        float dx = ponto.x - jogador.x, dz = ponto.z - jogador.z;
+        float distancia = dx*dx + dz*dz;
+        if (!achou || distancia > melhor)
+        {
+            achou   = true;
+            melhor  = distancia;
+            *destino = ponto;
+        }
+    }
+    return achou;
+}
+
+// Verdadeiro se a estátua "i" está sobre uma célula do campo de fuga (com o
+// centro até 2.5 acima do chão dela, como na busca na malha).
+static bool NoCampo(const StatueAI* ai, size_t i, const FlowField& campo)
+{
+    uint32_t c = FlowField_Cell(campo, ai->centro_x[i], ai->centro_z[i]);
+    if (c == FLOWFIELD_NONE)
+        return false;
+    float acima = ai->centro_y[i] - campo.altura[c];
+    return acima >= 0.0f && acima <= 2.5f;
+}
+
+void StatueAI_PlanEscapes(StatueAI* ai, const NavMesh* navmesh, const FlowField* campo,
+                          size_t first, size_t count, const glm::vec4& light_pos)
+{
+    // Cria a arena de rascunho desta thread já nos primeiros passos
+    Arena* rascunho = Arena_Scratch();
+
+    size_t fim = std::min(first + count, ai->count);
+    size_t pendentes = 0;
+    for (size_t i = first; i < fim; ++i)
+        if (ai->visto[i] && ai->rota[i] == STATUEAI_ROTA_PENDENTE)
+        {
+            ai->rota[i] = STATUEAI_SEM_ROTA;
+            pendentes += 1;
+        }
+    if (pendentes == 0)
+        return;
+
+    // Muitas estátuas (ou nenhuma malha): todas seguem o campo
+    if (navmesh == NULL || (campo != NULL && fim - first >= g_StatueAIFlowFieldThreshold))
+    {
+        if (campo != NULL)
+            for (size_t i = first; i < fim; ++i)
+                if (ai->visto[i] && ai->rota[i] == STATUEAI_SEM_ROTA && ai->t[i] == 0.0f && NoCampo(ai, i, *campo))
+                    ai->rota[i] = STATUEAI_ROTA_CAMPO;
+        return;
+    }
+
+    ArenaScope escopo(rascunho);
+    NavMeshQuery* consultas = Arena_New<NavMeshQuery>(rascunho, pendentes);
+    uint32_t*     estatuas  = Arena_New<uint32_t>(rascunho, pendentes);
+
+    // Procura o chão abaixo do centro da estátua, que está acima dele
+    glm::vec3 jogador = glm::vec3(light_pos);
+    glm::vec3 extents = glm::vec3(2.0f, 2.5f, 2.0f);
+    size_t n = 0;
+    for (size_t i = first; i < fim; ++i)
+        if (ai->visto[i] && ai->rota[i] == STATUEAI_SEM_ROTA && ai->t[i] == 0.0f
+         && ai->rotas.size() + n - ai->rotas_livres.size() < STATUEAI_MAX_ROTAS)
+        {
+            NavMeshQuery& q = consultas[n];
+            q.inicio  = glm::vec3(ai->centro_x[i], ai->centro_y[i], ai->centro_z[i]);
+            q.extents = extents;
+            if (!DestinoDaFuga(ai, i, *navmesh, jogador, extents, &q.fim))
+                continue;
+            estatuas[n++] = (uint32_t)i;
+        }
+
+    NavMeshPath* caminhos = Arena_New<NavMeshPath>(rascunho, n);
+    NavMesh_FindPaths(*navmesh, consultas, n, caminhos);
+
+    for (size_t k = 0; k < n; ++k)
+    {
+        NavMeshPath& c = caminhos[k];
+        if (c.num_pontos == 0)
+            continue;
+
+        // A rota começa no centro da estátua e segue o chão à mesma altura
+        glm::vec3 centro = consultas[k].inicio;
+        float altura = centro.y - c.pontos[0].y;
+        for (uint32_t p = 0; p < c.num_pontos; ++p)
+            c.pontos[p].y += altura;
+        c.pontos[0] = centro;
+        c.comprimento = 0.0f;
+        for (uint32_t p = 1; p < c.num_pontos; ++p)
+            c.comprimento += glm::distance(c.pontos[p - 1], c.pontos[p]);
+
+        uint32_t indice;
+        if (!ai->rotas_livres.empty())
+        {
+            indice = ai->rotas_livres.back();
+            ai->rotas_livres.pop_back();
+            ai->rotas[indice] = c;
+        }
+        else
+        {
+            indice = (uint32_t)ai->rotas.size();
+            ai->rotas.push_back(c);
+        }
+        ai->rota[estatuas[k]] = indice;
+    }
+
+    // As que ficaram sem rota seguem o campo, se possível
+    if (campo != NULL)
+        for (size_t i = first; i < fim; ++i)
+            if (ai->visto[i] && ai->rota[i] == STATUEAI_SEM_ROTA && ai->t[i] == 0.0f && NoCampo(ai, i, *campo))
+                ai->rota[i] = STATUEAI_ROTA_CAMPO;
+}
+
+// Entrada da tabela de espalhamento espacial para a célula (cx, cz), de
+// lado STATUEAI_SEPARATION_RADIUS. "mascara" é o tamanho da tabela menos um.
+static inline uint32_t Espalhamento(int32_t cx, int32_t cz, uint32_t mascara)
+{
+    return ((uint32_t)cx * 73856093u ^ (uint32_t)cz * 19349663u) & mascara;
+}
+
+// Afastamento de (x, z) das estátuas mais próximas que
+// STATUEAI_SEPARATION_RADIUS, procuradas nas 3x3 células da tabela de
+// espalhamento em volta (as estátuas da entrada h estão em [inicio[h],
+// inicio[h+1]) das posições ordenadas ox, oz): na direção oposta a cada uma,
+// com intensidade de 1 (encostadas) a 0 (no raio). A própria estátua, à
+// distância zero, não conta.
+static glm::vec2 Separacao(const float* ox, const float* oz, const uint32_t* inicio, uint32_t mascara,
+                           float x, float z)
+{
+    const float raio = STATUEAI_SEPARATION_RADIUS;
+    const float inv_lado = 1.0f / STATUEAI_SEPARATION_RADIUS;
+    int32_t cx = (int32_t)std::floor(x * inv_lado), cz = (int32_t)std::floor(z * inv_lado);
+
+#ifdef STATUEAI_SSE
+    // Quatro vizinhas por vez; as posições têm 3 floats extras no fim, e as
+    // que passam do fim da entrada são descartadas pela máscara. Com
+    // intensidade 1 - d/raio, o peso de (x - ox, z - oz) é 1/d - 1/raio.
+    const __m128  px = _mm_set1_ps(x), pz = _mm_set1_ps(z);
+    const __m128  r2 = _mm_set1_ps(raio * raio);
+    const __m128  inv_r = _mm_set1_ps(1.0f / raio);
+    const __m128  minimo = _mm_set1_ps(1e-6f);
+    const __m128i faixas = _mm_setr_epi32(0, 1, 2, 3);
+    __m128 ax = _mm_setzero_ps(), az = _mm_setzero_ps();
+#else
+    float sx = 0.0f, sz = 0.0f;
+#endif
+
+    uint32_t vistas[9];
+    int num_vistas = 0;
+    for (int32_t dz = -1; dz <= 1; ++dz)
+        for (int32_t dx = -1; dx <= 1; ++dx)
+        {
+            uint32_t h = Espalhamento(cx + dx, cz + dz, mascara);
+            if (std::find(vistas, vistas + num_vistas, h) != vistas + num_vistas)
+                continue; // Duas células na mesma entrada
+            vistas[num_vistas++] = h;
+
+            uint32_t a = inicio[h], b = inicio[h + 1];
+#ifdef STATUEAI_SSE
+            const __m128i fim = _mm_set1_epi32((int32_t)b);
+            for (uint32_t k = a; k < b; k += 4)
+            {
+                __m128 ddx = _mm_sub_ps(px, _mm_loadu_ps(ox + k));
+                __m128 ddz = _mm_sub_ps(pz, _mm_loadu_ps(oz + k));
+                __m128 d2  = _mm_add_ps(_mm_mul_ps(ddx, ddx), _mm_mul_ps(ddz, ddz));
+                __m128 dentro = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_add_epi32(_mm_set1_epi32((int32_t)k), faixas), fim));
+                __m128 perto  = _mm_and_ps(dentro, _mm_and_ps(_mm_cmplt_ps(d2, r2), _mm_cmpgt_ps(d2, minimo)));
+                __m128 peso   = _mm_and_ps(perto, _mm_sub_ps(_mm_rsqrt_ps(_mm_max_ps(d2, minimo)), inv_r));
+                ax = _mm_add_ps(ax, _mm_mul_ps(ddx, peso));
+                az = _mm_add_ps(az, _mm_mul_ps(ddz, peso));
+            }
+#else
+            for (uint32_t k = a; k < b; ++k)
+            {
+                float ddx = x - ox[k], ddz = z - oz[k];
+                float d2 = ddx*ddx + ddz*ddz;
+                if (d2 >= raio * raio || d2 <= 1e-6f)
+                    continue;
+                float peso = 1.0f / std::sqrt(d2) - 1.0f / raio;
+                sx += ddx * peso;
+                sz += ddz * peso;
+            }
+#endif
+        }
+
+#ifdef STATUEAI_SSE
+    float soma_x[4], soma_z[4];
+    _mm_storeu_ps(soma_x, ax);
+    _mm_storeu_ps(soma_z, az);
+    float sx = (soma_x[0] + soma_x[1]) + (soma_x[2] + soma_x[3]);
+    float sz = (soma_z[0] + soma_z[1]) + (soma_z[2] + soma_z[3]);
+#endif
+    return glm::vec2(sx, sz);
+}
+
+void StatueAI_Steer(StatueAI* ai, const FlowField& campo, size_t first, size_t count, float dt)
+{
+    // Cria a arena de rascunho desta thread já nos primeiros passos
+    Arena* rascunho = Arena_Scratch();
+
+    size_t fim = std::min(first + count, ai->count);
+    size_t guiadas = 0;
+    for (size_t i = first; i < fim; ++i)
+        guiadas += ai->rota[i] == STATUEAI_ROTA_CAMPO;
+    if (guiadas == 0 || !campo.pronto)
+        return;
+
+    ArenaScope escopo(rascunho);
+    size_t n = fim - first;
+
+    // Tabela de espalhamento com todas as estátuas (as paradas também
+    // afastam as que fogem), ordenadas por entrada da tabela (veja
+    // Separacao())
+    size_t tamanho = 16;
+    while (tamanho < 2 * n)
+        tamanho *= 2;
+    const uint32_t mascara = (uint32_t)tamanho - 1;
+    const float    inv_lado = 1.0f / STATUEAI_SEPARATION_RADIUS;
+
+    uint32_t* inicio = Arena_New<uint32_t>(rascunho, tamanho + 1);
+    uint32_t* chave  = Arena_New<uint32_t>(rascunho, n);
+    float*    ox     = Arena_New<float>(rascunho, n + 3); // Veja Separacao()
+    float*    oz     = Arena_New<float>(rascunho, n + 3);
+    std::fill(inicio, inicio + tamanho + 1, 0u);
+    std::fill(ox + n, ox + n + 3, 0.0f);
+    std::fill(oz + n, oz + n + 3, 0.0f);
+    for (size_t i = 0; i < n; ++i)
+    {
+        chave[i] = Espalhamento((int32_t)std::floor(ai->centro_x[first + i] * inv_lado),
+                                (int32_t)std::floor(ai->centro_z[first + i] * inv_lado), mascara);
+        inicio[chave[i]] += 1;
+    }
+    for (size_t h = 1; h <= tamanho; ++h)
+        inicio[h] += inicio[h - 1];
+    for (size_t i = n; i-- > 0; )
+    {
+        uint32_t k = --inicio[chave[i]];
+        ox[k] = ai->centro_x[first + i];
+        oz[k] = ai->centro_z[first + i];
+    }
+
+    uint32_t* estatuas = Arena_New<uint32_t>(rascunho, guiadas);
+    float*    novo_x   = Arena_New<float>(rascunho, guiadas);
+    float*    novo_y   = Arena_New<float>(rascunho, guiadas);
+    float*    novo_z   = Arena_New<float>(rascunho, guiadas);
+    for (size_t i = first, k = 0; i < fim; ++i)
+        if (ai->rota[i] == STATUEAI_ROTA_CAMPO)
+            estatuas[k++] = (uint32_t)i;
+
+    auto move = [&](size_t a, size_t b)
+    {
+        for (size_t k = a; k < b; ++k)
+        {
+            size_t i = estatuas[k];
+            float x = ai->centro_x[i], y = ai->centro_y[i], z = ai->centro_z[i];
+
+            glm::vec2 direcao = FlowField_Sample(campo, x, z)
+                              + STATUEAI_SEPARATION_WEIGHT * Separacao(ox, oz, inicio, mascara, x, z);
+            float comprimento = glm::length(direcao);
+            if (comprimento > 1.0f)
+                direcao /= comprimento;
+
+            // Derivada da sigmoide de AtualizaEstatuasFugindo(): percorre
+            // STATUEAI_ESCAPE_DISTANCE no total, como o caminho fixo
+            float t = ai->t[i];
+            direcao *= STATUEAI_ESCAPE_DISTANCE * 2.0f * t * (1.0f - t) * dt;
+
+            // Sem entrar em células fora do campo ou altas demais: tenta o
+            // passo inteiro e depois só em x ou só em z
+            uint32_t origem = FlowField_Cell(campo, x, z);
+            const float passos[3][2] = { { direcao.x, direcao.y }, { direcao.x, 0.0f }, { 0.0f, direcao.y } };
+            for (int p = 0; p < 3; ++p)
+            {
+                uint32_t destino = FlowField_Cell(campo, x + passos[p][0], z + passos[p][1]);
+                if (destino == FLOWFIELD_NONE)
+                    continue;
+                float subida = origem != FLOWFIELD_NONE ? campo.altura[destino] - campo.altura[origem] : 0.0f;
+                if (std::fabs(subida) > campo.agent_climb)
+                    continue;
+                x += passos[p][0];
+                z += passos[p][1];
+                y += subida;
+                break;
+            }
+
+            novo_x[k] = x;
+            novo_y[k] = y;
+            novo_z[k] = z;
+        }
+    };
+
+    if (guiadas < g_StatueAISteerParallelThreshold || Jobs_NumThreads() < 2)
+        move(0, guiadas);
+    else
+        Jobs_ParallelFor(0, guiadas, 128, move);
+
+    for (size_t k = 0; k < guiadas; ++k)
+    {
+        size_t i = estatuas[k];
+        ai->desloc_x[i] += novo_x[k] - ai->centro_x[i];
+        ai->desloc_y[i] += novo_y[k] - ai->centro_y[i];
+        ai->desloc_z[i] += novo_z[k] - ai->centro_z[i];
+        ai->centro_x[i] = novo_x[k];
+        ai->centro_y[i] = novo_y[k];
+        ai->centro_z[i] = novo_z[k];
+    }
+}
@@ -0,0 +1,212 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "streambuffer.h"
+
+#include <GLFW/glfw3.h>
+
+#define STREAMBUFFER_REGIOES 3
+
+// As regiões começam em múltiplos deste valor, que cobre os alinhamentos
+// usuais (vértices, GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+#define STREAMBUFFER_ALINHAMENTO_REGIAO 256
+
+// GL_ARB_buffer_storage não faz parte do OpenGL 3.3 carregado pelo glad:
+// a função é obtida com glfwGetProcAddress().
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT   0x0080
+#endif
+typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static BufferStorageProc g_BufferStorage = NULL;
+
+static GLuint         g_Buffer         = 0;
+static size_t         g_BytesPorRegiao = 0;
+static unsigned char* g_Persistente    = NULL; // Mapeamento do buffer inteiro, com GL_ARB_buffer_storage
+static GLsync         g_Fences[STREAMBUFFER_REGIOES];
+
+static int    g_Regiao       = 0;     // Região do quadro atual
+static size_t g_Usado        = 0;     // Bytes usados na região atual
+static bool   g_RegiaoLivre  = false; // A fence da região atual já foi esperada
+static bool   g_Mapeado      = false; // Última alocação ainda mapeada (sem GL_ARB_buffer_storage)
+
+static StreamBufferStats g_Stats;
+
+static void CriaBuffer(size_t bytes_por_regiao)
+{
+    g_BytesPorRegiao = (bytes_por_regiao + STREAMBUFFER_ALINHAMENTO_REGIAO - 1)
+                     / STREAMBUFFER_ALINHAMENTO_REGIAO * STREAMBUFFER_ALINHAMENTO_REGIAO;
+    GLsizeiptr total = (GLsizeiptr)(g_BytesPorRegiao * STREAMBUFFER_REGIOES);
+
+    // GL_COPY_WRITE_BUFFER não altera o GL_ARRAY_BUFFER de quem nos chama
+    glGenBuffers(1, &g_Buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_Buffer);
+    if (g_BufferStorage != NULL)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        g_BufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+        g_Persistente = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+        if (g_Persistente == NULL)
+        {
+            fprintf(stderr, "ERROR: não foi possível mapear o buffer circular (%lu bytes).\n", (unsigned long)total);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    else
+        glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+
+    for (int i = 0; i < STREAMBUFFER_REGIOES; ++i)
+        g_Fences[i] = 0;
+    g_Regiao      = 0;
+    g_Usado       = 0;
+    g_RegiaoLivre = true;
+    g_Stats.frame_bytes = g_BytesPorRegiao;
+}
+
+// Os desenhos já emitidos continuam válidos: OpenGL só destrói o buffer
+// quando a GPU não precisa mais dele.
+static void DestroiBuffer()
+{
+    if (g_Persistente != NULL)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_Buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        g_Persistente = NULL;
+    }
+    glDeleteBuffers(1, &g_Buffer);
+    g_Buffer = 0;
+
+    for (int i = 0; i < STREAMBUFFER_REGIOES; ++i)
+        if (g_Fences[i] != 0)
+            glDeleteSync(g_Fences[i]);
+}
+
+// Espera a GPU terminar de ler a região atual, o que normalmente já
+// aconteceu: a fence foi colocada três quadros atrás.
+static void EsperaRegiao()
+{
+    g_RegiaoLivre = true;
+    GLsync fence = g_Fences[g_Regiao];
+    if (fence == 0)
+        return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+        do
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        while (status == GL_TIMEOUT_EXPIRED);
+
+        g_Stats.stalls   += 1;
+        g_Stats.stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+    }
+    if (status == GL_WAIT_FAILED)
+        fprintf(stderr, "WARNING: falha ao esperar a fence do buffer circular.\n");
+
+    glDeleteSync(fence);
+    g_Fences[g_Regiao] = 0;
+}
+
+void StreamBuffer_Init(size_t frame_bytes)
+{
+    memset(&g_Stats, 0, sizeof(g_Stats));
+
+    g_BufferStorage = NULL;
+    if (glfwExtensionSupported("GL_ARB_buffer_storage"))
+        g_BufferStorage = (BufferStorageProc)glfwGetProcAddress("glBufferStorage");
+    g_Stats.persistent = g_BufferStorage != NULL;
+
+    CriaBuffer(frame_bytes);
+}
+
+void StreamBuffer_Shutdown()
+{
+    StreamBuffer_Commit();
+    DestroiBuffer();
+}
+
+StreamAllocation StreamBuffer_Allocate(size_t bytes, size_t align)
+{
+    StreamBuffer_Commit();
+    if (!g_RegiaoLivre)
+        EsperaRegiao();
+    if (align == 0)
+        align = 1;
+
+    size_t base   = (size_t)g_Regiao * g_BytesPorRegiao;
+    size_t inicio = (base + g_Usado + align - 1) / align * align - base;
+    if (inicio + bytes > g_BytesPorRegiao)
+    {
+        // A região não basta para este quadro: trocamos o buffer por um
+        // maior, que começa sem nenhuma região em uso
+        size_t novo = std::max(2 * g_BytesPorRegiao, bytes + align);
+        DestroiBuffer();
+        CriaBuffer(novo);
+        g_Stats.grows += 1;
+
+        base   = 0;
+        inicio = 0;
+    }
+    g_Usado = inicio + bytes;
+    g_Stats.peak_bytes   = std::max(g_Stats.peak_bytes, g_Usado);
+    g_Stats.allocations += 1;
+
+    StreamAllocation a;
+    a.offset = (GLintptr)(base + inicio);
+    a.buffer = g_Buffer;
+    if (g_Persistente != NULL)
+        a.ptr = g_Persistente + a.offset;
+    else if (bytes == 0)
+        a.ptr = NULL;
+    else
+    {
+        // A fence da região já foi esperada: a GPU não lê esta faixa e não
+        // há por que sincronizar o mapeamento
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_Buffer);
+        a.ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, a.offset, (GLsizeiptr)bytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (a.ptr == NULL)
+        {
+            fprintf(stderr, "ERROR: não foi possível mapear %lu bytes do buffer circular.\n", (unsigned long)bytes);
+            std::exit(EXIT_FAILURE);
+        }
+        g_Mapeado = true;
+    }
+    return a;
+}
+
+void StreamBuffer_Commit()
+{
+    if (!g_Mapeado)
+        return;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_Buffer);
+    if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE)
+        fprintf(stderr, "WARNING: o conteúdo do buffer circular foi perdido.\n");
+    g_Mapeado = false;
+}
+
+void StreamBuffer_EndFrame()
+{
+    StreamBuffer_Commit();
+
+    // Regiões não usadas no quadro mantêm a fence antiga
+    if (g_RegiaoLivre)
+        g_Fences[g_Regiao] = g_Usado > 0 ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+
+    g_Regiao      = (g_Regiao + 1) % STREAMBUFFER_REGIOES;
+    g_Usado       = 0;
+    g_RegiaoLivre = false;
+    g_Stats.frames += 1;
+}
+
+StreamBufferStats StreamBuffer_Stats()
+{
+    return g_Stats;
+}
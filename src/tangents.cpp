@@ -0,0 +1,358 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include "tangents.h"
+#include "normals.h"
+#include "mappedfile.h"
+#include "jobs.h"
+
+// Elementos (triângulos ou quinas) por tarefa
+#define TANGENTS_GRAO 4096
+
+// Partes da soldagem: bits mais altos do hash de cada quina
+#define TANGENTS_BITS_DAS_PARTES 10
+#define TANGENTS_PARTES (1u << TANGENTS_BITS_DAS_PARTES)
+
+static inline glm::vec3 Vetor3(const float* v, size_t stride, size_t q)
+{
+    const float* p = v + stride * q;
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+static inline glm::vec3 Normaliza(const glm::vec3& v)
+{
+    float comprimento = std::sqrt(glm::dot(v, v));
+    return comprimento > 0.0f ? v / comprimento : glm::vec3(0.0f);
+}
+
+// Componente de v no plano perpendicular à normal unitária n
+static inline glm::vec3 Projeta(const glm::vec3& v, const glm::vec3& n)
+{
+    return v - n * glm::dot(n, v);
+}
+
+// Atributos que definem um vértice soldado
+struct ChaveDaQuina
+{
+    float valores[8]; // Posição, normal e coordenada de textura
+
+    bool operator==(const ChaveDaQuina& o) const
+    {
+        for (int i = 0; i < 8; ++i)
+            if (valores[i] != o.valores[i])
+                return false;
+        return true;
+    }
+};
+
+static inline ChaveDaQuina Chave(const float* positions, size_t position_stride,
+                                 const float* normals, size_t normal_stride,
+                                 const float* texcoords, size_t texcoord_stride, size_t q)
+{
+    ChaveDaQuina c;
+    memcpy(&c.valores[0], positions + position_stride * q, 3 * sizeof(float));
+    memcpy(&c.valores[3], normals + normal_stride * q, 3 * sizeof(float));
+    memcpy(&c.valores[6], texcoords + texcoord_stride * q, 2 * sizeof(float));
+    return c;
+}
+
+// FNV-1a de 64 bits sobre os bits dos atributos. Somar 0 troca -0 por +0,
+// que são iguais para ChaveDaQuina::operator==.
+static inline uint64_t Hash(const ChaveDaQuina& c)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (int i = 0; i < 8; ++i)
+    {
+        float f = c.valores[i] + 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        for (int b = 0; b < 4; ++b)
+            h = (h ^ ((bits >> (8 * b)) & 0xFF)) * 1099511628211ull;
+    }
+    return h;
+}
+
+// Tangente qualquer perpendicular a n, para vértices cujos triângulos não
+// têm coordenadas de textura distintas
+static glm::vec3 TangenteArbitraria(const glm::vec3& n)
+{
+    glm::vec3 eixo = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 t = Normaliza(Projeta(eixo, n));
+    return t != glm::vec3(0.0f) ? t : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+// Quina de uma parte da soldagem
+struct QuinaDaParte
+{
+    uint64_t hash;
+    uint32_t quina;
+
+    bool operator<(const QuinaDaParte& o) const
+    {
+        return hash != o.hash ? hash < o.hash : quina < o.quina;
+    }
+};
+
+// Vértice soldado: somas separadas por orientação do triângulo
+struct GrupoDeQuinas
+{
+    uint32_t  representante; // Primeira quina do grupo
+    glm::vec3 soma[2];       // [0] = orientação preservada, [1] = espelhada
+    float     peso[2];
+};
+
+void Tangents_Compute(const float* positions, size_t position_stride,
+                      const float* normals, size_t normal_stride,
+                      const float* texcoords, size_t texcoord_stride,
+                      size_t num_corners, float* tangents)
+{
+    size_t num_triangulos = num_corners / 3;
+    size_t num_quinas     = 3 * num_triangulos;
+
+    // 1. Tangente de cada triângulo, unitária e com o sentido da orientação
+    //    da textura; orientação 0 se as coordenadas de textura não têm área.
+    std::vector<glm::vec3> tangente_da_face(num_triangulos);
+    std::vector<int8_t>    orientacao(num_triangulos);
+
+    Jobs_ParallelFor(0, num_triangulos, TANGENTS_GRAO, [&](size_t a, size_t b)
+    {
+        for (size_t t = a; t < b; ++t)
+        {
+            glm::vec3 p0 = Vetor3(positions, position_stride, 3*t + 0);
+            glm::vec3 d1 = Vetor3(positions, position_stride, 3*t + 1) - p0;
+            glm::vec3 d2 = Vetor3(positions, position_stride, 3*t + 2) - p0;
+
+            const float* uv0 = texcoords + texcoord_stride * (3*t + 0);
+            const float* uv1 = texcoords + texcoord_stride * (3*t + 1);
+            const float* uv2 = texcoords + texcoord_stride * (3*t + 2);
+            float t21x = uv1[0] - uv0[0], t21y = uv1[1] - uv0[1];
+            float t31x = uv2[0] - uv0[0], t31y = uv2[1] - uv0[1];
+
+            float area = t21x*t31y - t21y*t31x;
+            glm::vec3 s = t31y*d1 - t21y*d2;
+            float comprimento = std::sqrt(glm::dot(s, s));
+
+            if (area != 0.0f && comprimento > 0.0f)
+            {
+                orientacao[t]       = area > 0.0f ? 1 : -1;
+                tangente_da_face[t] = s * ((area > 0.0f ? 1.0f : -1.0f) / comprimento);
+            }
+            else
+            {
+                orientacao[t]       = 0;
+                tangente_da_face[t] = glm::vec3(0.0f);
+            }
+        }
+    });
+
+    // 2. Contribuição de cada quina: a tangente do triângulo no plano da
+    //    normal da quina, vezes o ângulo do triângulo nesse plano. Junto,
+    //    o hash do vértice soldado.
+    std::vector<glm::vec3> contribuicao(num_quinas);
+    std::vector<float>     peso(num_quinas);
+    std::vector<uint64_t>  hashes(num_quinas);
+
+    Jobs_ParallelFor(0, num_quinas, TANGENTS_GRAO, [&](size_t a, size_t b)
+    {
+        for (size_t q = a; q < b; ++q)
+        {
+            hashes[q] = Hash(Chave(positions, position_stride, normals, normal_stride,
+                                   texcoords, texcoord_stride, q));
+
+            size_t t = q / 3;
+            contribuicao[q] = glm::vec3(0.0f);
+            peso[q] = 0.0f;
+            if (orientacao[t] == 0)
+                continue;
+
+            glm::vec3 n = Normaliza(Vetor3(normals, normal_stride, q));
+            glm::vec3 tangente = Normaliza(Projeta(tangente_da_face[t], n));
+
+            size_t j = q % 3;
+            glm::vec3 p  = Vetor3(positions, position_stride, q);
+            glm::vec3 e1 = Normaliza(Projeta(Vetor3(positions, position_stride, 3*t + (j + 1) % 3) - p, n));
+            glm::vec3 e2 = Normaliza(Projeta(Vetor3(positions, position_stride, 3*t + (j + 2) % 3) - p, n));
+            float angulo = std::acos(std::max(-1.0f, std::min(1.0f, glm::dot(e1, e2))));
+
+            contribuicao[q] = tangente * angulo;
+            peso[q]         = angulo;
+        }
+    });
+
+    // 3. Quinas de cada parte da soldagem, em ordem crescente (ordenação
+    //    por contagem, estável)
+    std::vector<uint32_t> inicio(TANGENTS_PARTES + 1, 0);
+    for (size_t q = 0; q < num_quinas; ++q)
+        inicio[(hashes[q] >> (64 - TANGENTS_BITS_DAS_PARTES)) + 1] += 1;
+    for (uint32_t p = 0; p < TANGENTS_PARTES; ++p)
+        inicio[p + 1] += inicio[p];
+
+    std::vector<uint32_t> ordem(num_quinas);
+    {
+        std::vector<uint32_t> proxima(inicio.begin(), inicio.end() - 1);
+        for (size_t q = 0; q < num_quinas; ++q)
+            ordem[proxima[hashes[q] >> (64 - TANGENTS_BITS_DAS_PARTES)]++] = (uint32_t)q;
+    }
+
+    // 4. Cada parte solda suas quinas e escreve as tangentes. As partes não
+    //    compartilham quinas, e as somas seguem a ordem das quinas.
+    Jobs_ParallelFor(0, TANGENTS_PARTES, 16, [&](size_t a, size_t b)
+    {
+        std::vector<QuinaDaParte>  quinas;
+        std::vector<GrupoDeQuinas> grupos;
+        std::vector<uint32_t>      grupo_da_quina;
+
+        for (size_t parte = a; parte < b; ++parte)
+        {
+            quinas.clear();
+            for (uint32_t k = inicio[parte]; k < inicio[parte + 1]; ++k)
+            {
+                QuinaDaParte qp = { hashes[ordem[k]], ordem[k] };
+                quinas.push_back(qp);
+            }
+            std::sort(quinas.begin(), quinas.end());
+
+            grupos.clear();
+            grupo_da_quina.resize(quinas.size());
+            for (size_t i = 0; i < quinas.size(); )
+            {
+                // Quinas com o mesmo hash; colisões são separadas comparando
+                // os atributos com o representante de cada grupo
+                size_t fim = i;
+                while (fim < quinas.size() && quinas[fim].hash == quinas[i].hash)
+                    ++fim;
+
+                size_t primeiro_grupo = grupos.size();
+                for (size_t k = i; k < fim; ++k)
+                {
+                    uint32_t q = quinas[k].quina;
+                    ChaveDaQuina chave = Chave(positions, position_stride, normals, normal_stride,
+                                               texcoords, texcoord_stride, q);
+                    size_t g = primeiro_grupo;
+                    while (g < grupos.size()
+                        && !(Chave(positions, position_stride, normals, normal_stride,
+                                   texcoords, texcoord_stride, grupos[g].representante) == chave))
+                        ++g;
+                    if (g == grupos.size())
+                    {
+                        GrupoDeQuinas novo;
+                        novo.representante = q;
+                        novo.soma[0] = novo.soma[1] = glm::vec3(0.0f);
+                        novo.peso[0] = novo.peso[1] = 0.0f;
+                        grupos.push_back(novo);
+                    }
+                    grupo_da_quina[k] = (uint32_t)g;
+
+                    int8_t o = orientacao[q / 3];
+                    if (o != 0)
+                    {
+                        int lado = o > 0 ? 0 : 1;
+                        grupos[g].soma[lado] += contribuicao[q];
+                        grupos[g].peso[lado] += peso[q];
+                    }
+                }
+                i = fim;
+            }
+
+            for (size_t k = 0; k < quinas.size(); ++k)
+            {
+                uint32_t q = quinas[k].quina;
+                const GrupoDeQuinas& g = grupos[grupo_da_quina[k]];
+
+                // Triângulo sem área de textura: usa a orientação com mais peso
+                int8_t o = orientacao[q / 3];
+                int lado = o > 0 ? 0 : o < 0 ? 1 : (g.peso[1] > g.peso[0] ? 1 : 0);
+
+                glm::vec3 n = Normaliza(Vetor3(normals, normal_stride, q));
+                glm::vec3 tangente = Normaliza(g.soma[lado]);
+                if (tangente == glm::vec3(0.0f))
+                    tangente = TangenteArbitraria(n);
+
+                float* saida = tangents + 4 * q;
+                saida[0] = tangente.x;
+                saida[1] = tangente.y;
+                saida[2] = tangente.z;
+                saida[3] = lado == 0 ? 1.0f : -1.0f;
+            }
+        }
+    });
+}
+
+// Cabeçalho do cache, seguido de 4 floats por quina
+struct TangentsCacheHeader
+{
+    char     magic[4];     // "FCGN"
+    uint32_t version;
+    uint64_t source_size;  // Tamanho e data de modificação do ".obj"
+    int64_t  source_mtime;
+    uint64_t num_corners;
+    uint32_t normals_weight; // g_NormalsWeight e g_NormalsCreaseAngle
+    float    crease_angle;
+};
+
+static const uint32_t TANGENTS_CACHE_VERSION = 1;
+
+bool Tangents_SaveCache(const char* filename, const char* source,
+                        const float* tangents, size_t num_corners)
+{
+    TangentsCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "FCGN", 4);
+    header.version        = TANGENTS_CACHE_VERSION;
+    header.num_corners    = num_corners;
+    header.normals_weight = (uint32_t)g_NormalsWeight;
+    header.crease_angle   = g_NormalsCreaseAngle;
+    if (!File_Stamp(source, &header.source_size, &header.source_mtime))
+        return false;
+
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL)
+        return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(tangents, 4 * sizeof(float), num_corners, f) == num_corners;
+
+    fclose(f);
+    if (!ok)
+        remove(filename);
+
+    return ok;
+}
+
+bool Tangents_LoadCache(const char* filename, const char* source,
+                        size_t num_corners, float* tangents)
+{
+    uint64_t size;
+    int64_t  mtime;
+    if (!File_Stamp(source, &size, &mtime))
+        return false;
+
+    MappedFile file;
+    if (!MappedFile_Open(&file, filename))
+        return false;
+
+    TangentsCacheHeader header;
+    bool ok = file.size == sizeof(header) + 4 * sizeof(float) * num_corners;
+    if (ok)
+    {
+        memcpy(&header, file.data, sizeof(header));
+        ok = memcmp(header.magic, "FCGN", 4) == 0
+          && header.version == TANGENTS_CACHE_VERSION
+          && header.source_size == size && header.source_mtime == mtime
+          && header.num_corners == num_corners
+          && header.normals_weight == (uint32_t)g_NormalsWeight
+          && header.crease_angle == g_NormalsCreaseAngle;
+    }
+    if (ok)
+        memcpy(tangents, file.data + sizeof(header), 4 * sizeof(float) * num_corners);
+
+    MappedFile_Close(&file);
+    return ok;
+}
@@ -1,6 +1,7 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <cstring>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,6 +11,7 @@
 
 #include "utils.h"
 #include "dejavufont.h"
+#include "streambuffer.h"
 
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
 
@@ -83,7 +85,7 @@ void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_i
 }
 
 GLuint textVAO;
-GLuint textVBO;
+GLuint textVBO; // Buffer apontado por textVAO: o de "streambuffer.h", que muda quando cresce
 GLuint textprogram_id;
 GLuint texttexture_id;
 
@@ -91,7 +93,7 @@ void TextRendering_Init()
 {
     GLuint sampler;
 
-    glGenBuffers(1, &textVBO);
+    textVBO = 0;
     glGenVertexArrays(1, &textVAO);
     glGenTextures(1, &texttexture_id);
     glGenSamplers(1, &sampler);
@@ -124,27 +126,19 @@ void TextRendering_Init()
     glBindSampler(textureunit, sampler);
     glCheckError();
 
-    glBindVertexArray(textVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
-    glCheckError();
-
     glUseProgram(textprogram_id);
     glUniform1i(texttex_uniform, textureunit);
     glUseProgram(0);
     glCheckError();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
     glCheckError();
 }
 
+struct TextVertex {float x, y, s, t;};
+
 float textscale = 5.0f;
 
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+void TextRendering_PrintString(GLFWwindow* window, const char* str, float x, float y, float scale = 1.0f)
 {
     scale *= textscale;
     int width, height;
@@ -152,7 +146,18 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
     float sx = scale / width;
     float sy = scale / height;
 
-    for (size_t i = 0; i < str.size(); i++)
+    size_t len = strlen(str);
+    if (len == 0)
+        return;
+
+    // Os vértices de todos os caracteres vão para o buffer circular (veja
+    // "streambuffer.h") e são desenhados de uma só vez. Caracteres sem
+    // glifo não usam os seus 6 vértices.
+    StreamAllocation a = StreamBuffer_Allocate(6 * len * sizeof(TextVertex), sizeof(TextVertex));
+    TextVertex* data = (TextVertex*)a.ptr;
+    size_t num_vertices = 0;
+
+    for (size_t i = 0; i < len; i++)
     {
         // Find the glyph for the character we are looking for
         texture_glyph_t *glyph = 0;
@@ -178,7 +183,7 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
         float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
 
-        struct {float x, y, s, t;} data[6] = {
+        TextVertex quad[6] = {
             { x0, y0, s0, t0 },
             { x0, y1, s0, t1 },
             { x1, y1, s1, t1 },
@@ -186,29 +191,42 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
             { x1, y1, s1, t1 },
             { x1, y0, s1, t0 }
         };
+        memcpy(data + num_vertices, quad, sizeof(quad));
+        num_vertices += 6;
+
+        x += (glyph->advance_x * sx);
+    }
+    StreamBuffer_Commit();
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (num_vertices == 0)
+        return;
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
+    glBindVertexArray(textVAO);
+    if (a.buffer != textVBO)
+    {
+        textVBO = a.buffer;
         glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), 0);
+        glEnableVertexAttribArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    glUseProgram(textprogram_id);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+    // O deslocamento da alocação é múltiplo de sizeof(TextVertex)
+    glDrawArrays(GL_TRIANGLES, (GLint)(a.offset / sizeof(TextVertex)), (GLsizei)num_vertices);
 
-        glDisable(GL_BLEND);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
 
-        x += (glyph->advance_x * sx);
-    }
+    glDisable(GL_BLEND);
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
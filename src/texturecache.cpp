@@ -0,0 +1,634 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <stb_image.h>
+
+#include "texturecache.h"
+#include "textureupload.h"
+#include "mappedfile.h"
+
+// Enumerações da extensão GL_EXT_texture_compression_s3tc (e sua variante
+// sRGB), que não fazem parte do glad gerado para OpenGL 3.3 core.
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+
+// Mipmaps com lado menor ou igual a este valor são enviados imediatamente em
+// TextureCache_Load(); os maiores passam pela fila de envio assíncrono.
+#define TEXTURECACHE_FIRST_MIP_SIZE 64
+
+size_t g_TextureVRAMBudget = 256u * 1024u * 1024u;
+
+// Cabeçalho do arquivo ".tcache". Logo após o cabeçalho vem a tabela com
+// num_mips entradas TextureCacheMip e, em seguida, os blocos BC1 de cada nível.
+struct TextureCacheHeader
+{
+    char     magic[4];     // "FCGT"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_mips;
+    uint32_t reserved;
+    uint64_t source_size;  // Tamanho e data de modificação da imagem original,
+    int64_t  source_mtime; // utilizados para invalidar o cache.
+};
+
+struct TextureCacheMip
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // Posição dos blocos BC1 deste nível dentro do arquivo
+    uint64_t size;   // Tamanho em bytes dos blocos BC1 deste nível
+};
+
+static const uint32_t TEXTURECACHE_VERSION = 1;
+
+struct ImagemRGB
+{
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+// Textura cujos mipmaps maiores ainda estão sendo carregados.
+struct TexturaEmStreaming
+{
+    GLuint texture_id;
+    GLuint textureunit;
+    std::vector<TextureCacheMip> mips;
+    int      base_level;     // Nível mais detalhado já amostrado pela GPU
+    int      min_level;      // Nível mais detalhado permitido pelo orçamento de VRAM
+    uint32_t niveis_prontos; // Bit "i" ligado se o nível "i" já foi enviado
+};
+
+static std::vector<TexturaEmStreaming> g_StreamedTextures;
+static size_t g_TextureVRAMUsed = 0;
+
+static uint16_t ParaRGB565(const int rgb[3])
+{
+    int r = (rgb[0]*31 + 127) / 255;
+    int g = (rgb[1]*63 + 127) / 255;
+    int b = (rgb[2]*31 + 127) / 255;
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void DeRGB565(uint16_t c, int rgb[3])
+{
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Comprime um bloco de 4x4 pixels RGB em 8 bytes no formato BC1. Os extremos
+// da paleta são a diagonal da caixa envolvente das cores do bloco, escolhida
+// pelo sinal da covariância com o canal de maior variação.
+static void ComprimeBlocoBC1(const unsigned char bloco[16][3], unsigned char out[8])
+{
+    int mn[3] = {255, 255, 255};
+    int mx[3] = {0, 0, 0};
+    float media[3] = {0.0f, 0.0f, 0.0f};
+
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+        {
+            mn[c] = std::min(mn[c], (int)bloco[i][c]);
+            mx[c] = std::max(mx[c], (int)bloco[i][c]);
+            media[c] += bloco[i][c] / 16.0f;
+        }
+
+    int ref = 0;
+    for (int c = 1; c < 3; ++c)
+        if (mx[c] - mn[c] > mx[ref] - mn[ref])
+            ref = c;
+
+    for (int c = 0; c < 3; ++c)
+    {
+        if (c == ref)
+            continue;
+        float cov = 0.0f;
+        for (int i = 0; i < 16; ++i)
+            cov += (bloco[i][ref] - media[ref]) * (bloco[i][c] - media[c]);
+        if (cov < 0.0f)
+            std::swap(mn[c], mx[c]);
+    }
+
+    // Aproximamos os extremos do centro em 1/16 da variação, o que reduz o
+    // erro médio (mesmo método do stb_dxt).
+    for (int c = 0; c < 3; ++c)
+    {
+        int inset = (mx[c] - mn[c]) / 16;
+        mx[c] -= inset;
+        mn[c] += inset;
+    }
+
+    uint16_t c0 = ParaRGB565(mx);
+    uint16_t c1 = ParaRGB565(mn);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int paleta[4][3];
+        DeRGB565(c0, paleta[0]);
+        DeRGB565(c1, paleta[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            paleta[2][c] = (2*paleta[0][c] + paleta[1][c]) / 3;
+            paleta[3][c] = (paleta[0][c] + 2*paleta[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int melhor = 0;
+            int menor_dist = 1 << 30;
+            for (int p = 0; p < 4; ++p)
+            {
+                int dr = bloco[i][0] - paleta[p][0];
+                int dg = bloco[i][1] - paleta[p][1];
+                int db = bloco[i][2] - paleta[p][2];
+                int dist = dr*dr + dg*dg + db*db;
+                if (dist < menor_dist)
+                {
+                    menor_dist = dist;
+                    melhor = p;
+                }
+            }
+            indices |= (uint32_t)melhor << (2*i);
+        }
+    }
+
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    out[4] = indices & 0xFF;
+    out[5] = (indices >> 8) & 0xFF;
+    out[6] = (indices >> 16) & 0xFF;
+    out[7] = (indices >> 24) & 0xFF;
+}
+
+static void DescomprimeBlocoBC1(const unsigned char in[8], unsigned char bloco[16][3])
+{
+    uint16_t c0 = in[0] | (in[1] << 8);
+    uint16_t c1 = in[2] | (in[3] << 8);
+    uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+
+    int paleta[4][3];
+    DeRGB565(c0, paleta[0]);
+    DeRGB565(c1, paleta[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        if (c0 > c1)
+        {
+            paleta[2][c] = (2*paleta[0][c] + paleta[1][c]) / 3;
+            paleta[3][c] = (paleta[0][c] + 2*paleta[1][c]) / 3;
+        }
+        else
+        {
+            paleta[2][c] = (paleta[0][c] + paleta[1][c]) / 2;
+            paleta[3][c] = 0;
+        }
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+        int p = (indices >> (2*i)) & 3;
+        for (int c = 0; c < 3; ++c)
+            bloco[i][c] = (unsigned char)paleta[p][c];
+    }
+}
+
+static size_t TamanhoBC1(int width, int height)
+{
+    return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * 8;
+}
+
+static std::vector<unsigned char> ComprimeBC1(const ImagemRGB& img)
+{
+    std::vector<unsigned char> out(TamanhoBC1(img.width, img.height));
+    unsigned char* dst = out.data();
+
+    for (int by = 0; by < img.height; by += 4)
+        for (int bx = 0; bx < img.width; bx += 4)
+        {
+            unsigned char bloco[16][3];
+            for (int y = 0; y < 4; ++y)
+                for (int x = 0; x < 4; ++x)
+                {
+                    // Blocos na borda repetem o último pixel válido
+                    int px = std::min(bx + x, img.width - 1);
+                    int py = std::min(by + y, img.height - 1);
+                    const unsigned char* src = &img.pixels[3*(py*img.width + px)];
+                    bloco[4*y + x][0] = src[0];
+                    bloco[4*y + x][1] = src[1];
+                    bloco[4*y + x][2] = src[2];
+                }
+            ComprimeBlocoBC1(bloco, dst);
+            dst += 8;
+        }
+
+    return out;
+}
+
+static void DescomprimeBC1(const unsigned char* blocos, int width, int height, unsigned char* out)
+{
+    for (int by = 0; by < height; by += 4)
+        for (int bx = 0; bx < width; bx += 4)
+        {
+            unsigned char bloco[16][3];
+            DescomprimeBlocoBC1(blocos, bloco);
+            blocos += 8;
+
+            for (int y = 0; y < 4 && by + y < height; ++y)
+                for (int x = 0; x < 4 && bx + x < width; ++x)
+                {
+                    unsigned char* dst = &out[3*((by + y)*width + bx + x)];
+                    dst[0] = bloco[4*y + x][0];
+                    dst[1] = bloco[4*y + x][1];
+                    dst[2] = bloco[4*y + x][2];
+                }
+        }
+}
+
+// Gera o próximo nível de mipmap através da média de blocos de 2x2 pixels.
+static ImagemRGB ReduzMipmap(const ImagemRGB& src)
+{
+    ImagemRGB dst;
+    dst.width  = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.pixels.resize(3*(size_t)dst.width*dst.height);
+
+    for (int y = 0; y < dst.height; ++y)
+        for (int x = 0; x < dst.width; ++x)
+        {
+            int x0 = std::min(2*x, src.width - 1);
+            int x1 = std::min(2*x + 1, src.width - 1);
+            int y0 = std::min(2*y, src.height - 1);
+            int y1 = std::min(2*y + 1, src.height - 1);
+            for (int c = 0; c < 3; ++c)
+            {
+                int soma = src.pixels[3*(y0*src.width + x0) + c]
+                         + src.pixels[3*(y0*src.width + x1) + c]
+                         + src.pixels[3*(y1*src.width + x0) + c]
+                         + src.pixels[3*(y1*src.width + x1) + c];
+                dst.pixels[3*(y*dst.width + x) + c] = (unsigned char)((soma + 2) / 4);
+            }
+        }
+
+    return dst;
+}
+
+static bool LeCabecalho(FILE* f, TextureCacheHeader* header, std::vector<TextureCacheMip>* mips)
+{
+    if (fread(header, sizeof(*header), 1, f) != 1)
+        return false;
+    if (memcmp(header->magic, "FCGT", 4) != 0 || header->version != TEXTURECACHE_VERSION)
+        return false;
+    if (header->num_mips == 0 || header->num_mips > 32)
+        return false;
+
+    mips->resize(header->num_mips);
+    return fread(mips->data(), sizeof(TextureCacheMip), mips->size(), f) == mips->size();
+}
+
+// Verifica se o cache existe e corresponde à imagem original. Se a imagem
+// original não existir, um cache válido é usado mesmo assim (permitindo
+// distribuir somente os arquivos ".tcache").
+static bool CacheAtualizado(const char* filename, const std::string& cachename)
+{
+    FILE* f = fopen(cachename.c_str(), "rb");
+    if (f == NULL)
+        return false;
+
+    TextureCacheHeader header;
+    std::vector<TextureCacheMip> mips;
+    bool ok = LeCabecalho(f, &header, &mips);
+    fclose(f);
+
+    if (!ok)
+        return false;
+
+    uint64_t size;
+    int64_t  mtime;
+    if (!File_Stamp(filename, &size, &mtime))
+        return true;
+
+    return size == header.source_size && mtime == header.source_mtime;
+}
+
+bool TextureCache_Build(const char* filename, const char* cachename)
+{
+    // Mesma orientação utilizada antes da introdução do cache
+    stbi_set_flip_vertically_on_load(true);
+    int width;
+    int height;
+    int channels;
+    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+
+    if ( data == NULL )
+        return false;
+
+    ImagemRGB nivel;
+    nivel.width  = width;
+    nivel.height = height;
+    nivel.pixels.assign(data, data + 3*(size_t)width*height);
+    stbi_image_free(data);
+
+    std::vector<TextureCacheMip> mips;
+    std::vector< std::vector<unsigned char> > blocos;
+    for (;;)
+    {
+        blocos.push_back(ComprimeBC1(nivel));
+
+        TextureCacheMip mip;
+        mip.width  = nivel.width;
+        mip.height = nivel.height;
+        mip.offset = 0;
+        mip.size   = blocos.back().size();
+        mips.push_back(mip);
+
+        if (nivel.width == 1 && nivel.height == 1)
+            break;
+        nivel = ReduzMipmap(nivel);
+    }
+
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "FCGT", 4);
+    header.version  = TEXTURECACHE_VERSION;
+    header.width    = width;
+    header.height   = height;
+    header.num_mips = (uint32_t)mips.size();
+    File_Stamp(filename, &header.source_size, &header.source_mtime);
+
+    uint64_t offset = sizeof(header) + mips.size()*sizeof(TextureCacheMip);
+    for (size_t i = 0; i < mips.size(); ++i)
+    {
+        mips[i].offset = offset;
+        offset += mips[i].size;
+    }
+
+    FILE* f = fopen(cachename, "wb");
+    if (f == NULL)
+        return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+           && fwrite(mips.data(), sizeof(TextureCacheMip), mips.size(), f) == mips.size();
+    for (size_t i = 0; ok && i < blocos.size(); ++i)
+        ok = fwrite(blocos[i].data(), 1, blocos[i].size(), f) == blocos[i].size();
+
+    fclose(f);
+    if (!ok)
+        remove(cachename);
+
+    return ok;
+}
+
+// GL_COMPRESSED_SRGB_S3TC_DXT1_EXT vem de GL_EXT_texture_sRGB (ou, em
+// drivers mais novos, de GL_EXT_texture_compression_s3tc_srgb), não da
+// extensão S3TC: sem as duas, usamos a descompressão na CPU.
+static bool S3TCSuportado()
+{
+    static int suportado = -1;
+    if (suportado < 0)
+    {
+        bool s3tc = false, srgb = false;
+        GLint num_extensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+        for (GLint i = 0; i < num_extensions; ++i)
+        {
+            const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (ext == NULL)
+                continue;
+            if (strcmp(ext, "GL_EXT_texture_compression_s3tc") == 0)
+                s3tc = true;
+            else if (strcmp(ext, "GL_EXT_texture_sRGB") == 0 || strcmp(ext, "GL_EXT_texture_compression_s3tc_srgb") == 0)
+                srgb = true;
+        }
+        suportado = s3tc && srgb;
+
+        if (!s3tc)
+            fprintf(stderr, "WARNING: GL_EXT_texture_compression_s3tc indisponivel, descomprimindo texturas na CPU.\n");
+        else if (!srgb)
+            fprintf(stderr, "WARNING: GL_EXT_texture_sRGB indisponivel, descomprimindo texturas na CPU.\n");
+    }
+    return suportado == 1;
+}
+
+static size_t BytesNaGPU(const TextureCacheMip& mip)
+{
+    if (S3TCSuportado())
+        return mip.size;
+    return 3*(size_t)mip.width*mip.height;
+}
+
+// Envia um nível de mipmap para a textura ligada em GL_TEXTURE_2D.
+static void EnviaMipmap(const TextureCacheMip& mip, int level, const unsigned char* blocos)
+{
+    if (S3TCSuportado())
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,
+                               mip.width, mip.height, 0, (GLsizei)mip.size, blocos);
+    }
+    else
+    {
+        std::vector<unsigned char> rgb(BytesNaGPU(mip));
+        DescomprimeBC1(blocos, mip.width, mip.height, rgb.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_SRGB8, mip.width, mip.height, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+    }
+}
+
+static bool LeBlocos(FILE* f, const TextureCacheMip& mip, unsigned char* dst)
+{
+    return fseek(f, (long)mip.offset, SEEK_SET) == 0
+        && fread(dst, 1, mip.size, f) == mip.size;
+}
+
+// Chamada quando o nível "level" terminou de ser copiado para a GPU. O nível
+// só passa a ser amostrado quando todos os menores também estão presentes,
+// pois GL_TEXTURE_BASE_LEVEL define o nível mais detalhado utilizado.
+static void NivelEnviado(size_t textura, int level)
+{
+    TexturaEmStreaming& tex = g_StreamedTextures[textura];
+    tex.niveis_prontos |= 1u << level;
+
+    int base = tex.base_level;
+    while (base > tex.min_level && (tex.niveis_prontos & (1u << (base - 1))))
+        base -= 1;
+
+    if (base != tex.base_level)
+    {
+        glActiveTexture(GL_TEXTURE0 + tex.textureunit);
+        glBindTexture(GL_TEXTURE_2D, tex.texture_id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+        tex.base_level = base;
+    }
+}
+
+void TextureCache_Load(const char* filename, GLuint texture_id, GLuint textureunit)
+{
+    printf("Carregando imagem \"%s\"... ", filename);
+
+    std::string cachename = std::string(filename) + ".tcache";
+    if (!CacheAtualizado(filename, cachename))
+    {
+        printf("convertendo para BC1... ");
+        if (!TextureCache_Build(filename, cachename.c_str()))
+        {
+            fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    FILE* f = fopen(cachename.c_str(), "rb");
+    TextureCacheHeader header;
+    TexturaEmStreaming tex;
+    if (f == NULL || !LeCabecalho(f, &header, &tex.mips))
+    {
+        fprintf(stderr, "ERROR: Invalid texture cache \"%s\".\n", cachename.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    int num_mips = (int)tex.mips.size();
+
+    // Descartamos os níveis mais detalhados enquanto a textura completa não
+    // couber no orçamento de memória de vídeo.
+    size_t total = 0;
+    for (int level = 0; level < num_mips; ++level)
+        total += BytesNaGPU(tex.mips[level]);
+
+    int min_level = 0;
+    while (min_level < num_mips - 1 && g_TextureVRAMUsed + total > g_TextureVRAMBudget)
+    {
+        total -= BytesNaGPU(tex.mips[min_level]);
+        min_level += 1;
+    }
+    g_TextureVRAMUsed += total;
+
+    int first_level = min_level;
+    while (first_level < num_mips - 1
+        && std::max(tex.mips[first_level].width, tex.mips[first_level].height) > TEXTURECACHE_FIRST_MIP_SIZE)
+        first_level += 1;
+
+    // Os níveis pequenos são enviados agora, do menor para o maior.
+    std::vector<unsigned char> blocos;
+    for (int level = num_mips - 1; level >= first_level; --level)
+    {
+        const TextureCacheMip& mip = tex.mips[level];
+        blocos.resize(mip.size);
+        if (!LeBlocos(f, mip, blocos.data()))
+        {
+            fprintf(stderr, "ERROR: Invalid texture cache \"%s\".\n", cachename.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+        EnviaMipmap(mip, level, blocos.data());
+    }
+    fclose(f);
+
+    tex.niveis_prontos = 0;
+    for (int level = first_level; level < num_mips; ++level)
+        tex.niveis_prontos |= 1u << level;
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, first_level);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, num_mips - 1);
+
+    tex.texture_id  = texture_id;
+    tex.textureunit = textureunit;
+    tex.base_level  = first_level;
+    tex.min_level   = min_level;
+    g_StreamedTextures.push_back(tex);
+
+    // Os níveis restantes são lidos do disco (e descomprimidos, se preciso)
+    // por threads auxiliares diretamente em PBOs. Veja "textureupload.cpp".
+    size_t textura = g_StreamedTextures.size() - 1;
+    bool s3tc = S3TCSuportado();
+    for (int level = first_level - 1; level >= min_level; --level)
+    {
+        TextureCacheMip mip = tex.mips[level];
+
+        TextureUploadDesc desc;
+        desc.texture_id     = texture_id;
+        desc.textureunit    = textureunit;
+        desc.level          = level;
+        desc.width          = mip.width;
+        desc.height         = mip.height;
+        desc.internalformat = s3tc ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_SRGB8;
+        desc.compressed     = s3tc;
+        desc.format         = GL_RGB;
+        desc.type           = GL_UNSIGNED_BYTE;
+        desc.size           = BytesNaGPU(mip);
+
+        TextureUpload_Request(desc,
+            [cachename, mip, s3tc](unsigned char* dst) -> bool
+            {
+                FILE* f = fopen(cachename.c_str(), "rb");
+                if (f == NULL)
+                    return false;
+
+                bool ok;
+                if (s3tc)
+                    ok = LeBlocos(f, mip, dst);
+                else
+                {
+                    std::vector<unsigned char> blocos(mip.size);
+                    ok = LeBlocos(f, mip, blocos.data());
+                    if (ok)
+                        DescomprimeBC1(blocos.data(), mip.width, mip.height, dst);
+                }
+                fclose(f);
+                return ok;
+            },
+            [textura, level]()
+            {
+                NivelEnviado(textura, level);
+            });
+    }
+
+    printf("OK (%dx%d, %d mipmaps).\n", header.width, header.height, num_mips - min_level);
+}
+
+bool TextureCache_LoadLinear(const char* filename)
+{
+    printf("Carregando imagem \"%s\"... ", filename);
+
+    stbi_set_flip_vertically_on_load(true);
+    int width;
+    int height;
+    int channels;
+    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+
+    if ( data == NULL )
+    {
+        printf("\n");
+        return false;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    stbi_image_free(data);
+
+    // Os mipmaps somam cerca de um terço do nível 0
+    g_TextureVRAMUsed += 4 * (3*(size_t)width*height) / 3;
+
+    printf("OK (%dx%d).\n", width, height);
+    return true;
+}
+
+size_t TextureCache_VRAMUsed()
+{
+    return g_TextureVRAMUsed;
+}
@@ -0,0 +1,286 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include "textureupload.h"
+#include "jobs.h"
+
+// Número máximo de PBOs em uso simultâneo (mapeados ou aguardando a GPU).
+#define TEXTUREUPLOAD_MAX_PBOS 8
+
+size_t g_TextureUploadBytesPerFrame = 4u * 1024u * 1024u;
+
+enum EstadoEnvio
+{
+    AGUARDANDO_PBO, // Na fila, esperando um PBO livre
+    PRODUZINDO,     // PBO mapeado, tarefa de segundo plano escrevendo os pixels
+    PRONTO,         // Pixels escritos, aguardando orçamento do quadro
+    FALHOU,         // O produtor retornou erro
+    ENVIADO         // Cópia emitida, aguardando a fence
+};
+
+struct PixelBuffer
+{
+    GLuint id;
+    size_t capacidade;
+    bool   livre;
+};
+
+struct PedidoEnvio
+{
+    TextureUploadDesc     desc;
+    TextureUploadProducer produz;
+    TextureUploadCallback concluido;
+    EstadoEnvio           estado;
+    int                   pbo;   // Índice em g_PixelBuffers
+    unsigned char*        ptr;   // Memória mapeada do PBO
+    GLsync                fence;
+};
+
+static std::vector<PixelBuffer> g_PixelBuffers;
+
+// Pedidos em ordem de chegada. Apenas a thread de renderização insere e
+// remove elementos; as tarefas de produção só alteram o campo "estado".
+static std::deque< std::unique_ptr<PedidoEnvio> > g_Pedidos;
+
+// As tarefas de produção são filhas de g_Producao, que só termina em
+// TextureUpload_Shutdown() (veja "jobs.h").
+static Job*       g_Producao = NULL;
+static std::mutex g_EnvioMutex;
+static bool       g_EncerraProducao = false;
+
+static void Produz(PedidoEnvio* pedido)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_EnvioMutex);
+        if (g_EncerraProducao)
+        {
+            pedido->estado = FALHOU;
+            return;
+        }
+    }
+
+    bool ok = pedido->produz(pedido->ptr);
+
+    std::lock_guard<std::mutex> lock(g_EnvioMutex);
+    pedido->estado = ok ? PRONTO : FALHOU;
+}
+
+// Procura um PBO livre com capacidade suficiente, criando ou aumentando um
+// se necessário. Retorna -1 se todos estiverem ocupados.
+static int ReservaPixelBuffer(size_t size)
+{
+    int escolhido = -1;
+    for (size_t i = 0; i < g_PixelBuffers.size(); ++i)
+    {
+        if (!g_PixelBuffers[i].livre)
+            continue;
+        if (escolhido < 0 || (g_PixelBuffers[i].capacidade >= size && g_PixelBuffers[escolhido].capacidade < size))
+            escolhido = (int)i;
+    }
+
+    if (escolhido < 0 || g_PixelBuffers[escolhido].capacidade < size)
+    {
+        if (g_PixelBuffers.size() < TEXTUREUPLOAD_MAX_PBOS)
+        {
+            PixelBuffer pbo;
+            glGenBuffers(1, &pbo.id);
+            pbo.capacidade = 0;
+            pbo.livre = true;
+            g_PixelBuffers.push_back(pbo);
+            escolhido = (int)g_PixelBuffers.size() - 1;
+        }
+        if (escolhido < 0)
+            return -1;
+    }
+
+    PixelBuffer& pbo = g_PixelBuffers[escolhido];
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.id);
+    if (pbo.capacidade < size)
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        pbo.capacidade = size;
+    }
+    pbo.livre = false;
+    return escolhido;
+}
+
+void TextureUpload_Request(const TextureUploadDesc& desc, TextureUploadProducer produz, TextureUploadCallback concluido)
+{
+    // Alocamos agora o armazenamento do nível; os pixels chegam depois com
+    // glTexSubImage2D() a partir do PBO.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0 + desc.textureunit);
+    glBindTexture(GL_TEXTURE_2D, desc.texture_id);
+    if (desc.compressed)
+        glCompressedTexImage2D(GL_TEXTURE_2D, desc.level, desc.internalformat, desc.width, desc.height, 0, (GLsizei)desc.size, NULL);
+    else
+        glTexImage2D(GL_TEXTURE_2D, desc.level, desc.internalformat, desc.width, desc.height, 0, desc.format, desc.type, NULL);
+
+    std::unique_ptr<PedidoEnvio> pedido(new PedidoEnvio);
+    pedido->desc      = desc;
+    pedido->produz    = produz;
+    pedido->concluido = concluido;
+    pedido->estado    = AGUARDANDO_PBO;
+    pedido->pbo       = -1;
+    pedido->ptr       = NULL;
+    pedido->fence     = 0;
+    g_Pedidos.push_back(std::move(pedido));
+}
+
+void TextureUpload_Update()
+{
+    if (g_Pedidos.empty())
+        return;
+
+    std::vector<PedidoEnvio*> para_produzir;
+    size_t bytes_no_quadro = 0;
+
+    {
+        std::unique_lock<std::mutex> lock(g_EnvioMutex);
+
+        for (size_t i = 0; i < g_Pedidos.size(); )
+        {
+            PedidoEnvio* pedido = g_Pedidos[i].get();
+
+            if (pedido->estado == ENVIADO)
+            {
+                // A fence indica que a GPU já copiou o PBO para a textura
+                GLenum status = glClientWaitSync(pedido->fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                {
+                    ++i;
+                    continue;
+                }
+                glDeleteSync(pedido->fence);
+                g_PixelBuffers[pedido->pbo].livre = true;
+
+                lock.unlock();
+                pedido->concluido();
+                lock.lock();
+
+                g_Pedidos.erase(g_Pedidos.begin() + i);
+                continue;
+            }
+
+            if (pedido->estado == FALHOU)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_PixelBuffers[pedido->pbo].id);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                g_PixelBuffers[pedido->pbo].livre = true;
+                fprintf(stderr, "ERROR: Texture upload for level %d failed.\n", pedido->desc.level);
+                g_Pedidos.erase(g_Pedidos.begin() + i);
+                continue;
+            }
+
+            if (pedido->estado == PRONTO)
+            {
+                // Sempre enviamos ao menos um nível por quadro, mesmo que ele
+                // sozinho seja maior que o orçamento.
+                if (bytes_no_quadro > 0 && bytes_no_quadro + pedido->desc.size > g_TextureUploadBytesPerFrame)
+                {
+                    ++i;
+                    continue;
+                }
+                bytes_no_quadro += pedido->desc.size;
+
+                const TextureUploadDesc& desc = pedido->desc;
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_PixelBuffers[pedido->pbo].id);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+                glActiveTexture(GL_TEXTURE0 + desc.textureunit);
+                glBindTexture(GL_TEXTURE_2D, desc.texture_id);
+                if (desc.compressed)
+                    glCompressedTexSubImage2D(GL_TEXTURE_2D, desc.level, 0, 0, desc.width, desc.height, desc.internalformat, (GLsizei)desc.size, (void*)0);
+                else
+                    glTexSubImage2D(GL_TEXTURE_2D, desc.level, 0, 0, desc.width, desc.height, desc.format, desc.type, (void*)0);
+
+                pedido->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                pedido->estado = ENVIADO;
+            }
+            else if (pedido->estado == AGUARDANDO_PBO)
+            {
+                int pbo = ReservaPixelBuffer(pedido->desc.size);
+                if (pbo >= 0)
+                {
+                    pedido->pbo = pbo;
+                    pedido->ptr = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, pedido->desc.size,
+                                                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                    if (pedido->ptr == NULL)
+                    {
+                        g_PixelBuffers[pbo].livre = true;
+                        fprintf(stderr, "ERROR: glMapBufferRange() failed for texture upload.\n");
+                        g_Pedidos.erase(g_Pedidos.begin() + i);
+                        continue;
+                    }
+                    pedido->estado = PRODUZINDO;
+                    para_produzir.push_back(pedido);
+                }
+            }
+
+            ++i;
+        }
+    }
+
+    // Nunca deixamos um PBO ligado, senão glTexImage2D() posteriores leriam dele
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!para_produzir.empty() && g_Producao == NULL)
+    {
+        g_EncerraProducao = false;
+        g_Producao = Jobs_Create(JobFunction());
+    }
+    for (size_t i = 0; i < para_produzir.size(); ++i)
+    {
+        PedidoEnvio* pedido = para_produzir[i];
+        Job* job = Jobs_Create([pedido]{ Produz(pedido); }, g_Producao);
+        Jobs_RunBackground(job);
+        Jobs_Release(job);
+    }
+}
+
+void TextureUpload_Shutdown()
+{
+    // As tarefas ainda na fila terminam sem produzir; esperamos as que já
+    // estão escrevendo nos PBOs
+    if (g_Producao != NULL)
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_EnvioMutex);
+            g_EncerraProducao = true;
+        }
+        Jobs_Run(g_Producao);
+        Jobs_Wait(g_Producao);
+        g_Producao = NULL;
+    }
+
+    // Os pedidos não concluídos são descartados sem chamar "concluido": os
+    // que têm PBO ainda mapeado (produzindo, prontos ou interrompidos acima)
+    // são desmapeados e os enviados deixam a fence para trás
+    for (size_t i = 0; i < g_Pedidos.size(); ++i)
+    {
+        PedidoEnvio* pedido = g_Pedidos[i].get();
+        if (pedido->estado == ENVIADO)
+            glDeleteSync(pedido->fence);
+        else if (pedido->estado != AGUARDANDO_PBO)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_PixelBuffers[pedido->pbo].id);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    g_Pedidos.clear();
+
+    for (size_t i = 0; i < g_PixelBuffers.size(); ++i)
+        glDeleteBuffers(1, &g_PixelBuffers[i].id);
+    g_PixelBuffers.clear();
+}
+
+size_t TextureUpload_Pending()
+{
+    return g_Pedidos.size();
+}
@@ -0,0 +1,268 @@
+#include <cstring>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "tlsf.h"
+
+#define TLSF_BITS_DA_MANTISSA 3
+#define TLSF_MANTISSA         (1u << TLSF_BITS_DA_MANTISSA)
+#define TLSF_MASCARA          (TLSF_MANTISSA - 1)
+
+static inline uint32_t PrimeiroBit(uint32_t x) // x != 0
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (uint32_t)i;
+#else
+    return (uint32_t)__builtin_ctz(x);
+#endif
+}
+
+static inline uint32_t UltimoBit(uint32_t x) // x != 0
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse(&i, x);
+    return (uint32_t)i;
+#else
+    return 31u - (uint32_t)__builtin_clz(x);
+#endif
+}
+
+// Classe de um tamanho: tamanhos menores que 8 são as classes 0..7; os
+// demais têm expoente e 3 bits de mantissa abaixo do bit mais alto.
+// Arredondando para cima, todo bloco da classe cabe o tamanho pedido;
+// arredondando para baixo, a classe de um bloco livre não promete mais do
+// que ele tem.
+static uint32_t ClasseParaBaixo(uint32_t size)
+{
+    if (size < TLSF_MANTISSA)
+        return size;
+    uint32_t deslocamento = UltimoBit(size) - TLSF_BITS_DA_MANTISSA;
+    return ((deslocamento + 1) << TLSF_BITS_DA_MANTISSA) + ((size >> deslocamento) & TLSF_MASCARA);
+}
+
+static uint32_t ClasseParaCima(uint32_t size)
+{
+    if (size < TLSF_MANTISSA)
+        return size;
+    uint32_t deslocamento = UltimoBit(size) - TLSF_BITS_DA_MANTISSA;
+    uint32_t classe = ((deslocamento + 1) << TLSF_BITS_DA_MANTISSA) + ((size >> deslocamento) & TLSF_MASCARA);
+    // Mantissa 8 passa naturalmente para o expoente seguinte
+    if (size & ((1u << deslocamento) - 1))
+        classe += 1;
+    return classe;
+}
+
+static uint32_t NovoNo(TLSFAllocator* a)
+{
+    if (!a->nos_vagos.empty())
+    {
+        uint32_t i = a->nos_vagos.back();
+        a->nos_vagos.pop_back();
+        return i;
+    }
+    a->nos.push_back(TLSFNode());
+    return (uint32_t)a->nos.size() - 1;
+}
+
+static void InsereNaLista(TLSFAllocator* a, uint32_t i)
+{
+    TLSFNode& no = a->nos[i];
+    uint32_t classe = ClasseParaBaixo(no.size);
+
+    no.usado             = false;
+    no.anterior_na_lista = TLSF_NENHUM;
+    no.proximo_na_lista  = a->listas[classe];
+    if (no.proximo_na_lista != TLSF_NENHUM)
+        a->nos[no.proximo_na_lista].anterior_na_lista = i;
+    a->listas[classe] = i;
+
+    a->grupos_usados |= 1u << (classe >> TLSF_BITS_DA_MANTISSA);
+    a->classes_usadas[classe >> TLSF_BITS_DA_MANTISSA] |= (uint8_t)(1u << (classe & TLSF_MASCARA));
+    a->livre += no.size;
+}
+
+static void RemoveDaLista(TLSFAllocator* a, uint32_t i)
+{
+    TLSFNode& no = a->nos[i];
+    uint32_t classe = ClasseParaBaixo(no.size);
+
+    if (no.anterior_na_lista != TLSF_NENHUM)
+        a->nos[no.anterior_na_lista].proximo_na_lista = no.proximo_na_lista;
+    else
+        a->listas[classe] = no.proximo_na_lista;
+    if (no.proximo_na_lista != TLSF_NENHUM)
+        a->nos[no.proximo_na_lista].anterior_na_lista = no.anterior_na_lista;
+
+    if (a->listas[classe] == TLSF_NENHUM)
+    {
+        uint32_t grupo = classe >> TLSF_BITS_DA_MANTISSA;
+        a->classes_usadas[grupo] &= (uint8_t)~(1u << (classe & TLSF_MASCARA));
+        if (a->classes_usadas[grupo] == 0)
+            a->grupos_usados &= ~(1u << grupo);
+    }
+    a->livre -= no.size;
+}
+
+void TLSF_Init(TLSFAllocator* a, uint32_t size)
+{
+    a->size          = 0;
+    a->livre         = 0;
+    a->alocacoes     = 0;
+    a->grupos_usados = 0;
+    memset(a->classes_usadas, 0, sizeof(a->classes_usadas));
+    for (int i = 0; i < 256; ++i)
+        a->listas[i] = TLSF_NENHUM;
+    a->ultimo = TLSF_NENHUM;
+    a->nos.clear();
+    a->nos_vagos.clear();
+
+    TLSF_Grow(a, size);
+}
+
+bool TLSF_Allocate(TLSFAllocator* a, uint32_t size, TLSFAllocation* out)
+{
+    out->offset = 0;
+    out->node   = TLSF_NENHUM;
+    if (size == 0 || size > a->livre)
+        return false;
+
+    // Menor classe não vazia a partir de ClasseParaCima(size)
+    uint32_t minima = ClasseParaCima(size);
+    uint32_t grupo  = minima >> TLSF_BITS_DA_MANTISSA;
+    uint32_t classe;
+    uint32_t no_grupo = grupo < 32 ? a->classes_usadas[grupo] & (0xFFu << (minima & TLSF_MASCARA)) & 0xFFu : 0;
+    if (no_grupo != 0)
+        classe = (grupo << TLSF_BITS_DA_MANTISSA) + PrimeiroBit(no_grupo);
+    else
+    {
+        uint32_t grupos = grupo + 1 < 32 ? a->grupos_usados & (0xFFFFFFFFu << (grupo + 1)) : 0;
+        if (grupos == 0)
+            return false;
+        grupo  = PrimeiroBit(grupos);
+        classe = (grupo << TLSF_BITS_DA_MANTISSA) + PrimeiroBit(a->classes_usadas[grupo]);
+    }
+
+    uint32_t i = a->listas[classe];
+    RemoveDaLista(a, i);
+
+    // O resto do bloco volta para as listas
+    uint32_t resto = a->nos[i].size - size;
+    if (resto > 0)
+    {
+        uint32_t r = NovoNo(a);
+        TLSFNode& no = a->nos[i];
+        TLSFNode& novo = a->nos[r];
+        novo.offset           = no.offset + size;
+        novo.size             = resto;
+        novo.vizinho_anterior = i;
+        novo.vizinho_proximo  = no.vizinho_proximo;
+        if (no.vizinho_proximo != TLSF_NENHUM)
+            a->nos[no.vizinho_proximo].vizinho_anterior = r;
+        else
+            a->ultimo = r;
+        no.vizinho_proximo = r;
+        no.size            = size;
+        InsereNaLista(a, r);
+    }
+
+    a->nos[i].usado = true;
+    a->alocacoes   += 1;
+    out->offset = a->nos[i].offset;
+    out->node   = i;
+    return true;
+}
+
+// Junta ao nó "i" o seu vizinho seguinte "j"; nenhum dos dois pode estar
+// nas listas de livres
+static void Absorve(TLSFAllocator* a, uint32_t i, uint32_t j)
+{
+    TLSFNode& no = a->nos[i];
+    no.size           += a->nos[j].size;
+    no.vizinho_proximo = a->nos[j].vizinho_proximo;
+    if (no.vizinho_proximo != TLSF_NENHUM)
+        a->nos[no.vizinho_proximo].vizinho_anterior = i;
+    else
+        a->ultimo = i;
+    a->nos_vagos.push_back(j);
+}
+
+void TLSF_Free(TLSFAllocator* a, uint32_t node)
+{
+    uint32_t i = node;
+    a->alocacoes -= 1;
+
+    uint32_t proximo = a->nos[i].vizinho_proximo;
+    if (proximo != TLSF_NENHUM && !a->nos[proximo].usado)
+    {
+        RemoveDaLista(a, proximo);
+        Absorve(a, i, proximo);
+    }
+
+    uint32_t anterior = a->nos[i].vizinho_anterior;
+    if (anterior != TLSF_NENHUM && !a->nos[anterior].usado)
+    {
+        RemoveDaLista(a, anterior);
+        Absorve(a, anterior, i);
+        i = anterior;
+    }
+
+    InsereNaLista(a, i);
+}
+
+void TLSF_Grow(TLSFAllocator* a, uint32_t size)
+{
+    if (size <= a->size)
+        return;
+    uint32_t acrescimo = size - a->size;
+
+    if (a->ultimo != TLSF_NENHUM && !a->nos[a->ultimo].usado)
+    {
+        RemoveDaLista(a, a->ultimo);
+        a->nos[a->ultimo].size += acrescimo;
+        InsereNaLista(a, a->ultimo);
+    }
+    else
+    {
+        uint32_t i = NovoNo(a);
+        TLSFNode& no = a->nos[i];
+        no.offset           = a->size;
+        no.size             = acrescimo;
+        no.vizinho_anterior = a->ultimo;
+        no.vizinho_proximo  = TLSF_NENHUM;
+        if (a->ultimo != TLSF_NENHUM)
+            a->nos[a->ultimo].vizinho_proximo = i;
+        a->ultimo = i;
+        InsereNaLista(a, i);
+    }
+    a->size = size;
+}
+
+uint32_t TLSF_Size(const TLSFAllocator& a, uint32_t node)
+{
+    return a.nos[node].size;
+}
+
+TLSFStats TLSF_Stats(const TLSFAllocator& a)
+{
+    TLSFStats s;
+    s.size         = a.size;
+    s.free         = a.livre;
+    s.used         = a.size - a.livre;
+    s.allocations  = a.alocacoes;
+    s.largest_free = 0;
+    s.free_blocks  = 0;
+
+    for (uint32_t classe = 0; classe < 256; ++classe)
+        for (uint32_t i = a.listas[classe]; i != TLSF_NENHUM; i = a.nos[i].proximo_na_lista)
+        {
+            s.largest_free = std::max(s.largest_free, a.nos[i].size);
+            s.free_blocks += 1;
+        }
+    return s;
+}
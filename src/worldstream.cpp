@@ -0,0 +1,355 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+
+#include "worldstream.h"
+#include "jobs.h"
+#include "framearena.h"
+
+float  g_WorldStreamRadius       = 60.0f;
+float  g_WorldStreamPrefetchTime = 3.0f;
+size_t g_WorldStreamBudget       = 128u * 1024u * 1024u;
+float  g_WorldStreamActivateMs   = 2.0f;
+float  g_WorldStreamHitchMs      = 8.0f;
+
+enum EstadoCelula
+{
+    DESCARREGADA,
+    NA_FILA,      // Aguardando a tarefa de carregamento
+    CARREGANDO,   // Sendo lida pela tarefa de carregamento
+    CARREGADA,    // Lida, aguardando ativação na thread de renderização
+    ATIVA,
+    FALHOU        // O carregamento retornou erro; não é tentada novamente
+};
+
+struct Celula
+{
+    WorldCell             info;
+    EstadoCelula          estado;
+    std::shared_ptr<void> dados;        // Resultado do carregamento (até a ativação)
+    size_t                bytes;        // Memória ocupada enquanto ativa
+    unsigned long         quadro_desejada; // Último quadro em que a célula foi necessária
+    float                 prioridade;   // Menor = mais urgente
+    bool                  antecipada;   // Pedida apenas pela posição prevista
+};
+
+static WorldCellLoader    g_Carrega;
+static WorldCellActivator g_Ativa;
+static WorldCellReleaser  g_Libera;
+static float              g_TamanhoCelula = 0.0f;
+
+// Células em ordem de criação (a referência para cada uma nunca muda).
+static std::deque<Celula>                g_Celulas;
+static std::unordered_map<long long, int> g_IndiceCelulas;
+
+// Fila da tarefa de carregamento, ordenada por prioridade a cada quadro.
+// Há no máximo uma tarefa (de segundo plano) lendo células: ela é criada
+// quando a fila deixa de estar vazia e termina quando a fila se esvazia.
+static std::deque<Celula*>   g_FilaCarga;
+static Job*                  g_Carregador = NULL;
+static bool                  g_Carregando = false; // g_Carregador ainda retira células da fila
+static std::mutex            g_CelulasMutex;
+static bool                  g_EncerraCarregador = false;
+
+static unsigned long    g_Quadro = 0;
+static bool             g_TemUltimaPosicao = false;
+static glm::vec4        g_UltimaPosicao;
+static glm::vec4        g_Velocidade(0.0f, 0.0f, 0.0f, 0.0f);
+static WorldStreamStats g_Stats;
+
+static long long ChaveCelula(int x, int z)
+{
+    return ((long long)x << 32) ^ (long long)(unsigned int)z;
+}
+
+static void Carregador()
+{
+    for (;;)
+    {
+        Celula* celula;
+        {
+            std::lock_guard<std::mutex> lock(g_CelulasMutex);
+            if (g_EncerraCarregador || g_FilaCarga.empty())
+            {
+                g_Carregando = false;
+                return;
+            }
+            celula = g_FilaCarga.front();
+            g_FilaCarga.pop_front();
+            celula->estado = CARREGANDO;
+        }
+
+        std::shared_ptr<void> dados = g_Carrega(celula->info);
+
+        std::lock_guard<std::mutex> lock(g_CelulasMutex);
+        celula->dados  = dados;
+        celula->estado = dados ? CARREGADA : FALHOU;
+        if (!dados)
+            fprintf(stderr, "ERROR: Cannot load world cell \"%s\".\n", celula->info.filename.c_str());
+    }
+}
+
+void WorldStream_Init(float cell_size, WorldCellLoader carrega, WorldCellActivator ativa, WorldCellReleaser libera)
+{
+    g_TamanhoCelula = cell_size;
+    g_Carrega = carrega;
+    g_Ativa   = ativa;
+    g_Libera  = libera;
+    memset(&g_Stats, 0, sizeof(g_Stats));
+    g_EncerraCarregador = false;
+}
+
+void WorldStream_AddCell(int x, int z, const char* filename)
+{
+    std::lock_guard<std::mutex> lock(g_CelulasMutex);
+
+    long long chave = ChaveCelula(x, z);
+    if (g_IndiceCelulas.count(chave))
+    {
+        fprintf(stderr, "ERROR: World cell (%d, %d) defined twice.\n", x, z);
+        std::exit(EXIT_FAILURE);
+    }
+
+    Celula celula;
+    celula.info.id       = (int)g_Celulas.size();
+    celula.info.x        = x;
+    celula.info.z        = z;
+    celula.info.filename = filename;
+    celula.estado        = DESCARREGADA;
+    celula.bytes         = 0;
+    celula.quadro_desejada = 0;
+    celula.prioridade    = 0.0f;
+    celula.antecipada    = false;
+
+    g_IndiceCelulas[chave] = celula.info.id;
+    g_Celulas.push_back(celula);
+}
+
+static Celula* ProcuraCelula(int x, int z)
+{
+    std::unordered_map<long long, int>::iterator it = g_IndiceCelulas.find(ChaveCelula(x, z));
+    return it == g_IndiceCelulas.end() ? NULL : &g_Celulas[it->second];
+}
+
+// Marca como desejadas as células que tocam o círculo de raio
+// g_WorldStreamRadius em torno de "centro". A prioridade é a distância do
+// centro da célula somada a "penalidade".
+static void MarcaCelulas(const glm::vec4& centro, float penalidade, bool antecipada)
+{
+    float r = g_WorldStreamRadius;
+    int x0 = (int)std::floor((centro.x - r) / g_TamanhoCelula);
+    int x1 = (int)std::floor((centro.x + r) / g_TamanhoCelula);
+    int z0 = (int)std::floor((centro.z - r) / g_TamanhoCelula);
+    int z1 = (int)std::floor((centro.z + r) / g_TamanhoCelula);
+
+    for (int x = x0; x <= x1; ++x)
+    for (int z = z0; z <= z1; ++z)
+    {
+        Celula* celula = ProcuraCelula(x, z);
+        if (celula == NULL)
+            continue;
+
+        // Distância do centro ao ponto mais próximo da célula
+        float min_x = x * g_TamanhoCelula, max_x = min_x + g_TamanhoCelula;
+        float min_z = z * g_TamanhoCelula, max_z = min_z + g_TamanhoCelula;
+        float dx = std::max(0.0f, std::max(min_x - centro.x, centro.x - max_x));
+        float dz = std::max(0.0f, std::max(min_z - centro.z, centro.z - max_z));
+        float d  = std::sqrt(dx*dx + dz*dz);
+        if (d > r)
+            continue;
+
+        float prioridade = d + penalidade;
+        if (celula->quadro_desejada != g_Quadro)
+        {
+            celula->quadro_desejada = g_Quadro;
+            celula->prioridade = prioridade;
+            celula->antecipada = antecipada;
+        }
+        else if (prioridade < celula->prioridade)
+            celula->prioridade = prioridade;
+    }
+}
+
+static bool PorPrioridade(const Celula* a, const Celula* b)
+{
+    return a->prioridade < b->prioridade;
+}
+
+static void Descarrega(Celula* celula)
+{
+    g_Libera(celula->info);
+    g_Stats.bytes_resident -= celula->bytes;
+    g_Stats.evictions += 1;
+    celula->bytes = 0;
+
+    std::lock_guard<std::mutex> lock(g_CelulasMutex);
+    celula->estado = DESCARREGADA;
+}
+
+void WorldStream_Update(const glm::vec4& position, float deltaTime)
+{
+    if (g_Celulas.empty() || g_TamanhoCelula <= 0.0f)
+        return;
+
+    g_Quadro += 1;
+
+    // Velocidade no plano XZ, suavizada para que pequenas variações não
+    // mudem a previsão a cada quadro.
+    if (g_TemUltimaPosicao && deltaTime > 0.0f)
+    {
+        glm::vec4 v = (position - g_UltimaPosicao) / deltaTime;
+        v.y = 0.0f;
+        v.w = 0.0f;
+        g_Velocidade = 0.8f*g_Velocidade + 0.2f*v;
+    }
+    g_UltimaPosicao = position;
+    g_TemUltimaPosicao = true;
+
+    MarcaCelulas(position, 0.0f, false);
+    MarcaCelulas(position + g_Velocidade*g_WorldStreamPrefetchTime, g_WorldStreamRadius, true);
+
+    // Os vetores temporários ficam na memória do quadro (veja "framearena.h")
+    Celula** para_ativar = Arena_New<Celula*>(&g_FrameArena, g_Celulas.size());
+    size_t   num_para_ativar = 0;
+    bool inicia_carregador = false;
+    {
+        std::lock_guard<std::mutex> lock(g_CelulasMutex);
+
+        g_FilaCarga.clear();
+        for (size_t i = 0; i < g_Celulas.size(); ++i)
+        {
+            Celula* celula = &g_Celulas[i];
+            bool desejada = celula->quadro_desejada == g_Quadro;
+
+            if (celula->estado == NA_FILA && !desejada)
+                celula->estado = DESCARREGADA;
+            else if (celula->estado == DESCARREGADA && desejada)
+                celula->estado = NA_FILA;
+
+            if (celula->estado == NA_FILA)
+                g_FilaCarga.push_back(celula);
+            else if (celula->estado == CARREGADA)
+                para_ativar[num_para_ativar++] = celula;
+        }
+        std::sort(g_FilaCarga.begin(), g_FilaCarga.end(), PorPrioridade);
+        if (!g_FilaCarga.empty() && !g_Carregando)
+            inicia_carregador = g_Carregando = true;
+    }
+    if (inicia_carregador)
+    {
+        // A tarefa anterior já saiu da fila (ou está saindo)
+        if (g_Carregador != NULL)
+            Jobs_Wait(g_Carregador);
+        g_Carregador = Jobs_Create(Carregador);
+        Jobs_RunBackground(g_Carregador);
+    }
+
+    // Ativamos as células já lidas, as mais urgentes primeiro, até esgotar o
+    // tempo do quadro.
+    std::sort(para_ativar, para_ativar + num_para_ativar, PorPrioridade);
+
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    double gasto_ms = 0.0;
+    for (size_t i = 0; i < num_para_ativar && gasto_ms < g_WorldStreamActivateMs; ++i)
+    {
+        Celula* celula = para_ativar[i];
+        std::shared_ptr<void> dados;
+        {
+            std::lock_guard<std::mutex> lock(g_CelulasMutex);
+            dados.swap(celula->dados);
+            celula->estado = DESCARREGADA;
+        }
+
+        if (celula->quadro_desejada == g_Quadro)
+        {
+            celula->bytes = g_Ativa(celula->info, dados);
+            g_Stats.bytes_resident += celula->bytes;
+            g_Stats.loads += 1;
+            if (celula->antecipada)
+                g_Stats.prefetches += 1;
+
+            std::lock_guard<std::mutex> lock(g_CelulasMutex);
+            celula->estado = ATIVA;
+        }
+
+        gasto_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+    }
+
+    g_Stats.max_activation_ms = std::max(g_Stats.max_activation_ms, gasto_ms);
+    if (gasto_ms > g_WorldStreamHitchMs)
+        g_Stats.hitches += 1;
+
+    // A tarefa de carregamento também altera o estado das células.
+    std::unique_lock<std::mutex> lock(g_CelulasMutex);
+
+    Celula* atual = ProcuraCelula((int)std::floor(position.x / g_TamanhoCelula), (int)std::floor(position.z / g_TamanhoCelula));
+    if (atual != NULL && atual->estado != ATIVA && atual->estado != FALHOU)
+        g_Stats.misses += 1;
+
+    // Acima do orçamento, descarregamos as células que não são mais
+    // necessárias, da usada há mais tempo para a mais recente.
+    Celula** candidatas = Arena_New<Celula*>(&g_FrameArena, g_Celulas.size());
+    size_t   num_candidatas = 0;
+    if (g_Stats.bytes_resident > g_WorldStreamBudget)
+        for (size_t i = 0; i < g_Celulas.size(); ++i)
+            if (g_Celulas[i].estado == ATIVA && g_Celulas[i].quadro_desejada != g_Quadro)
+                candidatas[num_candidatas++] = &g_Celulas[i];
+
+    lock.unlock();
+
+    if (num_candidatas > 0)
+    {
+        std::sort(candidatas, candidatas + num_candidatas,
+                  [](const Celula* a, const Celula* b){ return a->quadro_desejada < b->quadro_desejada; });
+
+        for (size_t i = 0; i < num_candidatas && g_Stats.bytes_resident > g_WorldStreamBudget; ++i)
+            Descarrega(candidatas[i]);
+    }
+}
+
+void WorldStream_Shutdown()
+{
+    if (g_Carregador != NULL)
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_CelulasMutex);
+            g_EncerraCarregador = true;
+        }
+        Jobs_Wait(g_Carregador);
+        g_Carregador = NULL;
+    }
+
+    for (size_t i = 0; i < g_Celulas.size(); ++i)
+        if (g_Celulas[i].estado == ATIVA)
+            Descarrega(&g_Celulas[i]);
+
+    g_FilaCarga.clear();
+    g_Celulas.clear();
+    g_IndiceCelulas.clear();
+    g_TemUltimaPosicao = false;
+}
+
+WorldStreamStats WorldStream_Stats()
+{
+    WorldStreamStats stats = g_Stats;
+    stats.cells_resident = 0;
+    stats.cells_loading  = 0;
+
+    std::lock_guard<std::mutex> lock(g_CelulasMutex);
+    for (size_t i = 0; i < g_Celulas.size(); ++i)
+    {
+        EstadoCelula estado = g_Celulas[i].estado;
+        if (estado == ATIVA)
+            stats.cells_resident += 1;
+        else if (estado == NA_FILA || estado == CARREGANDO || estado == CARREGADA)
+            stats.cells_loading += 1;
+    }
+    return stats;
+}
@@ -0,0 +1,200 @@
+// Compara os caminhos de "bezierpath.h" com a avaliação direta da curva de
+// Bézier usada antes pelas estátuas (cubic_bezier(), mantida aqui como
+// referência): pelo parâmetro, com velocidade constante e com suavização,
+// em BezierPath e em BezierPathBatch.
+
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+#include "bezierpath.h"
+#include "teste.h"
+
+#define CAMINHOS_ALEATORIOS 200
+#define CORDAS_REFERENCIA   4096 // Cordas do comprimento de referência
+#define FRACOES             40   // Frações do comprimento testadas por caminho
+
+// Tolerâncias, em fração do comprimento do caminho (ou de uma unidade, nos
+// caminhos mais curtos, em que domina o arredondamento de cubic_bezier()):
+// BezierPath usa BEZIERPATH_SAMPLES cordas por segmento, e BezierPathBatch
+// ainda interpola o parâmetro entre BEZIERPATH_TABLE_SIZE distâncias.
+#define ERRO_PARAMETRO 1e-4f
+#define ERRO_CAMINHO   2e-3f
+#define ERRO_LOTE      1e-2f
+
+// A função de main.cpp antes de "bezierpath.h".
+static glm::vec3 cubic_bezier(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 p4, float t)
+{
+    return (float)(pow((1-t),3)) * p1 + (float)(3*t*pow((1-t),2)) * p2 + (float)(3*t*t*(1-t)) * p3 + (float)(t*t*t)*p4;
+}
+
+// Comprimento acumulado de cubic_bezier() em CORDAS_REFERENCIA+1 pontos.
+static std::vector<double> ComprimentoReferencia(const glm::vec3 p[4])
+{
+    std::vector<double> acumulado(CORDAS_REFERENCIA + 1, 0.0);
+    glm::vec3 anterior = p[0];
+    for (int j = 1; j <= CORDAS_REFERENCIA; ++j)
+    {
+        glm::vec3 atual = cubic_bezier(p[0], p[1], p[2], p[3], (float)j / CORDAS_REFERENCIA);
+        acumulado[j] = acumulado[j-1] + glm::length(atual - anterior);
+        anterior = atual;
+    }
+    return acumulado;
+}
+
+// Ponto de cubic_bezier() após percorrer a fração "f" do comprimento.
+static glm::vec3 PontoReferencia(const glm::vec3 p[4], const std::vector<double>& acumulado, float f)
+{
+    double s = std::min(std::max((double)f, 0.0), 1.0) * acumulado.back();
+    size_t k = std::upper_bound(acumulado.begin(), acumulado.end(), s) - acumulado.begin();
+    k = std::min(std::max(k, (size_t)1), acumulado.size() - 1) - 1;
+    double trecho = acumulado[k+1] - acumulado[k];
+    double w = trecho > 0.0 ? (s - acumulado[k]) / trecho : 0.0;
+    return cubic_bezier(p[0], p[1], p[2], p[3], (float)((k + w) / CORDAS_REFERENCIA));
+}
+
+static float Aleatorio(float a, float b)
+{
+    return a + (b - a) * (float)std::rand() / (float)RAND_MAX;
+}
+
+// Frações percorridas testadas: uniformes (velocidade constante), com
+// BezierPath_EaseInOut(), com BezierPath_EaseSigmoid() e com a sigmoide do
+// tempo de fuga das estátuas (veja "statueai.h").
+static float Fracao(int modo, int j)
+{
+    float x = (float)j / FRACOES;
+    switch (modo)
+    {
+        case 0:  return x;
+        case 1:  return BezierPath_EaseInOut(x);
+        case 2:  return BezierPath_EaseSigmoid(x, 8.0f);
+        default: return 1.0f / (1.0f + std::exp(-2.0f*(10.0f*x - 5.0f)));
+    }
+}
+#define MODOS 4
+
+int main()
+{
+    // Pontos de controle com espaçamentos bem diferentes, e depois aleatórios
+    std::vector<glm::vec3> pontos;
+    const glm::vec3 fixos[][4] =
+    {
+        { glm::vec3(0, 0, 0), glm::vec3(1, 0, 0),  glm::vec3(2, 0, 0),   glm::vec3(3, 0, 0)   }, // Reta uniforme
+        { glm::vec3(0, 0, 0), glm::vec3(0.1f, 0, 0), glm::vec3(0.2f, 0, 0), glm::vec3(10, 0, 0) }, // Reta concentrada no início
+        { glm::vec3(0, 0, 0), glm::vec3(0, 0, 10), glm::vec3(10, 0, -10), glm::vec3(10, 0, 0)  }, // Curva em S
+        { glm::vec3(0, 1, 0), glm::vec3(5, 1, 5),  glm::vec3(0, 1, 5),   glm::vec3(5, 1, 0)   }, // Laço
+        { glm::vec3(2, 1, 2), glm::vec3(2, 1, 2),  glm::vec3(2, 1, 2),   glm::vec3(2, 1, 2)   }, // Parada
+    };
+    for (size_t i = 0; i < sizeof(fixos) / sizeof(fixos[0]); ++i)
+        pontos.insert(pontos.end(), fixos[i], fixos[i] + 4);
+
+    std::srand(1);
+    for (int i = 0; i < CAMINHOS_ALEATORIOS; ++i)
+    {
+        glm::vec3 p(Aleatorio(-50.0f, 50.0f), Aleatorio(0.0f, 2.0f), Aleatorio(-50.0f, 50.0f));
+        float passo = Aleatorio(0.1f, 10.0f);
+        for (int k = 0; k < 4; ++k)
+        {
+            pontos.push_back(p);
+            p += passo * glm::vec3(Aleatorio(-1.0f, 1.0f), Aleatorio(-0.1f, 0.1f), Aleatorio(-1.0f, 1.0f));
+        }
+    }
+    size_t caminhos = pontos.size() / 4;
+
+    BezierPathBatch lote;
+    std::vector< std::vector<double> > referencias(caminhos);
+    float maior_erro[3] = { 0.0f, 0.0f, 0.0f }; // Parâmetro, caminho, lote
+    for (size_t i = 0; i < caminhos; ++i)
+    {
+        const glm::vec3* p = &pontos[4*i];
+        BezierPath caminho;
+        BezierPath_Build(&caminho, p, 4);
+        BezierPathBatch_Add(&lote, p);
+
+        referencias[i] = ComprimentoReferencia(p);
+        const std::vector<double>& acumulado = referencias[i];
+        float escala = std::max((float)acumulado.back(), 1.0f);
+        TESTE_VERIFICA(std::fabs(caminho.total - acumulado.back()) <= ERRO_CAMINHO * escala,
+                       "caminho %lu: comprimento %f, esperado %f", (unsigned long)i, caminho.total, acumulado.back());
+
+        for (int j = 0; j <= FRACOES; ++j)
+        {
+            float u = (float)j / FRACOES;
+            float erro = glm::length(BezierPath_Evaluate(caminho, u) - cubic_bezier(p[0], p[1], p[2], p[3], u)) / escala;
+            maior_erro[0] = std::max(maior_erro[0], erro);
+            TESTE_VERIFICA(erro <= ERRO_PARAMETRO, "caminho %lu, u = %f: erro de %f", (unsigned long)i, u, erro);
+        }
+
+        for (int modo = 0; modo < MODOS; ++modo)
+            for (int j = 0; j <= FRACOES; ++j)
+            {
+                float f = Fracao(modo, j);
+                float erro = glm::length(BezierPath_PointAtFraction(caminho, f) - PontoReferencia(p, acumulado, f)) / escala;
+                maior_erro[1] = std::max(maior_erro[1], erro);
+                TESTE_VERIFICA(erro <= ERRO_CAMINHO, "caminho %lu, modo %d, f = %f: erro de %f", (unsigned long)i, modo, f, erro);
+            }
+    }
+
+    // O lote inteiro (grupos de quatro com SSE e o resto sem), e uma faixa
+    // que começa no meio de um grupo
+    TESTE_VERIFICA(lote.count == caminhos, "%lu caminhos no lote", (unsigned long)lote.count);
+    std::vector<float> fracao(caminhos), x(caminhos), y(caminhos), z(caminhos);
+    for (int modo = 0; modo < MODOS; ++modo)
+        for (int j = 0; j <= FRACOES; ++j)
+        {
+            for (size_t i = 0; i < caminhos; ++i)
+                fracao[i] = Fracao(modo, (j + (int)i) % (FRACOES + 1));
+
+            std::fill(x.begin(), x.end(), NAN);
+            size_t first = j % 2 ? 0 : 3, count = j % 2 ? caminhos : 6;
+            BezierPathBatch_Evaluate(lote, first, count, fracao.data(), x.data(), y.data(), z.data());
+
+            for (size_t i = 0; i < caminhos; ++i)
+            {
+                if (i < first || i >= first + count)
+                {
+                    TESTE_VERIFICA(std::isnan(x[i]), "caminho %lu, fora da faixa, foi escrito", (unsigned long)i);
+                    continue;
+                }
+                const glm::vec3* p = &pontos[4*i];
+                const std::vector<double>& acumulado = referencias[i];
+                float escala = std::max((float)acumulado.back(), 1.0f);
+                float erro = glm::length(glm::vec3(x[i], y[i], z[i]) - PontoReferencia(p, acumulado, fracao[i])) / escala;
+                maior_erro[2] = std::max(maior_erro[2], erro);
+                TESTE_VERIFICA(erro <= ERRO_LOTE, "lote, caminho %lu, modo %d, f = %f: erro de %f",
+                               (unsigned long)i, modo, fracao[i], erro);
+            }
+        }
+
+    // Caminho de dois segmentos: cada um ocupa metade do parâmetro
+    const glm::vec3 dois[7] = { glm::vec3(0, 0, 0), glm::vec3(2, 0, 4), glm::vec3(4, 0, 4), glm::vec3(6, 0, 0),
+                                glm::vec3(8, 0, -4), glm::vec3(12, 0, -4), glm::vec3(12, 0, 0) };
+    BezierPath longo;
+    BezierPath_Build(&longo, dois, 7);
+    std::vector<double> primeiro = ComprimentoReferencia(dois), segundo = ComprimentoReferencia(dois + 3);
+    float escala = (float)(primeiro.back() + segundo.back());
+    TESTE_VERIFICA(std::fabs(longo.total - escala) <= ERRO_CAMINHO * escala, "dois segmentos: comprimento %f, esperado %f", longo.total, escala);
+    for (int j = 0; j <= FRACOES; ++j)
+    {
+        float u = (float)j / FRACOES;
+        const glm::vec3* p = u < 0.5f ? dois : dois + 3;
+        glm::vec3 esperado = cubic_bezier(p[0], p[1], p[2], p[3], u < 0.5f ? 2.0f*u : 2.0f*u - 1.0f);
+        float erro = glm::length(BezierPath_Evaluate(longo, u) - esperado) / escala;
+        TESTE_VERIFICA(erro <= ERRO_PARAMETRO, "dois segmentos, u = %f: erro de %f", u, erro);
+
+        double s = u * escala;
+        esperado = s <= primeiro.back() ? PontoReferencia(dois, primeiro, (float)(s / primeiro.back()))
+                                        : PontoReferencia(dois + 3, segundo, (float)((s - primeiro.back()) / segundo.back()));
+        erro = glm::length(BezierPath_PointAtDistance(longo, (float)s) - esperado) / escala;
+        TESTE_VERIFICA(erro <= ERRO_CAMINHO, "dois segmentos, s = %f: erro de %f", s, erro);
+    }
+
+    printf("bezierpath: %lu caminhos; maior erro (em fração do comprimento) %.2e pelo parâmetro, "
+           "%.2e em BezierPath e %.2e em BezierPathBatch.\n",
+           (unsigned long)caminhos, maior_erro[0], maior_erro[1], maior_erro[2]);
+    return Teste_Fim("bezierpath_test");
+}
@@ -0,0 +1,236 @@
+// Testes das consultas de "bvh.h" em malhas que levam a árvores profundas:
+// triângulos com espaçamento geométrico, em que a SAH separa um triângulo
+// por nível, triângulos com o mesmo centróide e uma árvore montada à mão
+// mais funda que BVH_MAX_DEPTH. Raios, caixas e cápsulas devem achar todos
+// os triângulos (ou, quando a pilha não basta, dar a consulta como
+// bloqueada, nunca como livre), BVH_Build() não pode passar de
+// BVH_MAX_DEPTH e o cache deve recusar árvores inválidas ou profundas
+// demais.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "bvh.h"
+#include "teste.h"
+
+#define DEGRAUS      50   // Triângulos da escada das consultas, em x = 1.5^i
+#define DEGRAUS_SAH  200  // Da escada que só é construída, de x = 1.5^-100 a 1.5^99
+#define COINCIDENTES 2000
+#define PROFUNDA     100  // Profundidade da árvore montada à mão
+
+// Triângulos nos planos x = 1.5^i, i em [primeiro, primeiro + n), de
+// semi-largura "largura" * 1.5^i, centrados no eixo x
+static void ConstroiEscada(BVH* bvh, int primeiro, int n, float largura)
+{
+    std::vector<float>        posicoes;
+    std::vector<unsigned int> indices;
+    for (int i = 0; i < n; ++i)
+    {
+        float x = std::pow(1.5f, (float)(primeiro + i)), s = largura * x;
+        const float v[9] = { x, -s, -s,  x, s, -s,  x, 0.0f, s };
+        posicoes.insert(posicoes.end(), v, v + 9);
+        for (int k = 0; k < 3; ++k)
+            indices.push_back(3 * i + k);
+    }
+    BVH_Build(bvh, posicoes.data(), 3, indices.data(), indices.size());
+}
+
+static int Profundidade(const BVH& bvh, uint32_t no = 0)
+{
+    if (bvh.nos[no].num_triangulos > 0)
+        return 0;
+    return 1 + std::max(Profundidade(bvh, bvh.nos[no].inicio), Profundidade(bvh, bvh.nos[no].inicio + 1));
+}
+
+// Triângulos nas folhas; cada um aparece em exatamente uma
+static size_t TriangulosNasFolhas(const BVH& bvh)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < bvh.nos.size(); ++i)
+        total += bvh.nos[i].num_triangulos;
+    return total;
+}
+
+static void VerificaEscada()
+{
+    BVH bvh;
+    ConstroiEscada(&bvh, 0, DEGRAUS, 0.25f);
+
+    unsigned long raios = 0, ocultos = 0, livres = 0, caixas = 0, fora = 0, capsulas = 0;
+    const glm::vec3 eixo_x(1.0f, 0.0f, 0.0f);
+    for (int i = 0; i < DEGRAUS; ++i)
+    {
+        float x = std::pow(1.5f, (float)i);
+
+        // Antes do triângulo i só há os menores, que ficam para trás
+        glm::vec3 origem(0.9f * x, 0.0f, 0.0f);
+        float  t   = 0.0f;
+        size_t tri = 0;
+        raios   += !(BVH_Raycast(bvh, origem, eixo_x, 1e30f, &t, &tri)
+                     && bvh.triangulos[tri].v0.x == x && std::fabs(t - 0.1f * x) <= 1e-4f * x);
+        ocultos += !BVH_Occluded(bvh, origem, eixo_x, 0.2f * x);
+        livres  += BVH_Occluded(bvh, origem, eixo_x, 0.05f * x);
+
+        // Entre os planos x e 1.5x não há nada
+        glm::vec3 h(0.01f * x);
+        glm::vec3 centro(x, 0.0f, 0.0f), vazio(1.2f * x, 0.0f, 0.0f);
+        caixas   += !BVH_OverlapsBox(bvh, centro - h, centro + h);
+        fora     += BVH_OverlapsBox(bvh, vazio - h, vazio + h);
+        capsulas += !BVH_OverlapsCapsule(bvh, glm::vec3(0.95f * x, 0.0f, 0.0f), glm::vec3(0.98f * x, 0.0f, 0.0f), 0.03f * x);
+        fora     += BVH_OverlapsCapsule(bvh, glm::vec3(1.1f * x, 0.0f, 0.0f), glm::vec3(1.3f * x, 0.0f, 0.0f), 0.05f * x);
+    }
+    printf("bvh: escada de %d triângulos, profundidade %d.\n", DEGRAUS, Profundidade(bvh));
+    TESTE_VERIFICA(raios == 0, "escada: %lu triângulos não achados por BVH_Raycast()", raios);
+    TESTE_VERIFICA(ocultos == 0, "escada: %lu triângulos não achados por BVH_Occluded()", ocultos);
+    TESTE_VERIFICA(livres == 0, "escada: %lu raios livres dados como bloqueados", livres);
+    TESTE_VERIFICA(caixas == 0, "escada: %lu triângulos não achados por BVH_OverlapsBox()", caixas);
+    TESTE_VERIFICA(capsulas == 0, "escada: %lu triângulos não achados por BVH_OverlapsCapsule()", capsulas);
+    TESTE_VERIFICA(fora == 0, "escada: %lu sobreposições com espaços vazios", fora);
+
+    // Da origem, o primeiro triângulo atingido é o menor, o mais fundo da árvore
+    float  t   = 0.0f;
+    size_t tri = 0;
+    TESTE_VERIFICA(BVH_Raycast(bvh, glm::vec3(0.0f), eixo_x, 1e30f, &t, &tri) && t == 1.0f,
+                   "escada: raio da origem atinge t = %g em vez de 1", t);
+
+    // Em quase toda a faixa de um float a SAH separaria um triângulo por
+    // nível além de BVH_SAH_MAX_DEPTH
+    BVH extrema;
+    ConstroiEscada(&extrema, -DEGRAUS_SAH / 2, DEGRAUS_SAH, 0.01f);
+    int profundidade = Profundidade(extrema);
+    printf("bvh: escada de %d triângulos de 1e-18 a 1e17, profundidade %d.\n", DEGRAUS_SAH, profundidade);
+    TESTE_VERIFICA(profundidade > 1 && profundidade <= BVH_MAX_DEPTH, "escada extrema: profundidade %d", profundidade);
+    TESTE_VERIFICA(TriangulosNasFolhas(extrema) == DEGRAUS_SAH, "escada extrema: %lu triângulos nas folhas",
+                   (unsigned long)TriangulosNasFolhas(extrema));
+}
+
+// Todos os triângulos com o mesmo centróide: só a divisão pela mediana
+static void VerificaCoincidentes()
+{
+    std::vector<float>        posicoes;
+    std::vector<unsigned int> indices;
+    for (int i = 0; i < COINCIDENTES; ++i)
+    {
+        float s = 1.0f + 0.001f * i;
+        const float v[9] = { -s, -s, 0.0f,  s, -s, 0.0f,  0.0f, s, 0.0f };
+        posicoes.insert(posicoes.end(), v, v + 9);
+        for (int k = 0; k < 3; ++k)
+            indices.push_back(3 * i + k);
+    }
+    BVH bvh;
+    BVH_Build(&bvh, posicoes.data(), 3, indices.data(), indices.size());
+
+    int profundidade = Profundidade(bvh);
+    TESTE_VERIFICA(profundidade <= BVH_MAX_DEPTH, "coincidentes: profundidade %d", profundidade);
+    TESTE_VERIFICA(TriangulosNasFolhas(bvh) == COINCIDENTES, "coincidentes: %lu triângulos nas folhas",
+                   (unsigned long)TriangulosNasFolhas(bvh));
+    TESTE_VERIFICA(BVH_OverlapsBox(bvh, glm::vec3(-0.1f), glm::vec3(0.1f)), "coincidentes: caixa no centro sem sobreposição");
+    TESTE_VERIFICA(BVH_Occluded(bvh, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), 2.0f),
+                   "coincidentes: raio pelo centro não bloqueado");
+}
+
+// Árvore bem formada, mas mais funda que BVH_MAX_DEPTH (como sairia de um
+// construtor sem o limite): um nó interno e uma folha por nível, com o
+// menor triângulo da escada na folha mais funda.
+static void ArvoreProfunda(BVH* bvh)
+{
+    ConstroiEscada(bvh, 0, PROFUNDA + 1, 0.25f);
+    std::sort(bvh->triangulos.begin(), bvh->triangulos.end(),
+              [](const BVHTriangle& a, const BVHTriangle& b) { return a.v0.x < b.v0.x; });
+
+    BVHNode raiz = bvh->nos[0];
+    bvh->nos.assign(1, raiz);
+    uint32_t atual = 0;
+    for (uint32_t nivel = 0; nivel < PROFUNDA; ++nivel)
+    {
+        uint32_t filho = (uint32_t)bvh->nos.size();
+        bvh->nos[atual].inicio         = filho;
+        bvh->nos[atual].num_triangulos = 0;
+        BVHNode folha = raiz;
+        folha.inicio         = PROFUNDA - nivel;
+        folha.num_triangulos = 1;
+        bvh->nos.push_back(raiz);
+        bvh->nos.push_back(folha);
+        atual = filho;
+    }
+    bvh->nos[atual].inicio         = 0;
+    bvh->nos[atual].num_triangulos = 1;
+}
+
+static void VerificaArvoreProfunda()
+{
+    BVH bvh;
+    ArvoreProfunda(&bvh);
+    TESTE_VERIFICA(Profundidade(bvh) == PROFUNDA, "árvore montada com profundidade %d", Profundidade(bvh));
+
+    // O único triângulo ao alcance está na folha mais funda
+    const glm::vec3 origem(0.5f, 0.0f, 0.0f), eixo_x(1.0f, 0.0f, 0.0f);
+    TESTE_VERIFICA(BVH_Occluded(bvh, origem, eixo_x, 1.0f), "árvore profunda: raio dado como livre");
+    TESTE_VERIFICA(BVH_OverlapsBox(bvh, glm::vec3(0.99f, -0.01f, -0.01f), glm::vec3(1.01f, 0.01f, 0.01f)),
+                   "árvore profunda: caixa dada como livre");
+    TESTE_VERIFICA(BVH_OverlapsCapsule(bvh, glm::vec3(0.9f, 0.0f, 0.0f), glm::vec3(0.95f, 0.0f, 0.0f), 0.1f),
+                   "árvore profunda: cápsula dada como livre");
+}
+
+// Salva "bvh" no cache de "fonte" e o lê de volta
+static bool SalvaELe(const std::string& cache, const char* fonte, const BVH& bvh)
+{
+    std::vector<std::shared_ptr<const BVH> > salvas(1, std::make_shared<BVH>(bvh));
+    std::vector<std::shared_ptr<const BVH> > lidas;
+    std::vector<size_t> num_triangulos(1, bvh.triangulos.size());
+    TESTE_VERIFICA(BVH_SaveCache(cache.c_str(), fonte, salvas), "erro ao salvar \"%s\"", cache.c_str());
+    bool ok = BVH_LoadCache(cache.c_str(), fonte, num_triangulos, &lidas);
+    return ok && lidas.size() == 1 && lidas[0]->nos.size() == bvh.nos.size();
+}
+
+static void VerificaCache()
+{
+    char fonte[] = "/tmp/bvh_testXXXXXX";
+    int fd = mkstemp(fonte);
+    TESTE_VERIFICA(fd >= 0, "não foi possível criar um arquivo temporário");
+    if (fd < 0)
+        return;
+    TESTE_VERIFICA(write(fd, "o escada\n", 9) == 9, "erro ao escrever \"%s\"", fonte);
+    close(fd);
+    std::string cache = std::string(fonte) + ".bvh";
+
+    BVH escada;
+    ConstroiEscada(&escada, 0, DEGRAUS, 0.25f);
+    TESTE_VERIFICA(SalvaELe(cache, fonte, escada), "cache válido recusado");
+
+    BVH fora_dos_nos = escada;
+    fora_dos_nos.nos[0].inicio = (uint32_t)fora_dos_nos.nos.size();
+    TESTE_VERIFICA(!SalvaELe(cache, fonte, fora_dos_nos), "cache com filho fora do vetor de nós aceito");
+
+    BVH ciclo = escada;
+    ciclo.nos[ciclo.nos[0].inicio].inicio         = 0;
+    ciclo.nos[ciclo.nos[0].inicio].num_triangulos = 0;
+    TESTE_VERIFICA(!SalvaELe(cache, fonte, ciclo), "cache com filho antes do pai aceito");
+
+    BVH fora_dos_triangulos = escada;
+    fora_dos_triangulos.nos.back().num_triangulos = DEGRAUS + 1;
+    TESTE_VERIFICA(!SalvaELe(cache, fonte, fora_dos_triangulos), "cache com folha fora do vetor de triângulos aceito");
+
+    BVH profunda;
+    ArvoreProfunda(&profunda);
+    TESTE_VERIFICA(!SalvaELe(cache, fonte, profunda), "cache com árvore mais funda que BVH_MAX_DEPTH aceito");
+
+    std::remove(cache.c_str());
+    std::remove(fonte);
+}
+
+int main()
+{
+    VerificaEscada();
+    VerificaCoincidentes();
+    VerificaArvoreProfunda();
+    VerificaCache();
+    return Teste_Fim("bvh_test");
+}
@@ -0,0 +1,211 @@
+// Testes do sistema de tarefas ("jobs.h"): cobertura e tamanho das faixas
+// de Jobs_ParallelFor(), tarefas aninhadas, tarefas pai e filhas, roubo de
+// tarefas, tarefas de segundo plano e uso por threads fora do conjunto,
+// antes e depois de Jobs_Init().
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+
+#include "jobs.h"
+#include "teste.h"
+
+#define MAIOR_FAIXA  5000
+#define SORTEIOS     2000
+#define TAREFAS      256
+
+static std::atomic<int> g_Contagem[MAIOR_FAIXA + 100];
+
+// Faixas recebidas por f(a, b) em uma chamada de Jobs_ParallelFor()
+struct Faixas
+{
+    std::mutex                             mutex;
+    std::vector<std::pair<size_t, size_t> > faixas;
+    std::vector<std::thread::id>           threads;
+};
+
+// Chama Jobs_ParallelFor(inicio, fim, grao) e verifica que cada elemento
+// foi visitado uma vez, que as faixas têm pelo menos "grao" elementos (a
+// não ser a última), que não passam de quatro por thread e que a thread
+// atual executou a primeira.
+static void VerificaParallelFor(size_t inicio, size_t fim, size_t grao)
+{
+    for (size_t i = 0; i < fim; ++i)
+        g_Contagem[i].store(0);
+
+    Faixas r;
+    Jobs_ParallelFor(inicio, fim, grao, [&r](size_t a, size_t b)
+    {
+        for (size_t i = a; i < b; ++i)
+            g_Contagem[i].fetch_add(1);
+        std::lock_guard<std::mutex> trava(r.mutex);
+        r.faixas.push_back(std::make_pair(a, b));
+        r.threads.push_back(std::this_thread::get_id());
+    });
+
+    unsigned long erradas = 0;
+    for (size_t i = 0; i < fim; ++i)
+        erradas += g_Contagem[i].load() != (i >= inicio ? 1 : 0);
+    TESTE_VERIFICA(erradas == 0, "[%lu, %lu), grão %lu: %lu elementos visitados zero ou várias vezes",
+                   (unsigned long)inicio, (unsigned long)fim, (unsigned long)grao, erradas);
+
+    if (fim <= inicio)
+    {
+        TESTE_VERIFICA(r.faixas.empty(), "faixa vazia [%lu, %lu) chamou f()", (unsigned long)inicio, (unsigned long)fim);
+        return;
+    }
+
+    TESTE_VERIFICA(r.faixas.size() <= 4 * Jobs_NumThreads(), "[%lu, %lu), grão %lu: %lu faixas para %u threads",
+                   (unsigned long)inicio, (unsigned long)fim, (unsigned long)grao, (unsigned long)r.faixas.size(), Jobs_NumThreads());
+    for (size_t k = 0; k < r.faixas.size(); ++k)
+    {
+        size_t a = r.faixas[k].first, b = r.faixas[k].second;
+        TESTE_VERIFICA(b == fim || b - a >= grao, "[%lu, %lu), grão %lu: faixa [%lu, %lu) pequena demais",
+                       (unsigned long)inicio, (unsigned long)fim, (unsigned long)grao, (unsigned long)a, (unsigned long)b);
+        if (a == inicio)
+            TESTE_VERIFICA(r.threads[k] == std::this_thread::get_id(), "[%lu, %lu): primeira faixa executada por outra thread",
+                           (unsigned long)inicio, (unsigned long)fim);
+    }
+}
+
+// Pai, filhas e netas: o pai só termina depois de todas.
+static void VerificaPaiEFilhas()
+{
+    std::atomic<bool> liberadas(false);
+    std::atomic<int>  executadas(0);
+
+    Job* raiz = Jobs_Create([&executadas]() { executadas.fetch_add(1); });
+    for (int i = 0; i < 8; ++i)
+    {
+        Job* filha = Jobs_Create([&executadas]() { executadas.fetch_add(1); }, raiz);
+        for (int j = 0; j < 8; ++j)
+        {
+            Job* neta = Jobs_Create([&liberadas, &executadas]()
+            {
+                while (!liberadas.load())
+                    std::this_thread::yield();
+                executadas.fetch_add(1);
+            }, filha);
+            Jobs_Run(neta);
+            Jobs_Release(neta);
+        }
+        Jobs_Run(filha);
+        Jobs_Release(filha);
+    }
+    Jobs_Run(raiz);
+
+    // As netas esperam "liberadas": nada pode ter terminado a raiz ainda
+    for (int k = 0; k < 1000 && executadas.load() < 1 + 8; ++k)
+        std::this_thread::yield();
+    TESTE_VERIFICA(!Jobs_Done(raiz), "raiz terminou antes das netas");
+
+    liberadas.store(true);
+    Jobs_Wait(raiz);
+    TESTE_VERIFICA(executadas.load() == 1 + 8 + 64, "%d de %d tarefas executadas ao terminar a raiz", executadas.load(), 1 + 8 + 64);
+}
+
+int main()
+{
+    // Sem Jobs_Init(), tudo acontece na thread atual
+    VerificaParallelFor(3, 1000, 10);
+    bool executou = false;
+    Job* job = Jobs_Create([&executou]() { executou = true; });
+    Jobs_RunBackground(job);
+    TESTE_VERIFICA(executou, "tarefa de segundo plano não executada em Jobs_RunBackground() sem Jobs_Init()");
+    Jobs_Wait(job);
+
+    Jobs_Init();
+    TESTE_VERIFICA(Jobs_NumThreads() >= 2, "%u threads depois de Jobs_Init()", Jobs_NumThreads());
+
+    std::srand(1);
+    for (int k = 0; k < SORTEIOS; ++k)
+    {
+        size_t inicio = std::rand() % 100;
+        size_t fim    = inicio + std::rand() % MAIOR_FAIXA;
+        size_t grao   = k % 10 == 0 ? 0 : 1 + std::rand() % 600;
+        VerificaParallelFor(inicio, fim, grao);
+    }
+    VerificaParallelFor(50, 50, 1);
+    VerificaParallelFor(60, 50, 1);
+
+    // Jobs_ParallelFor() dentro de Jobs_ParallelFor()
+    std::atomic<long> soma(0);
+    Jobs_ParallelFor(0, 64, 1, [&soma](size_t a, size_t b)
+    {
+        for (size_t i = a; i < b; ++i)
+            Jobs_ParallelFor(0, 1000, 10, [&soma](size_t c, size_t d) { soma.fetch_add((long)(d - c)); });
+    });
+    TESTE_VERIFICA(soma.load() == 64 * 1000, "Jobs_ParallelFor() aninhado: %ld de %d elementos", soma.load(), 64 * 1000);
+
+    VerificaPaiEFilhas();
+
+    // Tarefas na fila da thread atual, que não as executa: só terminam se
+    // as outras threads as roubarem
+    JobStats antes = Jobs_Stats();
+    std::atomic<int> roubadas(0);
+    std::vector<Job*> tarefas;
+    for (int i = 0; i < TAREFAS; ++i)
+    {
+        tarefas.push_back(Jobs_Create([&roubadas]() { roubadas.fetch_add(1); }));
+        Jobs_Run(tarefas.back());
+    }
+    for (int i = 0; i < TAREFAS; ++i)
+        while (!Jobs_Done(tarefas[i]))
+            std::this_thread::yield();
+    for (int i = 0; i < TAREFAS; ++i)
+        Jobs_Wait(tarefas[i]);
+    JobStats depois = Jobs_Stats();
+    TESTE_VERIFICA(roubadas.load() == TAREFAS, "%d de %d tarefas executadas", roubadas.load(), TAREFAS);
+    TESTE_VERIFICA(depois.stolen - antes.stolen >= TAREFAS, "só %lu tarefas roubadas", depois.stolen - antes.stolen);
+
+    // Segundo plano: executadas pelas threads do conjunto, nunca por
+    // Jobs_Wait() na thread atual
+    antes = Jobs_Stats();
+    std::mutex mutex;
+    std::vector<std::thread::id> executoras;
+    Job* grupo = Jobs_Create(JobFunction());
+    for (int i = 0; i < TAREFAS; ++i)
+    {
+        Job* leitura = Jobs_Create([&mutex, &executoras]()
+        {
+            std::lock_guard<std::mutex> trava(mutex);
+            executoras.push_back(std::this_thread::get_id());
+        }, grupo);
+        Jobs_RunBackground(leitura);
+        Jobs_Release(leitura);
+    }
+    Jobs_Run(grupo);
+    Jobs_Wait(grupo);
+    depois = Jobs_Stats();
+    TESTE_VERIFICA(executoras.size() == TAREFAS, "%lu de %d tarefas de segundo plano executadas", (unsigned long)executoras.size(), TAREFAS);
+    TESTE_VERIFICA(std::count(executoras.begin(), executoras.end(), std::this_thread::get_id()) == 0,
+                   "tarefa de segundo plano executada dentro de Jobs_Wait()");
+    TESTE_VERIFICA(depois.background - antes.background == TAREFAS, "%lu tarefas de segundo plano contadas",
+                   depois.background - antes.background);
+
+    // Uma thread fora do conjunto usa a fila compartilhada
+    std::thread externa([]()
+    {
+        for (int k = 0; k < 50; ++k)
+            VerificaParallelFor(0, 1 + std::rand() % MAIOR_FAIXA, 16);
+        std::atomic<int> executadas(0);
+        Job* job = Jobs_Create([&executadas]() { executadas.fetch_add(1); });
+        Jobs_Run(job);
+        Jobs_Wait(job);
+        TESTE_VERIFICA(executadas.load() == 1, "tarefa de uma thread externa não executada");
+    });
+    externa.join();
+
+    Jobs_Shutdown();
+    TESTE_VERIFICA(Jobs_NumThreads() == 1, "%u threads depois de Jobs_Shutdown()", Jobs_NumThreads());
+    VerificaParallelFor(0, 777, 7);
+
+    JobStats stats = Jobs_Stats();
+    printf("jobs: %lu tarefas executadas, %lu roubadas, %lu dentro de Jobs_Wait(), %lu de segundo plano.\n",
+           stats.jobs, stats.stolen, stats.helped, stats.background);
+    return Teste_Fim("jobs_test");
+}
@@ -0,0 +1,285 @@
+// Testes de NavMesh ("navmesh.h") em níveis sintéticos: um chão aberto, um
+// muro no meio do caminho, que o caminho deve contornar sem atravessar, e
+// um corredor em zigue-zague com mais curvas do que cabem em
+// NAVMESH_MAX_PATH pontos, que deve marcar o caminho como truncado. O cache
+// deve devolver a mesma malha e recusar arquivos de outra chave, truncados,
+// com outro "magic" ou com índices fora dos vetores.
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+#include "navmesh.h"
+#include "teste.h"
+
+#define MUROS_CURTO 3  // Muros do zigue-zague que ainda cabe em NAVMESH_MAX_PATH
+#define MUROS_LONGO 12 // Muros do que não cabe
+
+// Cubo [0, 1]^3: 8 vértices e 12 triângulos
+static const float CUBO_VERTICES[8 * 3] = { 0,0,0,  1,0,0,  0,1,0,  1,1,0,  0,0,1,  1,0,1,  0,1,1,  1,1,1 };
+static const unsigned int CUBO_INDICES[12 * 3] = { 0,4,6, 0,6,2,  1,3,7, 1,7,5,  0,1,5, 0,5,4,
+                                                   2,6,7, 2,7,3,  0,2,3, 0,3,1,  4,5,7, 4,7,6 };
+
+struct Nivel
+{
+    std::vector<glm::vec3> triangulos;
+    NavMeshParams          params;
+    NavMesh                navmesh;
+};
+
+static void Caixa(Nivel* nivel, const glm::vec3& min, const glm::vec3& max)
+{
+    for (int k = 0; k < 12 * 3; ++k)
+    {
+        const float* v = &CUBO_VERTICES[3 * CUBO_INDICES[k]];
+        nivel->triangulos.push_back(min + glm::vec3(v[0], v[1], v[2]) * (max - min));
+    }
+}
+
+// Chão em y = 0 sobre [x0, x1] x [z0, z1], com os parâmetros de
+// PrepareNavMesh() em main.cpp, exceto células menores (0.2 em vez de 0.3)
+// para que as medidas dos níveis caiam nas bordas das células
+static void Chao(Nivel* nivel, float x0, float z0, float x1, float z1)
+{
+    glm::vec3 a(x0, 0.0f, z0), b(x1, 0.0f, z0), c(x1, 0.0f, z1), d(x0, 0.0f, z1);
+    const glm::vec3 plano[6] = { a, c, b, a, d, c };
+    nivel->triangulos.insert(nivel->triangulos.end(), plano, plano + 6);
+
+    NavMeshParams& params = nivel->params;
+    params.min          = glm::vec3(x0, -1.0f, z0);
+    params.max          = glm::vec3(x1,  4.0f, z1);
+    params.cell_size    = 0.2f;
+    params.cell_height  = 0.1f;
+    params.agent_height = 1.8f;
+    params.agent_radius = 0.4f;
+    params.agent_climb  = 0.4f;
+    params.max_slope    = 45.0f;
+}
+
+static void Constroi(Nivel* nivel)
+{
+    NavMesh_Build(&nivel->navmesh, nivel->params, nivel->triangulos.data(), nivel->triangulos.size());
+}
+
+static bool Caminho(const NavMesh& navmesh, const glm::vec3& inicio, const glm::vec3& fim, NavMeshPath* caminho)
+{
+    NavMeshQuery query;
+    query.inicio  = inicio;
+    query.fim     = fim;
+    query.extents = glm::vec3(1.0f, 2.0f, 1.0f);
+    return NavMesh_FindPath(navmesh, query, caminho);
+}
+
+// Nível com um muro de 10 m entre o início e o fim
+static void NivelComMuro(Nivel* nivel)
+{
+    Chao(nivel, -10.0f, -10.0f, 10.0f, 10.0f);
+    Caixa(nivel, glm::vec3(-5.0f, 0.0f, -0.2f), glm::vec3(5.0f, 3.0f, 0.2f));
+    Constroi(nivel);
+}
+
+// Corredor em zigue-zague: muros em z = 2k + 1, com a passagem
+// alternadamente em x > 4 e em x < -4, entre z = -0.5 e z = 2 * muros + 0.5
+static void NivelZigueZague(Nivel* nivel, int muros)
+{
+    Chao(nivel, -6.0f, -2.0f, 6.0f, 2.0f * muros + 2.0f);
+    for (int k = 0; k < muros; ++k)
+    {
+        float z = 2.0f * k + 1.0f;
+        float x0 = k % 2 == 0 ? -6.0f : -4.0f;
+        Caixa(nivel, glm::vec3(x0, 0.0f, z - 0.1f), glm::vec3(x0 + 10.0f, 3.0f, z + 0.1f));
+    }
+    Constroi(nivel);
+}
+
+static void VerificaChaoAberto()
+{
+    Nivel nivel;
+    Chao(&nivel, -10.0f, -10.0f, 10.0f, 10.0f);
+    Constroi(&nivel);
+    TESTE_VERIFICA(!nivel.navmesh.poligonos.empty() && nivel.navmesh.num_regioes == 1,
+                   "chão aberto: %lu polígonos em %u regiões", (unsigned long)nivel.navmesh.poligonos.size(),
+                   nivel.navmesh.num_regioes);
+
+    NavMeshPath caminho;
+    glm::vec3 inicio(-5.0f, 0.0f, -5.0f), fim(5.0f, 0.0f, 4.0f);
+    bool ok = Caminho(nivel.navmesh, inicio, fim, &caminho);
+    TESTE_VERIFICA(ok && caminho.num_pontos == 2 && !caminho.truncado, "chão aberto: caminho com %u pontos",
+                   caminho.num_pontos);
+    TESTE_VERIFICA(std::fabs(caminho.comprimento - glm::distance(inicio, fim)) < 0.1f,
+                   "chão aberto: comprimento %g em vez de %g", caminho.comprimento, glm::distance(inicio, fim));
+
+    // Fora da malha não há caminho
+    TESTE_VERIFICA(!Caminho(nivel.navmesh, inicio, glm::vec3(30.0f, 0.0f, 0.0f), &caminho) && caminho.num_pontos == 0,
+                   "caminho até fora da malha");
+}
+
+static bool DentroDoMuro(const glm::vec3& p)
+{
+    return p.x > -5.0f && p.x < 5.0f && p.z > -0.2f && p.z < 0.2f;
+}
+
+static void VerificaMuro()
+{
+    Nivel nivel;
+    NivelComMuro(&nivel);
+
+    NavMeshPath caminho;
+    glm::vec3 inicio(0.0f, 0.0f, -5.0f), fim(0.0f, 0.0f, 5.0f);
+    bool ok = Caminho(nivel.navmesh, inicio, fim, &caminho);
+    TESTE_VERIFICA(ok && caminho.num_pontos >= 3 && !caminho.truncado, "muro: caminho com %u pontos", caminho.num_pontos);
+    if (!ok || caminho.num_pontos < 2)
+        return;
+
+    // Os pontos ficam no topo das células do chão, até cell_height acima dele
+    TESTE_VERIFICA(glm::distance(caminho.pontos[0], inicio) <= 0.11f
+                && glm::distance(caminho.pontos[caminho.num_pontos - 1], fim) <= 0.11f, "muro: pontas do caminho");
+
+    // Contornando uma ponta do muro (mais o raio do agente): ao menos
+    // 2 * sqrt(5.4^2 + 5^2)
+    float minimo = 2.0f * std::sqrt(5.4f * 5.4f + 5.0f * 5.0f);
+    TESTE_VERIFICA(caminho.comprimento >= minimo - 0.1f && caminho.comprimento < 20.0f,
+                   "muro: comprimento %g, esperado entre %g e 20", caminho.comprimento, minimo);
+
+    unsigned long dentro = 0, fora_do_chao = 0;
+    for (uint32_t i = 0; i + 1 < caminho.num_pontos; ++i)
+        for (int k = 0; k <= 100; ++k)
+        {
+            glm::vec3 p = caminho.pontos[i] + (caminho.pontos[i + 1] - caminho.pontos[i]) * (k / 100.0f);
+            dentro       += DentroDoMuro(p);
+            fora_do_chao += std::fabs(p.y) > 0.2f;
+        }
+    TESTE_VERIFICA(dentro == 0, "muro: %lu pontos do caminho dentro do muro", dentro);
+    TESTE_VERIFICA(fora_do_chao == 0, "muro: %lu pontos do caminho fora do chão", fora_do_chao);
+}
+
+static void VerificaTruncado()
+{
+    NavMeshPath caminho;
+
+    Nivel curto;
+    NivelZigueZague(&curto, MUROS_CURTO);
+    bool ok = Caminho(curto.navmesh, glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 0.0f, 2.0f * MUROS_CURTO + 0.5f), &caminho);
+    printf("navmesh: zigue-zague de %d muros, %u pontos, %.1f m.\n", MUROS_CURTO, caminho.num_pontos, caminho.comprimento);
+    TESTE_VERIFICA(ok && !caminho.truncado && caminho.num_pontos > MUROS_CURTO && caminho.num_pontos < NAVMESH_MAX_PATH,
+                   "zigue-zague curto: %u pontos, truncado = %d", caminho.num_pontos, (int)caminho.truncado);
+
+    Nivel longo;
+    NivelZigueZague(&longo, MUROS_LONGO);
+    glm::vec3 fim(0.0f, 0.0f, 2.0f * MUROS_LONGO + 0.5f);
+    ok = Caminho(longo.navmesh, glm::vec3(0.0f, 0.0f, -0.5f), fim, &caminho);
+    printf("navmesh: zigue-zague de %d muros, %u pontos, truncado = %d.\n", MUROS_LONGO, caminho.num_pontos, (int)caminho.truncado);
+    TESTE_VERIFICA(ok && caminho.truncado && caminho.num_pontos == NAVMESH_MAX_PATH,
+                   "zigue-zague longo: %u pontos, truncado = %d", caminho.num_pontos, (int)caminho.truncado);
+
+    // O caminho truncado para antes do fim, ainda no corredor
+    if (caminho.num_pontos > 0)
+        TESTE_VERIFICA(glm::distance(caminho.pontos[caminho.num_pontos - 1], fim) > 2.0f,
+                       "zigue-zague longo: último ponto no fim do caminho");
+}
+
+static bool MesmaMalha(const NavMesh& a, const NavMesh& b)
+{
+    return a.largura == b.largura && a.profundidade == b.profundidade && a.num_regioes == b.num_regioes
+        && a.poligonos.size() == b.poligonos.size() && a.ligacoes.size() == b.ligacoes.size()
+        && a.inicio_coluna == b.inicio_coluna && a.poligonos_da_coluna == b.poligonos_da_coluna;
+}
+
+// Salva "navmesh" no cache com "chave" e tenta lê-lo com a mesma chave
+static bool SalvaELe(const char* cache, uint64_t chave, const NavMesh& navmesh)
+{
+    TESTE_VERIFICA(NavMesh_SaveCache(cache, chave, navmesh), "erro ao salvar \"%s\"", cache);
+    NavMesh lida;
+    return NavMesh_LoadCache(cache, chave, &lida);
+}
+
+static void VerificaCache()
+{
+    char cache[] = "/tmp/navmesh_testXXXXXX";
+    int fd = mkstemp(cache);
+    TESTE_VERIFICA(fd >= 0, "não foi possível criar um arquivo temporário");
+    if (fd < 0)
+        return;
+    close(fd);
+
+    Nivel nivel;
+    NivelComMuro(&nivel);
+    uint64_t chave = NavMesh_Key(nivel.params, nivel.triangulos.data(), nivel.triangulos.size());
+
+    // Cache válido: a mesma malha e o mesmo caminho
+    NavMesh lida;
+    TESTE_VERIFICA(NavMesh_SaveCache(cache, chave, nivel.navmesh), "erro ao salvar \"%s\"", cache);
+    TESTE_VERIFICA(NavMesh_LoadCache(cache, chave, &lida) && MesmaMalha(lida, nivel.navmesh), "cache válido recusado");
+    NavMeshPath original, do_cache;
+    Caminho(nivel.navmesh, glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(0.0f, 0.0f, 5.0f), &original);
+    Caminho(lida, glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(0.0f, 0.0f, 5.0f), &do_cache);
+    TESTE_VERIFICA(original.num_pontos == do_cache.num_pontos && original.comprimento == do_cache.comprimento,
+                   "caminho diferente na malha lida do cache");
+
+    // Cache antigo: o muro mudou de lugar
+    Nivel movido;
+    Chao(&movido, -10.0f, -10.0f, 10.0f, 10.0f);
+    Caixa(&movido, glm::vec3(-5.0f, 0.0f, 1.8f), glm::vec3(5.0f, 3.0f, 2.2f));
+    uint64_t outra = NavMesh_Key(movido.params, movido.triangulos.data(), movido.triangulos.size());
+    TESTE_VERIFICA(outra != chave, "a chave não mudou com o muro");
+    TESTE_VERIFICA(!NavMesh_LoadCache(cache, outra, &lida), "cache de outro nível aceito");
+
+    // Arquivo truncado e "magic" errado
+    FILE* f = fopen(cache, "rb");
+    std::vector<char> bytes;
+    if (f != NULL)
+    {
+        fseek(f, 0, SEEK_END);
+        bytes.resize((size_t)ftell(f));
+        fseek(f, 0, SEEK_SET);
+        TESTE_VERIFICA(fread(bytes.data(), 1, bytes.size(), f) == bytes.size(), "erro ao ler \"%s\"", cache);
+        fclose(f);
+    }
+    TESTE_VERIFICA(bytes.size() > 16, "cache com %lu bytes", (unsigned long)bytes.size());
+    if (bytes.size() > 16)
+    {
+        TESTE_VERIFICA(truncate(cache, (off_t)bytes.size() - 4) == 0, "erro ao truncar \"%s\"", cache);
+        TESTE_VERIFICA(!NavMesh_LoadCache(cache, chave, &lida), "cache truncado aceito");
+
+        bytes[0] ^= 0xFF;
+        f = fopen(cache, "wb");
+        TESTE_VERIFICA(f != NULL && fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size(), "erro ao escrever \"%s\"", cache);
+        if (f != NULL)
+            fclose(f);
+        TESTE_VERIFICA(!NavMesh_LoadCache(cache, chave, &lida), "cache com \"magic\" errado aceito");
+    }
+
+    // Arquivos do tamanho certo, mas com índices fora dos vetores
+    NavMesh vizinho = nivel.navmesh;
+    vizinho.ligacoes[0].vizinho = (uint32_t)vizinho.poligonos.size();
+    TESTE_VERIFICA(!SalvaELe(cache, chave, vizinho), "cache com ligação para polígono inexistente aceito");
+
+    NavMesh ligacoes = nivel.navmesh;
+    ligacoes.poligonos.back().num_ligacoes += 1;
+    TESTE_VERIFICA(!SalvaELe(cache, chave, ligacoes), "cache com polígono além das ligações aceito");
+
+    NavMesh coluna = nivel.navmesh;
+    coluna.poligonos_da_coluna[0] = (uint32_t)coluna.poligonos.size();
+    TESTE_VERIFICA(!SalvaELe(cache, chave, coluna), "cache com coluna apontando para polígono inexistente aceito");
+
+    NavMesh inicio = nivel.navmesh;
+    inicio.inicio_coluna.back() += 1;
+    TESTE_VERIFICA(!SalvaELe(cache, chave, inicio), "cache com colunas além de poligonos_da_coluna aceito");
+
+    std::remove(cache);
+}
+
+int main()
+{
+    VerificaChaoAberto();
+    VerificaMuro();
+    VerificaTruncado();
+    VerificaCache();
+    return Teste_Fim("navmesh_test");
+}
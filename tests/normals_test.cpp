@@ -0,0 +1,237 @@
+// Testes de Normals_Compute() ("normals.h"): com os pesos por área e sem
+// vincos, o resultado deve ser o do ComputeNormals() anterior (mantido aqui
+// como referência) em todos os modelos de data/; as normais por ângulo e
+// com vincos são conferidas em um cubo, cujas normais exatas conhecemos; e
+// o resultado não pode depender do número de threads.
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include <glm/vec4.hpp>
+
+#include "matrices.h"
+#include "tiny_obj_loader.h"
+#include "normals.h"
+#include "jobs.h"
+#include "teste.h"
+
+#define ERRO_MAXIMO 1e-6f // Por coordenada, em normais unitárias
+
+static const char* MODELOS[] = { "data/snowglobe.obj", "data/iso_flat.obj", "data/iso_flat1piece.obj",
+                                 "data/revolver.obj", "data/statue.obj", "data/plane.obj" };
+
+// Posições e vértice de cada quina (triângulos de todas as shapes)
+struct Malha
+{
+    std::vector<float>    posicoes;
+    std::vector<uint32_t> vertices;
+};
+
+static bool Carrega(const char* arquivo, Malha* malha)
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, arquivo, "data/", true))
+        return false;
+
+    malha->posicoes = attrib.vertices;
+    malha->vertices.clear();
+    for (size_t shape = 0; shape < shapes.size(); ++shape)
+        for (size_t i = 0; i < shapes[shape].mesh.indices.size(); ++i)
+            malha->vertices.push_back(shapes[shape].mesh.indices[i].vertex_index);
+    return true;
+}
+
+// O ComputeNormals() de main.cpp antes de "normals.h": uma normal por
+// vértice, a média das normais (sem normalizar) dos triângulos que o usam.
+static std::vector<float> NormaisAntigas(const Malha& malha)
+{
+    size_t num_vertices = malha.posicoes.size() / 3;
+
+    std::vector<int> num_triangles_per_vertex(num_vertices, 0);
+    std::vector<glm::vec4> vertex_normals(num_vertices, glm::vec4(0.0f,0.0f,0.0f,0.0f));
+
+    for (size_t triangle = 0; 3*triangle + 2 < malha.vertices.size(); ++triangle)
+    {
+        glm::vec4  vertices[3];
+        for (size_t vertex = 0; vertex < 3; ++vertex)
+        {
+            uint32_t idx = malha.vertices[3*triangle + vertex];
+            const float vx = malha.posicoes[3*idx + 0];
+            const float vy = malha.posicoes[3*idx + 1];
+            const float vz = malha.posicoes[3*idx + 2];
+            vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
+        }
+
+        const glm::vec4  a = vertices[0];
+        const glm::vec4  b = vertices[1];
+        const glm::vec4  c = vertices[2];
+
+        const glm::vec4  n = crossproduct(b-a,c-a);
+
+        for (size_t vertex = 0; vertex < 3; ++vertex)
+        {
+            uint32_t idx = malha.vertices[3*triangle + vertex];
+            num_triangles_per_vertex[idx] += 1;
+            vertex_normals[idx] += n;
+        }
+    }
+
+    std::vector<float> normals(3*num_vertices);
+    for (size_t i = 0; i < vertex_normals.size(); ++i)
+    {
+        glm::vec4 n = vertex_normals[i] / (float)num_triangles_per_vertex[i];
+        n /= norm(n);
+        normals[3*i + 0] = n.x;
+        normals[3*i + 1] = n.y;
+        normals[3*i + 2] = n.z;
+    }
+    return normals;
+}
+
+static std::vector<float> Normais(const Malha& malha, NormalsWeight peso, float vinco, size_t normals_stride = 3)
+{
+    std::vector<float> normais(normals_stride * malha.vertices.size(), -7.0f);
+    Normals_Compute(malha.posicoes.data(), 3, malha.posicoes.size() / 3, malha.vertices.data(), malha.vertices.size(),
+                    normais.data(), normals_stride, peso, vinco);
+    return normais;
+}
+
+// Compara com a referência cada quina; onde a referência é NaN (vértice
+// sem área em volta), a normal nova deve ser zero.
+static void ComparaComAntigas(const char* arquivo, const Malha& malha)
+{
+    std::vector<float> antigas = NormaisAntigas(malha);
+    std::vector<float> novas   = Normais(malha, NORMALS_AREA, NORMALS_NO_CREASE);
+
+    float maior_erro = 0.0f;
+    unsigned long nan = 0, erradas = 0;
+    for (size_t q = 0; q < malha.vertices.size(); ++q)
+    {
+        const float* a = &antigas[3 * malha.vertices[q]];
+        const float* n = &novas[3 * q];
+        if (std::isnan(a[0]) || std::isnan(a[1]) || std::isnan(a[2]))
+        {
+            nan += 1;
+            erradas += n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f;
+            continue;
+        }
+        for (int k = 0; k < 3; ++k)
+            maior_erro = std::max(maior_erro, std::fabs(a[k] - n[k]));
+    }
+
+    printf("normals: %s: %lu quinas, maior diferença %.2e, %lu quinas com NaN antes.\n",
+           arquivo, (unsigned long)malha.vertices.size(), maior_erro, nan);
+    TESTE_VERIFICA(maior_erro <= ERRO_MAXIMO, "%s: diferença de %e do ComputeNormals() anterior", arquivo, maior_erro);
+    TESTE_VERIFICA(erradas == 0, "%s: %lu quinas sem área com normal diferente de zero", arquivo, erradas);
+}
+
+// Cubo de lado 2 centrado na origem, com 8 vértices compartilhados pelas
+// faces e cada face dividida em dois triângulos (normais para fora).
+static Malha Cubo()
+{
+    Malha cubo;
+    for (int v = 0; v < 8; ++v)
+    {
+        cubo.posicoes.push_back(v & 1 ? 1.0f : -1.0f);
+        cubo.posicoes.push_back(v & 2 ? 1.0f : -1.0f);
+        cubo.posicoes.push_back(v & 4 ? 1.0f : -1.0f);
+    }
+    const uint32_t faces[6][4] = { {0,4,6,2}, {1,3,7,5}, {0,1,5,4}, {2,6,7,3}, {0,2,3,1}, {4,5,7,6} };
+    for (int f = 0; f < 6; ++f)
+    {
+        const uint32_t t[6] = { faces[f][0], faces[f][1], faces[f][2], faces[f][0], faces[f][2], faces[f][3] };
+        cubo.vertices.insert(cubo.vertices.end(), t, t + 6);
+    }
+    return cubo;
+}
+
+static void VerificaCubo()
+{
+    Malha cubo = Cubo();
+    const float diagonal = 1.0f / std::sqrt(3.0f);
+
+    // Pelo ângulo, cada face contribui igualmente: a normal é a diagonal
+    std::vector<float> angulo = Normais(cubo, NORMALS_ANGLE, NORMALS_NO_CREASE);
+    float erro = 0.0f;
+    for (size_t q = 0; q < cubo.vertices.size(); ++q)
+        for (int k = 0; k < 3; ++k)
+            erro = std::max(erro, std::fabs(angulo[3*q + k] - cubo.posicoes[3*cubo.vertices[q] + k] * diagonal));
+    TESTE_VERIFICA(erro <= ERRO_MAXIMO, "cubo, pesos por ângulo: diferença de %e da diagonal", erro);
+
+    // Com um vinco de 60 graus, as faces perpendiculares não se misturam:
+    // cada quina fica com a normal da sua face
+    std::vector<float> vinco = Normais(cubo, NORMALS_AREA, 60.0f * 3.14159265f / 180.0f);
+    erro = 0.0f;
+    for (size_t q = 0; q < cubo.vertices.size(); ++q)
+    {
+        const float* a = &cubo.posicoes[3*cubo.vertices[3*(q/3) + 0]];
+        const float* b = &cubo.posicoes[3*cubo.vertices[3*(q/3) + 1]];
+        const float* c = &cubo.posicoes[3*cubo.vertices[3*(q/3) + 2]];
+        glm::vec4 face = crossproduct(glm::vec4(b[0]-a[0], b[1]-a[1], b[2]-a[2], 0.0f), glm::vec4(c[0]-a[0], c[1]-a[1], c[2]-a[2], 0.0f));
+        face /= norm(face);
+        for (int k = 0; k < 3; ++k)
+            erro = std::max(erro, std::fabs(vinco[3*q + k] - face[k]));
+    }
+    TESTE_VERIFICA(erro <= ERRO_MAXIMO, "cubo, vinco de 60 graus: diferença de %e da normal da face", erro);
+
+    // Normais com espaçamento 4: a quarta coordenada não é escrita
+    std::vector<float> espacadas = Normais(cubo, NORMALS_AREA, NORMALS_NO_CREASE, 4);
+    std::vector<float> juntas    = Normais(cubo, NORMALS_AREA, NORMALS_NO_CREASE);
+    unsigned long diferentes = 0;
+    for (size_t q = 0; q < cubo.vertices.size(); ++q)
+        diferentes += espacadas[4*q + 0] != juntas[3*q + 0] || espacadas[4*q + 1] != juntas[3*q + 1]
+                   || espacadas[4*q + 2] != juntas[3*q + 2] || espacadas[4*q + 3] != -7.0f;
+    TESTE_VERIFICA(diferentes == 0, "cubo, normals_stride 4: %lu quinas diferentes", diferentes);
+
+    // Um triângulo sem área, sozinho nos seus vértices, fica com normal zero
+    Malha degenerada;
+    const float p[9] = { 0, 0, 0, 1, 1, 1, 2, 2, 2 };
+    degenerada.posicoes.assign(p, p + 9);
+    degenerada.vertices.push_back(0);
+    degenerada.vertices.push_back(1);
+    degenerada.vertices.push_back(2);
+    std::vector<float> zero = Normais(degenerada, NORMALS_ANGLE, NORMALS_NO_CREASE);
+    TESTE_VERIFICA(std::count(zero.begin(), zero.end(), 0.0f) == 9, "triângulo sem área com normal diferente de zero");
+}
+
+#define MODOS 4
+static const NormalsWeight PESOS[MODOS]  = { NORMALS_AREA, NORMALS_ANGLE, NORMALS_AREA, NORMALS_ANGLE };
+static const float         VINCOS[MODOS] = { NORMALS_NO_CREASE, NORMALS_NO_CREASE, 1.0f, 1.0f };
+
+int main()
+{
+    const size_t modelos = sizeof(MODELOS) / sizeof(MODELOS[0]);
+    std::vector<Malha> malhas(modelos);
+    for (size_t i = 0; i < modelos; ++i)
+        TESTE_VERIFICA(Carrega(MODELOS[i], &malhas[i]), "não foi possível ler \"%s\" (execute a partir da raiz do projeto)", MODELOS[i]);
+
+    for (size_t i = 0; i < modelos; ++i)
+        ComparaComAntigas(MODELOS[i], malhas[i]);
+    VerificaCubo();
+
+    // Sem threads e com elas, em todos os modos, o resultado é o mesmo bit a bit
+    std::vector<std::vector<float> > sem_threads;
+    for (size_t i = 0; i < modelos; ++i)
+        for (int modo = 0; modo < MODOS; ++modo)
+            sem_threads.push_back(Normais(malhas[i], PESOS[modo], VINCOS[modo]));
+
+    Jobs_Init();
+    for (size_t i = 0; i < modelos; ++i)
+        for (int modo = 0; modo < MODOS; ++modo)
+        {
+            std::vector<float> com_threads = Normais(malhas[i], PESOS[modo], VINCOS[modo]);
+            const std::vector<float>& esperado = sem_threads[i * MODOS + modo];
+            TESTE_VERIFICA(com_threads.size() == esperado.size()
+                        && std::memcmp(com_threads.data(), esperado.data(), esperado.size() * sizeof(float)) == 0,
+                           "%s, modo %d: resultado com %u threads difere do resultado sem threads", MODELOS[i], modo, Jobs_NumThreads());
+        }
+    Jobs_Shutdown();
+
+    return Teste_Fim("normals_test");
+}
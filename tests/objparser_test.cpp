@@ -0,0 +1,208 @@
+// Compara ObjParser_Load() ("objparser.h") com tinyobj::LoadObj(): todos
+// os arquivos data/*.obj e alguns casos especiais devem dar os mesmos
+// atributos (bit a bit), faces, índices, shapes, materiais e mensagens, com
+// e sem triangulação, com pedaços de vários tamanhos e com e sem as threads
+// de "jobs.h".
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "objparser.h"
+#include "jobs.h"
+#include "teste.h"
+
+#define PASTA_DADOS "data/"
+
+// Casos que os modelos de data/ não cobrem: fins de linha CRLF, índices
+// negativos, quadriláteros e polígonos, "g"/"o" vazios e repetidos, vários
+// "usemtl", material inexistente, "s" e "t".
+static const char* CASOS =
+    "# casos especiais\r\n"
+    "mtllib statue.mtl\r\n"
+    "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\nv 0.5 2 0 1\r\n"
+    "vt 0 0\r\nvt 1 0\r\nvt 1 1\r\nvt 0 1\r\n"
+    "vn 0 0 1\r\n"
+    "g\r\n"
+    "f 1/1/1 2/2/1 3/3/1 4/4/1\r\n"
+    "o objeto\r\n"
+    "usemtl inexistente\r\n"
+    "f -5//-1 -4//-1 -3//-1\r\n"
+    "usemtl Material\n"
+    "s 1\n"
+    "f 1 2 3 5 4\n"
+    "g grupo grupo2\n"
+    "g grupo\n"
+    "usemtl Material\n"
+    "t crease 2/1/0 1 2 0.5\n"
+    "f 4/4 3/3 5/2\n"
+    "f 1/-4 2/-3 3/-2 4/-1\n"
+    "o\n"
+    "v 2 2 2\n"
+    "f -1 -2 -3\n";
+
+static unsigned long g_Diferencas = 0;
+
+#define COMPARA(a, b, ...) do { if (!((a) == (b))) { g_Diferencas += 1; if (g_Diferencas <= 20) { printf("  difere: "); printf(__VA_ARGS__); printf("\n"); } } } while (0)
+
+// Vetores de float comparados bit a bit
+static bool Iguais(const std::vector<float>& a, const std::vector<float>& b)
+{
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+static bool Iguais(const float* a, const float* b, size_t n)
+{
+    return std::memcmp(a, b, n * sizeof(float)) == 0;
+}
+
+static void ComparaMateriais(const std::vector<tinyobj::material_t>& a, const std::vector<tinyobj::material_t>& b)
+{
+    COMPARA(a.size(), b.size(), "%lu e %lu materiais", (unsigned long)a.size(), (unsigned long)b.size());
+    for (size_t i = 0; i < std::min(a.size(), b.size()); ++i)
+    {
+        const tinyobj::material_t& x = a[i];
+        const tinyobj::material_t& y = b[i];
+        COMPARA(x.name, y.name, "material %lu: nome", (unsigned long)i);
+        COMPARA(Iguais(x.ambient, y.ambient, 3) && Iguais(x.diffuse, y.diffuse, 3) && Iguais(x.specular, y.specular, 3)
+             && Iguais(x.transmittance, y.transmittance, 3) && Iguais(x.emission, y.emission, 3), true,
+                "material %lu: cores", (unsigned long)i);
+        COMPARA(Iguais(&x.shininess, &y.shininess, 1) && Iguais(&x.ior, &y.ior, 1) && Iguais(&x.dissolve, &y.dissolve, 1)
+             && x.illum == y.illum, true, "material %lu: Ns, Ni, d ou illum", (unsigned long)i);
+        COMPARA(x.ambient_texname + x.diffuse_texname + x.specular_texname + x.specular_highlight_texname
+              + x.bump_texname + x.displacement_texname + x.alpha_texname,
+                y.ambient_texname + y.diffuse_texname + y.specular_texname + y.specular_highlight_texname
+              + y.bump_texname + y.displacement_texname + y.alpha_texname, "material %lu: texturas", (unsigned long)i);
+        COMPARA(Iguais(&x.roughness, &y.roughness, 1) && Iguais(&x.metallic, &y.metallic, 1) && Iguais(&x.sheen, &y.sheen, 1)
+             && Iguais(&x.clearcoat_thickness, &y.clearcoat_thickness, 1) && Iguais(&x.clearcoat_roughness, &y.clearcoat_roughness, 1)
+             && Iguais(&x.anisotropy, &y.anisotropy, 1) && Iguais(&x.anisotropy_rotation, &y.anisotropy_rotation, 1), true,
+                "material %lu: PBR", (unsigned long)i);
+        COMPARA(x.roughness_texname + x.metallic_texname + x.sheen_texname + x.emissive_texname + x.normal_texname,
+                y.roughness_texname + y.metallic_texname + y.sheen_texname + y.emissive_texname + y.normal_texname,
+                "material %lu: texturas PBR", (unsigned long)i);
+        COMPARA(x.unknown_parameter == y.unknown_parameter, true, "material %lu: parâmetros desconhecidos", (unsigned long)i);
+    }
+}
+
+static void ComparaShapes(const std::vector<tinyobj::shape_t>& a, const std::vector<tinyobj::shape_t>& b)
+{
+    COMPARA(a.size(), b.size(), "%lu e %lu shapes", (unsigned long)a.size(), (unsigned long)b.size());
+    for (size_t i = 0; i < std::min(a.size(), b.size()); ++i)
+    {
+        const tinyobj::mesh_t& x = a[i].mesh;
+        const tinyobj::mesh_t& y = b[i].mesh;
+        COMPARA(a[i].name, b[i].name, "shape %lu: nome \"%s\" e \"%s\"", (unsigned long)i, a[i].name.c_str(), b[i].name.c_str());
+        COMPARA(x.indices.size(), y.indices.size(), "shape %lu: %lu e %lu índices", (unsigned long)i,
+                (unsigned long)x.indices.size(), (unsigned long)y.indices.size());
+        unsigned long indices = 0;
+        for (size_t k = 0; k < std::min(x.indices.size(), y.indices.size()); ++k)
+            indices += x.indices[k].vertex_index != y.indices[k].vertex_index
+                    || x.indices[k].normal_index != y.indices[k].normal_index
+                    || x.indices[k].texcoord_index != y.indices[k].texcoord_index;
+        COMPARA(indices, 0ul, "shape %lu: %lu índices diferentes", (unsigned long)i, indices);
+        COMPARA(x.num_face_vertices == y.num_face_vertices, true, "shape %lu: vértices por face", (unsigned long)i);
+        COMPARA(x.material_ids == y.material_ids, true, "shape %lu: materiais das faces", (unsigned long)i);
+        COMPARA(x.tags.size(), y.tags.size(), "shape %lu: %lu e %lu tags", (unsigned long)i,
+                (unsigned long)x.tags.size(), (unsigned long)y.tags.size());
+        for (size_t k = 0; k < std::min(x.tags.size(), y.tags.size()); ++k)
+            COMPARA(x.tags[k].name == y.tags[k].name && x.tags[k].intValues == y.tags[k].intValues
+                 && Iguais(x.tags[k].floatValues, y.tags[k].floatValues) && x.tags[k].stringValues == y.tags[k].stringValues,
+                    true, "shape %lu: tag %lu", (unsigned long)i, (unsigned long)k);
+    }
+}
+
+// Lê "arquivo" com tinyobj e com ObjParser_Load() e compara os resultados.
+static void Compara(const std::string& arquivo, bool triangulate, size_t pedaco)
+{
+    tinyobj::attrib_t                attrib_t, attrib_p;
+    std::vector<tinyobj::shape_t>    shapes_t, shapes_p;
+    std::vector<tinyobj::material_t> materiais_t, materiais_p;
+    std::string                      err_t, err_p;
+
+    bool ok_t = tinyobj::LoadObj(&attrib_t, &shapes_t, &materiais_t, &err_t, arquivo.c_str(), PASTA_DADOS, triangulate);
+
+    g_ObjParserChunkSize = pedaco;
+    bool ok_p = ObjParser_Load(&attrib_p, &shapes_p, &materiais_p, &err_p, arquivo.c_str(), PASTA_DADOS, triangulate);
+
+    unsigned long antes = g_Diferencas;
+    COMPARA(ok_t, ok_p, "retorno");
+    COMPARA(err_t, err_p, "mensagens \"%s\" e \"%s\"", err_t.c_str(), err_p.c_str());
+    COMPARA(Iguais(attrib_t.vertices, attrib_p.vertices), true, "vértices (%lu e %lu)",
+            (unsigned long)attrib_t.vertices.size(), (unsigned long)attrib_p.vertices.size());
+    COMPARA(Iguais(attrib_t.normals, attrib_p.normals), true, "normais (%lu e %lu)",
+            (unsigned long)attrib_t.normals.size(), (unsigned long)attrib_p.normals.size());
+    COMPARA(Iguais(attrib_t.texcoords, attrib_p.texcoords), true, "coordenadas de textura (%lu e %lu)",
+            (unsigned long)attrib_t.texcoords.size(), (unsigned long)attrib_p.texcoords.size());
+    ComparaShapes(shapes_t, shapes_p);
+    ComparaMateriais(materiais_t, materiais_p);
+
+    TESTE_VERIFICA(g_Diferencas == antes, "%s (triangulate = %d, pedaços de %lu bytes, %u threads): %lu diferenças",
+                   arquivo.c_str(), (int)triangulate, (unsigned long)pedaco, Jobs_NumThreads(), g_Diferencas - antes);
+}
+
+static void ComparaTodos(const std::vector<std::string>& arquivos, size_t pedaco_padrao)
+{
+    const size_t pedacos[] = { pedaco_padrao, 4096, 61 };
+    for (size_t i = 0; i < arquivos.size(); ++i)
+        for (size_t k = 0; k < sizeof(pedacos) / sizeof(pedacos[0]); ++k)
+        {
+            Compara(arquivos[i], true, pedacos[k]);
+            Compara(arquivos[i], false, pedacos[k]);
+        }
+}
+
+int main()
+{
+    std::vector<std::string> arquivos;
+    DIR* pasta = opendir(PASTA_DADOS);
+    TESTE_VERIFICA(pasta != NULL, "pasta \"%s\" não encontrada (execute a partir da raiz do projeto)", PASTA_DADOS);
+    if (pasta != NULL)
+    {
+        for (struct dirent* e = readdir(pasta); e != NULL; e = readdir(pasta))
+        {
+            std::string nome = e->d_name;
+            if (nome.size() > 4 && nome.compare(nome.size() - 4, 4, ".obj") == 0)
+                arquivos.push_back(PASTA_DADOS + nome);
+        }
+        closedir(pasta);
+    }
+    std::sort(arquivos.begin(), arquivos.end());
+    TESTE_VERIFICA(!arquivos.empty(), "nenhum arquivo .obj em \"%s\"", PASTA_DADOS);
+
+    // Casos especiais, um arquivo vazio e um inexistente
+    char casos[] = "/tmp/objparser_testXXXXXX";
+    int fd = mkstemp(casos);
+    TESTE_VERIFICA(fd >= 0, "não foi possível criar um arquivo temporário");
+    if (fd >= 0)
+    {
+        TESTE_VERIFICA(write(fd, CASOS, std::strlen(CASOS)) == (ssize_t)std::strlen(CASOS), "erro ao escrever \"%s\"", casos);
+        close(fd);
+        arquivos.push_back(casos);
+    }
+    char vazio[] = "/tmp/objparser_vazioXXXXXX";
+    fd = mkstemp(vazio);
+    if (fd >= 0)
+    {
+        close(fd);
+        arquivos.push_back(vazio);
+    }
+    arquivos.push_back(PASTA_DADOS "inexistente.obj");
+
+    size_t pedaco_padrao = g_ObjParserChunkSize;
+    ComparaTodos(arquivos, pedaco_padrao);
+    Jobs_Init();
+    ComparaTodos(arquivos, pedaco_padrao);
+    Jobs_Shutdown();
+
+    std::remove(casos);
+    std::remove(vazio);
+
+    printf("objparser: %lu arquivos comparados com tinyobj::LoadObj().\n", (unsigned long)arquivos.size());
+    return Teste_Fim("objparser_test");
+}
@@ -0,0 +1,177 @@
+// Testes de Pool ("pool.h"): depois de Pool_Remove() (que move a última
+// entidade) e de Pool_RemoveIf() (que compacta em ordem), os handles das
+// entidades que ficaram continuam levando a elas, os das removidas ficam
+// inválidos mesmo quando a posição é reaproveitada, e nada é alocado depois
+// de Pool_Reserve().
+
+#include <random>
+#include <vector>
+#include <cstdlib>
+
+#include "pool.h"
+#include "alloccounter.h"
+#include "teste.h"
+
+#define ENTIDADES 2000
+#define OPERACOES 200000
+#define CELULAS   16
+
+struct Quente
+{
+    int id;
+};
+
+struct Fria
+{
+    int id;
+    int celula;
+};
+
+typedef Pool<Quente, Fria> Entidades;
+
+// O que o teste sabe de cada entidade criada, viva ou não
+struct Registro
+{
+    PoolHandle handle;
+    int        celula;
+    bool       viva;
+};
+
+static unsigned long g_Erradas = 0;
+
+// Confere o pool inteiro contra os registros
+static void Confere(const Entidades& p, const std::vector<Registro>& registros)
+{
+    size_t vivas = 0;
+    for (size_t id = 0; id < registros.size(); ++id)
+    {
+        const Registro& r = registros[id];
+        if (!r.viva)
+        {
+            g_Erradas += Pool_Valid(p, r.handle);
+            continue;
+        }
+        vivas += 1;
+        if (!Pool_Valid(p, r.handle))
+        {
+            g_Erradas += 1;
+            continue;
+        }
+        size_t i = Pool_Index(p, r.handle);
+        g_Erradas += i >= Pool_Size(p) || p.quente[i].id != (int)id || p.fria[i].id != (int)id
+                  || p.fria[i].celula != r.celula;
+    }
+    g_Erradas += vivas != Pool_Size(p) || p.fria.size() != Pool_Size(p) || p.slot_de.size() != Pool_Size(p);
+
+    for (size_t i = 0; i < Pool_Size(p); ++i)
+    {
+        PoolHandle h = Pool_Handle(p, i);
+        g_Erradas += !Pool_Valid(p, h) || Pool_Index(p, h) != i;
+    }
+}
+
+static void Adiciona(Entidades* p, std::vector<Registro>* registros, std::mt19937& gerador)
+{
+    int    id = (int)registros->size();
+    Quente q = { id };
+    Fria   f = { id, (int)(gerador() % CELULAS) };
+    Registro r = { Pool_Add(p, q, f), f.celula, true };
+    registros->push_back(r);
+}
+
+int main()
+{
+    TESTE_VERIFICA(AllocCounter_Enabled(), "contagem de alocações desligada (compile com ALLOC_COUNTER)");
+
+    // Casos pequenos: remover a última, remover do meio, remover duas vezes
+    // e reaproveitar a posição
+    {
+        Entidades p;
+        std::vector<Registro> registros;
+        std::mt19937 gerador(7);
+        for (int id = 0; id < 4; ++id)
+            Adiciona(&p, &registros, gerador);
+
+        TESTE_VERIFICA(Pool_Remove(&p, registros[3].handle), "remover a última entidade");
+        registros[3].viva = false;
+        TESTE_VERIFICA(Pool_Remove(&p, registros[1].handle), "remover do meio");
+        registros[1].viva = false;
+        TESTE_VERIFICA(!Pool_Remove(&p, registros[1].handle), "remover duas vezes a mesma entidade");
+        TESTE_VERIFICA(Pool_Size(p) == 2 && p.quente[1].id == 2, "a última não ocupou o lugar da removida");
+
+        Adiciona(&p, &registros, gerador);
+        const Registro& r = registros.back();
+        TESTE_VERIFICA(r.handle.slot == registros[1].handle.slot && r.handle.geracao != registros[1].handle.geracao,
+                       "posição livre não reaproveitada com outra geração");
+
+        Confere(p, registros);
+        TESTE_VERIFICA(g_Erradas == 0, "casos pequenos: %lu verificações erradas", g_Erradas);
+    }
+
+    // Operações aleatórias em um pool reservado: adicionar, remover por
+    // handle (inclusive handles já inválidos) e liberar uma célula inteira
+    Entidades p;
+    Pool_Reserve(&p, ENTIDADES);
+    std::vector<Registro> registros;
+    registros.reserve(OPERACOES + ENTIDADES);
+    std::vector<int> ordem;
+    ordem.reserve(ENTIDADES);
+    std::mt19937 gerador(1);
+
+    unsigned long alocacoes = AllocCounter_Thread();
+    unsigned long removidas = 0, repetidas = 0, por_celula = 0, fora_de_ordem = 0;
+    for (int k = 0; k < OPERACOES; ++k)
+    {
+        unsigned int operacao = gerador() % 100;
+        if (operacao < 50 && Pool_Size(p) < ENTIDADES)
+            Adiciona(&p, &registros, gerador);
+        else if (operacao < 99 && !registros.empty())
+        {
+            // Metade das vezes uma entidade viva; na outra, qualquer uma já
+            // criada (em geral com o handle inválido)
+            size_t id = gerador() % registros.size();
+            if (operacao % 2 == 0 && Pool_Size(p) > 0)
+                id = (size_t)p.quente[gerador() % Pool_Size(p)].id;
+            Registro& r = registros[id];
+            bool removida = Pool_Remove(&p, r.handle);
+            if (removida != r.viva)
+                g_Erradas += 1;
+            removidas += removida;
+            repetidas += !removida;
+            r.viva = false;
+        }
+        else
+        {
+            // Libera uma célula: a ordem das que ficam não pode mudar
+            int celula = (int)(gerador() % CELULAS);
+            for (size_t id = 0; id < registros.size(); ++id)
+                if (registros[id].celula == celula)
+                    registros[id].viva = false;
+
+            ordem.clear();
+            for (size_t i = 0; i < Pool_Size(p); ++i)
+                if (p.fria[i].celula != celula)
+                    ordem.push_back(p.quente[i].id);
+
+            size_t n = Pool_RemoveIf(&p, [celula](const Quente&, const Fria& f) { return f.celula == celula; });
+            por_celula += n;
+            fora_de_ordem += ordem.size() != Pool_Size(p);
+            for (size_t i = 0; i < ordem.size() && i < Pool_Size(p); ++i)
+                fora_de_ordem += ordem[i] != p.quente[i].id;
+        }
+
+        if (k % 1000 == 0)
+            Confere(p, registros);
+    }
+    alocacoes = AllocCounter_Thread() - alocacoes;
+    Confere(p, registros);
+
+    printf("pool: %lu entidades criadas, %lu removidas por handle, %lu por célula, %lu remoções de handles inválidos.\n",
+           (unsigned long)registros.size(), removidas, por_celula, repetidas);
+    TESTE_VERIFICA(g_Erradas == 0, "%lu verificações de handles erradas", g_Erradas);
+    TESTE_VERIFICA(fora_de_ordem == 0, "Pool_RemoveIf(): %lu entidades fora de ordem", fora_de_ordem);
+    TESTE_VERIFICA(removidas > 0 && repetidas > 0 && por_celula > 0, "operações aleatórias não cobriram todos os casos");
+    TESTE_VERIFICA(alocacoes == 0, "%lu alocações depois de Pool_Reserve()", alocacoes);
+
+    return Teste_Fim("pool_test");
+}
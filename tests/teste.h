@@ -0,0 +1,33 @@
+#ifndef _TESTE_H
+#define _TESTE_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// Verificações dos testes em tests/ (veja "make test"). Cada teste é um
+// programa: TESTE_VERIFICA() anota as falhas sem interromper o teste, e
+// Teste_Fim() mostra o resultado e devolve o código de saída do programa.
+
+static unsigned long g_TesteVerificacoes = 0;
+static unsigned long g_TesteFalhas       = 0;
+
+#define TESTE_VERIFICA(condicao, ...)                                              \
+    do                                                                             \
+    {                                                                              \
+        g_TesteVerificacoes += 1;                                                  \
+        if (!(condicao))                                                           \
+        {                                                                          \
+            g_TesteFalhas += 1;                                                    \
+            fprintf(stderr, "FALHOU %s:%d: %s: ", __FILE__, __LINE__, #condicao);  \
+            fprintf(stderr, __VA_ARGS__);                                          \
+            fprintf(stderr, "\n");                                                 \
+        }                                                                          \
+    } while (0)
+
+static inline int Teste_Fim(const char* nome)
+{
+    printf("%s: %lu verificações, %lu falhas.\n", nome, g_TesteVerificacoes, g_TesteFalhas);
+    return g_TesteFalhas == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // _TESTE_H
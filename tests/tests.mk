@@ -0,0 +1,43 @@
+# Testes automáticos, incluídos pelo Makefile de cada sistema, que define
+# BIN. Cada teste é um programa que usa apenas os módulos de que precisa
+# (sem janela nem OpenGL) e termina com erro se alguma verificação falhar.
+# "make test" compila e executa todos, a partir da raiz do projeto (os
+# testes leem arquivos de data/).
+
+CXXFLAGS_TESTES = -std=c++11 -Wall -Wno-unused-function -O2 -g -I ./include/ -I ./tests/
+LIBS_TESTES     = -lpthread
+
+TESTES = $(BIN)/tests/worldstream_test \
+         $(BIN)/tests/bezierpath_test \
+         $(BIN)/tests/jobs_test \
+         $(BIN)/tests/objparser_test \
+         $(BIN)/tests/normals_test \
+         $(BIN)/tests/zeroalloc_test \
+         $(BIN)/tests/pool_test \
+         $(BIN)/tests/bvh_test \
+         $(BIN)/tests/tlsf_test \
+         $(BIN)/tests/navmesh_test
+
+$(BIN)/tests/worldstream_test: tests/worldstream_test.cpp src/worldstream.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/tests/bezierpath_test: tests/bezierpath_test.cpp src/bezierpath.cpp
+$(BIN)/tests/jobs_test: tests/jobs_test.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/tests/objparser_test: tests/objparser_test.cpp src/objparser.cpp src/tiny_obj_loader.cpp src/mappedfile.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/tests/normals_test: tests/normals_test.cpp src/normals.cpp src/tiny_obj_loader.cpp src/jobs.cpp src/framearena.cpp
+$(BIN)/tests/zeroalloc_test: tests/zeroalloc_test.cpp src/alloccounter.cpp src/statueai.cpp src/bezierpath.cpp src/lineofsight.cpp \
+                             src/bvh.cpp src/navmesh.cpp src/flowfield.cpp src/scenegraph.cpp src/drawlist.cpp src/renderqueue.cpp \
+                             src/bounds.cpp src/fastmath.cpp src/mappedfile.cpp src/jobs.cpp src/framearena.cpp src/glad.c
+$(BIN)/tests/pool_test: tests/pool_test.cpp src/alloccounter.cpp
+$(BIN)/tests/bvh_test: tests/bvh_test.cpp src/bvh.cpp src/mappedfile.cpp
+$(BIN)/tests/tlsf_test: tests/tlsf_test.cpp src/tlsf.cpp
+$(BIN)/tests/navmesh_test: tests/navmesh_test.cpp src/navmesh.cpp src/mappedfile.cpp src/jobs.cpp src/framearena.cpp
+
+# Os testes de alocações contam as chamadas a "new" (veja "alloccounter.h")
+$(BIN)/tests/zeroalloc_test $(BIN)/tests/pool_test: CXXFLAGS_TESTES += -DALLOC_COUNTER
+
+$(TESTES): tests/teste.h include/*.h
+	mkdir -p $(BIN)/tests
+	g++ $(CXXFLAGS_TESTES) -o $@ $(filter %.cpp %.c,$^) $(LIBS_TESTES)
+
+.PHONY: test
+test: $(TESTES)
+	@for t in $(TESTES); do echo "== $$t"; ./$$t || exit 1; done
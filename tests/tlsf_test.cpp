@@ -0,0 +1,240 @@
+// Testes de TLSFAllocator ("tlsf.h"): alocação em faixas contíguas, união
+// dos vizinhos livres em qualquer ordem de liberação, falta de espaço e
+// fragmentação, alinhamento dos offsets quando todos os tamanhos são
+// múltiplos de um passo, TLSF_Grow() e uma sequência aleatória conferida
+// contra um mapa das faixas em uso.
+
+#include <map>
+#include <random>
+#include <vector>
+#include <cstdlib>
+
+#include "tlsf.h"
+#include "teste.h"
+
+#define OPERACOES 200000
+#define ESPACO    (1u << 20)
+#define PASSO     256 // Tamanhos múltiplos deste valor dão offsets múltiplos dele
+
+static uint32_t Aloca(TLSFAllocator* a, uint32_t size, uint32_t* offset = NULL)
+{
+    TLSFAllocation alocacao;
+    bool ok = TLSF_Allocate(a, size, &alocacao);
+    TESTE_VERIFICA(ok && alocacao.node != TLSF_NENHUM, "falha ao alocar %u de %u livres", size, a->livre);
+    if (offset != NULL)
+        *offset = alocacao.offset;
+    return alocacao.node;
+}
+
+static void VerificaAlocacao()
+{
+    TLSFAllocator a;
+    TLSF_Init(&a, 1000);
+
+    uint32_t o1 = 0, o2 = 0, o3 = 0;
+    uint32_t n1 = Aloca(&a, 10, &o1), n2 = Aloca(&a, 200, &o2), n3 = Aloca(&a, 7, &o3);
+    TESTE_VERIFICA(o1 == 0 && o2 == 10 && o3 == 210, "offsets %u, %u, %u em vez de 0, 10, 210", o1, o2, o3);
+    TESTE_VERIFICA(TLSF_Size(a, n1) == 10 && TLSF_Size(a, n2) == 200 && TLSF_Size(a, n3) == 7, "tamanhos das alocações");
+
+    TLSFStats s = TLSF_Stats(a);
+    TESTE_VERIFICA(s.size == 1000 && s.used == 217 && s.free == 783 && s.allocations == 3 && s.free_blocks == 1
+                && s.largest_free == 783, "estatísticas depois de três alocações");
+
+    TLSFAllocation nula;
+    TESTE_VERIFICA(!TLSF_Allocate(&a, 0, &nula) && nula.node == TLSF_NENHUM, "alocação de tamanho zero aceita");
+}
+
+// Três blocos que enchem o espaço, liberados em todas as ordens: ao fim
+// sobra um único bloco livre do tamanho do espaço
+static void VerificaUniao()
+{
+    const int ordens[6][3] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+    unsigned long erradas = 0;
+    for (int k = 0; k < 6; ++k)
+    {
+        TLSFAllocator a;
+        TLSF_Init(&a, 96);
+        uint32_t nos[3] = { Aloca(&a, 32), Aloca(&a, 32), Aloca(&a, 32) };
+        erradas += TLSF_Stats(a).free_blocks != 0;
+
+        for (int j = 0; j < 3; ++j)
+            TLSF_Free(&a, nos[ordens[k][j]]);
+
+        TLSFStats s = TLSF_Stats(a);
+        erradas += s.free_blocks != 1 || s.largest_free != 96 || s.allocations != 0 || s.used != 0;
+
+        // O bloco unido volta a ser alocável inteiro
+        uint32_t offset = 1;
+        Aloca(&a, 64, &offset);
+        erradas += offset != 0;
+    }
+    TESTE_VERIFICA(erradas == 0, "união de vizinhos livres: %lu verificações erradas", erradas);
+
+    // Liberar o do meio com os dois vizinhos livres une os três de uma vez
+    TLSFAllocator a;
+    TLSF_Init(&a, 96);
+    uint32_t esquerda = Aloca(&a, 32), meio = Aloca(&a, 32), direita = Aloca(&a, 32);
+    TLSF_Free(&a, esquerda);
+    TLSF_Free(&a, direita);
+    TESTE_VERIFICA(TLSF_Stats(a).free_blocks == 2, "vizinhos não adjacentes unidos");
+    TLSF_Free(&a, meio);
+    TESTE_VERIFICA(TLSF_Stats(a).free_blocks == 1 && TLSF_Stats(a).largest_free == 96, "três blocos não unidos em um");
+}
+
+static void VerificaFaltaDeEspaco()
+{
+    TLSFAllocator a;
+    TLSF_Init(&a, 128);
+
+    // Oito blocos de 16, liberados alternadamente: metade do espaço livre,
+    // mas nenhum bloco livre maior que 16
+    uint32_t nos[8];
+    for (int i = 0; i < 8; ++i)
+        nos[i] = Aloca(&a, 16);
+    TLSFAllocation alocacao;
+    TESTE_VERIFICA(!TLSF_Allocate(&a, 1, &alocacao) && alocacao.node == TLSF_NENHUM, "alocação com o espaço cheio");
+
+    for (int i = 0; i < 8; i += 2)
+        TLSF_Free(&a, nos[i]);
+    TLSFStats s = TLSF_Stats(a);
+    TESTE_VERIFICA(s.free == 64 && s.largest_free == 16 && s.free_blocks == 4, "espaço fragmentado: %u livres, maior bloco %u",
+                   s.free, s.largest_free);
+    TESTE_VERIFICA(!TLSF_Allocate(&a, 32, &alocacao), "alocação maior que o maior bloco livre");
+    TESTE_VERIFICA(!TLSF_Allocate(&a, 65, &alocacao), "alocação maior que o espaço livre");
+
+    uint32_t offset = 1;
+    Aloca(&a, 16, &offset);
+    TESTE_VERIFICA(offset % 32 == 0, "bloco de 16 alocado em %u, fora das lacunas", offset);
+
+    // Liberar um vizinho de uma lacuna abre espaço para 32 (ou mais)
+    TLSF_Free(&a, nos[1]);
+    TESTE_VERIFICA(TLSF_Allocate(&a, 32, &alocacao), "32 não cabem depois de unir duas lacunas");
+}
+
+// Com tamanhos múltiplos de PASSO (e o espaço também), todo bloco livre
+// começa em um múltiplo de PASSO: quem precisa de offsets alinhados só
+// precisa arredondar os tamanhos pedidos
+static void VerificaAlinhamento()
+{
+    TLSFAllocator a;
+    TLSF_Init(&a, 4096 * PASSO);
+    std::mt19937 gerador(3);
+    std::vector<uint32_t> nos;
+    unsigned long desalinhadas = 0, alocacoes = 0;
+    for (int k = 0; k < 20000; ++k)
+    {
+        if (nos.empty() || gerador() % 100 < 55)
+        {
+            TLSFAllocation alocacao;
+            if (!TLSF_Allocate(&a, PASSO * (1 + gerador() % 32), &alocacao))
+                continue;
+            desalinhadas += alocacao.offset % PASSO != 0;
+            alocacoes    += 1;
+            nos.push_back(alocacao.node);
+        }
+        else
+        {
+            size_t i = gerador() % nos.size();
+            TLSF_Free(&a, nos[i]);
+            nos[i] = nos.back();
+            nos.pop_back();
+        }
+    }
+    TESTE_VERIFICA(desalinhadas == 0, "%lu de %lu offsets fora de múltiplos de %d", desalinhadas, alocacoes, PASSO);
+}
+
+static void VerificaCrescimento()
+{
+    TLSFAllocator a;
+    TLSF_Init(&a, 64);
+    uint32_t offset = 1;
+    uint32_t cheio = Aloca(&a, 64, &offset);
+
+    // Fim do espaço em uso: o acréscimo vira um bloco novo
+    TLSF_Grow(&a, 128);
+    uint32_t depois = 0;
+    uint32_t novo = Aloca(&a, 64, &depois);
+    TESTE_VERIFICA(offset == 0 && depois == 64 && TLSF_Size(a, cheio) == 64, "crescimento com o último bloco em uso");
+
+    // Fim do espaço livre: o último bloco só aumenta
+    TLSF_Free(&a, novo);
+    TLSF_Grow(&a, 256);
+    TLSFStats s = TLSF_Stats(a);
+    TESTE_VERIFICA(s.size == 256 && s.free_blocks == 1 && s.largest_free == 192, "crescimento com o último bloco livre");
+    TLSF_Free(&a, cheio);
+    TESTE_VERIFICA(TLSF_Stats(a).free_blocks == 1, "bloco crescido não unido ao vizinho");
+}
+
+// Sequência aleatória conferida contra um mapa offset -> (tamanho, nó)
+static void VerificaAleatorio()
+{
+    TLSFAllocator a;
+    TLSF_Init(&a, ESPACO);
+    std::map<uint32_t, std::pair<uint32_t, uint32_t> > vivas;
+    std::mt19937 gerador(1);
+
+    unsigned long sobrepostas = 0, fora = 0, estatisticas = 0, recusadas = 0;
+    uint64_t usado = 0;
+    for (int k = 0; k < OPERACOES; ++k)
+    {
+        if (k == OPERACOES / 2)
+            TLSF_Grow(&a, 2 * ESPACO);
+
+        if (vivas.empty() || gerador() % 100 < 55)
+        {
+            uint32_t size = 1 + (gerador() % 3 == 0 ? gerador() % 40000 : gerador() % 300);
+            TLSFAllocation alocacao;
+            if (!TLSF_Allocate(&a, size, &alocacao))
+            {
+                recusadas += 1;
+                continue;
+            }
+            fora += alocacao.offset + size > a.size || TLSF_Size(a, alocacao.node) != size;
+
+            std::map<uint32_t, std::pair<uint32_t, uint32_t> >::iterator v = vivas.lower_bound(alocacao.offset);
+            if (v != vivas.end() && v->first < alocacao.offset + size)
+                sobrepostas += 1;
+            if (v != vivas.begin() && (--v)->first + v->second.first > alocacao.offset)
+                sobrepostas += 1;
+            vivas[alocacao.offset] = std::make_pair(size, alocacao.node);
+            usado += size;
+        }
+        else
+        {
+            std::map<uint32_t, std::pair<uint32_t, uint32_t> >::iterator v = vivas.begin();
+            std::advance(v, gerador() % vivas.size());
+            TLSF_Free(&a, v->second.second);
+            usado -= v->second.first;
+            vivas.erase(v);
+        }
+
+        if (k % 1000 == 0)
+        {
+            TLSFStats s = TLSF_Stats(a);
+            estatisticas += s.used != usado || s.allocations != vivas.size() || s.used + s.free != s.size;
+        }
+    }
+
+    for (std::map<uint32_t, std::pair<uint32_t, uint32_t> >::iterator v = vivas.begin(); v != vivas.end(); ++v)
+        TLSF_Free(&a, v->second.second);
+    TLSFStats s = TLSF_Stats(a);
+
+    printf("tlsf: %d operações, %lu alocações recusadas por falta de espaço.\n", OPERACOES, recusadas);
+    TESTE_VERIFICA(sobrepostas == 0, "%lu alocações sobrepostas", sobrepostas);
+    TESTE_VERIFICA(fora == 0, "%lu alocações fora do espaço ou com tamanho errado", fora);
+    TESTE_VERIFICA(estatisticas == 0, "%lu estatísticas erradas", estatisticas);
+    TESTE_VERIFICA(recusadas > 0, "a sequência não chegou a encher o espaço");
+    TESTE_VERIFICA(s.free_blocks == 1 && s.largest_free == 2 * ESPACO && s.allocations == 0,
+                   "depois de liberar tudo: %u blocos livres, maior %u", s.free_blocks, s.largest_free);
+}
+
+int main()
+{
+    VerificaAlocacao();
+    VerificaUniao();
+    VerificaFaltaDeEspaco();
+    VerificaAlinhamento();
+    VerificaCrescimento();
+    VerificaAleatorio();
+    return Teste_Fim("tlsf_test");
+}
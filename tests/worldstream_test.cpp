@@ -0,0 +1,119 @@
+// Teste de longa duração do carregamento por células ("worldstream.h"): a
+// câmera percorre várias vezes uma grade de células, e verificamos que as
+// células necessárias ficam prontas a tempo (poucos "misses"), que as
+// ativações não travam os quadros ("hitches") e que a memória ocupada não
+// passa do orçamento depois dos descarregamentos.
+
+#include <cmath>
+#include <set>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+#include "worldstream.h"
+#include "framearena.h"
+#include "jobs.h"
+#include "teste.h"
+
+#define LADO_GRADE    16      // Células em x e em z
+#define TAMANHO       32.0f   // Lado de cada célula
+#define BYTES_CELULA  (1u << 20)
+#define VELOCIDADE    20.0f   // Da câmera, em unidades por segundo
+#define DT            (1.0f / 60.0f)
+#define QUADROS       7200    // Dois minutos de jogo
+#define AQUECIMENTO   120     // Quadros iniciais, em que as primeiras células ainda estão sendo lidas
+
+static std::mutex    g_AtivasMutex;
+static std::set<int> g_Ativas;      // Células ativas, segundo as funções abaixo
+static unsigned long g_Duplicadas = 0; // Ativações de células já ativas
+static unsigned long g_Estranhas  = 0; // Descarregamentos de células que não estavam ativas
+
+static std::shared_ptr<void> Carrega(const WorldCell& cell)
+{
+    // Simula a leitura do disco
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    return std::make_shared<int>(cell.id);
+}
+
+static size_t Ativa(const WorldCell& cell, const std::shared_ptr<void>& dados)
+{
+    std::lock_guard<std::mutex> lock(g_AtivasMutex);
+    if (*(const int*)dados.get() != cell.id || !g_Ativas.insert(cell.id).second)
+        g_Duplicadas += 1;
+    return BYTES_CELULA;
+}
+
+static void Libera(const WorldCell& cell)
+{
+    std::lock_guard<std::mutex> lock(g_AtivasMutex);
+    if (g_Ativas.erase(cell.id) == 0)
+        g_Estranhas += 1;
+}
+
+// Caminho da câmera: uma curva de Lissajous que cobre a grade, percorrida
+// a VELOCIDADE constante (aproximadamente).
+static glm::vec4 Camera(float tempo)
+{
+    const float centro = LADO_GRADE * TAMANHO * 0.5f;
+    const float raio   = centro - 2.0f * TAMANHO;
+    const float w      = VELOCIDADE / raio;
+    return glm::vec4(centro + raio * std::sin(w * tempo), 1.7f, centro + raio * std::sin(1.5f * w * tempo + 0.5f), 1.0f);
+}
+
+int main()
+{
+    Jobs_Init();
+
+    g_WorldStreamRadius = 60.0f;
+    g_WorldStreamBudget = 48 * (size_t)BYTES_CELULA;
+    WorldStream_Init(TAMANHO, Carrega, Ativa, Libera);
+    for (int x = 0; x < LADO_GRADE; ++x)
+        for (int z = 0; z < LADO_GRADE; ++z)
+            WorldStream_AddCell(x, z, "celula");
+
+    WorldStreamStats aquecido = WorldStream_Stats();
+    size_t maior_residente = 0;
+    unsigned long acima_do_orcamento = 0;
+    for (int quadro = 0; quadro < QUADROS; ++quadro)
+    {
+        FrameArena_BeginFrame();
+        WorldStream_Update(Camera(quadro * DT), DT);
+
+        WorldStreamStats stats = WorldStream_Stats();
+        maior_residente = std::max(maior_residente, stats.bytes_resident);
+        acima_do_orcamento += stats.bytes_resident > g_WorldStreamBudget;
+        if (quadro + 1 == AQUECIMENTO)
+            aquecido = stats;
+
+        // Quadros de 1 ms: a leitura das células continua em paralelo
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    WorldStreamStats stats = WorldStream_Stats();
+    unsigned long misses  = stats.misses - aquecido.misses;
+    unsigned long hitches = stats.hitches;
+    printf("worldstream: %d quadros, %lu células lidas (%lu antecipadas), %lu descarregadas, "
+           "%lu misses depois do aquecimento, %lu hitches, ativação máxima %.3f ms, pico de %.1f MB (orçamento %.1f MB).\n",
+           QUADROS, stats.loads, stats.prefetches, stats.evictions, misses, hitches, stats.max_activation_ms,
+           maior_residente / 1048576.0, g_WorldStreamBudget / 1048576.0);
+
+    TESTE_VERIFICA(stats.loads > LADO_GRADE * LADO_GRADE / 2, "só %lu células lidas", stats.loads);
+    TESTE_VERIFICA(stats.prefetches > 0, "nenhuma célula antecipada");
+    TESTE_VERIFICA(stats.evictions > 0, "nenhuma célula descarregada");
+    TESTE_VERIFICA(misses <= QUADROS / 100, "%lu quadros sem a célula da câmera", misses);
+    TESTE_VERIFICA(hitches <= QUADROS / 100, "%lu quadros com ativações demoradas", hitches);
+    TESTE_VERIFICA(acima_do_orcamento == 0, "%lu quadros acima do orçamento", acima_do_orcamento);
+    TESTE_VERIFICA(stats.bytes_resident == g_Ativas.size() * (size_t)BYTES_CELULA,
+                   "%lu bytes residentes, %lu células ativas", (unsigned long)stats.bytes_resident, (unsigned long)g_Ativas.size());
+    TESTE_VERIFICA(stats.cells_resident == g_Ativas.size(), "%u células residentes, %lu ativas",
+                   stats.cells_resident, (unsigned long)g_Ativas.size());
+
+    WorldStream_Shutdown();
+    Jobs_Shutdown();
+
+    TESTE_VERIFICA(g_Ativas.empty(), "%lu células ativas depois de WorldStream_Shutdown()", (unsigned long)g_Ativas.size());
+    TESTE_VERIFICA(g_Duplicadas == 0, "%lu ativações repetidas", g_Duplicadas);
+    TESTE_VERIFICA(g_Estranhas == 0, "%lu descarregamentos de células inativas", g_Estranhas);
+    return Teste_Fim("worldstream_test");
+}
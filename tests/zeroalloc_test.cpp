@@ -0,0 +1,327 @@
+// Verifica que, depois dos primeiros quadros, o caminho da simulação e da
+// lista de desenho não aloca memória com "new" em nenhuma thread (veja
+// "alloccounter.h" e "--zero-alloc" em main.cpp). Sem janela nem OpenGL:
+// um cenário de paredes com linha de visão e malha de navegação, estátuas
+// que fogem por rotas e pelo campo de fuga, o grafo de cena, a publicação
+// dos estados da simulação e a montagem da lista de desenho, com as threads
+// de "jobs.h" e os limites de paralelismo reduzidos para que todos os
+// caminhos paralelos sejam usados.
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <cstdlib>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "alloccounter.h"
+#include "bvh.h"
+#include "lineofsight.h"
+#include "navmesh.h"
+#include "flowfield.h"
+#include "statueai.h"
+#include "scenegraph.h"
+#include "simulation.h"
+#include "drawlist.h"
+#include "bounds.h"
+#include "framearena.h"
+#include "jobs.h"
+#include "teste.h"
+
+#define PAREDES          40
+#define ESTATUAS         2000 // Seguem o campo de fuga
+#define ESTATUAS_ROTAS   32   // Seguem rotas pela malha de navegação
+#define QUADROS_INICIAIS 120  // Ignorados, como g_ZeroAllocWarmup em main.cpp
+#define QUADROS          900  // Medidos: as estátuas começam a fugir no meio deles
+#define PASSO            (1.0f / 60.0f)
+#define CHAO             -1.0f
+
+// O que a simulação publica para a renderização (como EstadoDoJogo em main.cpp)
+struct Objeto
+{
+    glm::mat4 model;
+    glm::vec3 centro;
+    float     raio;
+    int       object_id;
+};
+
+struct Estado
+{
+    std::vector<Objeto> objetos;
+    glm::vec4           camera_position;
+};
+
+struct Mundo
+{
+    std::vector<glm::mat4> paredes;
+    NavMesh                navmesh;
+    FlowField              campo;
+    SceneGraph             cena;
+    StatueAI               muitas, poucas;
+    std::vector<int>       nos_muitas, nos_poucas;
+    Estado                 estado_do_passo;
+    SimulationSnapshots<Estado> estados;
+};
+
+static float Aleatorio(float a, float b)
+{
+    return a + (b - a) * (float)std::rand() / (float)RAND_MAX;
+}
+
+// Cubo [-1, 1]^3: 8 vértices e 12 triângulos voltados para fora
+static const float CUBO_VERTICES[8 * 3] = { -1,-1,-1,  1,-1,-1,  -1,1,-1,  1,1,-1,  -1,-1,1,  1,-1,1,  -1,1,1,  1,1,1 };
+static const unsigned int CUBO_INDICES[12 * 3] = { 0,4,6, 0,6,2,  1,3,7, 1,7,5,  0,1,5, 0,5,4,
+                                                   2,6,7, 2,7,3,  0,2,3, 0,3,1,  4,5,7, 4,7,6 };
+
+// Paredes espalhadas (oclusoras e obstáculos da malha) sobre um chão de 80 x 80
+static void CriaCenario(Mundo* m)
+{
+    std::shared_ptr<BVH> bvh = std::make_shared<BVH>();
+    BVH_Build(bvh.get(), CUBO_VERTICES, 3, CUBO_INDICES, 12 * 3);
+
+    std::vector<glm::vec3> triangulos;
+    for (int i = 0; i < PAREDES; ++i)
+    {
+        glm::vec3 centro(Aleatorio(-35.0f, 35.0f), CHAO + 1.5f, Aleatorio(-35.0f, 35.0f));
+        if (glm::length(glm::vec2(centro.x, centro.z)) < 14.0f)
+            centro.x += centro.x < 0.0f ? -14.0f : 14.0f; // Longe do caminho do jogador
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), centro)
+                        * glm::rotate(glm::mat4(1.0f), Aleatorio(0.0f, 3.14f), glm::vec3(0.0f, 1.0f, 0.0f))
+                        * glm::scale(glm::mat4(1.0f), glm::vec3(Aleatorio(1.0f, 4.0f), 1.5f, 0.3f));
+        m->paredes.push_back(model);
+        LineOfSight_AddOccluder(bvh, model, -1);
+        for (int k = 0; k < 12 * 3; ++k)
+        {
+            const float* v = &CUBO_VERTICES[3 * CUBO_INDICES[k]];
+            triangulos.push_back(glm::vec3(model * glm::vec4(v[0], v[1], v[2], 1.0f)));
+        }
+    }
+
+    // Parâmetros de PrepareNavMesh() em main.cpp
+    NavMeshParams params;
+    params.min          = glm::vec3(-40.0f, CHAO - 1.0f, -40.0f);
+    params.max          = glm::vec3( 40.0f, CHAO + 5.0f,  40.0f);
+    params.cell_size    = 0.3f;
+    params.cell_height  = 0.1f;
+    params.agent_height = 1.8f;
+    params.agent_radius = 0.4f;
+    params.agent_climb  = 0.4f;
+    params.max_slope    = 45.0f;
+
+    glm::vec3 a(params.min.x, CHAO, params.min.z), b(params.max.x, CHAO, params.min.z);
+    glm::vec3 c(params.max.x, CHAO, params.max.z), d(params.min.x, CHAO, params.max.z);
+    const glm::vec3 plano[6] = { a, c, b, a, d, c };
+    triangulos.insert(triangulos.end(), plano, plano + 6);
+
+    NavMesh_Build(&m->navmesh, params, triangulos.data(), triangulos.size());
+    FlowField_Build(&m->campo, m->navmesh);
+}
+
+static void CriaEstatuas(Mundo* m, StatueAI* ai, std::vector<int>* nos, const std::vector<glm::vec3>& centros)
+{
+    int raiz = SceneGraph_Add(&m->cena, -1, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    for (size_t i = 0; i < centros.size(); ++i)
+    {
+        const glm::vec3& centro = centros[i];
+        glm::vec3 fuga = glm::normalize(glm::vec3(Aleatorio(-1.0f, 1.0f), 0.0f, Aleatorio(-1.0f, 1.0f)) + glm::vec3(0.01f, 0.0f, 0.0f));
+        glm::vec3 path[4] = { centro, centro + 2.0f * fuga, centro + 4.0f * fuga + glm::vec3(0.0f, 1.0f, 0.0f), centro + 6.0f * fuga };
+        StatueAI_Add(ai, glm::vec4(centro, 1.0f), path, -1);
+        nos->push_back(SceneGraph_Add(&m->cena, raiz, centro, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.9f, 0.5f)));
+    }
+}
+
+// O jogador dá voltas em torno da origem, olhando para fora, e as estátuas
+// que ele observa por STATUEAI_WATCH_TIME segundos fogem
+static glm::vec4 Olho(int quadro)
+{
+    float angulo = 0.03f * quadro * PASSO;
+    return glm::vec4(10.0f * std::cos(angulo), CHAO + 1.7f, 10.0f * std::sin(angulo), 1.0f);
+}
+
+static glm::vec4 Visao(int quadro)
+{
+    float angulo = 0.03f * quadro * PASSO + 0.3f;
+    return glm::vec4(std::cos(angulo), 0.0f, std::sin(angulo), 0.0f);
+}
+
+// As estátuas de um grupo em um passo, como em SimulationStep(). Cada grupo
+// tem o seu orçamento de raios.
+static void AtualizaEstatuas(Mundo* m, StatueAI* ai, const glm::vec4& olho, const glm::vec4& visao)
+{
+    LineOfSight_BeginStep();
+    StatueAI_UpdateLineOfSight(ai, 0, ai->count, olho, visao);
+    StatueAI_Update(ai, 0, ai->count, olho, visao, PASSO);
+    StatueAI_PlanEscapes(ai, &m->navmesh, &m->campo, 0, ai->count, olho);
+    StatueAI_Steer(ai, m->campo, 0, ai->count, PASSO);
+}
+
+// As estátuas que fugiram são reposicionadas a partir do centro calculado
+// pela IA
+static void MoveNos(Mundo* m, const StatueAI& ai, const std::vector<int>& nos)
+{
+    for (size_t i = 0; i < ai.count; ++i)
+        if (ai.desloc_x[i] != 0.0f || ai.desloc_y[i] != 0.0f || ai.desloc_z[i] != 0.0f)
+            SceneGraph_SetPosition(&m->cena, nos[i], glm::vec3(ai.centro_x[i], ai.centro_y[i], ai.centro_z[i]));
+}
+
+static void PublicaObjetos(Mundo* m, const StatueAI& ai, const std::vector<int>& nos, int object_id)
+{
+    for (size_t i = 0; i < ai.count; ++i)
+    {
+        Objeto objeto = { SceneGraph_World(m->cena, nos[i]), glm::vec3(ai.centro_x[i], ai.centro_y[i], ai.centro_z[i]), 1.0f, object_id };
+        m->estado_do_passo.objetos.push_back(objeto);
+    }
+}
+
+static void Passo(Mundo* m, const glm::vec4& olho, const glm::vec4& visao, double tempo)
+{
+    FlowField_Update(&m->campo, glm::vec3(olho), 4096);
+    AtualizaEstatuas(m, &m->muitas, olho, visao);
+    AtualizaEstatuas(m, &m->poucas, olho, visao);
+
+    MoveNos(m, m->muitas, m->nos_muitas);
+    MoveNos(m, m->poucas, m->nos_poucas);
+    SceneGraph_Update(&m->cena);
+
+    Estado& estado = m->estado_do_passo;
+    estado.objetos.clear();
+    estado.camera_position = olho;
+    PublicaObjetos(m, m->muitas, m->nos_muitas, 1);
+    PublicaObjetos(m, m->poucas, m->nos_poucas, 2);
+    for (size_t i = 0; i < m->paredes.size(); ++i)
+    {
+        Objeto parede = { m->paredes[i], glm::vec3(m->paredes[i][3]), 4.0f, 3 };
+        estado.objetos.push_back(parede);
+    }
+    m->estados.Publish(estado, tempo);
+}
+
+// Um quadro do laço de renderização, sem o OpenGL: lê os estados, monta a
+// lista de desenho e codifica os comandos.
+static void Quadro(Mundo* m, DrawList* lista, Estado* anterior, Estado* estado, const glm::vec4& visao)
+{
+    FrameArena_BeginFrame();
+
+    double tempo = 0.0;
+    m->estados.Read(anterior, estado, &tempo);
+
+    glm::vec3 olho(estado->camera_position);
+    glm::mat4 view       = glm::lookAt(olho, olho + glm::vec3(visao), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(3.141592f / 3.0f, 16.0f / 9.0f, 0.001f, 200.0f);
+
+    // Memória do quadro, como a usada pelos módulos de renderização
+    glm::mat4* matrizes = Arena_New<glm::mat4>(&g_FrameArena, estado->objetos.size());
+    for (size_t i = 0; i < estado->objetos.size(); ++i)
+        matrizes[i] = estado->objetos[i].model;
+
+    DrawList_Begin(lista);
+    RenderItem item = RenderItem();
+    item.passo       = RENDERPASS_OPACO;
+    item.vao         = 1;
+    item.num_indices = 6;
+    item.model       = glm::mat4(1.0f);
+    DrawList_Append(lista, item);
+
+    DrawListView vista;
+    Bounds_ExtractFrustum(&vista.frustum, projection * view);
+    vista.olho             = olho;
+    vista.distancia_maxima = 200.0f;
+    vista.tamanho_minimo   = 0.001f;
+    DrawList_Build(lista, vista, estado->objetos.size(),
+        [estado, matrizes](size_t i, RenderItem* item, glm::vec3* centro, float* raio)
+        {
+            const Objeto& objeto = estado->objetos[i];
+            *item = RenderItem();
+            item->passo          = RENDERPASS_OPACO;
+            item->object_id      = objeto.object_id;
+            item->vao            = 2 + objeto.object_id;
+            item->rendering_mode = 4;
+            item->num_indices    = 36;
+            item->model          = matrizes[i];
+            *centro = objeto.centro;
+            *raio   = objeto.raio;
+            return true;
+        });
+    DrawList_Finish(lista);
+}
+
+int main()
+{
+    TESTE_VERIFICA(AllocCounter_Enabled(), "contagem de alocações desligada (compile com ALLOC_COUNTER)");
+
+    std::srand(1);
+    Jobs_Init();
+    g_StatueAIParallelThreshold      = 256;
+    g_StatueAISteerParallelThreshold = 256;
+    g_SceneGraphParallelThreshold    = 256;
+    g_DrawListParallelThreshold      = 256;
+
+    Mundo* m = new Mundo;
+    CriaCenario(m);
+
+    // A multidão espalhada pelo chão, e as outras à frente do jogador em
+    // algum momento da volta, para que sejam observadas
+    std::vector<glm::vec3> centros;
+    for (int i = 0; i < ESTATUAS; ++i)
+        centros.push_back(glm::vec3(Aleatorio(-35.0f, 35.0f), CHAO + 0.9f, Aleatorio(-35.0f, 35.0f)));
+    CriaEstatuas(m, &m->muitas, &m->nos_muitas, centros);
+    centros.clear();
+    for (int i = 0; i < ESTATUAS_ROTAS; ++i)
+    {
+        int quadro = i * (QUADROS_INICIAIS + QUADROS / 2) / ESTATUAS_ROTAS;
+        centros.push_back(glm::vec3(Olho(quadro) + Aleatorio(4.0f, 8.0f) * Visao(quadro)) + glm::vec3(0.0f, -0.8f, 0.0f));
+    }
+    CriaEstatuas(m, &m->poucas, &m->nos_poucas, centros);
+    SceneGraph_Update(&m->cena);
+
+    DrawList lista;
+    Estado   anterior, estado;
+
+    unsigned long alocacoes_antes = 0, quadros_com_alocacao = 0, alocacoes = 0;
+    for (int quadro = 0; quadro < QUADROS_INICIAIS + QUADROS; ++quadro)
+    {
+        glm::vec4 olho  = Olho(quadro);
+        glm::vec4 visao = Visao(quadro);
+
+        if (quadro == QUADROS_INICIAIS)
+            alocacoes_antes = AllocCounter_Total();
+
+        unsigned long antes = AllocCounter_Total();
+        Passo(m, olho, visao, quadro * PASSO);
+        Quadro(m, &lista, &anterior, &estado, visao);
+        unsigned long deste_quadro = AllocCounter_Total() - antes;
+        if (quadro >= QUADROS_INICIAIS && deste_quadro > 0)
+        {
+            quadros_com_alocacao += 1;
+            alocacoes += deste_quadro;
+        }
+    }
+    unsigned long total = AllocCounter_Total() - alocacoes_antes;
+
+    size_t fugindo = 0, pelo_campo = 0, por_rotas = 0;
+    for (size_t i = 0; i < m->muitas.count; ++i)
+    {
+        fugindo    += m->muitas.visto[i] != 0;
+        pelo_campo += m->muitas.rota[i] == STATUEAI_ROTA_CAMPO;
+    }
+    for (size_t i = 0; i < m->poucas.count; ++i)
+        por_rotas += m->poucas.rota[i] < STATUEAI_ROTA_CAMPO;
+    DrawListStats desenho = DrawList_Stats();
+
+    printf("zeroalloc: %d quadros, %lu objetos, %lu estátuas fugindo (%lu pelo campo, %lu por rotas), %lu itens desenhados, %lu listas paralelas.\n",
+           QUADROS, (unsigned long)estado.objetos.size(), (unsigned long)(fugindo + por_rotas), (unsigned long)pelo_campo,
+           (unsigned long)por_rotas, desenho.items, desenho.parallel);
+    TESTE_VERIFICA(fugindo > 0 && por_rotas > 0, "nenhuma estátua fugiu: o teste não cobre o planejamento de fugas");
+    TESTE_VERIFICA(desenho.parallel > 0, "nenhuma lista de desenho montada em paralelo");
+    TESTE_VERIFICA(quadros_com_alocacao == 0 && total == 0, "%lu de %d quadros alocaram memória (%lu alocações)",
+                   quadros_com_alocacao, QUADROS, alocacoes);
+
+    Jobs_Shutdown();
+    delete m;
+    return Teste_Fim("zeroalloc_test");
+}